@@ -1,11 +1,11 @@
-QT       += core gui charts
+QT       += core gui charts svg concurrent sql
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 CONFIG += c++17
 
 # 头文件包含路径
-INCLUDEPATH += src/ledgermanager src/curveGraph
+INCLUDEPATH += src/ledgermanager src/curveGraph src/ledgerarchive src/ledgerstats src/reportrenderer src/integritychecker src/recomputeengine src/notepool src/darkstyle src/amountdelegate src/ledgerstorage src/historypager src/transactionledger src/statementimporter src/exchangerates src/quantilesketch src/ledgersnapshot src/taskscheduler src/projectionengine src/budgetrules src/ledgermerger
 
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
@@ -15,12 +15,62 @@ SOURCES += \
     main.cpp \
     mainwindow.cpp \
     src/ledgermanager/ledgermanager.cpp \
-    src/curveGraph/curveGraph.cpp
+    src/ledgermanager/ledgerrecord.cpp \
+    src/ledgerarchive/ledgerarchive.cpp \
+    src/ledgerstats/ledgerstats.cpp \
+    src/reportrenderer/reportrenderer.cpp \
+    src/integritychecker/integritychecker.cpp \
+    src/recomputeengine/recomputeengine.cpp \
+    src/notepool/notepool.cpp \
+    src/notepool/noteitem.cpp \
+    src/darkstyle/darkstyle.cpp \
+    src/amountdelegate/amountdelegate.cpp \
+    src/ledgerstorage/ledgerstorage.cpp \
+    src/ledgerstorage/csvledgerstorage.cpp \
+    src/ledgerstorage/sqliteledgerstorage.cpp \
+    src/historypager/historypager.cpp \
+    src/transactionledger/transactionledger.cpp \
+    src/statementimporter/statementimporter.cpp \
+    src/exchangerates/exchangerates.cpp \
+    src/quantilesketch/quantilesketch.cpp \
+    src/ledgersnapshot/ledgersnapshot.cpp \
+    src/taskscheduler/taskscheduler.cpp \
+    src/projectionengine/projectionengine.cpp \
+    src/budgetrules/budgetrules.cpp \
+    src/ledgermerger/ledgermerger.cpp \
+    src/curveGraph/curveGraph.cpp \
+    src/curveGraph/trendOverlay.cpp \
+    src/curveGraph/cachedChartView.cpp
 
 HEADERS += \
     mainwindow.h \
     src/ledgermanager/ledgermanager.h \
-    src/curveGraph/curveGraph.h
+    src/ledgermanager/ledgerrecord.h \
+    src/ledgerarchive/ledgerarchive.h \
+    src/ledgerstats/ledgerstats.h \
+    src/reportrenderer/reportrenderer.h \
+    src/integritychecker/integritychecker.h \
+    src/recomputeengine/recomputeengine.h \
+    src/notepool/notepool.h \
+    src/notepool/noteitem.h \
+    src/darkstyle/darkstyle.h \
+    src/amountdelegate/amountdelegate.h \
+    src/ledgerstorage/ledgerstorage.h \
+    src/ledgerstorage/csvledgerstorage.h \
+    src/ledgerstorage/sqliteledgerstorage.h \
+    src/historypager/historypager.h \
+    src/transactionledger/transactionledger.h \
+    src/statementimporter/statementimporter.h \
+    src/exchangerates/exchangerates.h \
+    src/quantilesketch/quantilesketch.h \
+    src/ledgersnapshot/ledgersnapshot.h \
+    src/taskscheduler/taskscheduler.h \
+    src/projectionengine/projectionengine.h \
+    src/budgetrules/budgetrules.h \
+    src/ledgermerger/ledgermerger.h \
+    src/curveGraph/curveGraph.h \
+    src/curveGraph/trendOverlay.h \
+    src/curveGraph/cachedChartView.h
 
 FORMS += \
     mainwindow.ui
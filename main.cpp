@@ -6,8 +6,81 @@
  * @Description: 
  */
 #include "mainwindow.h"
+#include "reportrenderer.h"
+#include "ledgermerger.h"
+#include "darkstyle.h"
 
 #include <QApplication>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QTimer>
+#include <QWidget>
+#include <QDebug>
+
+namespace {
+
+/**
+ * @brief 启动耗时报告：记录各阶段相对main()入口的时间，
+ *        并在主窗口第一次绘制完成后输出
+ */
+class StartupTimer : public QObject
+{
+public:
+    StartupTimer()
+    {
+        timer.start();
+    }
+    
+    /**
+     * @brief 记录一个启动阶段
+     * @param phase 阶段名称
+     */
+    void mark(const char *phase)
+    {
+        marks.append(qMakePair(QString::fromUtf8(phase), timer.elapsed()));
+    }
+    
+    /**
+     * @brief 监听窗口的第一次绘制事件
+     * @param window 主窗口
+     */
+    void watchFirstPaint(QWidget *window)
+    {
+        watched = window;
+        qApp->installEventFilter(this);
+    }
+    
+protected:
+    bool eventFilter(QObject *object, QEvent *event) override
+    {
+        if (event->type() == QEvent::Paint && object->isWidgetType()
+            && static_cast<QWidget*>(object)->window() == watched) {
+            qApp->removeEventFilter(this);
+            // 等本轮绘制结束后再报告
+            QTimer::singleShot(0, this, [this]() {
+                mark("首次绘制完成");
+                report();
+            });
+        }
+        return QObject::eventFilter(object, event);
+    }
+    
+private:
+    void report() const
+    {
+        qDebug() << "启动耗时报告(ms，相对main入口):";
+        for (const auto &phase : marks) {
+            qDebug().noquote() << "  " << phase.first << phase.second;
+        }
+    }
+    
+    QElapsedTimer timer;
+    QList<QPair<QString, qint64>> marks;
+    QWidget *watched = nullptr;
+};
+
+} // namespace
 
 /**
  * @brief 程序入口函数
@@ -17,196 +90,30 @@
  */
 int main(int argc, char *argv[])
 {
+    // 合并账本模式：纯文件处理，不需要图形平台
+    if (LedgerMerger::isRequested(argc, argv)) {
+        QCoreApplication a(argc, argv);
+        return LedgerMerger::runFromCommandLine(a.arguments());
+    }
+    
+    // 批量渲染模式：使用offscreen平台，不创建任何窗口
+    if (ReportRenderer::isRequested(argc, argv)) {
+        if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        }
+        QApplication a(argc, argv);
+        return ReportRenderer::runFromCommandLine(a.arguments());
+    }
+    
+    StartupTimer startupTimer;
     QApplication a(argc, argv);
-    // 设置全局样式表
-    QString styleSheet = R"(
-        /* 主窗口样式 */
-        QMainWindow {
-            background-color: #1a1a1a;
-            color: #ffffff;
-            font-family: "Microsoft YaHei", "Segoe UI", Arial, sans-serif;
-        }
-        
-        /* 标签页样式 */
-        QTabWidget {
-            background-color: #2a2a2a;
-            color: #ffffff;
-            border: none;
-        }
-        
-        QTabBar {
-            background-color: #2a2a2a;
-        }
-        
-        QTabBar::tab {
-            background-color: #3a3a3a;
-            color: #cccccc;
-            padding: 12px 24px;
-            margin-right: 2px;
-            border-top-left-radius: 8px;
-            border-top-right-radius: 8px;
-        }
-        
-        QTabBar::tab:selected {
-            background-color: #4a4a4a;
-            color: #ffffff;
-            font-weight: bold;
-        }
-        
-        QTabBar::tab:hover {
-            background-color: #404040;
-        }
-        
-        /* 表格样式 */
-        QTableView {
-            background-color: #2a2a2a;
-            color: #ffffff;
-            border: 1px solid #3a3a3a;
-            gridline-color: #3a3a3a;
-        }
-        
-        QTableView::header {
-            background-color: #3a3a3a;
-            color: #ffffff;
-            font-weight: bold;
-            border: none;
-        }
-        
-        QTableView::item {
-            background-color: #2a2a2a;
-            color: #ffffff;
-            border-bottom: 1px solid #3a3a3a;
-        }
-        
-        QTableView::item:selected {
-            background-color: #0078d7;
-            color: #ffffff;
-        }
-        
-        QTableView::item:hover {
-            background-color: #3a3a3a;
-        }
-        
-        /* 分组框样式 */
-        QGroupBox {
-            background-color: #2a2a2a;
-            color: #ffffff;
-            border: 1px solid #3a3a3a;
-            border-radius: 8px;
-            margin-top: 10px;
-        }
-        
-        QGroupBox::title {
-            color: #ffffff;
-            subcontrol-origin: margin;
-            left: 10px;
-            padding: 0 5px 0 5px;
-        }
-        
-        /* 输入控件样式 */
-        QLineEdit, QDoubleSpinBox, QDateEdit {
-            background-color: #3a3a3a;
-            color: #ffffff;
-            border: 1px solid #4a4a4a;
-            border-radius: 6px;
-            padding: 8px;
-        }
-        
-        QLineEdit:focus, QDoubleSpinBox:focus, QDateEdit:focus {
-            border: 1px solid #0078d7;
-            background-color: #404040;
-        }
-        
-        QDoubleSpinBox::up-button, QDoubleSpinBox::down-button {
-            background-color: #4a4a4a;
-            border: none;
-        }
-        
-        /* 按钮样式 */
-        QPushButton {
-            background-color: #0078d7;
-            color: #ffffff;
-            border: none;
-            border-radius: 6px;
-            padding: 10px 20px;
-            font-weight: bold;
-        }
-        
-        QPushButton:hover {
-            background-color: #106ebe;
-        }
-        
-        QPushButton:pressed {
-            background-color: #005a9e;
-        }
-        
-        /* 只读控件样式 */
-        QDoubleSpinBox:read-only {
-            background-color: #3a3a3a;
-            color: #888888;
-        }
-        
-        /* 标签样式 */
-        QLabel {
-            color: #ffffff;
-        }
-        
-        /* 状态栏样式 */
-        QStatusBar {
-            background-color: #2a2a2a;
-            color: #cccccc;
-        }
-            
-        /* 消息框样式 */
-        QMessageBox {
-            background-color: #2a2a2a;
-            color: #ffffff;
-        }
-        
-        QMessageBox QLabel {
-            color: #ffffff;
-        }
-        
-        QMessageBox QPushButton {
-            background-color: #0078d7;
-            color: #ffffff;
-            border: none;
-            border-radius: 4px;
-            padding: 5px 15px;
-        }
-        
-        QMessageBox QPushButton:hover {
-            background-color: #106ebe;
-        }
-        
-        QMessageBox QPushButton:pressed {
-            background-color: #005a9e;
-        }
-        
-        /* 对话框样式 */
-        QDialog {
-            background-color: #2a2a2a;
-            color: #ffffff;
-        }
-        
-        QDialog QLabel {
-            color: #ffffff;
-        }
-        
-        QDialog QPushButton {
-            background-color: #0078d7;
-            color: #ffffff;
-            border: none;
-            border-radius: 4px;
-            padding: 5px 15px;
-        }
-        
-        QDialog QPushButton:hover {
-            background-color: #106ebe;
-        }
-    )";
-    a.setStyleSheet(styleSheet);
+    startupTimer.mark("QApplication创建");
+    // 安装暗色主题：调色板加代理风格，不使用样式表
+    DarkStyle::apply(&a);
+    startupTimer.mark("主题应用");
     MainWindow w;
+    startupTimer.mark("主窗口构造");
+    startupTimer.watchFirstPaint(&w);
     w.show();
     return a.exec();
 }
\ No newline at end of file
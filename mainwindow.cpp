@@ -9,11 +9,41 @@
 #include "ui_mainwindow.h"
 #include "ledgermanager.h"
 #include "src/curveGraph/curveGraph.h"
+#include "cachedChartView.h"
+#include "ledgerstats.h"
+#include "integritychecker.h"
+#include "statementimporter.h"
+#include "taskscheduler.h"
+#include "projectionengine.h"
+#include "darkstyle.h"
 
 #include <QMessageBox>
 #include <QDir>
-// Include QtCharts headers
-#include <QtCharts/QChartView>
+#include <QFile>
+#include <QFileInfo>
+#include <QMenuBar>
+#include <QStatusBar>
+#include <QInputDialog>
+#include <QElapsedTimer>
+#include <QScrollBar>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QVBoxLayout>
+#include <QComboBox>
+#include <QLineEdit>
+#include <QDateEdit>
+#include <QTreeView>
+#include <QHeaderView>
+#include <QFileDialog>
+#include <QApplication>
+#include <QSpinBox>
+#include <QCheckBox>
+#include <QLabel>
+#include <QPlainTextEdit>
+#include <QDebug>
 
 /**
  * @brief 构造函数
@@ -23,7 +53,14 @@ MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
     , ledgerManager(new LedgerManager(this))
-    , curveGraph(new CurveGraph(this))
+    , curveGraph(nullptr)
+    , chartView(nullptr)
+    , statsModel(new QStandardItemModel(this))
+    , currencyBox(nullptr)
+    , budgetAlertLabel(nullptr)
+    , unsavedLabel(nullptr)
+    , scheduler(new TaskScheduler(0, this))
+    , animationPointLimit(CurveGraph::DefaultAnimationPointLimit)
 {
     ui->setupUi(this);
     // 设置窗口标题
@@ -68,17 +105,24 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->fixedDepositSpinBox, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, &MainWindow::calculateAmounts);
     connect(ui->expenseSpinBox, QOverload<double>::of(&QDoubleSpinBox::valueChanged), this, &MainWindow::calculateAmounts);
     
+    // 记账月份有收支明细时，当月工资和开支由明细汇总得到
+    connect(ui->dateEdit, &QDateEdit::dateChanged, this, &MainWindow::applyTransactionRollup);
+    connect(ui->dateEdit, &QDateEdit::dateChanged, this, &MainWindow::calculateAmounts);
+    
     // 设置窗口打开时自动全屏显示
     this->showMaximized();
     
     // 初始化计算
     calculateAmounts();
+    applyTransactionRollup();
+    
+    // 图表在首次切换到图表标签页时才创建，启动路径只包含表格视图
     
-    // 初始化图表视图
-    curveGraph->initChartView(ui->chartView);
+    // 初始化菜单栏
+    initMenus();
     
-    // 初始加载数据
-    curveGraph->updateData(ledgerManager->getModel());
+    // 初始化统计面板
+    initStatisticsPanel();
     
     // 连接标签页切换信号
     connect(ui->tabWidget, &QTabWidget::currentChanged, this, &MainWindow::onTabChanged);
@@ -92,7 +136,10 @@ MainWindow::MainWindow(QWidget *parent)
  */
 MainWindow::~MainWindow()
 {
-    // 先删除curveGraph，确保它能正确处理chartView的引用
+    // 先停止后台任务并等待工作线程退出，之后不会再有回调
+    delete scheduler;
+    
+    // 再删除curveGraph，确保它能正确处理chartView的引用
     delete curveGraph;
     
     // 再删除ledgerManager
@@ -111,12 +158,42 @@ void MainWindow::initLedger()
     //excelFilePath = QDir::toNativeSeparators("H:/My_project/QT/Ledger/ledger.csv");
     excelFilePath = QDir::currentPath() + "/ledger.csv";
     
+    // 已迁移到SQLite数据库时优先使用数据库文件
+    const QString databasePath = QDir::currentPath() + "/ledger.db";
+    if (QFile::exists(databasePath)) {
+        excelFilePath = databasePath;
+    }
+    
+    // 窗口模式（内存受限的设备）：Ledger --resident-months N [--memory-limit-mb M]
+    // 图表动画：Ledger --animation-points N（数据点超过 N 时关闭动画，0 表示始终关闭）
+    QCommandLineParser parser;
+    QCommandLineOption monthsOption("resident-months", "常驻内存的最近月数", "months");
+    QCommandLineOption memoryOption("memory-limit-mb", "分页读入的历史记录的内存上限(MB)", "mb", "4");
+    QCommandLineOption animationOption("animation-points", "图表开启动画的数据点上限", "points",
+                                       QString::number(CurveGraph::DefaultAnimationPointLimit));
+    parser.addOption(monthsOption);
+    parser.addOption(memoryOption);
+    parser.addOption(animationOption);
+    parser.parse(QCoreApplication::arguments());
+    const int residentMonths = parser.value(monthsOption).toInt();
+    if (residentMonths > 0) {
+        ledgerManager->setResidentWindow(residentMonths, parser.value(memoryOption).toLongLong() * 1024 * 1024);
+    }
+    bool animationOk = false;
+    const int animationPoints = parser.value(animationOption).toInt(&animationOk);
+    if (animationOk && animationPoints >= 0) {
+        animationPointLimit = animationPoints;
+    }
+    
     // 加载数据
     ledgerManager->loadData(excelFilePath);
     
     // 使用LedgerManager初始化表格视图
     ledgerManager->initTableView(ui->tableView);
     
+    // 窗口模式下滚动到顶部时分页读入更早的记录，回到底部时释放
+    connect(ui->tableView->verticalScrollBar(), &QScrollBar::valueChanged, this, &MainWindow::onTableScrolled);
+    
     // 设置定期余额默认值为上一次记录的值（如果有）
     double previousFixedDeposit = ledgerManager->getPreviousFixedDeposit();
     if (previousFixedDeposit > 0) {
@@ -127,6 +204,36 @@ void MainWindow::initLedger()
     ledgerManager->configureUI(ui->monthlyDepositSpinBox, 
                              ui->disposableAmountSpinBox, 
                              ui->expenseSpinBox);
+    
+    // 币种选择放在备注后面，默认人民币；汇率表中出现过的币种也可选
+    currencyBox = new QComboBox(this);
+    currencyBox->setEditable(true);
+    QStringList currencies = {LedgerRecord::DefaultCurrency, "USD", "HKD"};
+    for (const QString &code : ledgerManager->getExchangeRates().currencies()) {
+        if (!currencies.contains(code)) {
+            currencies.append(code);
+        }
+    }
+    currencyBox->addItems(currencies);
+    ui->horizontalLayout_8->addWidget(new QLabel("币种：", this));
+    ui->horizontalLayout_8->addWidget(currencyBox);
+    connect(currencyBox, &QComboBox::currentTextChanged, this, &MainWindow::calculateAmounts);
+    
+    // 预算提醒放在表单最下方，没有触发的规则时隐藏
+    budgetAlertLabel = new QLabel(this);
+    // 只修改调色板，不给单个控件设置样式表
+    QPalette alertPalette = budgetAlertLabel->palette();
+    alertPalette.setColor(QPalette::WindowText, DarkStyle::Colors::warning());
+    budgetAlertLabel->setPalette(alertPalette);
+    budgetAlertLabel->setWordWrap(true);
+    budgetAlertLabel->hide();
+    ui->gridLayout->addWidget(budgetAlertLabel, 5, 0, 1, 2);
+    
+    // 新记录写入文件失败时常驻状态栏，直到重试成功
+    unsavedLabel = new QLabel("未保存：新记录尚未写入账本文件，再次点击保存重试", this);
+    unsavedLabel->setPalette(alertPalette);
+    unsavedLabel->hide();
+    statusBar()->addPermanentWidget(unsavedLabel);
 }
 
 /**
@@ -141,8 +248,10 @@ void MainWindow::calculateAmounts()
     double monthlyDeposit = 0.0;
     
     // 使用LedgerManager计算可支配额度
-    double disposableAmount = ledgerManager->calculateDisposableAmount(totalDeposit, fixedDeposit);
+    // 可支配额度按记账日期的汇率换算为报表币种
+    double disposableAmount = ledgerManager->calculateDisposableAmount(totalDeposit, fixedDeposit, currencyBox->currentText(), ui->dateEdit->date());
     ui->disposableAmountSpinBox->setValue(disposableAmount);
+    ui->disposableAmountSpinBox->setSuffix(" " + ledgerManager->reportingCurrency());
     
     // 检查是否有上一次记录
     if (ledgerManager->isFirstRecord()) {
@@ -150,13 +259,54 @@ void MainWindow::calculateAmounts()
         monthlyDeposit = salary - expenseSpinBox;
         ui->monthlyDepositSpinBox->setValue(monthlyDeposit);
     } else {
-        // 使用LedgerManager自动计算金额
-        ledgerManager->calculateAmounts(totalDeposit, salary, expenseSpinBox, monthlyDeposit, true);
-        
-        // 更新控件值
-        ui->expenseSpinBox->setValue(expenseSpinBox);
-        ui->monthlyDepositSpinBox->setValue(monthlyDeposit);
+        // 使用LedgerManager自动计算金额，上一次总存款按记账日期的汇率换算为当前币种
+        if (!ledgerManager->calculateAmounts(totalDeposit, salary, expenseSpinBox, monthlyDeposit, true,
+                                             currencyBox->currentText(), ui->dateEdit->date())) {
+            statusBar()->showMessage(QString("缺少上一次记录的币种到 %1 的汇率，无法计算当月开支").arg(currencyBox->currentText()), 5000);
+        } else {
+            // 更新控件值
+            ui->expenseSpinBox->setValue(expenseSpinBox);
+            ui->monthlyDepositSpinBox->setValue(monthlyDeposit);
+        }
+    }
+    
+    updateBudgetAlerts();
+}
+
+/**
+ * @brief 用表单中待录入的记录检查预算规则，刷新提醒
+ */
+void MainWindow::updateBudgetAlerts()
+{
+    if (!budgetAlertLabel) {
+        return;
+    }
+    const double totalDeposit = ui->totalDepositSpinBox->value();
+    if (qFuzzyIsNull(totalDeposit)) {
+        budgetAlertLabel->hide();
+        return;
+    }
+    
+    // 与入账时相同，可支配额度按记录币种计算，由规则统一换算到报表币种
+    LedgerRecord candidate;
+    candidate.date = ui->dateEdit->date();
+    candidate.currency = LedgerRecord::normalizeCurrency(currencyBox->currentText());
+    const double values[LedgerAmountColumnCount] = {
+        totalDeposit,
+        ui->salarySpinBox->value(),
+        ui->fixedDepositSpinBox->value(),
+        ui->expenseSpinBox->value(),
+        ui->monthlyDepositSpinBox->value(),
+        totalDeposit - ui->fixedDepositSpinBox->value()
+    };
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        candidate.amounts[i] = qRound64(values[i] * 100.0);
+        candidate.presentMask |= quint8(1u << i);
     }
+    
+    const QStringList alerts = ledgerManager->checkBudgetRules(candidate);
+    budgetAlertLabel->setText("预算提醒：" + alerts.join("；"));
+    budgetAlertLabel->setVisible(!alerts.isEmpty());
 }
 
 /**
@@ -164,35 +314,68 @@ void MainWindow::calculateAmounts()
  */
 void MainWindow::on_saveButton_clicked()
 {
-    // 获取当前数据
-    QDate date = ui->dateEdit->date();
-    double totalDeposit = ui->totalDepositSpinBox->value();
-    double salary = ui->salarySpinBox->value();
-    double fixedDeposit = ui->fixedDepositSpinBox->value();
-    double expense = ui->expenseSpinBox->value();
-    double monthlyDeposit = ui->monthlyDepositSpinBox->value();
-    QString note = ui->noteLineEdit->text();
-    
-    // 添加记录到账本
-    if (ledgerManager->addRecord(date, totalDeposit, salary, fixedDeposit, expense, monthlyDeposit, note)) {
-        // 保存数据
-        ledgerManager->saveData(excelFilePath);
-        
-        // 调整列宽
-        ui->tableView->resizeColumnsToContents();
-        
-        // 重新设置列宽调整模式为拉伸，确保表头不会左缩进
-        ui->tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
-        
-        // 清空输入框，但保留定期余额为当前值
-        ui->totalDepositSpinBox->setValue(0);
-        ui->salarySpinBox->setValue(0);
-        ui->expenseSpinBox->setValue(0);
-        ui->noteLineEdit->clear();
+    QStandardItemModel *model = ledgerManager->getModel();
+    const int previousRowCount = model->rowCount();
+    
+    // 上一次写入失败的记录已在表格中，只重试写入，不重复添加
+    if (!ledgerManager->hasUnsavedRecords()) {
+        // 获取当前数据
+        QDate date = ui->dateEdit->date();
+        double totalDeposit = ui->totalDepositSpinBox->value();
+        double salary = ui->salarySpinBox->value();
+        double fixedDeposit = ui->fixedDepositSpinBox->value();
+        double expense = ui->expenseSpinBox->value();
+        double monthlyDeposit = ui->monthlyDepositSpinBox->value();
+        QString note = ui->noteLineEdit->text();
         
-        // 重新计算，确保状态正确
-        calculateAmounts();
+        // 添加记录到账本
+        if (!ledgerManager->addRecord(date, totalDeposit, salary, fixedDeposit, expense, monthlyDeposit, note, currencyBox->currentText())) {
+            return;
+        }
+    }
+    
+    // 只把新记录追加到文件末尾；期间其它程序追加的记录会先合并进来
+    // 写入失败时保留表单内容并显示"未保存"，不更新图表
+    const bool saved = ledgerManager->appendNewRecords();
+    updateSaveState();
+    if (!saved) {
+        return;
+    }
+    
+    // 新记录只需增量追加到图表，无需全量重建；图表尚未创建时首次显示会全量构建
+    if (curveGraph) {
+        if (model->rowCount() == previousRowCount + 1 && !curveGraph->isUpdating()) {
+            const int last = model->rowCount() - 1;
+            curveGraph->appendRecord(LedgerRecord::fromModelRow(model, last), ledgerManager->conversionFactor(last));
+            curveGraph->setDataVersion(ledgerManager->dataVersion());
+        } else {
+            // 合并了其它程序追加的记录、重试了上一次未保存的记录，或上一次异步更新尚未完成
+            refreshChart();
+        }
     }
+    
+    // 调整列宽
+    ui->tableView->resizeColumnsToContents();
+    
+    // 重新设置列宽调整模式为拉伸，确保表头不会左缩进
+    ui->tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    
+    // 清空输入框，但保留定期余额为当前值
+    ui->totalDepositSpinBox->setValue(0);
+    ui->salarySpinBox->setValue(0);
+    ui->expenseSpinBox->setValue(0);
+    ui->noteLineEdit->clear();
+    
+    // 重新计算，确保状态正确
+    calculateAmounts();
+}
+
+/**
+ * @brief 按是否有尚未写入文件的新记录显示或隐藏"未保存"提示
+ */
+void MainWindow::updateSaveState()
+{
+    unsavedLabel->setVisible(ledgerManager->hasUnsavedRecords());
 }
 
 /**
@@ -202,7 +385,771 @@ void MainWindow::on_saveButton_clicked()
 void MainWindow::onTabChanged(int index)
 {
     if (index == 1) { // 图表标签页
-        // 更新图表数据
-        curveGraph->updateData(ledgerManager->getModel());
+        // 数据版本未变化时不重建，视图直接贴出离屏缓存
+        ensureCurveGraph();
+        refreshChart();
+    } else if (index == 2) { // 统计标签页
+        updateStatistics();
+    }
+}
+
+/**
+ * @brief 获取图表管理器，首次调用时才创建QtCharts对象和图表视图
+ * @return 返回图表管理器指针
+ */
+CurveGraph *MainWindow::ensureCurveGraph()
+{
+    if (curveGraph) {
+        return curveGraph;
+    }
+    
+    QElapsedTimer timer;
+    timer.start();
+    
+    curveGraph = new CurveGraph(this);
+    chartView = new CachedChartView(ui->tabChart);
+    ui->verticalLayout_3->addWidget(chartView);
+    curveGraph->initChartView(chartView);
+    curveGraph->setScheduler(scheduler);
+    curveGraph->setAnimationPointLimit(animationPointLimit);
+    refreshChart();
+    
+    qDebug() << "图表子系统初始化耗时(ms):" << timer.elapsed();
+    return curveGraph;
+}
+
+/**
+ * @brief 按报表币种的换算系数刷新图表，数据版本未变化时不重建
+ * 曲线数据在工作线程中由只读快照计算，GUI线程只负责替换曲线
+ */
+void MainWindow::refreshChart()
+{
+    if (!curveGraph) {
+        return;
+    }
+    curveGraph->setConversionFactors(ledgerManager->conversionFactors());
+    curveGraph->updateDataAsync(ledgerManager->snapshot());
+}
+
+/**
+ * @brief 初始化菜单栏
+ */
+void MainWindow::initMenus()
+{
+    QMenu *dataMenu = ui->menubar->addMenu("数据");
+    QAction *archiveAction = dataMenu->addAction("归档往年记录");
+    connect(archiveAction, &QAction::triggered, this, &MainWindow::onArchiveHistory);
+    QAction *checkAction = dataMenu->addAction("校验账本完整性");
+    connect(checkAction, &QAction::triggered, this, &MainWindow::onCheckIntegrity);
+    QAction *storageAction = dataMenu->addAction("切换存储格式(CSV/SQLite)");
+    connect(storageAction, &QAction::triggered, this, &MainWindow::onSwitchStorage);
+    QAction *ratesAction = dataMenu->addAction("导入汇率表...");
+    connect(ratesAction, &QAction::triggered, this, &MainWindow::onImportExchangeRates);
+    QAction *currencyAction = dataMenu->addAction("报表币种...");
+    connect(currencyAction, &QAction::triggered, this, &MainWindow::onSetReportingCurrency);
+    QAction *budgetAction = dataMenu->addAction("预算规则...");
+    connect(budgetAction, &QAction::triggered, this, &MainWindow::onEditBudgetRules);
+    
+    QMenu *transactionMenu = ui->menubar->addMenu("明细");
+    QAction *addTransactionAction = transactionMenu->addAction("记一笔收支...");
+    connect(addTransactionAction, &QAction::triggered, this, &MainWindow::onAddTransaction);
+    QAction *importAction = transactionMenu->addAction("导入银行流水...");
+    connect(importAction, &QAction::triggered, this, &MainWindow::onImportStatement);
+    QAction *rollupAction = transactionMenu->addAction("收支汇总...");
+    connect(rollupAction, &QAction::triggered, this, &MainWindow::onShowTransactionRollup);
+    QAction *quantileAction = transactionMenu->addAction("开支分位数...");
+    connect(quantileAction, &QAction::triggered, this, &MainWindow::onShowExpenseQuantiles);
+    
+    QMenu *chartMenu = ui->menubar->addMenu("图表");
+    const QList<QPair<QString, CurveGraph::Overlay>> overlays = {
+        {"简单移动平均线", CurveGraph::SimpleAverageOverlay},
+        {"指数移动平均线", CurveGraph::ExponentialAverageOverlay},
+        {"趋势线", CurveGraph::TrendLineOverlay}
+    };
+    for (const auto &overlay : overlays) {
+        QAction *action = chartMenu->addAction(overlay.first);
+        action->setCheckable(true);
+        CurveGraph::Overlay type = overlay.second;
+        connect(action, &QAction::toggled, this, [this, type](bool checked) {
+            ensureCurveGraph()->setOverlayVisible(type, checked);
+        });
+    }
+    chartMenu->addSeparator();
+    
+    // 金额列曲线选择，切换显示不会重新遍历数据
+    QMenu *seriesMenu = chartMenu->addMenu("数据序列");
+    QStandardItemModel *model = ledgerManager->getModel();
+    for (int column = ColTotalDeposit; column <= ColDisposable; ++column) {
+        QAction *action = seriesMenu->addAction(model->headerData(column, Qt::Horizontal).toString());
+        action->setCheckable(true);
+        action->setChecked(CurveGraph::isSeriesVisibleByDefault(column));
+        connect(action, &QAction::toggled, this, [this, column](bool checked) {
+            ensureCurveGraph()->setSeriesVisible(column, checked);
+        });
+    }
+    chartMenu->addSeparator();
+    QAction *windowAction = chartMenu->addAction("设置移动平均月数...");
+    connect(windowAction, &QAction::triggered, this, &MainWindow::onSetMovingAverageWindow);
+    chartMenu->addSeparator();
+    QAction *projectionAction = chartMenu->addAction("储蓄预测...");
+    connect(projectionAction, &QAction::triggered, this, &MainWindow::onRunProjection);
+    QAction *clearProjectionAction = chartMenu->addAction("清除储蓄预测");
+    connect(clearProjectionAction, &QAction::triggered, this, &MainWindow::onClearProjection);
+}
+
+/**
+ * @brief 归档历史记录菜单事件处理函数
+ */
+void MainWindow::onArchiveHistory()
+{
+    // 往年的月份均已结账，归档到今年1月1日之前
+    QDate cutoff(QDate::currentDate().year(), 1, 1);
+    if (!ledgerManager->confirmOperation("确认", QString("将 %1 之前的记录移入压缩归档？").arg(cutoff.toString("yyyy/MM/dd")))) {
+        return;
+    }
+    
+    int archived = ledgerManager->archiveHistory(cutoff);
+    if (archived > 0) {
+        statusBar()->showMessage(QString("已归档 %1 条记录").arg(archived), 5000);
+    } else if (archived == 0) {
+        statusBar()->showMessage("没有需要归档的记录", 5000);
+    }
+}
+
+/**
+ * @brief 切换存储格式菜单事件处理函数：CSV与SQLite之间一次性迁移
+ */
+void MainWindow::onSwitchStorage()
+{
+    const bool toDatabase = LedgerStorage::backendForPath(excelFilePath) == LedgerStorage::CsvBackend;
+    QFileInfo info(excelFilePath);
+    const QString targetPath = info.absolutePath() + "/" + info.completeBaseName() + (toDatabase ? ".db" : ".csv");
+    const QString message = toDatabase ? "将账本迁移到SQLite数据库 %1 ？" : "将账本迁移回CSV文件 %1 ？";
+    if (!ledgerManager->confirmOperation("确认", message.arg(QDir::toNativeSeparators(targetPath)))) {
+        return;
+    }
+    
+    const QString sourcePath = excelFilePath;
+    if (!ledgerManager->migrateStorage(targetPath)) {
+        return;
+    }
+    excelFilePath = targetPath;
+    
+    // 启动时优先使用数据库文件，切回CSV后把数据库改名备份
+    if (!toDatabase) {
+        QFile::remove(sourcePath + ".bak");
+        QFile::rename(sourcePath, sourcePath + ".bak");
     }
-}
\ No newline at end of file
+    
+    ui->tableView->resizeColumnsToContents();
+    ui->tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    refreshChart();
+    updateSaveState();
+    statusBar()->showMessage(QString("当前存储：%1").arg(QDir::toNativeSeparators(excelFilePath)), 5000);
+}
+
+/**
+ * @brief 导入汇率表菜单事件处理函数
+ */
+void MainWindow::onImportExchangeRates()
+{
+    const QString path = QFileDialog::getOpenFileName(this, "导入汇率表", QDir::currentPath(), "CSV 文件 (*.csv *.txt);;所有文件 (*)");
+    if (path.isEmpty()) {
+        return;
+    }
+    
+    const int imported = ledgerManager->importExchangeRates(path);
+    if (imported < 0) {
+        QMessageBox::warning(this, "导入汇率表", "无法读取汇率文件！");
+        return;
+    }
+    
+    for (const QString &code : ledgerManager->getExchangeRates().currencies()) {
+        if (currencyBox->findText(code) < 0) {
+            currencyBox->addItem(code);
+        }
+    }
+    refreshCurrencyViews();
+    QMessageBox::information(this, "导入汇率表", QString("已导入 %1 条汇率。").arg(imported));
+}
+
+/**
+ * @brief 设置报表币种菜单事件处理函数
+ */
+void MainWindow::onSetReportingCurrency()
+{
+    QStringList currencies = ledgerManager->getExchangeRates().currencies();
+    if (!currencies.contains(LedgerRecord::DefaultCurrency)) {
+        currencies.prepend(LedgerRecord::DefaultCurrency);
+    }
+    bool ok = false;
+    const QString currency = QInputDialog::getItem(this, "报表币种", "统计、图表和可支配额度换算为：",
+                                                   currencies, qMax(0, currencies.indexOf(ledgerManager->reportingCurrency())), true, &ok);
+    if (!ok) {
+        return;
+    }
+    
+    bool valid = false;
+    const QString code = LedgerRecord::normalizeCurrency(currency, &valid);
+    if (!valid) {
+        QMessageBox::warning(this, "报表币种", "币种须为3位字母代码（如 USD、HKD）！");
+        return;
+    }
+    ledgerManager->setReportingCurrency(code.isEmpty() ? QString(LedgerRecord::DefaultCurrency) : code);
+    refreshCurrencyViews();
+}
+
+/**
+ * @brief 汇率或报表币种变化后刷新可支配额度、图表和统计面板
+ */
+void MainWindow::refreshCurrencyViews()
+{
+    calculateAmounts();
+    refreshChart();
+    if (ui->tabWidget->currentIndex() == 2) {
+        updateStatistics();
+    }
+    const int missing = ledgerManager->missingRateRows();
+    if (missing > 0) {
+        statusBar()->showMessage(QString("%1 条记录缺少到 %2 的汇率，图表和统计中未计入").arg(missing).arg(ledgerManager->reportingCurrency()), 5000);
+    }
+}
+
+/**
+ * @brief 记一笔收支明细菜单事件处理函数
+ */
+void MainWindow::onAddTransaction()
+{
+    TransactionLedger &transactions = ledgerManager->getTransactions();
+    
+    QDialog dialog(this);
+    dialog.setWindowTitle("记一笔收支");
+    QFormLayout *form = new QFormLayout(&dialog);
+    QDateEdit *dateEdit = new QDateEdit(QDate::currentDate(), &dialog);
+    dateEdit->setDisplayFormat("yyyy/MM/dd");
+    dateEdit->setCalendarPopup(true);
+    QComboBox *kindBox = new QComboBox(&dialog);
+    kindBox->addItems({"支出", "收入"});
+    QComboBox *categoryBox = new QComboBox(&dialog);
+    categoryBox->setEditable(true);
+    categoryBox->addItems(transactions.categories());
+    categoryBox->setCurrentText(QString());
+    QDoubleSpinBox *amountBox = new QDoubleSpinBox(&dialog);
+    amountBox->setRange(0.01, 999999999.99);
+    amountBox->setDecimals(2);
+    QLineEdit *noteEdit = new QLineEdit(&dialog);
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    form->addRow("日期", dateEdit);
+    form->addRow("类型", kindBox);
+    form->addRow("分类", categoryBox);
+    form->addRow("金额", amountBox);
+    form->addRow("备注", noteEdit);
+    form->addRow(buttons);
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+    
+    const QString category = categoryBox->currentText().trimmed();
+    if (category.isEmpty()) {
+        ledgerManager->showError("数据验证失败", "请填写分类！");
+        return;
+    }
+    bool ok = false;
+    qint64 cents = LedgerRecord::parseCents(QString::number(amountBox->value(), 'f', 2), &ok);
+    if (kindBox->currentIndex() == 0) {
+        cents = -cents;
+    }
+    if (!ok || !transactions.add(dateEdit->date(), category, cents, noteEdit->text())) {
+        ledgerManager->showError("错误", "无法保存收支明细！");
+        return;
+    }
+    
+    const QDate month = ui->dateEdit->date();
+    if (dateEdit->date().year() == month.year() && dateEdit->date().month() == month.month()) {
+        applyTransactionRollup();
+    }
+    statusBar()->showMessage(QString("已记录：%1 %2 %3").arg(kindBox->currentText(), category, LedgerRecord::formatCents(qAbs(cents))), 3000);
+}
+
+/**
+ * @brief 导入银行流水菜单事件处理函数：选择文件、设置列映射后流式导入并去重
+ */
+void MainWindow::onImportStatement()
+{
+    const QString filePath = QFileDialog::getOpenFileName(this, "选择银行流水", QDir::currentPath(), "CSV文件 (*.csv *.txt);;所有文件 (*)");
+    if (filePath.isEmpty()) {
+        return;
+    }
+    
+    // 列号从1开始显示，0表示没有该列
+    StatementImporter::ColumnMapping mapping;
+    QDialog dialog(this);
+    dialog.setWindowTitle("流水列映射");
+    QFormLayout *form = new QFormLayout(&dialog);
+    auto addColumnBox = [&](const QString &label, int column) {
+        QSpinBox *box = new QSpinBox(&dialog);
+        box->setRange(0, 64);
+        box->setSpecialValueText("无");
+        box->setValue(column + 1);
+        form->addRow(label, box);
+        return box;
+    };
+    QSpinBox *dateBox = addColumnBox("日期列", mapping.dateColumn);
+    QSpinBox *amountBox = addColumnBox("金额列（带符号）", mapping.amountColumn);
+    QSpinBox *debitBox = addColumnBox("支出列", mapping.debitColumn);
+    QSpinBox *creditBox = addColumnBox("收入列", mapping.creditColumn);
+    QSpinBox *descriptionBox = addColumnBox("摘要列", mapping.descriptionColumn);
+    QSpinBox *categoryBox = addColumnBox("分类列", mapping.categoryColumn);
+    QSpinBox *headerBox = new QSpinBox(&dialog);
+    headerBox->setRange(0, 100);
+    headerBox->setValue(mapping.headerLines);
+    form->addRow("表头行数", headerBox);
+    QLineEdit *separatorEdit = new QLineEdit(mapping.separator, &dialog);
+    separatorEdit->setMaxLength(1);
+    form->addRow("分隔符", separatorEdit);
+    QLineEdit *dateFormatEdit = new QLineEdit(&dialog);
+    dateFormatEdit->setPlaceholderText("自动识别，如 yyyyMMdd");
+    form->addRow("日期格式", dateFormatEdit);
+    QComboBox *encodingBox = new QComboBox(&dialog);
+    encodingBox->setEditable(true);
+    encodingBox->addItems({"UTF-8", "GB18030", "UTF-16LE"});
+    form->addRow("文件编码", encodingBox);
+    QCheckBox *negateBox = new QCheckBox("金额列中支出为正数", &dialog);
+    form->addRow(negateBox);
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    form->addRow(buttons);
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+    
+    mapping.dateColumn = dateBox->value() - 1;
+    mapping.amountColumn = amountBox->value() - 1;
+    mapping.debitColumn = debitBox->value() - 1;
+    mapping.creditColumn = creditBox->value() - 1;
+    mapping.descriptionColumn = descriptionBox->value() - 1;
+    mapping.categoryColumn = categoryBox->value() - 1;
+    mapping.headerLines = headerBox->value();
+    mapping.separator = separatorEdit->text().isEmpty() ? QChar(',') : separatorEdit->text().at(0);
+    mapping.dateFormat = dateFormatEdit->text().trimmed();
+    mapping.encoding = encodingBox->currentText().trimmed();
+    mapping.negateAmounts = negateBox->isChecked();
+    
+    QElapsedTimer timer;
+    timer.start();
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const StatementImporter::Result result = StatementImporter::importFile(filePath, mapping, ledgerManager->getTransactions());
+    QApplication::restoreOverrideCursor();
+    qDebug() << "导入银行流水耗时(ms):" << timer.elapsed() << "行数:" << result.lines;
+    
+    const QString summary = QString("读取 %1 行，新增 %2 笔，跳过重复 %3 笔，无法解析 %4 行")
+                                .arg(result.lines).arg(result.imported).arg(result.duplicates).arg(result.malformed);
+    if (!result.ok) {
+        ledgerManager->showError("导入失败", result.error + "\n" + summary);
+    } else {
+        ledgerManager->showSuccess("导入完成", summary);
+    }
+    if (result.imported > 0) {
+        applyTransactionRollup();
+    }
+}
+
+/**
+ * @brief 查看收支明细汇总菜单事件处理函数，按年 → 月 → 分类逐级展示
+ */
+void MainWindow::onShowTransactionRollup()
+{
+    const TransactionLedger &transactions = ledgerManager->getTransactions();
+    
+    QStandardItemModel rollupModel;
+    rollupModel.setHorizontalHeaderLabels({"年/月/分类", "收入", "支出", "结余", "笔数"});
+    auto makeRow = [](const QString &label, const TransactionLedger::Totals &totals) {
+        QList<QStandardItem*> items;
+        items << new QStandardItem(label);
+        items << new QStandardItem(LedgerRecord::formatCents(totals.income));
+        items << new QStandardItem(LedgerRecord::formatCents(totals.expense));
+        items << new QStandardItem(LedgerRecord::formatCents(totals.net()));
+        items << new QStandardItem(QString::number(totals.count));
+        for (QStandardItem *item : items) {
+            item->setEditable(false);
+        }
+        return items;
+    };
+    
+    // 每一级直接读取已维护好的汇总，不遍历明细
+    for (int year : transactions.years()) {
+        QList<QStandardItem*> yearRow = makeRow(QString("%1年").arg(year), transactions.yearTotals(year));
+        for (int month : transactions.months(year)) {
+            QList<QStandardItem*> monthRow = makeRow(QString("%1月").arg(month), transactions.monthTotals(year, month));
+            for (quint32 category : transactions.monthCategories(year, month)) {
+                monthRow.first()->appendRow(makeRow(transactions.categoryName(category),
+                                                    transactions.categoryTotals(year, month, category)));
+            }
+            yearRow.first()->appendRow(monthRow);
+        }
+        rollupModel.appendRow(yearRow);
+    }
+    
+    QDialog dialog(this);
+    dialog.setWindowTitle(QString("收支汇总（共 %1 笔）").arg(transactions.count()));
+    dialog.resize(640, 480);
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+    QTreeView *treeView = new QTreeView(&dialog);
+    treeView->setModel(&rollupModel);
+    treeView->setAlternatingRowColors(true);
+    treeView->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    layout->addWidget(treeView);
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Close, &dialog);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addWidget(buttons);
+    dialog.exec();
+}
+
+/**
+ * @brief 预算规则菜单事件处理函数
+ * 编辑规则文本，确定后重新编译并保存到账本同名的规则文件
+ */
+void MainWindow::onEditBudgetRules()
+{
+    QDialog dialog(this);
+    dialog.setWindowTitle("预算规则");
+    dialog.resize(560, 360);
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+    layout->addWidget(new QLabel("每行一条规则（名称: 表达式），# 开头的行为注释。录入新记录时触发的规则会显示在表单下方。", &dialog));
+    QPlainTextEdit *editor = new QPlainTextEdit(&dialog);
+    editor->setPlainText(ledgerManager->budgetRulesText());
+    layout->addWidget(editor);
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    layout->addWidget(buttons);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+    
+    QStringList errors;
+    const int count = ledgerManager->setBudgetRules(editor->toPlainText(), &errors);
+    if (!errors.isEmpty()) {
+        QMessageBox::warning(this, "预算规则", "以下规则无法编译，已忽略：\n" + errors.join("\n"));
+    }
+    statusBar()->showMessage(QString("已加载 %1 条预算规则").arg(count), 3000);
+    updateBudgetAlerts();
+}
+
+/**
+ * @brief 开支分位数菜单事件处理函数
+ * 月度记录按年、收支明细按分类读取已维护好的分位数草图，跨年汇总时合并草图
+ */
+void MainWindow::onShowExpenseQuantiles()
+{
+    QStandardItemModel quantileModel;
+    quantileModel.setHorizontalHeaderLabels({"年/分类", "记录数", "中位数", "P90", "P95", "高于P95的月份"});
+    auto makeRow = [](const QString &label, const QuantileSketch &sketch, const QString &outliers) {
+        QList<QStandardItem*> items;
+        items << new QStandardItem(label);
+        items << new QStandardItem(QString::number(sketch.count()));
+        items << new QStandardItem(QString::number(sketch.quantile(0.5), 'f', 2));
+        items << new QStandardItem(QString::number(sketch.quantile(0.9), 'f', 2));
+        items << new QStandardItem(QString::number(sketch.quantile(0.95), 'f', 2));
+        items << new QStandardItem(outliers);
+        for (QStandardItem *item : items) {
+            item->setEditable(false);
+        }
+        return items;
+    };
+    
+    // 月度记录的当月开支：每年一个草图，合计行由各年草图合并得到
+    QList<QStandardItem*> monthlyRow = makeRow(QString("当月开支（%1）").arg(ledgerManager->reportingCurrency()),
+                                               ledgerManager->mergedExpenseSketch(), QString());
+    for (int year : ledgerManager->expenseYears()) {
+        QStringList months;
+        for (const QDate &date : ledgerManager->monthsAboveExpenseQuantile(year, 0.95)) {
+            months << date.toString("M月");
+        }
+        monthlyRow.first()->appendRow(makeRow(QString("%1年").arg(year), ledgerManager->expenseSketch(year), months.join("、")));
+    }
+    quantileModel.appendRow(monthlyRow);
+    
+    // 收支明细的单笔支出：每个（年, 分类）一个草图
+    const TransactionLedger &transactions = ledgerManager->getTransactions();
+    QStandardItem *transactionRoot = new QStandardItem("单笔支出（收支明细）");
+    transactionRoot->setEditable(false);
+    const QList<int> years = transactions.years();
+    for (int category = 0; category < transactions.categories().size(); ++category) {
+        const QuantileSketch merged = transactions.categoryExpenseSketch(category);
+        if (merged.isEmpty()) {
+            continue;
+        }
+        QList<QStandardItem*> categoryRow = makeRow(transactions.categoryName(category), merged, QString());
+        for (int year : years) {
+            if (const QuantileSketch *sketch = transactions.expenseSketch(year, category)) {
+                categoryRow.first()->appendRow(makeRow(QString("%1年").arg(year), *sketch, QString()));
+            }
+        }
+        transactionRoot->appendRow(categoryRow);
+    }
+    quantileModel.appendRow(transactionRoot);
+    
+    QDialog dialog(this);
+    dialog.setWindowTitle("开支分位数");
+    dialog.resize(720, 480);
+    QVBoxLayout *layout = new QVBoxLayout(&dialog);
+    QTreeView *treeView = new QTreeView(&dialog);
+    treeView->setModel(&quantileModel);
+    treeView->setAlternatingRowColors(true);
+    treeView->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    treeView->expand(quantileModel.index(0, 0));
+    layout->addWidget(treeView);
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Close, &dialog);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addWidget(buttons);
+    dialog.exec();
+}
+
+/**
+ * @brief 所选月份有收支明细时，用月汇总填写当月工资和当前总存款金额
+ * 当前总存款金额 = 上一次总存款金额 + 收入合计 - 支出合计，
+ * 这样由存款差推算出的当月开支恰好等于明细中的支出合计
+ */
+void MainWindow::applyTransactionRollup()
+{
+    double income = 0.0;
+    double expense = 0.0;
+    if (!ledgerManager->deriveMonthFromTransactions(ui->dateEdit->date(), income, expense)) {
+        return;
+    }
+    
+    ui->salarySpinBox->setValue(income);
+    if (ledgerManager->isFirstRecord()) {
+        ui->expenseSpinBox->setValue(expense);
+    } else {
+        double previousTotalDeposit = 0.0;
+        if (!ledgerManager->getPreviousTotalDeposit(currencyBox->currentText(), ui->dateEdit->date(), previousTotalDeposit)) {
+            statusBar()->showMessage(QString("缺少上一次记录的币种到 %1 的汇率，未按收支明细填写").arg(currencyBox->currentText()), 5000);
+            return;
+        }
+        ui->totalDepositSpinBox->setValue(previousTotalDeposit + income - expense);
+    }
+    statusBar()->showMessage(QString("已按收支明细填写：收入 %1，支出 %2")
+                             .arg(QString::number(income, 'f', 2), QString::number(expense, 'f', 2)), 5000);
+}
+
+/**
+ * @brief 表格滚动事件处理函数，窗口模式下按需分页读取历史记录
+ * @param value 滚动条位置
+ */
+void MainWindow::onTableScrolled(int value)
+{
+    if (!ledgerManager->isWindowed()) {
+        return;
+    }
+    
+    QScrollBar *bar = ui->tableView->verticalScrollBar();
+    if (value == bar->minimum()) {
+        const int loaded = ledgerManager->pageInHistory();
+        if (loaded > 0) {
+            // 新记录插在顶部，保持原来的首行仍位于可见区域顶部
+            ui->tableView->scrollTo(ledgerManager->getModel()->index(loaded, 0), QAbstractItemView::PositionAtTop);
+            statusBar()->showMessage(QString("已载入 %1 条更早的记录").arg(loaded), 3000);
+        } else if (loaded < 0) {
+            statusBar()->showMessage("已达到历史记录的内存上限或账本已被修改，更早的记录未载入", 5000);
+        }
+    } else if (value == bar->maximum() && ledgerManager->pagedHistoryRows() > 0
+               && ui->tableView->rowAt(0) > ledgerManager->pagedHistoryRows()) {
+        // 分页记录已全部滚出可见区域才释放，避免刚读入就被释放
+        const int released = ledgerManager->pageOutHistory();
+        ui->tableView->scrollToBottom();
+        statusBar()->showMessage(QString("已释放 %1 条历史记录").arg(released), 3000);
+    }
+}
+
+/**
+ * @brief 校验账本完整性菜单事件处理函数
+ */
+void MainWindow::onCheckIntegrity()
+{
+    // 校验以后台优先级在工作线程中读取快照，期间可以继续记账；汇率表复制一份供工作线程使用
+    const LedgerSnapshotPtr snapshot = ledgerManager->snapshot();
+    const ExchangeRates rates = ledgerManager->getExchangeRates();
+    statusBar()->showMessage(QString("正在后台校验 %1 行...").arg(snapshot->rowCount()));
+    scheduler->submit("integrity", TaskScheduler::Background,
+                      [snapshot, rates](const TaskScheduler::CancellationToken &) {
+                          return IntegrityChecker::check(*snapshot, rates);
+                      },
+                      [this, snapshot](const IntegrityReport &report) {
+                          statusBar()->clearMessage();
+                          if (report.isClean()) {
+                              QMessageBox::information(this, "校验通过", report.summary());
+                              return;
+                          }
+                          
+                          // 定位到第一个问题所在的单元格（校验期间有修改时行号以快照为准）；
+                          // 快照中归档记录排在模型之前，问题位于归档记录中时无法定位
+                          QStandardItemModel *model = ledgerManager->getModel();
+                          const IntegrityIssue &first = report.issues.first();
+                          const int row = first.row - ledgerManager->archivedRowCount();
+                          QString summary = report.summary();
+                          if (row >= 0) {
+                              QModelIndex index = model->index(row, qMax(0, first.column));
+                              ui->tabWidget->setCurrentIndex(0);
+                              ui->tableView->setCurrentIndex(index);
+                              ui->tableView->scrollTo(index);
+                          } else {
+                              summary += "\n（第一个问题位于已归档的往年记录中）";
+                          }
+                          if (ledgerManager->dataVersion() != snapshot->version()) {
+                              summary += "\n（校验期间账本已被修改，行号以开始校验时为准）";
+                          }
+                          QMessageBox::warning(this, "校验发现问题", summary);
+                      });
+}
+
+/**
+ * @brief 设置移动平均月数菜单事件处理函数
+ */
+void MainWindow::onSetMovingAverageWindow()
+{
+    bool ok = false;
+    CurveGraph *graph = ensureCurveGraph();
+    int months = QInputDialog::getInt(this, "移动平均", "移动平均月数：", graph->movingAverageWindow(), 1, 120, 1, &ok);
+    if (ok) {
+        graph->setMovingAverageWindow(months);
+    }
+}
+
+/**
+ * @brief 储蓄预测菜单事件处理，在后台模拟后把扇形区间叠加到图表上
+ */
+void MainWindow::onRunProjection()
+{
+    bool ok = false;
+    const int years = QInputDialog::getInt(this, "储蓄预测", "预测年数：", 10, 1, 30, 1, &ok);
+    if (!ok) {
+        return;
+    }
+    
+    // 拟合与模拟都在工作线程中进行，以交互优先级先于图表重建执行；拟合完成后模拟按块拆成
+    // 同一键下的一批子任务，重复提交或清除时取消上一次模拟
+    const LedgerSnapshotPtr snapshot = ledgerManager->snapshot();
+    const QVector<double> factors = ledgerManager->conversionFactors();
+    const QString currency = ledgerManager->reportingCurrency();
+    const qint64 paths = 1000000;
+    statusBar()->showMessage(QString("正在模拟 %1 条存款路径...").arg(paths));
+    scheduler->submit("projection", TaskScheduler::Interactive,
+                      [snapshot, factors](const TaskScheduler::CancellationToken &) {
+                          return ProjectionEngine::fit(*snapshot, factors);
+                      },
+                      [this, years, paths, currency](const ProjectionEngine::Parameters &parameters) {
+                          if (!parameters.isValid()) {
+                              statusBar()->clearMessage();
+                              QMessageBox::information(this, "储蓄预测", "账本中没有可用于拟合的记录");
+                              return;
+                          }
+                          ProjectionEngine::submit(scheduler, "projection", TaskScheduler::Interactive, parameters,
+                                                   years, paths, 3, ProjectionEngine::DefaultSeed,
+                                                   [this, years, currency](const ProjectionEngine::Result &result) {
+                              statusBar()->clearMessage();
+                              if (result.isEmpty()) {
+                                  return;
+                              }
+                              ui->tabWidget->setCurrentIndex(1);
+                              ensureCurveGraph()->setProjection(result);
+
+                              const int last = result.dates.size() - 1;
+                              statusBar()->showMessage(
+                                  QString("储蓄预测：%1 条路径，耗时 %2 ms；%3 年后中位数 %4 %5，90%区间 %6 ~ %7")
+                                      .arg(result.paths).arg(result.elapsedMs).arg(years)
+                                      .arg(result.bands[ProjectionEngine::P50][last], 0, 'f', 0).arg(currency)
+                                      .arg(result.bands[ProjectionEngine::P5][last], 0, 'f', 0)
+                                      .arg(result.bands[ProjectionEngine::P95][last], 0, 'f', 0), 10000);
+                          });
+                      });
+}
+
+/**
+ * @brief 清除储蓄预测菜单事件处理
+ */
+void MainWindow::onClearProjection()
+{
+    scheduler->cancel("projection");
+    if (curveGraph) {
+        curveGraph->clearProjection();
+    }
+}
+
+/**
+ * @brief 初始化统计面板
+ */
+void MainWindow::initStatisticsPanel()
+{
+    statsModel->setHorizontalHeaderLabels({"统计项", "记录数", "最小值", "最大值", "合计", "平均值", "标准差"});
+    ui->statsTableView->setModel(statsModel);
+    ui->statsTableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    ui->statsTableView->verticalHeader()->setVisible(false);
+    ui->statsTableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+}
+
+/**
+ * @brief 刷新统计面板数据
+ */
+void MainWindow::updateStatistics()
+{
+    QStandardItemModel *model = ledgerManager->getModel();
+    QStringList labels;
+    for (int column = ColTotalDeposit; column <= ColDisposable; ++column) {
+        labels << QString("%1(%2)").arg(model->headerData(column, Qt::Horizontal).toString(), ledgerManager->reportingCurrency());
+    }
+    
+    // 统计在工作线程中读取快照，以交互优先级先于图表和后台任务执行
+    const LedgerSnapshotPtr snapshot = ledgerManager->snapshot();
+    const QVector<double> factors = ledgerManager->conversionFactors();
+    const int missing = ledgerManager->missingRateRows();
+    scheduler->submit("statistics", TaskScheduler::Interactive,
+                      [snapshot, factors](const TaskScheduler::CancellationToken &) {
+                          // 金额列：当前总存款金额 ~ 当月可支配额度，统一换算为报表币种后统计
+                          QVector<ColumnStats> result;
+                          for (int column = ColTotalDeposit; column <= ColDisposable; ++column) {
+                              QVector<double> values = snapshot->column(column);
+                              LedgerStats::multiply(values.constData(), factors.constData(), values.data(),
+                                                    qMin(values.size(), factors.size()));
+                              result.append(LedgerStats::compute(values));
+                          }
+                          return result;
+                      },
+                      [this, labels, missing](const QVector<ColumnStats> &result) {
+                          showStatistics(labels, result, missing);
+                      });
+}
+
+/**
+ * @brief 把统计结果填入统计面板
+ * @param labels 各金额列的统计项名称
+ * @param result 各金额列的统计结果
+ * @param missing 缺少汇率未计入的记录数
+ */
+void MainWindow::showStatistics(const QStringList &labels, const QVector<ColumnStats> &result, int missing)
+{
+    statsModel->removeRows(0, statsModel->rowCount());
+    for (int i = 0; i < result.size(); ++i) {
+        const ColumnStats &stats = result[i];
+        
+        QList<QStandardItem*> items;
+        items << new QStandardItem(labels.value(i));
+        items << new QStandardItem(QString::number(stats.count));
+        items << new QStandardItem(QString::number(stats.min, 'f', 2));
+        items << new QStandardItem(QString::number(stats.max, 'f', 2));
+        items << new QStandardItem(QString::number(stats.sum, 'f', 2));
+        items << new QStandardItem(QString::number(stats.mean, 'f', 2));
+        items << new QStandardItem(QString::number(stats.stddev(), 'f', 2));
+        statsModel->appendRow(items);
+    }
+    
+    if (missing > 0) {
+        statusBar()->showMessage(QString("统计内核：%1，%2 条记录缺少汇率未计入").arg(LedgerStats::kernelName()).arg(missing), 5000);
+    } else {
+        statusBar()->showMessage(QString("统计内核：%1").arg(LedgerStats::kernelName()), 3000);
+    }
+}
@@ -12,10 +12,10 @@ class MainWindow;
 }
 QT_END_NAMESPACE
 
-// Include QtCharts namespace
-namespace QtCharts {
-    class QChartView;
-}
+class CachedChartView;
+class QComboBox;
+class QLabel;
+class TaskScheduler;
 
 class MainWindow : public QMainWindow
 {
@@ -49,16 +49,147 @@ private slots:
      * @param index 当前标签页索引
      */
     void onTabChanged(int index);
+    
+    /**
+     * @brief 归档历史记录菜单事件处理
+     */
+    void onArchiveHistory();
+    
+    /**
+     * @brief 校验账本完整性菜单事件处理
+     */
+    void onCheckIntegrity();
+    
+    /**
+     * @brief 切换存储格式（CSV/SQLite）菜单事件处理
+     */
+    void onSwitchStorage();
+    
+    /**
+     * @brief 导入汇率表菜单事件处理
+     */
+    void onImportExchangeRates();
+    
+    /**
+     * @brief 设置报表币种菜单事件处理
+     */
+    void onSetReportingCurrency();
+    
+    /**
+     * @brief 记一笔收支明细菜单事件处理
+     */
+    void onAddTransaction();
+    
+    /**
+     * @brief 导入银行流水菜单事件处理
+     */
+    void onImportStatement();
+    
+    /**
+     * @brief 查看收支明细汇总菜单事件处理
+     */
+    void onShowTransactionRollup();
+    
+    /**
+     * @brief 查看开支分位数菜单事件处理
+     */
+    void onShowExpenseQuantiles();
+    
+    /**
+     * @brief 编辑预算规则菜单事件处理
+     */
+    void onEditBudgetRules();
+    
+    /**
+     * @brief 所选月份有收支明细时，用月汇总填写当月工资和当前总存款金额
+     */
+    void applyTransactionRollup();
+    
+    /**
+     * @brief 表格滚动事件处理，窗口模式下按需分页读取历史记录
+     * @param value 滚动条位置
+     */
+    void onTableScrolled(int value);
+    
+    /**
+     * @brief 设置移动平均月数菜单事件处理
+     */
+    void onSetMovingAverageWindow();
+    
+    /**
+     * @brief 储蓄预测菜单事件处理，在后台模拟后把扇形区间叠加到图表上
+     */
+    void onRunProjection();
+    
+    /**
+     * @brief 清除储蓄预测菜单事件处理
+     */
+    void onClearProjection();
 
 private:
     Ui::MainWindow *ui;                 //!< UI对象指针
     LedgerManager *ledgerManager;       //!< 账本管理器指针
-    CurveGraph *curveGraph;             //!< 图表管理器指针
+    CurveGraph *curveGraph;             //!< 图表管理器指针（首次显示图表时创建）
+    CachedChartView *chartView;         //!< 图表视图（首次显示图表时创建）
     QString excelFilePath;              //!< Excel文件路径
+    QStandardItemModel *statsModel;     //!< 统计面板数据模型
+    QComboBox *currencyBox;             //!< 新记录的币种选择
+    QLabel *budgetAlertLabel;           //!< 待录入记录触发的预算规则提醒
+    QLabel *unsavedLabel;               //!< 新记录写入文件失败时常驻状态栏的"未保存"提示
+    TaskScheduler *scheduler;           //!< 后台计算调度器（图表、统计、校验）
+    int animationPointLimit;            //!< 图表开启动画的数据点上限（--animation-points）
     
     /**
      * @brief 初始化账本
      */
     void initLedger();
+    
+    /**
+     * @brief 获取图表管理器，首次调用时才创建
+     */
+    CurveGraph *ensureCurveGraph();
+    
+    /**
+     * @brief 按报表币种的换算系数刷新图表
+     */
+    void refreshChart();
+    
+    /**
+     * @brief 汇率或报表币种变化后刷新可支配额度、图表和统计面板
+     */
+    void refreshCurrencyViews();
+    
+    /**
+     * @brief 用表单中待录入的记录检查预算规则，刷新提醒
+     */
+    void updateBudgetAlerts();
+    
+    /**
+     * @brief 按是否有尚未写入文件的新记录显示或隐藏"未保存"提示
+     */
+    void updateSaveState();
+    
+    /**
+     * @brief 初始化菜单栏
+     */
+    void initMenus();
+    
+    /**
+     * @brief 初始化统计面板
+     */
+    void initStatisticsPanel();
+    
+    /**
+     * @brief 刷新统计面板数据
+     */
+    void updateStatistics();
+    
+    /**
+     * @brief 把统计结果填入统计面板
+     * @param labels 各金额列的统计项名称
+     * @param result 各金额列的统计结果
+     * @param missing 缺少汇率未计入的记录数
+     */
+    void showStatistics(const QStringList &labels, const QVector<ColumnStats> &result, int missing);
 };
 #endif // MAINWINDOW_H
\ No newline at end of file
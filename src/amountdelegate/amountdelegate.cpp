@@ -0,0 +1,155 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 17:42:08
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 17:42:08
+ * @Description: 金额列的快速绘制代理
+ */
+#include "amountdelegate.h"
+#include "ledgerrecord.h"
+#include <QApplication>
+#include <QPainter>
+#include <QGlyphRun>
+#include <QStyle>
+#include <QtMath>
+
+namespace {
+
+const int TextMargin = 6;                   //!< 文本与单元格右边缘的间距
+const QColor NegativeColor("#e63946");      //!< 负数开支的颜色
+
+} // namespace
+
+/**
+ * @brief 构造函数
+ * @param parent 父对象指针
+ */
+AmountDelegate::AmountDelegate(QObject *parent)
+    : QStyledItemDelegate(parent)
+{
+}
+
+/**
+ * @brief 获取字体对应的字形缓存，字体变化时重建
+ * @param font 单元格字体
+ * @return 返回字形缓存，字体不可用时返回nullptr
+ */
+const AmountDelegate::GlyphTable *AmountDelegate::glyphTable(const QFont &font) const
+{
+    const QString key = font.key();
+    if (table.fontKey == key) {
+        return table.rawFont.isValid() ? &table : nullptr;
+    }
+
+    table.fontKey = key;
+    table.rawFont = QRawFont::fromFont(font);
+    if (!table.rawFont.isValid()) {
+        return nullptr;
+    }
+
+    QString ascii;
+    for (int ch = 0; ch < 128; ++ch) {
+        ascii.append(QChar(ch < 32 ? ' ' : ch));
+    }
+    const QVector<quint32> glyphs = table.rawFont.glyphIndexesForString(ascii);
+    const QVector<QPointF> advances = table.rawFont.advancesForGlyphIndexes(glyphs);
+    if (glyphs.size() != 128 || advances.size() != 128) {
+        table.rawFont = QRawFont();
+        return nullptr;
+    }
+
+    table.digitAdvance = 0;
+    for (int ch = 0; ch < 128; ++ch) {
+        table.glyphs[ch] = glyphs[ch];
+        table.advances[ch] = advances[ch].x();
+        if (ch >= '0' && ch <= '9') {
+            table.digitAdvance = qMax(table.digitAdvance, table.advances[ch]);
+        }
+    }
+    table.ascent = table.rawFont.ascent();
+    table.descent = table.rawFont.descent();
+    return &table;
+}
+
+/**
+ * @brief 把文本排成等宽数字的字形序列，结果写入复用缓冲区
+ * @param text 单元格文本
+ * @param cache 字形缓存
+ * @param width 输出总宽度
+ * @return 文本全部为可缓存的ASCII字符时返回true
+ */
+bool AmountDelegate::layoutText(const QString &text, const GlyphTable &cache, qreal &width) const
+{
+    glyphBuffer.resize(text.size());
+    positionBuffer.resize(text.size());
+
+    qreal x = 0;
+    for (qsizetype i = 0; i < text.size(); ++i) {
+        const ushort ch = text.at(i).unicode();
+        if (ch >= 128) {
+            return false;
+        }
+        const bool digit = ch >= '0' && ch <= '9';
+        const qreal cell = digit ? cache.digitAdvance : cache.advances[ch];
+        // 数字在等宽格内居中
+        glyphBuffer[i] = cache.glyphs[ch];
+        positionBuffer[i] = QPointF(x + (cell - cache.advances[ch]) / 2, 0);
+        x += cell;
+    }
+    width = x;
+    return true;
+}
+
+void AmountDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    QStyleOptionViewItem opt(option);
+    initStyleOption(&opt, index);
+
+    const GlyphTable *glyphs = glyphTable(opt.font);
+    qreal width = 0;
+    if (!glyphs || !layoutText(opt.text, *glyphs, width)) {
+        QStyledItemDelegate::paint(painter, option, index);
+        return;
+    }
+
+    // 背景、选中、焦点框仍交给风格绘制，只有文本由字形直接绘制
+    const QString text = opt.text;
+    opt.text.clear();
+    const QWidget *widget = opt.widget;
+    QStyle *style = widget ? widget->style() : QApplication::style();
+    style->drawControl(QStyle::CE_ItemViewItem, &opt, painter, widget);
+    if (text.isEmpty()) {
+        return;
+    }
+
+    const QRect textRect = style->subElementRect(QStyle::SE_ItemViewItemText, &opt, widget);
+    const qreal x = textRect.right() - TextMargin - width;
+    const qreal baseline = textRect.top() + (textRect.height() + glyphs->ascent - glyphs->descent) / 2;
+
+    QColor color = opt.palette.color(opt.state & QStyle::State_Selected ? QPalette::HighlightedText : QPalette::Text);
+    if (index.column() == ColExpense && text.startsWith('-')) {
+        color = NegativeColor;
+    }
+
+    QGlyphRun run;
+    run.setRawFont(glyphs->rawFont);
+    run.setGlyphIndexes(glyphBuffer);
+    run.setPositions(positionBuffer);
+
+    painter->save();
+    painter->setClipRect(textRect);
+    painter->setPen(color);
+    painter->drawGlyphRun(QPointF(x, baseline), run);
+    painter->restore();
+}
+
+QSize AmountDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    QSize size = QStyledItemDelegate::sizeHint(option, index);
+    const GlyphTable *glyphs = glyphTable(option.font);
+    qreal width = 0;
+    if (glyphs && layoutText(index.data(Qt::DisplayRole).toString(), *glyphs, width)) {
+        size.setWidth(qMax(size.width(), qCeil(width) + 2 * TextMargin));
+    }
+    return size;
+}
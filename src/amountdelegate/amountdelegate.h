@@ -0,0 +1,62 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 17:42:08
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 17:42:08
+ * @Description: 金额列的快速绘制代理
+ */
+#ifndef AMOUNTDELEGATE_H
+#define AMOUNTDELEGATE_H
+
+#include <QStyledItemDelegate>
+#include <QRawFont>
+#include <QVector>
+#include <QPointF>
+
+/*
+    QStyledItemDelegate 每次绘制单元格都会用 QTextLayout 重新排版文本。
+    金额单元格的文本已由 LedgerRecord::formatCents 预先格式化好，只包含
+    数字、小数点和负号，因此 AmountDelegate：
+    - 按字体缓存 ASCII 字符的字形索引与字宽（QRawFont），字体不变时不再查询；
+    - 数字统一使用最宽数字的字宽（等宽数字），各行小数点上下对齐；
+    - 右对齐后用一次 drawGlyphRun 画出整串字形，绕过文本排版；
+    - 当月开支为负数时以红色显示。
+    含非ASCII字符的文本回退到基类绘制。
+*/
+class AmountDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 构造函数
+     * @param parent 父对象指针
+     */
+    explicit AmountDelegate(QObject *parent = nullptr);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+private:
+    /**
+     * @brief 某一字体下 ASCII 字符的字形缓存
+     */
+    struct GlyphTable {
+        QString fontKey;                //!< QFont::key()，字体变化时重建
+        QRawFont rawFont;
+        quint32 glyphs[128];            //!< 字形索引
+        qreal advances[128];            //!< 字宽
+        qreal digitAdvance = 0;         //!< 等宽数字的字宽
+        qreal ascent = 0;
+        qreal descent = 0;
+    };
+
+    const GlyphTable *glyphTable(const QFont &font) const;
+    bool layoutText(const QString &text, const GlyphTable &cache, qreal &width) const;
+
+    mutable GlyphTable table;               //!< 当前字体的字形缓存
+    mutable QVector<quint32> glyphBuffer;   //!< 复用的字形索引缓冲区
+    mutable QVector<QPointF> positionBuffer;//!< 复用的字形位置缓冲区
+};
+
+#endif // AMOUNTDELEGATE_H
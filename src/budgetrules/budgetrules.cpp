@@ -0,0 +1,735 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 23:12:47
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 23:12:47
+ * @Description: 预算规则：编译为字节码，随新记录增量求值
+ */
+#include "budgetrules.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QPair>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const double Missing = std::numeric_limits<double>::quiet_NaN();
+
+/**
+ * @brief 金额列名称（英文名与中文名），下标对应金额列
+ */
+const char *const ColumnNames[LedgerAmountColumnCount][3] = {
+    {"total", "总存款", "当前总存款金额"},
+    {"salary", "工资", "当月工资"},
+    {"fixed", "定期", "定期余额"},
+    {"expense", "开支", "当月开支"},
+    {"deposit", "存款", "当月存款"},
+    {"disposable", "可支配", "当月可支配额度"}
+};
+
+/**
+ * @brief 查找金额列名称
+ * @return 返回金额列下标，找不到返回-1
+ */
+int columnIndex(const QString &name)
+{
+    const QString lower = name.toLower();
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        for (const char *alias : ColumnNames[i]) {
+            if (lower == QString::fromUtf8(alias)) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 聚合函数引用：编译时先记录在规则内，添加规则时再映射到去重后的聚合槽
+ */
+struct AggregateRef
+{
+    BudgetRules::AggregateKind kind;
+    int column;
+    int window;
+};
+
+/**
+ * @brief 规则表达式编译器：递归下降解析，直接生成栈式字节码
+ *
+ * 优先级从低到高：or、and、not、比较、加减、乘除、负号、基本项
+ */
+class Compiler
+{
+public:
+    explicit Compiler(const QString &expression)
+        : source(expression)
+    {
+        // 允许中文标点与乘号
+        source.replace(QChar(0xFF08), '(').replace(QChar(0xFF09), ')')
+              .replace(QChar(0xFF0C), ',').replace(QChar(0x00D7), '*');
+    }
+
+    bool compile(QVector<BudgetRules::Instruction> &code, QVector<AggregateRef> &refs, QString *error)
+    {
+        advance();
+        const bool ok = parseOr() && (current.type == End || fail("表达式末尾有多余的内容"));
+        if (!ok) {
+            if (error) {
+                *error = message;
+            }
+            return false;
+        }
+        code = instructions;
+        refs = aggregateRefs;
+        return true;
+    }
+
+private:
+    enum TokenType { End, Number, Identifier, Operator };
+
+    struct Token
+    {
+        TokenType type = End;
+        QString text;
+        double number = 0.0;
+        int position = 0;
+    };
+
+    /**
+     * @brief 读取下一个记号
+     */
+    void advance()
+    {
+        while (position < source.size() && source[position].isSpace()) {
+            ++position;
+        }
+        current = Token();
+        current.position = position;
+        if (position >= source.size()) {
+            return;
+        }
+
+        const QChar c = source[position];
+        if (c.isDigit() || (c == '.' && position + 1 < source.size() && source[position + 1].isDigit())) {
+            int end = position;
+            while (end < source.size() && (source[end].isDigit() || source[end] == '.')) {
+                ++end;
+            }
+            current.type = Number;
+            current.text = source.mid(position, end - position);
+            current.number = current.text.toDouble();
+            position = end;
+            return;
+        }
+        if (c.isLetter() || c == '_') {
+            int end = position;
+            while (end < source.size() && (source[end].isLetterOrNumber() || source[end] == '_')) {
+                ++end;
+            }
+            current.type = Identifier;
+            current.text = source.mid(position, end - position);
+            position = end;
+            return;
+        }
+
+        static const char *const twoCharOperators[] = {"<=", ">=", "==", "!=", "&&", "||"};
+        for (const char *op : twoCharOperators) {
+            if (source.mid(position, 2) == QLatin1String(op)) {
+                current.type = Operator;
+                current.text = QLatin1String(op);
+                position += 2;
+                return;
+            }
+        }
+        current.type = Operator;
+        current.text = QString(c);
+        ++position;
+    }
+
+    bool fail(const QString &text)
+    {
+        if (message.isEmpty()) {
+            message = QString("%1（第%2个字符）").arg(text).arg(current.position + 1);
+        }
+        return false;
+    }
+
+    bool isOperator(const char *op) const
+    {
+        return current.type == Operator && current.text == QLatin1String(op);
+    }
+
+    bool isKeyword(const char *keyword) const
+    {
+        return current.type == Identifier && current.text.toLower() == QLatin1String(keyword);
+    }
+
+    bool expect(const char *op)
+    {
+        if (!isOperator(op)) {
+            return fail(QString("缺少\"%1\"").arg(QLatin1String(op)));
+        }
+        advance();
+        return true;
+    }
+
+    /**
+     * @brief 追加一条指令并跟踪求值栈深度
+     * @param stackEffect 执行后栈深度的变化
+     */
+    bool append(BudgetRules::OpCode op, int stackEffect, int operand = 0, double value = 0.0)
+    {
+        BudgetRules::Instruction instruction;
+        instruction.op = op;
+        instruction.operand = operand;
+        instruction.value = value;
+        instructions.append(instruction);
+        depth += stackEffect;
+        if (depth > BudgetRules::MaxStackDepth) {
+            return fail("表达式嵌套过深");
+        }
+        return true;
+    }
+
+    bool parseOr()
+    {
+        if (!parseAnd()) {
+            return false;
+        }
+        while (isKeyword("or") || isOperator("||")) {
+            advance();
+            if (!parseAnd() || !append(BudgetRules::OpOr, -1)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool parseAnd()
+    {
+        if (!parseNot()) {
+            return false;
+        }
+        while (isKeyword("and") || isOperator("&&")) {
+            advance();
+            if (!parseNot() || !append(BudgetRules::OpAnd, -1)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool parseNot()
+    {
+        if (isKeyword("not") || isOperator("!")) {
+            advance();
+            return parseNot() && append(BudgetRules::OpNot, 0);
+        }
+        return parseComparison();
+    }
+
+    bool parseComparison()
+    {
+        if (!parseAdditive()) {
+            return false;
+        }
+        static const QPair<const char *, BudgetRules::OpCode> comparisons[] = {
+            {"<=", BudgetRules::OpLessEqual}, {">=", BudgetRules::OpGreaterEqual},
+            {"==", BudgetRules::OpEqual}, {"!=", BudgetRules::OpNotEqual},
+            {"<", BudgetRules::OpLess}, {">", BudgetRules::OpGreater}
+        };
+        for (const auto &comparison : comparisons) {
+            if (isOperator(comparison.first)) {
+                advance();
+                return parseAdditive() && append(comparison.second, -1);
+            }
+        }
+        return true;
+    }
+
+    bool parseAdditive()
+    {
+        if (!parseMultiplicative()) {
+            return false;
+        }
+        while (isOperator("+") || isOperator("-")) {
+            const BudgetRules::OpCode op = isOperator("+") ? BudgetRules::OpAdd : BudgetRules::OpSub;
+            advance();
+            if (!parseMultiplicative() || !append(op, -1)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool parseMultiplicative()
+    {
+        if (!parseUnary()) {
+            return false;
+        }
+        while (isOperator("*") || isOperator("/")) {
+            const BudgetRules::OpCode op = isOperator("*") ? BudgetRules::OpMul : BudgetRules::OpDiv;
+            advance();
+            if (!parseUnary() || !append(op, -1)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool parseUnary()
+    {
+        if (isOperator("-")) {
+            advance();
+            return parseUnary() && append(BudgetRules::OpNeg, 0);
+        }
+        return parsePrimary();
+    }
+
+    bool parsePrimary()
+    {
+        if (current.type == Number) {
+            const double value = current.number;
+            advance();
+            return append(BudgetRules::OpConst, 1, 0, value);
+        }
+        if (isOperator("(")) {
+            advance();
+            return parseOr() && expect(")");
+        }
+        if (current.type != Identifier) {
+            return fail(current.type == End ? QString("表达式不完整") : QString("无法识别\"%1\"").arg(current.text));
+        }
+
+        const QString name = current.text.toLower();
+        advance();
+        static const QPair<const char *, BudgetRules::AggregateKind> functions[] = {
+            {"prev", BudgetRules::Previous}, {"avg", BudgetRules::Average}, {"sum", BudgetRules::Sum},
+            {"min", BudgetRules::Minimum}, {"max", BudgetRules::Maximum}
+        };
+        for (const auto &function : functions) {
+            if (name == QLatin1String(function.first)) {
+                return parseAggregate(function.second);
+            }
+        }
+
+        const int column = columnIndex(name);
+        if (column < 0) {
+            return fail(QString("未知的名称\"%1\"").arg(name));
+        }
+        return append(BudgetRules::OpColumn, 1, column);
+    }
+
+    /**
+     * @brief 解析 prev(列) 或 avg/sum/min/max(列, N)
+     */
+    bool parseAggregate(BudgetRules::AggregateKind kind)
+    {
+        if (!expect("(")) {
+            return false;
+        }
+        const int column = current.type == Identifier ? columnIndex(current.text) : -1;
+        if (column < 0) {
+            return fail("函数的第一个参数应为金额列");
+        }
+        advance();
+
+        int window = 1;
+        if (kind != BudgetRules::Previous) {
+            if (!expect(",")) {
+                return false;
+            }
+            if (current.type != Number || current.number != std::floor(current.number)
+                    || current.number < 1 || current.number > BudgetRules::MaxWindow) {
+                return fail(QString("窗口应为 1 ~ %1 的整数").arg(BudgetRules::MaxWindow));
+            }
+            window = static_cast<int>(current.number);
+            advance();
+        }
+        if (!expect(")")) {
+            return false;
+        }
+
+        AggregateRef ref;
+        ref.kind = kind;
+        ref.column = column;
+        ref.window = window;
+        aggregateRefs.append(ref);
+        return append(BudgetRules::OpAggregate, 1, aggregateRefs.size() - 1);
+    }
+
+    QString source;
+    int position = 0;
+    Token current;
+    QString message;
+    int depth = 0;
+    QVector<BudgetRules::Instruction> instructions;
+    QVector<AggregateRef> aggregateRefs;
+};
+
+/**
+ * @brief 非空且不为0视为真
+ */
+inline bool truth(double value)
+{
+    return value == value && value != 0.0;
+}
+
+/**
+ * @brief 取出记录各金额列换算后的值，空单元格或缺少汇率为NaN
+ */
+void recordValues(const LedgerRecord &record, double factor, double values[LedgerAmountColumnCount])
+{
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        values[i] = record.hasAmount(i) && !std::isnan(factor) ? record.amount(i) * factor : Missing;
+    }
+}
+
+} // namespace
+
+/**
+ * @brief 构造函数
+ */
+BudgetRules::BudgetRules()
+{
+}
+
+/**
+ * @brief 规则文件路径：与账本同目录、同名的 .rules.txt 文件
+ * @param ledgerPath 账本文件路径
+ */
+QString BudgetRules::filePathFor(const QString &ledgerPath)
+{
+    QFileInfo info(ledgerPath);
+    return info.absolutePath() + "/" + info.completeBaseName() + ".rules.txt";
+}
+
+/**
+ * @brief 默认规则文本（规则文件不存在时使用）
+ */
+QString BudgetRules::defaultText()
+{
+    return QString(
+        "# 每行一条规则：名称: 表达式\n"
+        "开支超过近6个月平均的1.2倍: expense > 1.2 * avg(expense, 6)\n"
+        "可支配额度不足3个月开支: disposable < 3 * avg(expense, 6)\n"
+        "定期余额减少: fixed < prev(fixed)\n");
+}
+
+/**
+ * @brief 读取规则文件，文件不存在时使用默认规则
+ * @param filePath 规则文件路径
+ * @param errors 无法编译的规则（输出参数，可为空）
+ * @return 文件存在但无法读取时返回false
+ */
+bool BudgetRules::open(const QString &filePath, QStringList *errors)
+{
+    QFile file(filePath);
+    if (!file.exists()) {
+        setText(defaultText(), errors);
+        return true;
+    }
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        setText(QString(), errors);
+        return false;
+    }
+    QTextStream in(&file);
+    setText(in.readAll(), errors);
+    return true;
+}
+
+/**
+ * @brief 保存规则文本到文件
+ * @param filePath 规则文件路径
+ */
+bool BudgetRules::save(const QString &filePath) const
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        return false;
+    }
+    QTextStream out(&file);
+    out << sourceText;
+    return out.status() == QTextStream::Ok;
+}
+
+/**
+ * @brief 替换全部规则，历史状态随之清空，需要重新追加记录
+ * @param text 规则文本
+ * @param errors 无法编译的规则（输出参数，可为空）
+ * @return 返回编译成功的规则数
+ */
+int BudgetRules::setText(const QString &text, QStringList *errors)
+{
+    sourceText = text;
+    rules.clear();
+    aggregates.clear();
+    for (History &history : histories) {
+        history = History();
+    }
+
+    const QStringList lines = text.split('\n');
+    for (int i = 0; i < lines.size(); ++i) {
+        const QString line = lines[i].trimmed();
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+        int colon = line.indexOf(':');
+        const int wideColon = line.indexOf(QChar(0xFF1A));
+        if (colon < 0 || (wideColon >= 0 && wideColon < colon)) {
+            colon = wideColon;
+        }
+
+        QString error;
+        if (colon <= 0) {
+            error = "缺少规则名称";
+        } else {
+            addRule(line.left(colon).trimmed(), line.mid(colon + 1).trimmed(), &error);
+        }
+        if (!error.isEmpty() && errors) {
+            errors->append(QString("第%1行：%2").arg(i + 1).arg(error));
+        }
+    }
+    reset();
+    return rules.size();
+}
+
+/**
+ * @brief 编译并添加一条规则
+ * @param name 规则名称
+ * @param expression 规则表达式
+ * @param error 编译失败的原因（输出参数，可为空）
+ * @return 成功返回true
+ */
+bool BudgetRules::addRule(const QString &name, const QString &expression, QString *error)
+{
+    Rule rule;
+    rule.name = name;
+    rule.expression = expression;
+    QVector<AggregateRef> refs;
+    Compiler compiler(expression);
+    if (!compiler.compile(rule.code, refs, error)) {
+        return false;
+    }
+
+    // 规则内的聚合引用映射到全局去重的聚合槽
+    for (Instruction &instruction : rule.code) {
+        if (instruction.op == OpAggregate) {
+            const AggregateRef &ref = refs[instruction.operand];
+            instruction.operand = aggregateFor(ref.kind, ref.column, ref.window);
+        }
+    }
+    rules.append(rule);
+    reset();
+    return true;
+}
+
+/**
+ * @brief 查找或新建聚合槽，并保证对应列的滑动窗口足够长
+ * @return 返回槽号
+ */
+int BudgetRules::aggregateFor(AggregateKind kind, int column, int window)
+{
+    for (int i = 0; i < aggregates.size(); ++i) {
+        const Aggregate &aggregate = aggregates[i];
+        if (aggregate.kind == kind && aggregate.column == column && aggregate.window == window) {
+            return i;
+        }
+    }
+    Aggregate aggregate;
+    aggregate.kind = kind;
+    aggregate.column = column;
+    aggregate.window = window;
+    aggregates.append(aggregate);
+
+    History &history = histories[column];
+    if (history.values.size() < window) {
+        history.values.resize(window);
+    }
+    return aggregates.size() - 1;
+}
+
+/**
+ * @brief 规则需要回看的最多记录数，历史记录被修改后重放这么多条即可恢复状态
+ */
+int BudgetRules::historyDepth() const
+{
+    int depth = 0;
+    for (const Aggregate &aggregate : aggregates) {
+        depth = qMax(depth, aggregate.window);
+    }
+    return depth;
+}
+
+/**
+ * @brief 清空历史状态（滑动窗口与聚合槽），保留已编译的规则
+ */
+void BudgetRules::reset()
+{
+    for (Aggregate &aggregate : aggregates) {
+        aggregate.sum = 0.0;
+        aggregate.count = 0;
+        aggregate.value = Missing;
+    }
+    for (History &history : histories) {
+        history.head = 0;
+        history.size = 0;
+    }
+}
+
+/**
+ * @brief 滑动窗口中倒数第 offset+1 个值（offset 为0即最近一个）
+ */
+double BudgetRules::History::back(int offset) const
+{
+    const int capacity = values.size();
+    return values[(head - 1 - offset + capacity) % capacity];
+}
+
+/**
+ * @brief 新值进入窗口前更新一个聚合槽：求和类加入新值、移出最旧的值，最值类重新扫描窗口
+ * @param aggregate 聚合槽
+ * @param history 该列的滑动窗口（尚未写入新值）
+ * @param incoming 新值
+ */
+void BudgetRules::updateAggregate(Aggregate &aggregate, const History &history, double incoming) const
+{
+    switch (aggregate.kind) {
+    case Previous:
+        aggregate.value = incoming;
+        return;
+    case Average:
+    case Sum: {
+        if (!std::isnan(incoming)) {
+            aggregate.sum += incoming;
+            ++aggregate.count;
+        }
+        if (history.size >= aggregate.window) {
+            const double outgoing = history.back(aggregate.window - 1);
+            if (!std::isnan(outgoing)) {
+                aggregate.sum -= outgoing;
+                --aggregate.count;
+            }
+        }
+        if (aggregate.count == 0) {
+            aggregate.sum = 0.0;
+            aggregate.value = Missing;
+        } else {
+            aggregate.value = aggregate.kind == Average ? aggregate.sum / aggregate.count : aggregate.sum;
+        }
+        return;
+    }
+    case Minimum:
+    case Maximum: {
+        double result = incoming;
+        const int count = qMin(history.size, aggregate.window - 1);
+        for (int offset = 0; offset < count; ++offset) {
+            const double value = history.back(offset);
+            if (std::isnan(result)) {
+                result = value;
+            } else if (!std::isnan(value)) {
+                result = aggregate.kind == Minimum ? qMin(result, value) : qMax(result, value);
+            }
+        }
+        aggregate.value = result;
+        return;
+    }
+    }
+}
+
+/**
+ * @brief 追加一条已入账的记录，只更新滑动窗口和引用到的聚合槽
+ * @param record 记录
+ * @param factor 换算到报表币种的系数，NaN表示缺少汇率（该记录的金额按空值处理）
+ */
+void BudgetRules::append(const LedgerRecord &record, double factor)
+{
+    double values[LedgerAmountColumnCount];
+    recordValues(record, factor, values);
+
+    for (Aggregate &aggregate : aggregates) {
+        updateAggregate(aggregate, histories[aggregate.column], values[aggregate.column]);
+    }
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        History &history = histories[i];
+        if (history.values.isEmpty()) {
+            continue;
+        }
+        history.values[history.head] = values[i];
+        history.head = (history.head + 1) % history.values.size();
+        history.size = qMin(history.size + 1, history.values.size());
+    }
+}
+
+/**
+ * @brief 检查一条待录入的记录，返回触发的规则名称
+ * @param candidate 待录入的记录
+ * @param factor 换算到报表币种的系数
+ */
+QStringList BudgetRules::evaluate(const LedgerRecord &candidate, double factor) const
+{
+    double values[LedgerAmountColumnCount];
+    recordValues(candidate, factor, values);
+
+    QStringList fired;
+    double stack[MaxStackDepth];
+    for (const Rule &rule : rules) {
+        int top = 0;
+        for (const Instruction &instruction : rule.code) {
+            switch (instruction.op) {
+            case OpConst:
+                stack[top++] = instruction.value;
+                continue;
+            case OpColumn:
+                stack[top++] = values[instruction.operand];
+                continue;
+            case OpAggregate:
+                stack[top++] = aggregates[instruction.operand].value;
+                continue;
+            case OpNeg:
+                stack[top - 1] = -stack[top - 1];
+                continue;
+            case OpNot:
+                // 空值取反仍为空值，否则 not (expense > 1) 在缺少开支时会触发
+                if (!std::isnan(stack[top - 1])) {
+                    stack[top - 1] = truth(stack[top - 1]) ? 0.0 : 1.0;
+                }
+                continue;
+            default:
+                break;
+            }
+
+            // 其余均为二元运算，任一操作数为空值时结果为空值
+            const double b = stack[--top];
+            const double a = stack[top - 1];
+            if (std::isnan(a) || std::isnan(b)) {
+                stack[top - 1] = Missing;
+                continue;
+            }
+            double result = 0.0;
+            switch (instruction.op) {
+            case OpAdd: result = a + b; break;
+            case OpSub: result = a - b; break;
+            case OpMul: result = a * b; break;
+            case OpDiv: result = b != 0.0 ? a / b : Missing; break;
+            case OpLess: result = a < b; break;
+            case OpLessEqual: result = a <= b; break;
+            case OpGreater: result = a > b; break;
+            case OpGreaterEqual: result = a >= b; break;
+            case OpEqual: result = a == b; break;
+            case OpNotEqual: result = a != b; break;
+            case OpAnd: result = truth(a) && truth(b); break;
+            case OpOr: result = truth(a) || truth(b); break;
+            default: break;
+            }
+            stack[top - 1] = result;
+        }
+        if (top == 1 && truth(stack[0])) {
+            fired.append(rule.name);
+        }
+    }
+    return fired;
+}
@@ -0,0 +1,194 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 23:12:47
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 23:12:47
+ * @Description: 预算规则：编译为字节码，随新记录增量求值
+ */
+#ifndef BUDGETRULES_H
+#define BUDGETRULES_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "ledgerrecord.h"
+
+/*
+    预算规则文本每行一条，# 开头的行为注释：
+
+        名称: 表达式
+
+    表达式可以使用：
+    - 金额列：total（总存款）、salary（工资）、fixed（定期）、expense（开支）、
+      deposit（存款）、disposable（可支配），也可写中文名；
+    - prev(列)：上一条记录的值；
+    - avg(列, N) / sum(列, N) / min(列, N) / max(列, N)：此前 N 条记录的聚合（不含当前记录）；
+    - 数字、+ - * /、比较 < <= > >= == !=、and / or / not（或 && || !）和括号。
+    空单元格的值为NaN，任一操作数为NaN的运算（含比较和 and/or/not）结果仍为NaN，
+    NaN视为假，因此缺少数据的规则（包括取反后的规则）不会触发。
+
+    规则只编译一次，得到基于栈的字节码；表达式中的 prev/avg/sum/min/max 去重后
+    成为若干"聚合槽"。每追加一条历史记录，只更新各列的滑动窗口和引用到的聚合槽
+    （求和类O(1)，最值类O(N)），检查待录入的记录时直接读取槽中的值执行字节码，
+    不需要扫描历史记录；历史记录被修改后只需重放最近 historyDepth() 条记录。
+*/
+class BudgetRules
+{
+public:
+    /**
+     * @brief 构造函数
+     */
+    BudgetRules();
+
+    /**
+     * @brief 规则文件路径：与账本同目录、同名的 .rules.txt 文件
+     * @param ledgerPath 账本文件路径
+     */
+    static QString filePathFor(const QString &ledgerPath);
+
+    /**
+     * @brief 默认规则文本（规则文件不存在时使用）
+     */
+    static QString defaultText();
+
+    /**
+     * @brief 读取规则文件，文件不存在时使用默认规则
+     * @param filePath 规则文件路径
+     * @param errors 无法编译的规则（输出参数，可为空）
+     * @return 文件存在但无法读取时返回false
+     */
+    bool open(const QString &filePath, QStringList *errors = nullptr);
+
+    /**
+     * @brief 保存规则文本到文件
+     * @param filePath 规则文件路径
+     */
+    bool save(const QString &filePath) const;
+
+    /**
+     * @brief 替换全部规则，历史状态随之清空，需要重新追加记录
+     * @param text 规则文本
+     * @param errors 无法编译的规则（输出参数，可为空）
+     * @return 返回编译成功的规则数
+     */
+    int setText(const QString &text, QStringList *errors = nullptr);
+    QString text() const { return sourceText; }
+
+    /**
+     * @brief 编译并添加一条规则，历史状态随之清空
+     * @param name 规则名称
+     * @param expression 规则表达式
+     * @param error 编译失败的原因（输出参数，可为空）
+     * @return 成功返回true
+     */
+    bool addRule(const QString &name, const QString &expression, QString *error = nullptr);
+
+    int ruleCount() const { return rules.size(); }
+    QString ruleName(int index) const { return rules[index].name; }
+
+    /**
+     * @brief 规则需要回看的最多记录数，历史记录被修改后重放这么多条即可恢复状态
+     */
+    int historyDepth() const;
+
+    /**
+     * @brief 清空历史状态（滑动窗口与聚合槽），保留已编译的规则
+     */
+    void reset();
+
+    /**
+     * @brief 追加一条已入账的记录，只更新滑动窗口和引用到的聚合槽
+     * @param record 记录
+     * @param factor 换算到报表币种的系数，NaN表示缺少汇率（该记录的金额按空值处理）
+     */
+    void append(const LedgerRecord &record, double factor = 1.0);
+
+    /**
+     * @brief 检查一条待录入的记录，返回触发的规则名称
+     * @param candidate 待录入的记录
+     * @param factor 换算到报表币种的系数
+     */
+    QStringList evaluate(const LedgerRecord &candidate, double factor = 1.0) const;
+
+    /**
+     * @brief 字节码指令
+     */
+    enum OpCode : quint8 {
+        OpConst,            //!< 压入常数
+        OpColumn,           //!< 压入当前记录的金额列
+        OpAggregate,        //!< 压入聚合槽的值
+        OpAdd, OpSub, OpMul, OpDiv, OpNeg,
+        OpLess, OpLessEqual, OpGreater, OpGreaterEqual, OpEqual, OpNotEqual,
+        OpAnd, OpOr, OpNot
+    };
+
+    /**
+     * @brief 聚合类型
+     */
+    enum AggregateKind : quint8 {
+        Previous,           //!< 上一条记录
+        Average,            //!< 窗口平均
+        Sum,                //!< 窗口合计
+        Minimum,            //!< 窗口最小值
+        Maximum             //!< 窗口最大值
+    };
+
+    /**
+     * @brief 一条指令：操作码 + 操作数（列号/槽号或常数）
+     */
+    struct Instruction
+    {
+        OpCode op = OpConst;
+        int operand = 0;        //!< OpColumn 的金额列下标，OpAggregate 的槽号
+        double value = 0.0;     //!< OpConst 的常数
+    };
+
+    /**
+     * @brief 聚合槽：某列最近 window 条记录的聚合值，追加记录时增量维护
+     */
+    struct Aggregate
+    {
+        AggregateKind kind = Previous;
+        int column = 0;         //!< 金额列下标
+        int window = 1;         //!< 窗口长度
+        double sum = 0.0;       //!< 窗口内非空值之和
+        int count = 0;          //!< 窗口内非空值个数
+        double value = 0.0;     //!< 当前聚合值（NaN表示无值）
+    };
+
+    static constexpr int MaxStackDepth = 32;    //!< 字节码求值栈深度上限
+    static constexpr int MaxWindow = 240;       //!< 聚合窗口上限（记录条数）
+
+private:
+    /**
+     * @brief 编译后的规则
+     */
+    struct Rule
+    {
+        QString name;
+        QString expression;
+        QVector<Instruction> code;
+    };
+
+    /**
+     * @brief 某一金额列的滑动窗口（环形缓冲区，保存最近若干条记录的值）
+     */
+    struct History
+    {
+        QVector<double> values;     //!< 环形缓冲区，容量为引用该列的最大窗口
+        int head = 0;               //!< 下一次写入的位置
+        int size = 0;               //!< 已保存的值个数
+
+        double back(int offset) const;
+    };
+
+    int aggregateFor(AggregateKind kind, int column, int window);
+    void updateAggregate(Aggregate &aggregate, const History &history, double incoming) const;
+
+    QString sourceText;                                 //!< 规则文本
+    QVector<Rule> rules;                                //!< 编译后的规则
+    QVector<Aggregate> aggregates;                      //!< 去重后的聚合槽
+    History histories[LedgerAmountColumnCount];         //!< 各金额列的滑动窗口
+};
+
+#endif // BUDGETRULES_H
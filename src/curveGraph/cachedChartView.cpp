@@ -0,0 +1,152 @@
+#include "cachedChartView.h"
+#include <QGraphicsScene>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QMouseEvent>
+#include <QFontMetrics>
+
+/**
+ * @brief 构造函数
+ * @param parent 父窗口指针
+ */
+CachedChartView::CachedChartView(QWidget *parent)
+    : QChartView(parent)
+{
+    // QChartView 在构造时已创建自己的场景，场景任何变化都会让缓存失效
+    connect(scene(), &QGraphicsScene::changed, this, [this]() {
+        ++contentVersion;
+    });
+    viewport()->setMouseTracking(true);
+}
+
+/**
+ * @brief 主动使缓存失效，下次绘制时重新渲染
+ */
+void CachedChartView::invalidateCache()
+{
+    ++contentVersion;
+    viewport()->update();
+}
+
+/**
+ * @brief 显示或更新十字线，只重绘前景层
+ * @param crosshair 十字线与提示内容
+ */
+void CachedChartView::setCrosshair(const Crosshair &crosshair)
+{
+    this->crosshair = crosshair;
+    crosshairVisible = true;
+    viewport()->update();
+}
+
+/**
+ * @brief 隐藏十字线
+ */
+void CachedChartView::clearCrosshair()
+{
+    if (!crosshairVisible) {
+        return;
+    }
+    crosshairVisible = false;
+    viewport()->update();
+}
+
+void CachedChartView::mouseMoveEvent(QMouseEvent *event)
+{
+    emit hoverMoved(event->position().toPoint());
+    QChartView::mouseMoveEvent(event);
+}
+
+void CachedChartView::leaveEvent(QEvent *event)
+{
+    emit hoverLeft();
+    QChartView::leaveEvent(event);
+}
+
+void CachedChartView::paintEvent(QPaintEvent *event)
+{
+    const qreal ratio = viewport()->devicePixelRatioF();
+    const QSize pixelSize = viewport()->size() * ratio;
+    if (pixelSize.isEmpty()) {
+        return;
+    }
+
+    if (cachedVersion != contentVersion || cachedSize != pixelSize || cache.isNull()) {
+        renderCache(pixelSize);
+    }
+
+    QPainter painter(viewport());
+    painter.drawPixmap(event->rect(), cache, QRectF(QPointF(event->rect().topLeft()) * ratio,
+                                                    QSizeF(event->rect().size()) * ratio));
+    if (crosshairVisible) {
+        drawCrosshair(painter);
+    }
+}
+
+/**
+ * @brief 将整个场景渲染到缓存
+ * @param pixelSize 视口的物理像素尺寸
+ */
+void CachedChartView::renderCache(const QSize &pixelSize)
+{
+    cache = QPixmap(pixelSize);
+    cache.setDevicePixelRatio(viewport()->devicePixelRatioF());
+    cache.fill(backgroundBrush().style() == Qt::NoBrush ? palette().color(QPalette::Base)
+                                                        : backgroundBrush().color());
+
+    QPainter painter(&cache);
+    painter.setRenderHints(renderHints());
+    // QGraphicsView::render 按视图变换直接绘制场景，不会再次进入 paintEvent
+    render(&painter, QRectF(QPointF(0, 0), QSizeF(viewport()->size())), viewport()->rect());
+    painter.end();
+
+    cachedSize = pixelSize;
+    cachedVersion = contentVersion;
+    ++renders;
+}
+
+/**
+ * @brief 在视口上绘制十字线、数据点标记和提示框
+ */
+void CachedChartView::drawCrosshair(QPainter &painter)
+{
+    const QRectF &plot = crosshair.plotArea;
+    const QPointF &position = crosshair.position;
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(QPen(QColor(220, 220, 220, 160), 1, Qt::DashLine));
+    painter.drawLine(QPointF(position.x(), plot.top()), QPointF(position.x(), plot.bottom()));
+    painter.drawLine(QPointF(plot.left(), position.y()), QPointF(plot.right(), position.y()));
+
+    painter.setBrush(backgroundBrush());
+    for (int i = 0; i < crosshair.markers.size(); ++i) {
+        painter.setPen(QPen(crosshair.markerColors.value(i, Qt::white), 2));
+        painter.drawEllipse(crosshair.markers[i], 4, 4);
+    }
+
+    if (crosshair.lines.isEmpty()) {
+        return;
+    }
+    // 提示框默认在交点右下方，超出视口时翻到另一侧
+    const QFontMetrics metrics(font());
+    int textWidth = 0;
+    for (const QString &line : crosshair.lines) {
+        textWidth = qMax(textWidth, metrics.horizontalAdvance(line));
+    }
+    const QSizeF boxSize(textWidth + 16, crosshair.lines.size() * metrics.height() + 12);
+    QRectF box(position + QPointF(12, 12), boxSize);
+    if (box.right() > viewport()->width()) {
+        box.moveRight(position.x() - 12);
+    }
+    if (box.bottom() > viewport()->height()) {
+        box.moveBottom(position.y() - 12);
+    }
+
+    painter.setPen(QColor(255, 255, 255, 60));
+    painter.setBrush(QColor(32, 32, 32, 220));
+    painter.drawRoundedRect(box, 4, 4);
+    painter.setPen(QColor("#e0e0e0"));
+    for (int i = 0; i < crosshair.lines.size(); ++i) {
+        painter.drawText(QPointF(box.left() + 8, box.top() + 6 + metrics.ascent() + i * metrics.height()),
+                         crosshair.lines[i]);
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef CACHEDCHARTVIEW_H
+#define CACHEDCHARTVIEW_H
+
+#include <QtCharts/QChartView>
+#include <QPixmap>
+#include <QColor>
+#include <QStringList>
+#include <QVector>
+
+/*
+    QChartView 每次暴露（切换标签页、窗口被遮挡后恢复等）都会让 QGraphicsScene
+    重新绘制整个图表，开启抗锯齿时代价很高。CachedChartView 把场景渲染到一张
+    离屏 QPixmap 中，缓存键为 (场景版本, 视口像素尺寸)：
+    - 场景内容变化（数据、显隐、动画帧）时 QGraphicsScene::changed 会使版本号递增；
+    - 视口尺寸或设备像素比变化时重新渲染；
+    - 其余情况下 paintEvent 只把缓存贴到视口上。
+
+    鼠标悬停时的十字线和数值提示作为前景层，在贴上缓存之后直接画在视口上，
+    不修改场景，因此移动鼠标不会使缓存失效；视图只发出 hoverMoved 信号，
+    最近记录的查找由图表管理器完成。
+*/
+class CachedChartView : public QChartView
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 构造函数
+     * @param parent 父窗口指针
+     */
+    explicit CachedChartView(QWidget *parent = nullptr);
+
+    /**
+     * @brief 前景层的十字线与数值提示（坐标均为视口坐标）
+     */
+    struct Crosshair
+    {
+        QRectF plotArea;                //!< 绘图区域，十字线不超出该区域
+        QPointF position;               //!< 十字线交点：竖线对齐最近的记录，横线跟随鼠标
+        QVector<QPointF> markers;       //!< 最近记录在各可见曲线上的数据点
+        QVector<QColor> markerColors;   //!< 各数据点的颜色
+        QStringList lines;              //!< 提示框中的文本行
+    };
+
+    /**
+     * @brief 显示或更新十字线，只重绘前景层
+     * @param crosshair 十字线与提示内容
+     */
+    void setCrosshair(const Crosshair &crosshair);
+
+    /**
+     * @brief 隐藏十字线
+     */
+    void clearCrosshair();
+
+    /**
+     * @brief 主动使缓存失效，下次绘制时重新渲染
+     */
+    void invalidateCache();
+
+    /**
+     * @brief 缓存被重新渲染的次数，便于观察缓存命中情况
+     */
+    int renderCount() const { return renders; }
+
+signals:
+    /**
+     * @brief 鼠标在视口内移动
+     * @param position 视口坐标
+     */
+    void hoverMoved(const QPoint &position);
+
+    /**
+     * @brief 鼠标离开视口
+     */
+    void hoverLeft();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void leaveEvent(QEvent *event) override;
+
+private:
+    QPixmap cache;                  //!< 离屏渲染结果
+    QSize cachedSize;               //!< 缓存对应的视口像素尺寸
+    quint64 contentVersion = 1;     //!< 场景内容版本
+    quint64 cachedVersion = 0;      //!< 缓存对应的场景版本
+    int renders = 0;                //!< 重新渲染次数
+    Crosshair crosshair;            //!< 当前十字线
+    bool crosshairVisible = false;  //!< 是否显示十字线
+
+    /**
+     * @brief 将整个场景渲染到缓存
+     * @param pixelSize 视口的物理像素尺寸
+     */
+    void renderCache(const QSize &pixelSize);
+
+    /**
+     * @brief 在视口上绘制十字线、数据点标记和提示框
+     */
+    void drawCrosshair(QPainter &painter);
+};
+
+#endif // CACHEDCHARTVIEW_H
@@ -1,14 +1,22 @@
 #include "curveGraph.h"
+#include "cachedChartView.h"
+#include "ledgerstats.h"
 #include <QDateTime>
 #include <QDebug>
 #include <QPainter>
 #include <algorithm>
 #include <cmath>
+#include <limits>
+#include <numeric>
 #include <QtCharts/QChart>
 #include <QtCharts/QLineSeries>
+#include <QtCharts/QAreaSeries>
 #include <QtCharts/QDateTimeAxis>
 #include <QtCharts/QValueAxis>
 #include <QtCharts/QChartView>
+#include <QGraphicsScene>
+#include <QGraphicsLayout>
+#include <QPointer>
 
 /**
  * @brief 构造函数
@@ -33,6 +41,57 @@ CurveGraph::~CurveGraph()
     delete chart;
 }
 
+namespace {
+
+/**
+ * @brief 各金额列曲线的颜色，下标对应金额列
+ */
+const char *const SeriesColors[LedgerAmountColumnCount] = {
+    "#1e90ff", "#f4a261", "#8ecae6", "#e63946", "#90be6d", "#c77dff"
+};
+
+/**
+ * @brief 流量型金额（当月工资、当月开支、当月存款）使用右侧副坐标轴，
+ *        存量型金额（总存款、定期余额、可支配额度）使用左侧主坐标轴
+ * @param index 金额列下标（0 对应 ColTotalDeposit）
+ */
+bool isFlowColumn(int index)
+{
+    const int column = ColTotalDeposit + index;
+    return column == ColSalary || column == ColExpense || column == ColMonthlyDeposit;
+}
+
+/**
+ * @brief 金额轴的目标刻度间隔数
+ */
+const int TargetTickIntervals = 8;
+
+/**
+ * @brief 取与 range / TargetTickIntervals 最接近的"整齐"间隔（1、2、5 乘以 10 的整数次幂），
+ *        刻度间隔数保持在 TargetTickIntervals 个左右，与金额大小无关；间隔不小于1，保证刻度为整数
+ * @param range 轴范围
+ */
+double niceTickInterval(double range)
+{
+    const double raw = range / TargetTickIntervals;
+    if (!(raw > 1.0)) {
+        return 1.0;
+    }
+    const double magnitude = std::pow(10.0, std::floor(std::log10(raw)));
+    const double normalized = raw / magnitude;
+    double nice = 10.0;
+    if (normalized < 1.5) {
+        nice = 1.0;
+    } else if (normalized < 3.0) {
+        nice = 2.0;
+    } else if (normalized < 7.0) {
+        nice = 5.0;
+    }
+    return nice * magnitude;
+}
+
+} // namespace
+
 /**
  * @brief 初始化图表
  */
@@ -40,14 +99,45 @@ void CurveGraph::initChart()
 {
     // 创建图表
     chart = new QChart();
-    chart->setTitle("总存款金额变化趋势");
+    chart->setTitle("账本金额变化趋势");
     chart->setAnimationOptions(QChart::AllAnimations);
     
-    // 创建曲线系列
-    series = new QLineSeries();
-    series->setName("当前总存款金额");
+    // 为每个金额列创建曲线，当前总存款金额即主曲线
+    const QStringList headers = {"当前总存款金额", "当月工资", "定期余额", "当月开支", "当月存款", "当月可支配额度"};
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        QLineSeries *columnSeries = new QLineSeries();
+        columnSeries->setName(headers[i]);
+        columnSeries->setPen(QPen(QColor(SeriesColors[i]), 2));
+        amountSeries[i] = columnSeries;
+    }
+    series = amountSeries[0];
     series->setMarkerSize(8);
-    series->setPen(QPen(Qt::blue, 2));
+    
+    // 创建叠加线，默认隐藏
+    smaSeries = new QLineSeries();
+    smaSeries->setPen(QPen(QColor("#ff9f1c"), 2, Qt::DashLine));
+    emaSeries = new QLineSeries();
+    emaSeries->setPen(QPen(QColor("#2ec4b6"), 2));
+    trendSeries = new QLineSeries();
+    trendSeries->setName("趋势线");
+    trendSeries->setPen(QPen(QColor("#e71d36"), 2, Qt::DashDotLine));
+    setMovingAverageWindow(6);
+    
+    // 创建存款预测的分位线与色带，默认隐藏；色带边界线不单独加入图表，随图表析构
+    for (int band = 0; band < ProjectionEngine::BandCount; ++band) {
+        projectionLines[band] = new QLineSeries(chart);
+    }
+    QLineSeries *median = projectionLines[ProjectionEngine::P50];
+    median->setName("预测中位数");
+    median->setPen(QPen(QColor("#ffd166"), 2, Qt::DashLine));
+    projectionOuter = new QAreaSeries(projectionLines[ProjectionEngine::P95], projectionLines[ProjectionEngine::P5]);
+    projectionOuter->setName("预测区间 5%~95%");
+    projectionOuter->setPen(Qt::NoPen);
+    projectionOuter->setBrush(QColor(255, 209, 102, 50));
+    projectionInner = new QAreaSeries(projectionLines[ProjectionEngine::P75], projectionLines[ProjectionEngine::P25]);
+    projectionInner->setName("预测区间 25%~75%");
+    projectionInner->setPen(Qt::NoPen);
+    projectionInner->setBrush(QColor(255, 209, 102, 100));
     
     // 创建X轴（日期轴）
     axisX = new QDateTimeAxis();
@@ -55,191 +145,423 @@ void CurveGraph::initChart()
     axisX->setTitleText("记账日期");
     axisX->setTickCount(8);
     
-    // 创建Y轴（金额轴）
+    // 创建Y轴（存量金额轴）
     axisY = new QValueAxis();
-    axisY->setTitleText("当前总存款金额");
+    axisY->setTitleText("存款金额");
     axisY->setLabelFormat("¥%.0f"); // 只显示整数值
     axisY->setTickCount(10);
     axisY->setTickInterval(1000); // 默认刻度间隔为1000，后续会根据数据范围调整
     axisY->setMinorTickCount(2);
     
+    // 创建副Y轴（当月流量金额轴）
+    axisYFlow = new QValueAxis();
+    axisYFlow->setTitleText("当月金额");
+    axisYFlow->setLabelFormat("¥%.0f");
+    axisYFlow->setTickCount(10);
+    axisYFlow->setTickInterval(1000);
+    
     // 将系列和坐标轴添加到图表
-    chart->addSeries(series);
     chart->addAxis(axisX, Qt::AlignBottom);
     chart->addAxis(axisY, Qt::AlignLeft);
-    series->attachAxis(axisX);
-    series->attachAxis(axisY);
+    chart->addAxis(axisYFlow, Qt::AlignRight);
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        chart->addSeries(amountSeries[i]);
+        amountSeries[i]->attachAxis(axisX);
+        amountSeries[i]->attachAxis(isFlowColumn(i) ? axisYFlow : axisY);
+        amountSeries[i]->setVisible(isSeriesVisibleByDefault(ColTotalDeposit + i));
+    }
+    
+    for (QLineSeries *overlay : {smaSeries, emaSeries, trendSeries}) {
+        chart->addSeries(overlay);
+        overlay->attachAxis(axisX);
+        overlay->attachAxis(axisY);
+        overlay->setVisible(false);
+    }
+    
+    const QList<QAbstractSeries*> projections = {projectionOuter, projectionInner, median};
+    for (QAbstractSeries *projection : projections) {
+        chart->addSeries(projection);
+        projection->attachAxis(axisX);
+        projection->attachAxis(axisY);
+        projection->setVisible(false);
+    }
+    
+    updateValueAxes();
 }
+
 /**
- * @brief 更新图表数据
- * @param model 数据模型指针
+ * @brief 由快照计算各金额列的数据点与统计结果，不访问任何QtCharts对象，可在工作线程中调用
+ * @param snapshot 账本快照
+ * @param factors 每行换算到报表币种的系数，NaN表示缺少汇率（该行不绘制），为空表示不换算
+ * @param token 取消标记，被取消时尽早返回不完整的结果
+ * @return 返回曲线数据
  */
-void CurveGraph::updateData(QStandardItemModel *model)
+CurveGraph::SeriesData CurveGraph::buildSeries(const LedgerSnapshot &snapshot, const QVector<double> &factors,
+                                               const TaskScheduler::CancellationToken &token)
 {
-    // 清空现有数据
-    series->clear();
-    
-    if (!model || model->rowCount() == 0) {
-        return;
+    SeriesData data;
+    data.version = snapshot.version();
+    const int rowCount = snapshot.rowCount();
+    QVector<double> amounts[LedgerAmountColumnCount];
+    data.recordX.reserve(rowCount);
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        data.points[i].reserve(rowCount);
+        data.recordValues[i].reserve(rowCount);
+        amounts[i].reserve(rowCount);
     }
+    const double missing = std::numeric_limits<double>::quiet_NaN();
     
-    double minAmount = 0.0;
-    double maxAmount = 0.0;
-    bool firstPoint = true;
-    
-    // 遍历模型中的所有数据
-    qDebug() << "Total rows:" << model->rowCount();
-    for (int row = 0; row < model->rowCount(); ++row) {
-        // 获取日期列（第0列）
-        QStandardItem *dateItem = model->item(row, 0);
-        if (!dateItem) {
-            qDebug() << "Row" << row << ": dateItem is null";
-            continue;
+    // 一次遍历快照，同时收集所有金额列的数据点
+    for (int row = 0; row < rowCount; ++row) {
+        if ((row & 4095) == 0 && token.isCancelled()) {
+            return data;
         }
-        
-        // 获取总存款金额列（第1列）
-        QStandardItem *amountItem = model->item(row, 1);
-        if (!amountItem) {
-            qDebug() << "Row" << row << ": amountItem is null";
+        const LedgerRecord &record = snapshot.record(row);
+        if (!record.date.isValid()) {
             continue;
         }
-        
-        // 格式化日期
-        QString dateStr = dateItem->text();
-        QDateTime date = formatDate(dateStr);
-        if (!date.isValid()) {
-            qDebug() << "Row" << row << ": invalid date" << dateStr;
+        const double factor = row < factors.size() ? factors[row] : 1.0;
+        if (std::isnan(factor)) {
             continue;
         }
+        const double x = record.date.startOfDay().toMSecsSinceEpoch();
+        data.recordX.append(x);
         
-        // 转换金额
-        QString amountStr = amountItem->text();
-        double amount = amountStr.toDouble();
-        if (amount < 0) {
-            qDebug() << "Row" << row << ": negative amount" << amount;
-            continue;
+        for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+            if (!record.hasAmount(i)) {
+                data.recordValues[i].append(missing);
+                continue;
+            }
+            const double amount = record.amount(i) * factor;
+            data.recordValues[i].append(amount);
+            if (i == 0 && amount < 0) {
+                continue;
+            }
+            data.points[i].append(QPointF(x, amount));
+            amounts[i].append(amount);
         }
         
-        // 更新最大最小金额
-        if (firstPoint) {
-            minAmount = amount;
-            maxAmount = amount;
-            firstPoint = false;
-        } else {
-            if (amount < minAmount) minAmount = amount;
-            if (amount > maxAmount) maxAmount = amount;
-        }
-        
-        // 添加数据点
-        qDebug() << "Row" << row << ": adding point" << date << "-" << amount;
-        series->append(date.toMSecsSinceEpoch(), amount);
+        data.minX = data.hasX ? qMin(data.minX, x) : x;
+        data.maxX = data.hasX ? qMax(data.maxX, x) : x;
+        data.hasX = true;
     }
     
-    qDebug() << "Total points added:" << series->count();
-    
-    // 设置Y轴范围
-    if (!firstPoint) {
-        double range = maxAmount - minAmount;
-        double margin;
-        
-        // 如果只有一个数据点或范围很小，使用固定边距
-        if (range < 1.0) {
-            margin = 50.0; // 使用固定边距
-        } else {
-            margin = range * 0.1; // 正常情况下添加10%的边距
+    // 折线与悬停查找都要求按时间排序；账本通常已按日期排列，只有乱序时才重排一次
+    if (!std::is_sorted(data.recordX.cbegin(), data.recordX.cend())) {
+        QVector<int> order(data.recordX.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&data](int a, int b) {
+            return data.recordX[a] < data.recordX[b];
+        });
+        auto permute = [&order](QVector<double> &values) {
+            QVector<double> sorted;
+            sorted.reserve(order.size());
+            for (int index : order) {
+                sorted.append(values[index]);
+            }
+            values.swap(sorted);
+        };
+        permute(data.recordX);
+        for (QVector<double> &values : data.recordValues) {
+            permute(values);
         }
         
-        // 确保最小值不小于0
-        minAmount = qMax(0.0, minAmount - margin);
-        maxAmount = maxAmount + margin;
-        
-        // 设置合适的整数刻度间隔
-        double tickInterval;
-        if (maxAmount < 100) {
-            tickInterval = 10; // 0-100之间，每10个单位一个刻度
-        } else if (maxAmount < 500) {
-            tickInterval = 50; // 100-500之间，每50个单位一个刻度
-        } else if (maxAmount < 1000) {
-            tickInterval = 100; // 500-1000之间，每100个单位一个刻度
-        } else if (maxAmount < 5000) {
-            tickInterval = 500; // 1000-5000之间，每500个单位一个刻度
-        } else if (maxAmount < 10000) {
-            tickInterval = 1000; // 5000-10000之间，每1000个单位一个刻度
-        } else if (maxAmount < 50000) {
-            tickInterval = 5000; // 10000-50000之间，每5000个单位一个刻度
-        } else {
-            tickInterval = 10000; // 50000以上，每10000个单位一个刻度
-        }
-        
-        // 确保刻度值为整数，并且Y轴范围是tickInterval的整数倍
-        minAmount = floor(minAmount / tickInterval) * tickInterval;
-        maxAmount = ceil(maxAmount / tickInterval) * tickInterval;
-        
-        // 应用设置
-        axisY->setRange(minAmount, maxAmount);
-        axisY->setTickInterval(tickInterval);
-        
-        // 强制设置刻度数量，避免自动生成非整数刻度
-        int tickCount = qRound((maxAmount - minAmount) / tickInterval) + 1;
-        axisY->setTickCount(tickCount);
-    }
-    
-    // 更新X轴范围
-    if (series->count() > 0) {
-        qDebug() << "Updating X-axis range...";
-        QList<QPointF> points = series->points();
-        qDebug() << "Points count:" << points.size();
-        
-        // 对于只有一个数据点的情况，不需要排序
-        if (points.size() > 1) {
-            std::sort(points.begin(), points.end(), [](const QPointF &a, const QPointF &b) {
+        // 数据点只包含有值的记录，按同样的（稳定的）时间顺序排列
+        for (QList<QPointF> &points : data.points) {
+            std::stable_sort(points.begin(), points.end(), [](const QPointF &a, const QPointF &b) {
                 return a.x() < b.x();
             });
         }
-        
-        // 检查点是否有效
-        if (points.isEmpty()) {
-            qDebug() << "No valid points to set X-axis range";
-            return;
-        }
-        
-        // 使用第一个和最后一个点（对于单个点，它们是同一个）
-        qDebug() << "First point x:" << points.first().x() << "y:" << points.first().y();
-        qDebug() << "Last point x:" << points.last().x() << "y:" << points.last().y();
-        
-        // 确保时间戳有效
-        if (points.first().x() <= 0 || points.last().x() <= 0) {
-            qDebug() << "Invalid timestamp found";
-            return;
-        }
-        
-        QDateTime minDate = QDateTime::fromMSecsSinceEpoch(points.first().x());
-        QDateTime maxDate = QDateTime::fromMSecsSinceEpoch(points.last().x());
-        
-        // 检查日期是否有效
-        if (!minDate.isValid() || !maxDate.isValid()) {
-            qDebug() << "Invalid date conversion";
-            return;
+    }
+    
+    // 每列的最大最小金额由向量化统计内核一次求出，切换显示时直接复用
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        data.stats[i] = LedgerStats::compute(amounts[i]);
+    }
+    return data;
+}
+
+/**
+ * @brief 设置后台计算调度器，未设置时updateDataAsync退化为同步更新
+ * @param scheduler 调度器指针（不接管所有权）
+ */
+void CurveGraph::setScheduler(TaskScheduler *scheduler)
+{
+    this->scheduler = scheduler;
+}
+
+/**
+ * @brief 以"可见图表"优先级在后台由快照计算曲线数据，完成后回到GUI线程替换曲线；
+ *        新的请求会取消尚未交付的旧请求
+ * @param snapshot 账本快照
+ * @return 已开始计算返回true；图表已是该版本或正在计算该版本时返回false
+ */
+bool CurveGraph::updateDataAsync(const LedgerSnapshotPtr &snapshot)
+{
+    if (!snapshot) {
+        return false;
+    }
+    const quint64 version = snapshot->version();
+    if (pendingVersion == version) {
+        return false;
+    }
+    if (builtVersion == version) {
+        pendingVersion = 0;
+        if (scheduler) {
+            scheduler->cancel("chart");
         }
-        
-        qDebug() << "Min date before adjustment:" << minDate.toString();
-        qDebug() << "Max date before adjustment:" << maxDate.toString();
+        return false;
+    }
+    if (!scheduler) {
+        pendingVersion = 0;
+        applySeries(buildSeries(*snapshot, rowFactors));
+        builtVersion = version;
+        return true;
+    }
+    
+    // 工作线程只持有快照和系数的副本；同一键的旧请求被取消
+    pendingVersion = version;
+    const QVector<double> factors = rowFactors;
+    QPointer<CurveGraph> guard(this);
+    scheduler->submit("chart", TaskScheduler::Visible,
+                      [snapshot, factors](const TaskScheduler::CancellationToken &token) {
+                          return buildSeries(*snapshot, factors, token);
+                      },
+                      [guard, version](const SeriesData &data) {
+                          if (!guard || guard->pendingVersion != version) {
+                              return;
+                          }
+                          guard->pendingVersion = 0;
+                          guard->applySeries(data);
+                          guard->builtVersion = version;
+                      });
+    return true;
+}
+
+/**
+ * @brief 用计算好的数据替换各曲线、重建叠加线并调整坐标轴（GUI线程）
+ * @param data 曲线数据
+ */
+void CurveGraph::applySeries(const SeriesData &data)
+{
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        amountSeries[i]->replace(data.points[i]);
+        amountStats[i] = data.stats[i];
+        hoverValues[i] = data.recordValues[i];
+    }
+    hoverX = data.recordX;
+    rebuildOverlays(data.points[0]);
+    lastRecordX = data.hasX ? data.maxX : 0.0;
+    updateAnimationOptions();
+    qDebug() << "Total points added:" << series->count();
+    
+    // 设置Y轴范围
+    updateValueAxes();
+    
+    // 更新X轴范围（显示预测时延伸到预测的最后一个时点）
+    if (data.hasX && data.minX > 0) {
+        QDateTime minDate = QDateTime::fromMSecsSinceEpoch(data.minX);
+        QDateTime maxDate = QDateTime::fromMSecsSinceEpoch(projectionVisible ? qMax(data.maxX, projectionEndX) : data.maxX);
         
         // 如果所有日期相同，添加一些边距
         if (minDate == maxDate) {
-            qDebug() << "All dates are the same, adding margins...";
             // 使用addDays安全地添加边距
             minDate = minDate.addDays(-1);
             maxDate = maxDate.addDays(1);
-            qDebug() << "Min date after adjustment:" << minDate.toString();
-            qDebug() << "Max date after adjustment:" << maxDate.toString();
         }
         
-        qDebug() << "Setting X-axis range...";
         axisX->setRange(minDate, maxDate);
-        qDebug() << "X-axis range set successfully:" << minDate.toString() << "-" << maxDate.toString();
     }
 }
+/**
+ * @brief 设置每行金额换算到报表币种的系数，下次updateDataAsync时生效
+ * @param factors 与模型行一一对应的系数，NaN表示缺少汇率（该行不绘制），为空表示不换算
+ */
+void CurveGraph::setConversionFactors(const QVector<double> &factors)
+{
+    rowFactors = factors;
+}
+
+/**
+ * @brief 记录图表当前对应的数据版本（增量追加后调用）
+ * @param dataVersion 模型的数据版本
+ */
+void CurveGraph::setDataVersion(quint64 dataVersion)
+{
+    builtVersion = dataVersion;
+}
+
+/**
+ * @brief 设置开启动画的数据点上限，超过后关闭动画
+ * @param points 数据点数量
+ */
+void CurveGraph::setAnimationPointLimit(int points)
+{
+    animationPointLimit = qMax(0, points);
+    updateAnimationOptions();
+}
+
+/**
+ * @brief 数据点较多时关闭动画，避免每次更新都逐帧重绘整个场景
+ */
+void CurveGraph::updateAnimationOptions()
+{
+    int totalPoints = 0;
+    for (QLineSeries *columnSeries : amountSeries) {
+        totalPoints += columnSeries->count();
+    }
+    QChart::AnimationOptions options = totalPoints > animationPointLimit ? QChart::NoAnimation
+                                                                         : QChart::AllAnimations;
+    if (chart->animationOptions() != options) {
+        chart->setAnimationOptions(options);
+    }
+}
+
+/**
+ * @brief 显示或隐藏某个金额列的曲线，只用缓存的统计结果调整坐标轴
+ * @param column 模型列号（ColTotalDeposit ~ ColDisposable）
+ * @param visible 是否显示
+ */
+void CurveGraph::setSeriesVisible(int column, bool visible)
+{
+    const int index = column - ColTotalDeposit;
+    if (index < 0 || index >= LedgerAmountColumnCount) {
+        return;
+    }
+    amountSeries[index]->setVisible(visible);
+    updateValueAxes();
+}
+
+/**
+ * @brief 金额列曲线的默认显隐状态，默认只显示当前总存款金额
+ * @param column 模型列号
+ */
+bool CurveGraph::isSeriesVisibleByDefault(int column)
+{
+    return column == ColTotalDeposit;
+}
+
+bool CurveGraph::isSeriesVisible(int column) const
+{
+    const int index = column - ColTotalDeposit;
+    if (index < 0 || index >= LedgerAmountColumnCount) {
+        return false;
+    }
+    return amountSeries[index]->isVisible();
+}
+
+/**
+ * @brief 根据可见曲线的统计结果设置左右两个Y轴的范围
+ */
+void CurveGraph::updateValueAxes()
+{
+    // 坐标范围可能变化，已显示的十字线位置随之失效
+    clearHover();
+    
+    double stockMin = 0.0, stockMax = 0.0, flowMin = 0.0, flowMax = 0.0;
+    bool hasStock = false, hasFlow = false;
+    
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        const ColumnStats &stats = amountStats[i];
+        if (!amountSeries[i]->isVisible() || stats.isEmpty()) {
+            continue;
+        }
+        if (isFlowColumn(i)) {
+            flowMin = hasFlow ? qMin(flowMin, stats.min) : stats.min;
+            flowMax = hasFlow ? qMax(flowMax, stats.max) : stats.max;
+            hasFlow = true;
+        } else {
+            stockMin = hasStock ? qMin(stockMin, stats.min) : stats.min;
+            stockMax = hasStock ? qMax(stockMax, stats.max) : stats.max;
+            hasStock = true;
+        }
+    }
+    
+    // 预测的P5可能为负数，此时主坐标轴不限制最小值
+    if (projectionVisible) {
+        stockMin = hasStock ? qMin(stockMin, projectionMin) : projectionMin;
+        stockMax = hasStock ? qMax(stockMax, projectionMax) : projectionMax;
+        hasStock = true;
+    }
+    
+    if (hasStock) {
+        applyAxisRange(axisY, stockMin, stockMax, !projectionVisible || projectionMin >= 0);
+    }
+    axisYFlow->setVisible(hasFlow);
+    if (hasFlow) {
+        // 当月开支可能为负数，副坐标轴不限制最小值
+        applyAxisRange(axisYFlow, flowMin, flowMax, false);
+    }
+}
+
+/**
+ * @brief 为金额轴设置带边距的整数刻度范围
+ * @param axis 金额轴
+ * @param minAmount 数据最小值
+ * @param maxAmount 数据最大值
+ * @param clampAtZero 是否保证最小值不小于0
+ */
+void CurveGraph::applyAxisRange(QValueAxis *axis, double minAmount, double maxAmount, bool clampAtZero)
+{
+    double range = maxAmount - minAmount;
+    double margin;
+    
+    // 如果只有一个数据点或范围很小，使用固定边距
+    if (range < 1.0) {
+        margin = 50.0; // 使用固定边距
+    } else {
+        margin = range * 0.1; // 正常情况下添加10%的边距
+    }
+    
+    minAmount = minAmount - margin;
+    if (clampAtZero) {
+        // 确保最小值不小于0
+        minAmount = qMax(0.0, minAmount);
+    }
+    maxAmount = maxAmount + margin;
+    
+    // 按轴范围选择整齐的整数刻度间隔，大额账本也不会挤出几十个刻度
+    const double tickInterval = niceTickInterval(maxAmount - minAmount);
+    
+    // 确保刻度值为整数，并且Y轴范围是tickInterval的整数倍
+    minAmount = floor(minAmount / tickInterval) * tickInterval;
+    maxAmount = ceil(maxAmount / tickInterval) * tickInterval;
+    
+    // 应用设置
+    axis->setRange(minAmount, maxAmount);
+    axis->setTickInterval(tickInterval);
+    
+    // 强制设置刻度数量，避免自动生成非整数刻度
+    int tickCount = qRound((maxAmount - minAmount) / tickInterval) + 1;
+    axis->setTickCount(tickCount);
+}
+
+/**
+ * @brief 将图表绘制到任意绘图设备上，用于无界面批量渲染
+ * @param painter 绘图对象（可以是QImage、QSvgGenerator或QPdfWriter）
+ * @param target 目标区域
+ */
+void CurveGraph::render(QPainter *painter, const QRectF &target)
+{
+    // 图表已显示在界面上时直接由视图绘制，不能挪到离屏场景
+    if (chartView) {
+        chartView->render(painter, target);
+        return;
+    }
+    
+    if (!offscreenScene) {
+        offscreenScene = new QGraphicsScene(this);
+        offscreenScene->addItem(chart);
+    }
+    
+    // 工作线程没有事件循环，调整尺寸后需要立即完成布局
+    chart->resize(target.size());
+    if (chart->layout()) {
+        chart->layout()->activate();
+    }
+    offscreenScene->setSceneRect(QRectF(QPointF(0, 0), target.size()));
+    offscreenScene->render(painter, target, offscreenScene->sceneRect());
+}
 
 /**
  * @brief 初始化图表视图
@@ -251,43 +573,292 @@ void CurveGraph::initChartView(QChartView *chartView)
     chartView->setChart(chart);
     chartView->setRenderHint(QPainter::Antialiasing);
     
-    // 设置图表视图的样式
-    chartView->setStyleSheet(
-        "QChartView { background-color: #2a2a2a; color: white; }" 
-        "QChart { background-color: #2a2a2a; color: white; }"
-        "QChart::title { color: white; font-size: 16px; }"
-        "QValueAxis { color: white; }"
-        "QValueAxis::title { color: white; }"
-        "QValueAxis::label { color: white; }"
-        "QDateTimeAxis { color: white; }"
-        "QDateTimeAxis::title { color: white; }"
-        "QDateTimeAxis::label { color: white; }"
-        "QLegend { color: white; }"
-    );
+    // 设置图表视图的背景（QChart自身不受样式表影响，只需设置视图背景）
+    chartView->setBackgroundBrush(QColor("#2a2a2a"));
+    
+    // 带缓存的视图支持悬停十字线：视图只上报鼠标位置，查找和提示内容在这里完成
+    if (CachedChartView *cachedView = qobject_cast<CachedChartView*>(chartView)) {
+        connect(cachedView, &CachedChartView::hoverMoved, this, [this, cachedView](const QPoint &position) {
+            updateHover(cachedView, position);
+        });
+        connect(cachedView, &CachedChartView::hoverLeft, cachedView, &CachedChartView::clearCrosshair);
+    }
 }
 
 /**
- * @brief 格式化日期
- * @param dateStr 日期字符串
- * @return 返回QDateTime对象
+ * @brief 查找时间上最近的记录（对按时间排序的时间戳二分查找，O(log n)）
+ * @param x 时间戳（毫秒）
+ * @return 返回记录下标，没有记录时返回-1
  */
-QDateTime CurveGraph::formatDate(const QString &dateStr)
+int CurveGraph::nearestRecord(double x) const
 {
-    // 支持多种日期格式
-    QStringList formats = {
-        "yyyy/MM/dd",
-        "yyyy-MM-dd",
-        "MM/dd/yyyy",
-        "dd/MM/yyyy"
+    if (hoverX.isEmpty()) {
+        return -1;
+    }
+    const int index = std::lower_bound(hoverX.cbegin(), hoverX.cend(), x) - hoverX.cbegin();
+    if (index == hoverX.size()) {
+        return index - 1;
+    }
+    if (index > 0 && x - hoverX[index - 1] <= hoverX[index] - x) {
+        return index - 1;
+    }
+    return index;
+}
+
+/**
+ * @brief 鼠标悬停时查找最近的记录，在视图前景层显示十字线和各列数值
+ * @param view 图表视图
+ * @param position 鼠标的视口坐标
+ */
+void CurveGraph::updateHover(CachedChartView *view, const QPoint &position)
+{
+    const QPointF chartPosition = chart->mapFromScene(view->mapToScene(position));
+    const QRectF plotArea = chart->plotArea();
+    if (hoverX.isEmpty() || !plotArea.contains(chartPosition)) {
+        view->clearCrosshair();
+        return;
+    }
+    
+    // 只做一次坐标换算和一次二分查找，不遍历曲线的数据点
+    const int index = nearestRecord(chart->mapToValue(chartPosition, series).x());
+    const double x = hoverX[index];
+    auto toViewport = [this, view](const QPointF &point) {
+        return QPointF(view->mapFromScene(chart->mapToScene(point)));
     };
     
-    for (const QString &format : formats) {
-        QDateTime date = QDateTime::fromString(dateStr, format);
-        if (date.isValid()) {
-            return date;
+    CachedChartView::Crosshair crosshair;
+    crosshair.plotArea = QRectF(toViewport(plotArea.topLeft()), toViewport(plotArea.bottomRight()));
+    crosshair.position = QPointF(toViewport(chart->mapToPosition(QPointF(x, 0), series)).x(), position.y());
+    crosshair.lines << QDateTime::fromMSecsSinceEpoch(qint64(x)).toString("yyyy-MM-dd");
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        const double amount = hoverValues[i][index];
+        crosshair.lines << QString("%1：%2").arg(amountSeries[i]->name(),
+                                                 std::isnan(amount) ? QString("—") : QString::number(amount, 'f', 2));
+        if (!std::isnan(amount) && amountSeries[i]->isVisible()) {
+            crosshair.markers << toViewport(chart->mapToPosition(QPointF(x, amount), amountSeries[i]));
+            crosshair.markerColors << amountSeries[i]->pen().color();
         }
     }
+    view->setCrosshair(crosshair);
+}
+
+/**
+ * @brief 数据或坐标轴变化后隐藏已过期的十字线
+ */
+void CurveGraph::clearHover()
+{
+    if (CachedChartView *cachedView = qobject_cast<CachedChartView*>(chartView)) {
+        cachedView->clearCrosshair();
+    }
+}
+
+/**
+ * @brief 追加一条新记录，各曲线和叠加线均为O(1)增量更新
+ * @param record 新记录（日期必须晚于已有数据点）
+ * @param factor 换算到报表币种的系数，NaN表示缺少汇率
+ */
+void CurveGraph::appendRecord(const LedgerRecord &record, double factor)
+{
+    if (!record.date.isValid() || std::isnan(factor)) {
+        return;
+    }
     
-    qDebug() << "Invalid date format:" << dateStr;
-    return QDateTime();
-}
\ No newline at end of file
+    const QDateTime date = record.date.startOfDay();
+    const double x = date.toMSecsSinceEpoch();
+    if (lastRecordX > 0 && x <= lastRecordX) {
+        qDebug() << "appendRecord: date is not later than the last point" << record.date;
+        return;
+    }
+    const bool firstRecord = lastRecordX <= 0;
+    lastRecordX = x;
+    hoverX.append(x);
+    
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        if (!record.hasAmount(i)) {
+            hoverValues[i].append(std::numeric_limits<double>::quiet_NaN());
+            continue;
+        }
+        const double amount = record.amount(i) * factor;
+        hoverValues[i].append(amount);
+        if (i == 0 && amount < 0) {
+            continue;
+        }
+        amountSeries[i]->append(x, amount);
+        
+        // 增量维护坐标轴所需的统计量
+        ColumnStats &stats = amountStats[i];
+        stats.min = stats.isEmpty() ? amount : qMin(stats.min, amount);
+        stats.max = stats.isEmpty() ? amount : qMax(stats.max, amount);
+        stats.sum += amount;
+        stats.count++;
+        stats.mean = stats.sum / stats.count;
+        
+        if (i == 0) {
+            smaSeries->append(x, sma.push(amount));
+            emaSeries->append(x, ema.push(amount));
+            regression.push(x, amount);
+            if (regression.count() == 1) {
+                firstX = x;
+            }
+            lastX = x;
+            updateTrendLine();
+        }
+    }
+    
+    // 只在新数据点超出当前坐标范围时扩展坐标轴
+    if (firstRecord) {
+        axisX->setRange(date.addDays(-1), date.addDays(1));
+    } else if (date > axisX->max()) {
+        axisX->setMax(date);
+    }
+    updateValueAxes();
+    updateAnimationOptions();
+}
+
+/**
+ * @brief 显示或隐藏叠加线
+ * @param overlay 叠加线类型
+ * @param visible 是否显示
+ */
+void CurveGraph::setOverlayVisible(Overlay overlay, bool visible)
+{
+    switch (overlay) {
+    case SimpleAverageOverlay:
+        smaSeries->setVisible(visible);
+        break;
+    case ExponentialAverageOverlay:
+        emaSeries->setVisible(visible);
+        break;
+    case TrendLineOverlay:
+        trendSeries->setVisible(visible);
+        break;
+    }
+}
+
+/**
+ * @brief 设置移动平均的月数，会按已有数据点重新计算叠加线
+ * @param months 月数
+ */
+void CurveGraph::setMovingAverageWindow(int months)
+{
+    months = qMax(1, months);
+    sma.setWindow(months);
+    ema.setSpan(months);
+    smaSeries->setName(QString("%1月简单移动平均").arg(months));
+    emaSeries->setName(QString("%1月指数移动平均").arg(months));
+    
+    // 窗口变化后旧的累计值失效，只能按已有数据点重算一次
+    rebuildOverlays(series->points());
+}
+
+int CurveGraph::movingAverageWindow() const
+{
+    return sma.window();
+}
+
+/**
+ * @brief 根据当前曲线的数据点重建所有叠加线
+ * @param points 按时间排序的数据点
+ */
+void CurveGraph::rebuildOverlays(const QList<QPointF> &points)
+{
+    sma.reset();
+    ema.reset();
+    regression.reset();
+    firstX = lastX = 0.0;
+    
+    QList<QPointF> smaPoints;
+    QList<QPointF> emaPoints;
+    smaPoints.reserve(points.size());
+    emaPoints.reserve(points.size());
+    for (const QPointF &point : points) {
+        smaPoints.append(QPointF(point.x(), sma.push(point.y())));
+        emaPoints.append(QPointF(point.x(), ema.push(point.y())));
+        regression.push(point.x(), point.y());
+    }
+    if (!points.isEmpty()) {
+        firstX = points.first().x();
+        lastX = points.last().x();
+    }
+    
+    smaSeries->replace(smaPoints);
+    emaSeries->replace(emaPoints);
+    updateTrendLine();
+}
+
+/**
+ * @brief 用回归结果刷新趋势线的两个端点
+ */
+void CurveGraph::updateTrendLine()
+{
+    if (regression.count() < 2) {
+        trendSeries->clear();
+        return;
+    }
+    trendSeries->replace(QList<QPointF>{
+        QPointF(firstX, regression.valueAt(firstX)),
+        QPointF(lastX, regression.valueAt(lastX))
+    });
+}
+
+/**
+ * @brief 在存款曲线之后绘制存款预测的扇形区间（P5~P95、P25~P75两层色带和中位数线）
+ * @param result 预测结果
+ */
+void CurveGraph::setProjection(const ProjectionEngine::Result &result)
+{
+    if (result.isEmpty()) {
+        clearProjection();
+        return;
+    }
+    
+    projectionMin = 0.0;
+    projectionMax = 0.0;
+    for (int band = 0; band < ProjectionEngine::BandCount; ++band) {
+        QList<QPointF> points;
+        points.reserve(result.dates.size());
+        for (int i = 0; i < result.dates.size(); ++i) {
+            const double value = result.bands[band][i];
+            points.append(QPointF(result.dates[i].startOfDay().toMSecsSinceEpoch(), value));
+            if (band == 0 && i == 0) {
+                projectionMin = projectionMax = value;
+            }
+            projectionMin = qMin(projectionMin, value);
+            projectionMax = qMax(projectionMax, value);
+        }
+        projectionLines[band]->replace(points);
+    }
+    projectionEndX = result.dates.last().startOfDay().toMSecsSinceEpoch();
+    projectionVisible = true;
+    projectionOuter->setVisible(true);
+    projectionInner->setVisible(true);
+    projectionLines[ProjectionEngine::P50]->setVisible(true);
+    
+    const QDateTime endDate = QDateTime::fromMSecsSinceEpoch(projectionEndX);
+    if (endDate > axisX->max()) {
+        axisX->setMax(endDate);
+    }
+    updateValueAxes();
+}
+
+/**
+ * @brief 清除存款预测
+ */
+void CurveGraph::clearProjection()
+{
+    if (!projectionVisible) {
+        return;
+    }
+    projectionVisible = false;
+    for (QLineSeries *line : projectionLines) {
+        line->clear();
+    }
+    projectionOuter->setVisible(false);
+    projectionInner->setVisible(false);
+    projectionLines[ProjectionEngine::P50]->setVisible(false);
+    
+    if (lastRecordX > 0) {
+        axisX->setMax(QDateTime::fromMSecsSinceEpoch(lastRecordX));
+    }
+    updateValueAxes();
+}
@@ -4,19 +4,42 @@
 #include <QObject>
 #include <QStandardItemModel>
 #include <QDateTime>
+#include "trendOverlay.h"
+#include "ledgerrecord.h"
+#include "ledgerstats.h"
+#include "ledgersnapshot.h"
+#include "taskscheduler.h"
+#include "projectionengine.h"
+#include <QList>
+#include <QPointF>
 
 // Forward declarations for QtCharts classes
 class QChart;
 class QLineSeries;
+class QAreaSeries;
 class QDateTimeAxis;
 class QValueAxis;
 class QChartView;
+class QGraphicsScene;
+class QPainter;
+class CachedChartView;
 
 class CurveGraph : public QObject
 {
     Q_OBJECT
 
 public:
+    static constexpr int DefaultAnimationPointLimit = 500;  //!< 默认开启动画的数据点上限
+
+    /**
+     * @brief 可叠加在存款曲线上的辅助线
+     */
+    enum Overlay {
+        SimpleAverageOverlay,       //!< N月简单移动平均
+        ExponentialAverageOverlay,  //!< N月指数移动平均
+        TrendLineOverlay            //!< 最小二乘趋势线
+    };
+
     /**
      * @brief 构造函数
      * @param parent 父对象指针
@@ -29,23 +52,174 @@ public:
     ~CurveGraph();
 
     /**
-     * @brief 更新图表数据
-     * @param model 数据模型指针
+     * @brief 由快照计算出的曲线数据
+     */
+    struct SeriesData
+    {
+        quint64 version = 0;                                //!< 快照的数据版本
+        QList<QPointF> points[LedgerAmountColumnCount];     //!< 各金额列的数据点
+        ColumnStats stats[LedgerAmountColumnCount];         //!< 各金额列的统计结果
+        QVector<double> recordX;                            //!< 各记录的时间戳（升序），悬停时二分查找
+        QVector<double> recordValues[LedgerAmountColumnCount]; //!< 各记录换算后的金额，NaN表示空单元格
+        double minX = 0.0;                                  //!< 最早的时间戳
+        double maxX = 0.0;                                  //!< 最晚的时间戳
+        bool hasX = false;                                  //!< 是否有数据点
+    };
+
+    /**
+     * @brief 由快照计算各金额列的数据点与统计结果，不访问任何QtCharts对象，可在工作线程中调用
+     * @param snapshot 账本快照
+     * @param factors 每行换算到报表币种的系数，NaN表示缺少汇率（该行不绘制），为空表示不换算
+     * @param token 取消标记，被取消时尽早返回不完整的结果
+     * @return 返回曲线数据
+     */
+    static SeriesData buildSeries(const LedgerSnapshot &snapshot, const QVector<double> &factors,
+                                  const TaskScheduler::CancellationToken &token = TaskScheduler::CancellationToken());
+    
+    /**
+     * @brief 用计算好的数据替换各曲线、重建叠加线并调整坐标轴（GUI线程）
+     * @param data 曲线数据
+     */
+    void applySeries(const SeriesData &data);
+    
+    /**
+     * @brief 设置后台计算调度器，未设置时updateDataAsync退化为同步更新
+     * @param scheduler 调度器指针（不接管所有权）
+     */
+    void setScheduler(TaskScheduler *scheduler);
+    
+    /**
+     * @brief 以"可见图表"优先级在后台由快照计算曲线数据，完成后回到GUI线程替换曲线；
+     *        新的请求会取消尚未交付的旧请求
+     * @param snapshot 账本快照
+     * @return 已开始计算返回true；图表已是该版本或正在计算该版本时返回false
+     */
+    bool updateDataAsync(const LedgerSnapshotPtr &snapshot);
+    
+    /**
+     * @brief 是否有尚未完成的异步更新（此时不应增量追加记录）
      */
-    void updateData(QStandardItemModel *model);
+    bool isUpdating() const { return pendingVersion != 0; }
+    
+    /**
+     * @brief 记录图表当前对应的数据版本（增量追加后调用）
+     * @param dataVersion 模型的数据版本
+     */
+    void setDataVersion(quint64 dataVersion);
+    
+    /**
+     * @brief 设置开启动画的数据点上限，超过后关闭动画
+     * @param points 数据点数量
+     */
+    void setAnimationPointLimit(int points);
+    
+    /**
+     * @brief 将图表绘制到任意绘图设备上，用于无界面批量渲染
+     * @param painter 绘图对象（可以是QImage、QSvgGenerator或QPdfWriter）
+     * @param target 目标区域
+     */
+    void render(QPainter *painter, const QRectF &target);
     
     /**
      * @brief 初始化图表视图
      * @param chartView 图表视图指针
      */
     void initChartView(QChartView *chartView);
+    
+    /**
+     * @brief 设置每行金额换算到报表币种的系数，下次updateDataAsync时生效
+     * @param factors 与模型行一一对应的系数，NaN表示缺少汇率（该行不绘制），为空表示不换算
+     */
+    void setConversionFactors(const QVector<double> &factors);
+    
+    /**
+     * @brief 追加一条新记录，各曲线和叠加线均为O(1)增量更新
+     * @param record 新记录（日期必须晚于已有数据点）
+     * @param factor 换算到报表币种的系数，NaN表示缺少汇率
+     */
+    void appendRecord(const LedgerRecord &record, double factor = 1.0);
+    
+    /**
+     * @brief 显示或隐藏某个金额列的曲线，不会重新遍历数据
+     * @param column 模型列号（ColTotalDeposit ~ ColDisposable）
+     * @param visible 是否显示
+     */
+    void setSeriesVisible(int column, bool visible);
+    bool isSeriesVisible(int column) const;
+    
+    /**
+     * @brief 金额列曲线的默认显隐状态（图表尚未创建时用于初始化菜单）
+     * @param column 模型列号
+     */
+    static bool isSeriesVisibleByDefault(int column);
+    
+    /**
+     * @brief 显示或隐藏叠加线
+     * @param overlay 叠加线类型
+     * @param visible 是否显示
+     */
+    void setOverlayVisible(Overlay overlay, bool visible);
+    
+    /**
+     * @brief 设置移动平均的月数，会按已有数据点重新计算叠加线
+     * @param months 月数
+     */
+    void setMovingAverageWindow(int months);
+    int movingAverageWindow() const;
+    
+    /**
+     * @brief 在存款曲线之后绘制存款预测的扇形区间（P5~P95、P25~P75两层色带和中位数线）
+     * @param result 预测结果
+     */
+    void setProjection(const ProjectionEngine::Result &result);
+    
+    /**
+     * @brief 清除存款预测
+     */
+    void clearProjection();
+    bool hasProjection() const { return projectionVisible; }
+    
+    /**
+     * @brief 查找时间上最近的记录（对按时间排序的时间戳二分查找，O(log n)）
+     * @param x 时间戳（毫秒）
+     * @return 返回记录下标，没有记录时返回-1
+     */
+    int nearestRecord(double x) const;
 
 private:
     QChart *chart;              //!< 图表对象
-    QLineSeries *series;        //!< 曲线系列
+    QLineSeries *series;        //!< 曲线系列（当前总存款金额）
+    QLineSeries *amountSeries[LedgerAmountColumnCount];  //!< 各金额列曲线，下标0即series
+    ColumnStats amountStats[LedgerAmountColumnCount];    //!< 各金额列的统计结果
+    QLineSeries *smaSeries;     //!< 简单移动平均线
+    QLineSeries *emaSeries;     //!< 指数移动平均线
+    QLineSeries *trendSeries;   //!< 趋势线
+    QLineSeries *projectionLines[ProjectionEngine::BandCount]; //!< 预测分位线，P50即中位数线，其余为色带边界
+    QAreaSeries *projectionOuter; //!< 预测色带（P5 ~ P95）
+    QAreaSeries *projectionInner; //!< 预测色带（P25 ~ P75）
     QDateTimeAxis *axisX;       //!< X轴（日期轴）
-    QValueAxis *axisY;          //!< Y轴（金额轴）
-    QChartView *chartView;      //!< 图表视图
+    QValueAxis *axisY;          //!< Y轴（存量金额轴）
+    QValueAxis *axisYFlow;      //!< 副Y轴（当月流量金额轴）
+    QChartView *chartView = nullptr; //!< 图表视图
+    QGraphicsScene *offscreenScene = nullptr; //!< 无界面渲染时使用的离屏场景
+    
+    SimpleMovingAverage sma;            //!< 简单移动平均计算器
+    ExponentialMovingAverage ema;       //!< 指数移动平均计算器
+    OnlineLinearRegression regression;  //!< 在线线性回归
+    double firstX = 0.0;                //!< 第一个数据点的时间戳
+    double lastX = 0.0;                 //!< 最后一个数据点的时间戳
+    double lastRecordX = 0.0;           //!< 最后一条记录的时间戳
+    quint64 builtVersion = 0;           //!< 图表已构建的数据版本（0表示未构建）
+    quint64 pendingVersion = 0;         //!< 正在工作线程中计算的数据版本（0表示没有）
+    TaskScheduler *scheduler = nullptr; //!< 后台计算调度器
+    QVector<double> rowFactors;         //!< 每行换算到报表币种的系数
+    int animationPointLimit = DefaultAnimationPointLimit; //!< 开启动画的数据点上限
+    bool projectionVisible = false;     //!< 是否显示存款预测
+    double projectionMin = 0.0;         //!< 预测P5的最小值
+    double projectionMax = 0.0;         //!< 预测P95的最大值
+    double projectionEndX = 0.0;        //!< 预测最后一个时点的时间戳
+    QVector<double> hoverX;             //!< 各记录的时间戳（升序），用于悬停查找
+    QVector<double> hoverValues[LedgerAmountColumnCount]; //!< 各记录换算后的金额，NaN表示空单元格
     
     /**
      * @brief 初始化图表
@@ -53,11 +227,42 @@ private:
     void initChart();
     
     /**
-     * @brief 格式化日期
-     * @param dateStr 日期字符串
-     * @return 返回QDateTime对象
+     * @brief 根据当前曲线的数据点重建所有叠加线
+     * @param points 按时间排序的数据点
+     */
+    void rebuildOverlays(const QList<QPointF> &points);
+    
+    /**
+     * @brief 用回归结果刷新趋势线的两个端点
+     */
+    void updateTrendLine();
+    
+    /**
+     * @brief 根据可见曲线的统计结果设置左右两个Y轴的范围
+     */
+    void updateValueAxes();
+    
+    /**
+     * @brief 为金额轴设置带边距的整数刻度范围
+     */
+    void applyAxisRange(QValueAxis *axis, double minAmount, double maxAmount, bool clampAtZero);
+    
+    /**
+     * @brief 数据点较多时关闭动画，避免每次更新都逐帧重绘整个场景
+     */
+    void updateAnimationOptions();
+    
+    /**
+     * @brief 鼠标悬停时查找最近的记录，在视图前景层显示十字线和各列数值
+     * @param view 图表视图
+     * @param position 鼠标的视口坐标
+     */
+    void updateHover(CachedChartView *view, const QPoint &position);
+    
+    /**
+     * @brief 数据或坐标轴变化后隐藏已过期的十字线
      */
-    QDateTime formatDate(const QString &dateStr);
+    void clearHover();
 };
 
 #endif // CURVEGRAPH_H
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "trendOverlay.h"
+
+SimpleMovingAverage::SimpleMovingAverage(int window)
+{
+    setWindow(window);
+}
+
+/**
+ * @brief 设置窗口大小，会清空已有数据
+ * @param window 窗口大小（至少为1）
+ */
+void SimpleMovingAverage::setWindow(int window)
+{
+    ring.fill(0.0, qMax(1, window));
+    reset();
+}
+
+void SimpleMovingAverage::reset()
+{
+    ring.fill(0.0);
+    head = 0;
+    filled = 0;
+    sum = 0.0;
+}
+
+double SimpleMovingAverage::push(double value)
+{
+    // 窗口已满时先减去即将被覆盖的最旧值
+    if (filled == ring.size()) {
+        sum -= ring[head];
+    } else {
+        ++filled;
+    }
+    ring[head] = value;
+    sum += value;
+    head = (head + 1) % ring.size();
+    return sum / filled;
+}
+
+ExponentialMovingAverage::ExponentialMovingAverage(int span)
+{
+    setSpan(span);
+}
+
+/**
+ * @brief 设置平滑跨度，会清空已有数据
+ * @param span 跨度N（至少为1）
+ */
+void ExponentialMovingAverage::setSpan(int span)
+{
+    alpha = 2.0 / (qMax(1, span) + 1.0);
+    reset();
+}
+
+void ExponentialMovingAverage::reset()
+{
+    current = 0.0;
+    started = false;
+}
+
+double ExponentialMovingAverage::push(double value)
+{
+    if (!started) {
+        current = value;
+        started = true;
+    } else {
+        current += alpha * (value - current);
+    }
+    return current;
+}
+
+void OnlineLinearRegression::reset()
+{
+    n = 0;
+    meanX = meanY = 0.0;
+    sxx = sxy = 0.0;
+}
+
+void OnlineLinearRegression::push(double x, double y)
+{
+    ++n;
+    const double dx = x - meanX;
+    meanX += dx / n;
+    meanY += (y - meanY) / n;
+    // 使用更新前的 dx 与更新后的均值，保证 sxx/sxy 与两遍算法一致
+    sxx += dx * (x - meanX);
+    sxy += dx * (y - meanY);
+}
+
+double OnlineLinearRegression::slope() const
+{
+    return sxx > 0.0 ? sxy / sxx : 0.0;
+}
+
+double OnlineLinearRegression::intercept() const
+{
+    return meanY - slope() * meanX;
+}
@@ -0,0 +1,85 @@
+#ifndef TRENDOVERLAY_H
+#define TRENDOVERLAY_H
+
+#include <QVector>
+
+/*
+    图表叠加线使用的增量计算器，每追加一个数据点的代价都是 O(1)：
+    - SimpleMovingAverage      ：环形缓冲区 + 窗口内累计和
+    - ExponentialMovingAverage ：只保存上一次的平均值
+    - OnlineLinearRegression   ：以均值为中心的在线最小二乘（Welford形式），
+                                 x 为毫秒时间戳时也不会因数值过大丢失精度
+*/
+
+/**
+ * @brief N点简单移动平均
+ */
+class SimpleMovingAverage
+{
+public:
+    explicit SimpleMovingAverage(int window = 6);
+
+    void setWindow(int window);
+    int window() const { return ring.size(); }
+    void reset();
+
+    /**
+     * @brief 追加一个值
+     * @return 返回追加后的窗口平均值（不足N个时为已有值的平均）
+     */
+    double push(double value);
+
+    /**
+     * @brief 窗口是否已填满
+     */
+    bool isReady() const { return filled == ring.size(); }
+
+private:
+    QVector<double> ring;   //!< 环形缓冲区
+    int head = 0;           //!< 下一个写入位置
+    int filled = 0;         //!< 已填充数量
+    double sum = 0.0;       //!< 窗口内累计和
+};
+
+/**
+ * @brief 指数移动平均，平滑系数 alpha = 2 / (N + 1)
+ */
+class ExponentialMovingAverage
+{
+public:
+    explicit ExponentialMovingAverage(int span = 6);
+
+    void setSpan(int span);
+    void reset();
+    double push(double value);
+    double value() const { return current; }
+
+private:
+    double alpha;
+    double current = 0.0;
+    bool started = false;
+};
+
+/**
+ * @brief 在线最小二乘线性回归 y = slope * x + intercept
+ */
+class OnlineLinearRegression
+{
+public:
+    void reset();
+    void push(double x, double y);
+
+    qint64 count() const { return n; }
+    double slope() const;
+    double intercept() const;
+    double valueAt(double x) const { return slope() * x + intercept(); }
+
+private:
+    qint64 n = 0;
+    double meanX = 0.0;
+    double meanY = 0.0;
+    double sxx = 0.0;   //!< Σ(x - meanX)^2
+    double sxy = 0.0;   //!< Σ(x - meanX)(y - meanY)
+};
+
+#endif // TRENDOVERLAY_H
@@ -0,0 +1,342 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 17:10:26
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 17:10:26
+ * @Description: 基于QPalette与QProxyStyle的暗色主题
+ */
+#include "darkstyle.h"
+#include <QApplication>
+#include <QPainter>
+#include <QPainterPath>
+#include <QStyleOption>
+#include <QMainWindow>
+#include <QDialog>
+#include <QTabWidget>
+#include <QTabBar>
+#include <QStatusBar>
+#include <QMenuBar>
+#include <QGroupBox>
+#include <QPushButton>
+#include <QLineEdit>
+#include <QAbstractSpinBox>
+#include <QAbstractItemView>
+#include <QHeaderView>
+
+namespace {
+
+const qreal ButtonRadius = 6;           //!< 主窗口按钮圆角
+const qreal DialogButtonRadius = 4;     //!< 对话框按钮圆角
+const qreal InputRadius = 6;            //!< 输入框圆角
+const qreal GroupBoxRadius = 8;         //!< 分组框圆角
+const qreal TabRadius = 8;              //!< 标签页顶部圆角
+const int TabSpacing = 2;               //!< 标签页之间的间距
+
+/**
+ * @brief 设置控件调色板中单个角色的颜色
+ */
+void setWidgetColor(QWidget *widget, QPalette::ColorRole role, const QColor &color)
+{
+    QPalette palette = widget->palette();
+    palette.setColor(role, color);
+    widget->setPalette(palette);
+}
+
+} // namespace
+
+/**
+ * @brief 构造函数，以Fusion风格为基础
+ */
+DarkStyle::DarkStyle()
+    : QProxyStyle("Fusion")
+{
+}
+
+/**
+ * @brief 把暗色主题安装到应用程序（风格、调色板、字体）
+ * @param app 应用程序对象
+ */
+void DarkStyle::apply(QApplication *app)
+{
+    DarkStyle *style = new DarkStyle;
+    app->setStyle(style);
+    app->setPalette(style->standardPalette());
+
+    QFont font = app->font();
+    font.setFamilies({"Microsoft YaHei", "Segoe UI", "Arial"});
+    app->setFont(font);
+}
+
+/**
+ * @brief 设置输入控件的只读外观，只修改控件调色板，不触发样式表解析
+ * @param widget 输入控件
+ * @param readOnly 是否只读
+ */
+void DarkStyle::setReadOnlyAppearance(QWidget *widget, bool readOnly)
+{
+    QPalette palette = widget->palette();
+    palette.setColor(QPalette::Base, Colors::control());
+    palette.setColor(QPalette::Text, readOnly ? Colors::disabledText() : Colors::text());
+    widget->setPalette(palette);
+}
+
+/**
+ * @brief 暗色调色板
+ */
+QPalette DarkStyle::standardPalette() const
+{
+    QPalette palette;
+    palette.setColor(QPalette::Window, Colors::panel());
+    palette.setColor(QPalette::WindowText, Colors::text());
+    palette.setColor(QPalette::Base, Colors::panel());
+    palette.setColor(QPalette::AlternateBase, Colors::alternate());
+    palette.setColor(QPalette::Text, Colors::text());
+    palette.setColor(QPalette::Button, Colors::border());
+    palette.setColor(QPalette::ButtonText, Colors::text());
+    palette.setColor(QPalette::BrightText, Colors::text());
+    palette.setColor(QPalette::Highlight, Colors::accent());
+    palette.setColor(QPalette::HighlightedText, Colors::text());
+    palette.setColor(QPalette::ToolTipBase, Colors::control());
+    palette.setColor(QPalette::ToolTipText, Colors::text());
+    palette.setColor(QPalette::PlaceholderText, Colors::disabledText());
+    palette.setColor(QPalette::Light, Colors::border());
+    palette.setColor(QPalette::Midlight, Colors::controlHover());
+    palette.setColor(QPalette::Mid, Colors::control());
+    palette.setColor(QPalette::Dark, Colors::window());
+    palette.setColor(QPalette::Shadow, Qt::black);
+    palette.setColor(QPalette::Link, Colors::accent());
+
+    for (QPalette::ColorRole role : {QPalette::WindowText, QPalette::Text, QPalette::ButtonText}) {
+        palette.setColor(QPalette::Disabled, role, Colors::disabledText());
+    }
+    return palette;
+}
+
+/**
+ * @brief 控件首次显示前调用一次，按控件类型设置调色板与字体
+ * @param widget 控件指针
+ */
+void DarkStyle::polish(QWidget *widget)
+{
+    QProxyStyle::polish(widget);
+
+    if (qobject_cast<QMainWindow*>(widget)) {
+        setWidgetColor(widget, QPalette::Window, Colors::window());
+    } else if (qobject_cast<QTabWidget*>(widget) || qobject_cast<QMenuBar*>(widget)
+               || qobject_cast<QGroupBox*>(widget)) {
+        setWidgetColor(widget, QPalette::Window, Colors::panel());
+    } else if (qobject_cast<QStatusBar*>(widget)) {
+        QPalette palette = widget->palette();
+        palette.setColor(QPalette::Window, Colors::panel());
+        palette.setColor(QPalette::WindowText, Colors::dimText());
+        widget->setAutoFillBackground(true);
+        widget->setPalette(palette);
+    } else if (qobject_cast<QLineEdit*>(widget) || qobject_cast<QAbstractSpinBox*>(widget)) {
+        setWidgetColor(widget, QPalette::Base, Colors::control());
+    } else if (qobject_cast<QPushButton*>(widget) || qobject_cast<QHeaderView*>(widget)) {
+        widget->setAttribute(Qt::WA_Hover);
+        QFont font = widget->font();
+        font.setBold(true);
+        widget->setFont(font);
+    } else if (qobject_cast<QTabBar*>(widget)) {
+        widget->setAttribute(Qt::WA_Hover);
+    }
+
+    if (QAbstractItemView *view = qobject_cast<QAbstractItemView*>(widget)) {
+        view->viewport()->setAttribute(Qt::WA_Hover);
+    }
+}
+
+void DarkStyle::drawPrimitive(PrimitiveElement element, const QStyleOption *option, QPainter *painter, const QWidget *widget) const
+{
+    switch (element) {
+    case PE_PanelButtonCommand: {
+        QColor fill = Colors::accent();
+        if (!(option->state & State_Enabled)) {
+            fill = Colors::border();
+        } else if (option->state & (State_Sunken | State_On)) {
+            fill = Colors::accentPressed();
+        } else if (option->state & State_MouseOver) {
+            fill = Colors::accentHover();
+        }
+        drawRoundedPanel(painter, option->rect, fill, Qt::transparent,
+                         isInDialog(widget) ? DialogButtonRadius : ButtonRadius);
+        return;
+    }
+    case PE_FrameLineEdit: {
+        const QColor border = (option->state & State_HasFocus) ? Colors::accent() : Colors::border();
+        drawRoundedPanel(painter, option->rect, Qt::transparent, border, InputRadius);
+        return;
+    }
+    case PE_PanelLineEdit: {
+        const QStyleOptionFrame *frame = qstyleoption_cast<const QStyleOptionFrame*>(option);
+        if (frame && frame->lineWidth > 0) {
+            const bool focused = option->state & State_HasFocus;
+            drawRoundedPanel(painter, option->rect,
+                             focused ? Colors::controlHover() : option->palette.color(QPalette::Base),
+                             focused ? Colors::accent() : Colors::border(), InputRadius);
+            return;
+        }
+        break;
+    }
+    case PE_FrameGroupBox:
+        drawRoundedPanel(painter, option->rect, Qt::transparent, Colors::control(), GroupBoxRadius);
+        return;
+    case PE_PanelItemViewItem:
+        // 悬停行高亮（选中行仍由基础风格按Highlight绘制）
+        if ((option->state & State_MouseOver) && !(option->state & State_Selected)) {
+            painter->fillRect(option->rect, Colors::control());
+            return;
+        }
+        break;
+    default:
+        break;
+    }
+    QProxyStyle::drawPrimitive(element, option, painter, widget);
+}
+
+void DarkStyle::drawControl(ControlElement element, const QStyleOption *option, QPainter *painter, const QWidget *widget) const
+{
+    switch (element) {
+    case CE_TabBarTabShape: {
+        const QStyleOptionTab *tab = qstyleoption_cast<const QStyleOptionTab*>(option);
+        if (!tab || tab->shape != QTabBar::RoundedNorth) {
+            break;
+        }
+        QColor fill = Colors::control();
+        if (tab->state & State_Selected) {
+            fill = Colors::border();
+        } else if (tab->state & State_MouseOver) {
+            fill = Colors::controlHover();
+        }
+        // 只保留顶部圆角：把圆角矩形向下延伸后裁剪到标签区域
+        const QRect rect = tab->rect.adjusted(0, 0, -TabSpacing, 0);
+        painter->save();
+        painter->setClipRect(rect);
+        drawRoundedPanel(painter, rect.adjusted(0, 0, 0, int(TabRadius)), fill, Qt::transparent, TabRadius);
+        painter->restore();
+        return;
+    }
+    case CE_TabBarTabLabel: {
+        const QStyleOptionTab *tab = qstyleoption_cast<const QStyleOptionTab*>(option);
+        if (!tab) {
+            break;
+        }
+        QStyleOptionTab label(*tab);
+        const bool selected = tab->state & State_Selected;
+        label.palette.setColor(QPalette::WindowText, selected ? Colors::text() : Colors::dimText());
+        painter->save();
+        if (selected) {
+            QFont font = painter->font();
+            font.setBold(true);
+            painter->setFont(font);
+        }
+        QProxyStyle::drawControl(element, &label, painter, widget);
+        painter->restore();
+        return;
+    }
+    case CE_HeaderSection:
+        painter->save();
+        painter->fillRect(option->rect, Colors::control());
+        painter->setPen(Colors::border());
+        painter->drawRect(option->rect.adjusted(0, 0, -1, -1));
+        painter->restore();
+        return;
+    case CE_PushButtonLabel: {
+        const QStyleOptionButton *button = qstyleoption_cast<const QStyleOptionButton*>(option);
+        if (!button) {
+            break;
+        }
+        QStyleOptionButton label(*button);
+        label.palette.setColor(QPalette::ButtonText, Colors::text());
+        QProxyStyle::drawControl(element, &label, painter, widget);
+        return;
+    }
+    default:
+        break;
+    }
+    QProxyStyle::drawControl(element, option, painter, widget);
+}
+
+void DarkStyle::drawComplexControl(ComplexControl control, const QStyleOptionComplex *option, QPainter *painter, const QWidget *widget) const
+{
+    if (control == CC_SpinBox) {
+        const QStyleOptionSpinBox *spinBox = qstyleoption_cast<const QStyleOptionSpinBox*>(option);
+        if (spinBox && spinBox->frame) {
+            // 圆角边框自己画，按钮仍交给基础风格
+            const bool focused = option->state & State_HasFocus;
+            drawRoundedPanel(painter, option->rect,
+                             focused ? Colors::controlHover() : option->palette.color(QPalette::Base),
+                             focused ? Colors::accent() : Colors::border(), InputRadius);
+            QStyleOptionSpinBox buttons(*spinBox);
+            buttons.frame = false;
+            buttons.subControls &= ~SC_SpinBoxFrame;
+            QProxyStyle::drawComplexControl(control, &buttons, painter, widget);
+            return;
+        }
+    }
+    QProxyStyle::drawComplexControl(control, option, painter, widget);
+}
+
+QSize DarkStyle::sizeFromContents(ContentsType type, const QStyleOption *option, const QSize &size, const QWidget *widget) const
+{
+    const QSize base = QProxyStyle::sizeFromContents(type, option, size, widget);
+    switch (type) {
+    case CT_PushButton:
+        // 对应原样式表的 padding: 10px 20px（对话框中为 5px 15px）
+        return isInDialog(widget) ? size + QSize(30, 10) : size + QSize(40, 20);
+    case CT_HeaderSection:
+        return base.expandedTo(size + QSize(16, 16));
+    case CT_LineEdit:
+    case CT_SpinBox:
+        return base.expandedTo(size + QSize(16, 16));
+    default:
+        return base;
+    }
+}
+
+int DarkStyle::pixelMetric(PixelMetric metric, const QStyleOption *option, const QWidget *widget) const
+{
+    switch (metric) {
+    case PM_TabBarTabHSpace:
+        return 48 + TabSpacing;
+    case PM_TabBarTabVSpace:
+        return 24;
+    default:
+        return QProxyStyle::pixelMetric(metric, option, widget);
+    }
+}
+
+int DarkStyle::styleHint(StyleHint hint, const QStyleOption *option, const QWidget *widget, QStyleHintReturn *returnData) const
+{
+    if (hint == SH_Table_GridLineColor) {
+        return static_cast<int>(Colors::border().rgba());
+    }
+    return QProxyStyle::styleHint(hint, option, widget, returnData);
+}
+
+/**
+ * @brief 判断控件是否位于对话框（含消息框）中
+ */
+bool DarkStyle::isInDialog(const QWidget *widget)
+{
+    return widget && qobject_cast<const QDialog*>(widget->window());
+}
+
+/**
+ * @brief 绘制抗锯齿圆角面板
+ * @param painter 绘图对象
+ * @param rect 面板区域
+ * @param fill 填充色，透明表示不填充
+ * @param border 边框色，透明表示不画边框
+ * @param radius 圆角半径
+ */
+void DarkStyle::drawRoundedPanel(QPainter *painter, const QRectF &rect, const QColor &fill, const QColor &border, qreal radius)
+{
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
+    painter->setPen(border.alpha() > 0 ? QPen(border, 1) : QPen(Qt::NoPen));
+    painter->setBrush(fill.alpha() > 0 ? QBrush(fill) : QBrush(Qt::NoBrush));
+    painter->drawRoundedRect(rect.adjusted(0.5, 0.5, -0.5, -0.5), radius, radius);
+    painter->restore();
+}
@@ -0,0 +1,83 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 17:10:26
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 17:10:26
+ * @Description: 基于QPalette与QProxyStyle的暗色主题
+ */
+#ifndef DARKSTYLE_H
+#define DARKSTYLE_H
+
+#include <QProxyStyle>
+#include <QColor>
+
+class QApplication;
+
+/*
+    原先的暗色主题由全局样式表加控件级 setStyleSheet 实现，存在两个问题：
+    - 每次 setStyleSheet 都会让控件及其子控件重新解析样式并 repolish；
+    - 样式表接管 QTableView::item 后，每个单元格都要经过 QStyleSheetStyle 的
+      规则匹配，大表格绘制明显变慢。
+    DarkStyle 以 Fusion 为基础风格，颜色全部放在 QPalette 中，圆角按钮、标签页、
+    表头、输入框边框等少量外观在 drawPrimitive/drawControl 中直接绘制，
+    样式解析只在 polish 时发生一次，单元格绘制走原生路径。
+*/
+class DarkStyle : public QProxyStyle
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 主题颜色，与原样式表保持一致
+     */
+    struct Colors {
+        static QColor window()        { return QColor("#1a1a1a"); }  //!< 主窗口背景
+        static QColor panel()         { return QColor("#2a2a2a"); }  //!< 面板、表格背景
+        static QColor alternate()     { return QColor("#323232"); }  //!< 表格交替行
+        static QColor control()       { return QColor("#3a3a3a"); }  //!< 输入框、表头、标签页
+        static QColor controlHover()  { return QColor("#404040"); }  //!< 悬停、输入框焦点
+        static QColor border()        { return QColor("#4a4a4a"); }  //!< 边框、网格线、选中标签页
+        static QColor accent()        { return QColor("#0078d7"); }  //!< 按钮、选中、焦点边框
+        static QColor accentHover()   { return QColor("#106ebe"); }  //!< 按钮悬停
+        static QColor accentPressed() { return QColor("#005a9e"); }  //!< 按钮按下
+        static QColor text()          { return QColor("#ffffff"); }  //!< 主文字
+        static QColor dimText()       { return QColor("#cccccc"); }  //!< 次要文字
+        static QColor disabledText()  { return QColor("#888888"); }  //!< 只读、禁用文字
+        static QColor warning()       { return QColor("#e76f51"); }  //!< 提醒文字（预算超支等）
+    };
+
+    /**
+     * @brief 构造函数，以Fusion风格为基础
+     */
+    DarkStyle();
+
+    /**
+     * @brief 把暗色主题安装到应用程序（风格、调色板、字体）
+     * @param app 应用程序对象
+     */
+    static void apply(QApplication *app);
+
+    /**
+     * @brief 设置输入控件的只读外观，只修改控件调色板，不触发样式表解析
+     * @param widget 输入控件
+     * @param readOnly 是否只读
+     */
+    static void setReadOnlyAppearance(QWidget *widget, bool readOnly);
+
+    QPalette standardPalette() const override;
+    void polish(QWidget *widget) override;
+    using QProxyStyle::polish;
+
+    void drawPrimitive(PrimitiveElement element, const QStyleOption *option, QPainter *painter, const QWidget *widget = nullptr) const override;
+    void drawControl(ControlElement element, const QStyleOption *option, QPainter *painter, const QWidget *widget = nullptr) const override;
+    void drawComplexControl(ComplexControl control, const QStyleOptionComplex *option, QPainter *painter, const QWidget *widget = nullptr) const override;
+    QSize sizeFromContents(ContentsType type, const QStyleOption *option, const QSize &size, const QWidget *widget = nullptr) const override;
+    int pixelMetric(PixelMetric metric, const QStyleOption *option = nullptr, const QWidget *widget = nullptr) const override;
+    int styleHint(StyleHint hint, const QStyleOption *option = nullptr, const QWidget *widget = nullptr, QStyleHintReturn *returnData = nullptr) const override;
+
+private:
+    static bool isInDialog(const QWidget *widget);
+    static void drawRoundedPanel(QPainter *painter, const QRectF &rect, const QColor &fill, const QColor &border, qreal radius);
+};
+
+#endif // DARKSTYLE_H
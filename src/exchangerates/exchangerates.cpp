@@ -0,0 +1,323 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 20:58:14
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 20:58:14
+ * @Description: 按日期索引的汇率表
+ */
+#include "exchangerates.h"
+#include "ledgerrecord.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QSet>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+/**
+ * @brief 获取账本对应的汇率表路径
+ * @param ledgerPath 账本文件路径
+ * @return 返回与账本同目录、同名的.rates.csv文件路径
+ */
+QString ExchangeRates::filePathFor(const QString &ledgerPath)
+{
+    QFileInfo info(ledgerPath);
+    return info.absolutePath() + "/" + info.completeBaseName() + ".rates.csv";
+}
+
+/**
+ * @brief 读取汇率表，文件不存在时得到空表
+ * @param filePath 汇率表路径
+ * @return 文件存在但无法读取时返回false
+ */
+bool ExchangeRates::open(const QString &filePath)
+{
+    clear();
+    this->filePath = filePath;
+
+    QFile file(filePath);
+    if (!file.exists()) {
+        return true;
+    }
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return false;
+    }
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        QDate date;
+        QString from;
+        QString to;
+        double value = 0.0;
+        if (parseLine(in.readLine(), date, from, to, value)) {
+            insert(date, from, to, value);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 清空汇率表
+ */
+void ExchangeRates::clear()
+{
+    pairs.clear();
+    ++revision;
+}
+
+/**
+ * @brief 把外部汇率文件中的有效行合并到本地汇率表（追加写入并更新内存）
+ * @param sourcePath 外部汇率文件路径，格式与本地汇率表相同
+ * @param error 失败时输出错误信息
+ * @return 返回导入的汇率条数，失败返回-1
+ */
+int ExchangeRates::importFile(const QString &sourcePath, QString *error)
+{
+    if (filePath.isEmpty()) {
+        if (error) *error = "尚未打开账本";
+        return -1;
+    }
+    QFile source(sourcePath);
+    if (!source.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (error) *error = source.errorString();
+        return -1;
+    }
+
+    struct Entry { QDate date; QString from; QString to; double rate; };
+    QVector<Entry> entries;
+    QTextStream in(&source);
+    while (!in.atEnd()) {
+        Entry entry;
+        if (parseLine(in.readLine(), entry.date, entry.from, entry.to, entry.rate)) {
+            entries.append(entry);
+        }
+    }
+    if (entries.isEmpty()) {
+        if (error) *error = "文件中没有有效的汇率行（格式：日期,源币种,目标币种,汇率）";
+        return -1;
+    }
+
+    // 先写文件再更新内存；同一天的重复汇率以后写入的为准
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        if (error) *error = file.errorString();
+        return -1;
+    }
+    QTextStream out(&file);
+    for (const Entry &entry : entries) {
+        out << entry.date.toString("yyyy/MM/dd") << "," << entry.from << "," << entry.to << ","
+            << QString::number(entry.rate, 'g', 10) << "\n";
+    }
+    out.flush();
+    if (file.error() != QFileDevice::NoError) {
+        if (error) *error = file.errorString();
+        return -1;
+    }
+
+    for (const Entry &entry : entries) {
+        insert(entry.date, entry.from, entry.to, entry.rate);
+    }
+    return entries.size();
+}
+
+/**
+ * @brief 查询某日的汇率
+ * @param from 源币种
+ * @param to 目标币种
+ * @param date 日期
+ * @return 返回汇率，缺少汇率时返回NaN
+ */
+double ExchangeRates::rate(const QString &from, const QString &to, const QDate &date) const
+{
+    const QString source = from.isEmpty() ? QString(LedgerRecord::DefaultCurrency) : LedgerRecord::normalizeCurrency(from);
+    const QString target = to.isEmpty() ? QString(LedgerRecord::DefaultCurrency) : LedgerRecord::normalizeCurrency(to);
+    const Path path = resolve(source, target);
+    if (!path.valid) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return evaluate(path, date.toJulianDay());
+}
+
+/**
+ * @brief 把金额（分）换算为另一币种，币种相同时原样返回，不需要汇率
+ * @param cents 金额（分）
+ * @param from 源币种，空表示默认币种
+ * @param to 目标币种，空表示默认币种
+ * @param date 汇率日期
+ * @param converted 换算结果（输出参数，单位：分）
+ * @return 缺少汇率时返回false
+ */
+bool ExchangeRates::convertCents(qint64 cents, const QString &from, const QString &to, const QDate &date, qint64 &converted) const
+{
+    const double factor = rate(from, to, date);
+    if (std::isnan(factor)) {
+        return false;
+    }
+    converted = factor == 1.0 ? cents : qRound64(cents * factor);
+    return true;
+}
+
+/**
+ * @brief 计算整列换算的每行系数
+ * @param currencies 每行的币种
+ * @param days 每行的日期（儒略日）
+ * @param target 目标币种
+ * @return 返回每行的系数，缺少汇率的行为NaN
+ */
+QVector<double> ExchangeRates::factors(const QStringList &currencies, const QVector<qint64> &days, const QString &target) const
+{
+    const double missing = std::numeric_limits<double>::quiet_NaN();
+    const qsizetype size = qMin(currencies.size(), days.size());
+    QVector<double> result(size, missing);
+
+    // 账本中币种种类很少，每个币种的换算路径只解析一次
+    QHash<QString, Path> paths;
+    for (qsizetype i = 0; i < size; ++i) {
+        const QString code = currencies[i].isEmpty() ? QString(LedgerRecord::DefaultCurrency) : currencies[i];
+        auto it = paths.find(code);
+        if (it == paths.end()) {
+            it = paths.insert(code, resolve(code, target));
+        }
+        if (it->valid) {
+            result[i] = evaluate(it.value(), days[i]);
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief 汇率表中出现过的全部币种（升序）
+ */
+QStringList ExchangeRates::currencies() const
+{
+    QSet<QString> codes;
+    for (auto it = pairs.constBegin(); it != pairs.constEnd(); ++it) {
+        const QStringList parts = it.key().split('/');
+        for (const QString &code : parts) {
+            codes.insert(code);
+        }
+    }
+    QStringList result(codes.cbegin(), codes.cend());
+    result.sort();
+    return result;
+}
+
+/**
+ * @brief 汇率条数
+ */
+int ExchangeRates::count() const
+{
+    int total = 0;
+    for (const Series &series : pairs) {
+        total += series.days.size();
+    }
+    return total;
+}
+
+/**
+ * @brief 在序列中二分查找该日或之前最近的汇率，早于第一条时返回第一条
+ */
+double ExchangeRates::lookup(const Series &series, qint64 day)
+{
+    auto it = std::upper_bound(series.days.cbegin(), series.days.cend(), day);
+    const qsizetype index = qMax<qsizetype>(0, (it - series.days.cbegin()) - 1);
+    return series.rates[index];
+}
+
+/**
+ * @brief 解析汇率表中的一行
+ * @return 日期、币种和汇率都有效时返回true
+ */
+bool ExchangeRates::parseLine(const QString &line, QDate &date, QString &from, QString &to, double &rate)
+{
+    const QStringList fields = line.trimmed().split(',');
+    if (fields.size() < 4) {
+        return false;
+    }
+    bool fromOk = false;
+    bool toOk = false;
+    date = LedgerRecord::parseDate(fields[0]);
+    from = LedgerRecord::normalizeCurrency(fields[1], &fromOk);
+    to = LedgerRecord::normalizeCurrency(fields[2], &toOk);
+    bool rateOk = false;
+    rate = fields[3].trimmed().toDouble(&rateOk);
+    return date.isValid() && fromOk && toOk && !from.isEmpty() && !to.isEmpty() && from != to
+        && rateOk && std::isfinite(rate) && rate > 0.0;
+}
+
+/**
+ * @brief 插入一条汇率并保持序列按日期有序，同一天的汇率被替换
+ */
+void ExchangeRates::insert(const QDate &date, const QString &from, const QString &to, double rate)
+{
+    Series &series = pairs[pairKey(from, to)];
+    const qint64 day = date.toJulianDay();
+
+    // 汇率表通常按日期追加，大多数插入落在末尾
+    auto it = std::lower_bound(series.days.begin(), series.days.end(), day);
+    const qsizetype index = it - series.days.begin();
+    if (it != series.days.end() && *it == day) {
+        series.rates[index] = rate;
+    } else {
+        series.days.insert(index, day);
+        series.rates.insert(index, rate);
+    }
+    ++revision;
+}
+
+/**
+ * @brief 解析从源币种到目标币种的换算路径：直接汇率 → 反向汇率 → 经人民币交叉
+ */
+ExchangeRates::Path ExchangeRates::resolve(const QString &from, const QString &to) const
+{
+    Path path;
+    if (from == to) {
+        path.valid = true;
+        return path;
+    }
+
+    auto direct = [this](const QString &source, const QString &target, const Series *&series, bool &invert) {
+        auto it = pairs.constFind(pairKey(source, target));
+        if (it != pairs.constEnd() && !it->days.isEmpty()) {
+            series = &it.value();
+            invert = false;
+            return true;
+        }
+        it = pairs.constFind(pairKey(target, source));
+        if (it != pairs.constEnd() && !it->days.isEmpty()) {
+            series = &it.value();
+            invert = true;
+            return true;
+        }
+        return false;
+    };
+
+    if (direct(from, to, path.first, path.invertFirst)) {
+        path.valid = true;
+        return path;
+    }
+    const QString pivot(LedgerRecord::DefaultCurrency);
+    if (from != pivot && to != pivot
+            && direct(from, pivot, path.first, path.invertFirst)
+            && direct(pivot, to, path.second, path.invertSecond)) {
+        path.valid = true;
+    }
+    return path;
+}
+
+/**
+ * @brief 按换算路径计算某日的汇率
+ */
+double ExchangeRates::evaluate(const Path &path, qint64 day)
+{
+    double result = 1.0;
+    if (path.first) {
+        const double value = lookup(*path.first, day);
+        result *= path.invertFirst ? 1.0 / value : value;
+    }
+    if (path.second) {
+        const double value = lookup(*path.second, day);
+        result *= path.invertSecond ? 1.0 / value : value;
+    }
+    return result;
+}
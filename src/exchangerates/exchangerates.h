@@ -0,0 +1,136 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 20:58:14
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 20:58:14
+ * @Description: 按日期索引的汇率表
+ */
+#ifndef EXCHANGERATES_H
+#define EXCHANGERATES_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QDate>
+
+/*
+    汇率表保存在账本同目录的 <账本名>.rates.csv 中，每行"日期,源币种,目标币种,汇率"，
+    表示 1 单位源币种在该日可兑换的目标币种数量，如"2026/01/29,USD,CNY,7.1234"。
+
+    每个币种对的汇率按日期升序存成两个并行数组（儒略日、汇率），查询某日汇率时
+    二分查找该日或之前最近的一条；早于第一条时使用第一条。
+    没有直接的币种对时依次尝试反向币种对（取倒数）和经人民币的交叉汇率。
+
+    factors 为整列换算准备每行的换算系数：每个币种只解析一次换算路径，
+    每行只做二分查找，换算本身由 LedgerStats::multiply 向量化完成。
+*/
+class ExchangeRates
+{
+public:
+    /**
+     * @brief 获取账本对应的汇率表路径
+     * @param ledgerPath 账本文件路径
+     * @return 返回与账本同目录、同名的.rates.csv文件路径
+     */
+    static QString filePathFor(const QString &ledgerPath);
+
+    /**
+     * @brief 读取汇率表，文件不存在时得到空表
+     * @param filePath 汇率表路径
+     * @return 文件存在但无法读取时返回false
+     */
+    bool open(const QString &filePath);
+
+    /**
+     * @brief 清空汇率表
+     */
+    void clear();
+
+    /**
+     * @brief 把外部汇率文件中的有效行合并到本地汇率表（追加写入并更新内存）
+     * @param sourcePath 外部汇率文件路径，格式与本地汇率表相同
+     * @param error 失败时输出错误信息
+     * @return 返回导入的汇率条数，失败返回-1
+     */
+    int importFile(const QString &sourcePath, QString *error = nullptr);
+
+    /**
+     * @brief 查询某日的汇率
+     * @param from 源币种
+     * @param to 目标币种
+     * @param date 日期
+     * @return 返回汇率，缺少汇率时返回NaN
+     */
+    double rate(const QString &from, const QString &to, const QDate &date) const;
+
+    /**
+     * @brief 把金额（分）换算为另一币种，币种相同时原样返回，不需要汇率
+     * @param cents 金额（分）
+     * @param from 源币种，空表示默认币种
+     * @param to 目标币种，空表示默认币种
+     * @param date 汇率日期
+     * @param converted 换算结果（输出参数，单位：分）
+     * @return 缺少汇率时返回false
+     */
+    bool convertCents(qint64 cents, const QString &from, const QString &to, const QDate &date, qint64 &converted) const;
+
+    /**
+     * @brief 计算整列换算的每行系数
+     * @param currencies 每行的币种
+     * @param days 每行的日期（儒略日）
+     * @param target 目标币种
+     * @return 返回每行的系数，缺少汇率的行为NaN
+     */
+    QVector<double> factors(const QStringList &currencies, const QVector<qint64> &days, const QString &target) const;
+
+    /**
+     * @brief 汇率表中出现过的全部币种（升序）
+     */
+    QStringList currencies() const;
+
+    /**
+     * @brief 汇率条数
+     */
+    int count() const;
+
+    /**
+     * @brief 汇率表版本，每次修改递增，用于判断换算结果是否需要重算
+     */
+    quint64 version() const { return revision; }
+
+private:
+    /**
+     * @brief 一个币种对的汇率序列，按日期升序
+     */
+    struct Series
+    {
+        QVector<qint64> days;       //!< 儒略日
+        QVector<double> rates;      //!< 汇率
+    };
+
+    /**
+     * @brief 某币种到目标币种的换算路径：最多经过两段汇率序列
+     */
+    struct Path
+    {
+        bool valid = false;
+        const Series *first = nullptr;
+        bool invertFirst = false;
+        const Series *second = nullptr;
+        bool invertSecond = false;
+    };
+
+    static QString pairKey(const QString &from, const QString &to) { return from + "/" + to; }
+    static double lookup(const Series &series, qint64 day);
+    static bool parseLine(const QString &line, QDate &date, QString &from, QString &to, double &rate);
+    void insert(const QDate &date, const QString &from, const QString &to, double rate);
+    Path resolve(const QString &from, const QString &to) const;
+    static double evaluate(const Path &path, qint64 day);
+
+    QString filePath;                       //!< 汇率表路径
+    QHash<QString, Series> pairs;           //!< "源/目标" → 汇率序列
+    quint64 revision = 1;                   //!< 版本号
+};
+
+#endif // EXCHANGERATES_H
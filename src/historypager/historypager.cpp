@@ -0,0 +1,214 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 19:05:37
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 19:05:37
+ * @Description: 内存受限窗口模式下按块分页读取CSV历史记录
+ */
+#include "historypager.h"
+#include "csvledgerstorage.h"
+#include <QFile>
+#include <QDebug>
+#include <algorithm>
+
+/**
+ * @brief 构造函数
+ * @param rowsPerBlock 每块记录数
+ * @param maxCacheBytes 块缓存的内存上限（字节）
+ */
+HistoryPager::HistoryPager(int rowsPerBlock, qint64 maxCacheBytes)
+    : blockRows(qMax(1, rowsPerBlock))
+    , cache(maxCacheBytes)
+{
+}
+
+/**
+ * @brief 扫描CSV文件建立块索引，并清空缓存
+ * @param filePath CSV文件路径
+ * @return 成功返回true
+ */
+bool HistoryPager::index(const QString &filePath)
+{
+    clear();
+    this->filePath = filePath;
+
+    // 以二进制方式读取，保证记录的偏移就是文件中的字节位置
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    Block current;
+    while (!file.atEnd()) {
+        const qint64 offset = file.pos();
+        const QStringList fields = CsvLedgerStorage::splitLine(QString::fromUtf8(file.readLine()).trimmed());
+        if (fields.isEmpty()) {
+            continue;
+        }
+        const QDate date = LedgerRecord::parseDate(fields[ColDate]);
+        if (current.rowCount == 0) {
+            current.offset = offset;
+            current.firstRow = totalRows;
+            current.firstDate = date;
+        }
+        current.lastDate = date;
+        ++current.rowCount;
+        ++totalRows;
+        if (current.rowCount == blockRows) {
+            blocks.append(current);
+            current = Block();
+        }
+    }
+    if (current.rowCount > 0) {
+        blocks.append(current);
+    }
+    return true;
+}
+
+/**
+ * @brief 清空索引和缓存
+ */
+void HistoryPager::clear()
+{
+    blocks.clear();
+    totalRows = 0;
+    cache.clear();
+    oversized.clear();
+}
+
+/**
+ * @brief 设置块缓存的内存上限，超出部分按最近最少使用顺序淘汰
+ * @param bytes 上限（字节）
+ */
+void HistoryPager::setMaxCacheBytes(qint64 bytes)
+{
+    cache.setMaxCost(qMax<qint64>(0, bytes));
+}
+
+qint64 HistoryPager::maxCacheBytes() const
+{
+    return cache.maxCost();
+}
+
+/**
+ * @brief 当前缓存占用的字节数
+ */
+qint64 HistoryPager::cachedBytes() const
+{
+    return cache.totalCost();
+}
+
+/**
+ * @brief 查找包含指定行的块（二分查找）
+ * @param row 行号
+ * @return 返回块下标，超出范围返回-1
+ */
+int HistoryPager::blockForRow(int row) const
+{
+    if (row < 0 || row >= totalRows) {
+        return -1;
+    }
+    auto it = std::upper_bound(blocks.cbegin(), blocks.cend(), row, [](int value, const Block &block) {
+        return value < block.firstRow;
+    });
+    return static_cast<int>(it - blocks.cbegin()) - 1;
+}
+
+/**
+ * @brief 查找第一个末日期不早于指定日期的块（二分查找）
+ * @param date 日期
+ * @return 返回块下标，所有块都更早时返回blockCount()
+ */
+int HistoryPager::firstBlockEndingOnOrAfter(const QDate &date) const
+{
+    auto it = std::lower_bound(blocks.cbegin(), blocks.cend(), date, [](const Block &block, const QDate &value) {
+        return block.lastDate < value;
+    });
+    return static_cast<int>(it - blocks.cbegin());
+}
+
+/**
+ * @brief 读取一个块的记录，优先命中缓存
+ * @param index 块下标
+ * @return 返回块内记录，失败返回nullptr（指针归缓存所有，下次调用前有效）
+ */
+const QVector<LedgerRecord> *HistoryPager::records(int index)
+{
+    if (index < 0 || index >= blocks.size()) {
+        return nullptr;
+    }
+    if (QVector<LedgerRecord> *cached = cache.object(index)) {
+        return cached;
+    }
+
+    const Block &info = blocks[index];
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(info.offset)) {
+        return nullptr;
+    }
+
+    auto *decoded = new QVector<LedgerRecord>();
+    decoded->reserve(info.rowCount);
+    while (decoded->size() < info.rowCount && !file.atEnd()) {
+        const QStringList fields = CsvLedgerStorage::splitLine(QString::fromUtf8(file.readLine()).trimmed());
+        if (!fields.isEmpty()) {
+            decoded->append(LedgerRecord::fromFields(fields));
+        }
+    }
+    if (decoded->size() != info.rowCount) {
+        qDebug() << "History block" << index << "is truncated, file changed since indexing";
+        delete decoded;
+        return nullptr;
+    }
+
+    // 单个块超过缓存上限时QCache会拒绝并删除对象，这种块只保留最近一份
+    const qint64 cost = estimateBytes(*decoded);
+    if (cost > cache.maxCost()) {
+        oversized = *decoded;
+        delete decoded;
+        return &oversized;
+    }
+    cache.insert(index, decoded, cost);
+    return decoded;
+}
+
+/**
+ * @brief 查询日期范围内、行号小于endRow的记录，只读取日期重叠的块
+ * @param from 起始日期（含），无效日期表示不限
+ * @param to 结束日期（含），无效日期表示不限
+ * @param endRow 行号上限（不含），用于排除已常驻在模型中的记录
+ */
+QVector<LedgerRecord> HistoryPager::query(const QDate &from, const QDate &to, int endRow)
+{
+    QVector<LedgerRecord> result;
+    const int first = from.isValid() ? firstBlockEndingOnOrAfter(from) : 0;
+    for (int index = first; index < blocks.size(); ++index) {
+        const Block &info = blocks[index];
+        if (info.firstRow >= endRow || (to.isValid() && info.firstDate > to)) {
+            break;
+        }
+        const QVector<LedgerRecord> *block = records(index);
+        if (!block) {
+            continue;
+        }
+        for (int i = 0; i < block->size() && info.firstRow + i < endRow; ++i) {
+            const LedgerRecord &record = block->at(i);
+            if ((!from.isValid() || record.date >= from) && (!to.isValid() || record.date <= to)) {
+                result.append(record);
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief 估算一组记录占用的内存
+ */
+qint64 HistoryPager::estimateBytes(const QVector<LedgerRecord> &records)
+{
+    qint64 bytes = sizeof(QVector<LedgerRecord>) + records.capacity() * qint64(sizeof(LedgerRecord));
+    for (const LedgerRecord &record : records) {
+        bytes += (record.note.capacity() + record.currency.capacity()) * qint64(sizeof(QChar));
+    }
+    return bytes;
+}
@@ -0,0 +1,120 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 19:05:37
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 19:05:37
+ * @Description: 内存受限窗口模式下按块分页读取CSV历史记录
+ */
+#ifndef HISTORYPAGER_H
+#define HISTORYPAGER_H
+
+#include <QString>
+#include <QVector>
+#include <QCache>
+#include <QDate>
+#include "ledgerrecord.h"
+
+/*
+    窗口模式下模型只常驻最近 N 个月的记录，更早的记录留在 CSV 文件中。
+    HistoryPager 扫描一遍 CSV，每 rowsPerBlock 条记录建立一个块索引项
+    { 字节偏移, 首行号, 行数, 首末日期 }，索引本身只占 O(n / rowsPerBlock) 内存。
+    需要某一块时按偏移定位并只解析该块，解析结果放入以字节数计费的 LRU 缓存
+    （QCache），缓存总量不超过 maxCacheBytes；超过上限的单个块不进入缓存。
+    常驻窗口与分页读入的记录都从块边界开始，块边界之前的文件内容在保存时可以原样保留。
+*/
+class HistoryPager
+{
+public:
+    /**
+     * @brief 块索引项
+     */
+    struct Block
+    {
+        qint64 offset = 0;      //!< 块内首条记录在文件中的字节偏移
+        int firstRow = 0;       //!< 块内首条记录的行号
+        int rowCount = 0;       //!< 块内记录数
+        QDate firstDate;        //!< 块内首条记录的日期
+        QDate lastDate;         //!< 块内末条记录的日期
+    };
+
+    /**
+     * @brief 构造函数
+     * @param rowsPerBlock 每块记录数
+     * @param maxCacheBytes 块缓存的内存上限（字节）
+     */
+    explicit HistoryPager(int rowsPerBlock = 256, qint64 maxCacheBytes = 4 * 1024 * 1024);
+
+    /**
+     * @brief 扫描CSV文件建立块索引，并清空缓存
+     * @param filePath CSV文件路径
+     * @return 成功返回true
+     */
+    bool index(const QString &filePath);
+
+    /**
+     * @brief 清空索引和缓存
+     */
+    void clear();
+
+    /**
+     * @brief 设置块缓存的内存上限，超出部分按最近最少使用顺序淘汰
+     * @param bytes 上限（字节）
+     */
+    void setMaxCacheBytes(qint64 bytes);
+    qint64 maxCacheBytes() const;
+
+    /**
+     * @brief 当前缓存占用的字节数
+     */
+    qint64 cachedBytes() const;
+
+    QString sourcePath() const { return filePath; }
+    int rowsPerBlock() const { return blockRows; }
+    int recordCount() const { return totalRows; }
+    int blockCount() const { return blocks.size(); }
+    const Block &block(int index) const { return blocks[index]; }
+
+    /**
+     * @brief 查找包含指定行的块（二分查找）
+     * @param row 行号
+     * @return 返回块下标，超出范围返回-1
+     */
+    int blockForRow(int row) const;
+
+    /**
+     * @brief 查找第一个末日期不早于指定日期的块（二分查找）
+     * @param date 日期
+     * @return 返回块下标，所有块都更早时返回blockCount()
+     */
+    int firstBlockEndingOnOrAfter(const QDate &date) const;
+
+    /**
+     * @brief 读取一个块的记录，优先命中缓存
+     * @param index 块下标
+     * @return 返回块内记录，失败返回nullptr（指针归缓存所有，下次调用前有效）
+     */
+    const QVector<LedgerRecord> *records(int index);
+
+    /**
+     * @brief 查询日期范围内、行号小于endRow的记录，只读取日期重叠的块
+     * @param from 起始日期（含），无效日期表示不限
+     * @param to 结束日期（含），无效日期表示不限
+     * @param endRow 行号上限（不含），用于排除已常驻在模型中的记录
+     */
+    QVector<LedgerRecord> query(const QDate &from, const QDate &to, int endRow);
+
+    /**
+     * @brief 估算一组记录占用的内存
+     */
+    static qint64 estimateBytes(const QVector<LedgerRecord> &records);
+
+private:
+    QString filePath;                                   //!< CSV文件路径
+    int blockRows;                                      //!< 每块记录数
+    int totalRows = 0;                                  //!< 文件中的总记录数
+    QVector<Block> blocks;                              //!< 块索引
+    QCache<int, QVector<LedgerRecord>> cache;           //!< 以字节计费的LRU块缓存
+    QVector<LedgerRecord> oversized;                    //!< 超过缓存上限的块，不进入缓存
+};
+
+#endif // HISTORYPAGER_H
@@ -0,0 +1,244 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 15:40:18
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 15:40:18
+ * @Description: 全账本并行完整性校验
+ */
+#include "integritychecker.h"
+#include "ledgersnapshot.h"
+#include <QElapsedTimer>
+#include <QtConcurrent/QtConcurrentMap>
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+/**
+ * @brief 推算值与表中值允许的误差（分）
+ */
+const qint64 ToleranceCents = 1;
+
+/**
+ * @brief 一个并行块的行范围 [start, end)
+ */
+struct Chunk
+{
+    int start = 0;
+    int end = 0;
+};
+
+QVector<Chunk> splitChunks(int rowCount, int chunkSize)
+{
+    QVector<Chunk> chunks;
+    chunkSize = qMax(1, chunkSize);
+    for (int start = 0; start < rowCount; start += chunkSize) {
+        chunks.append({start, qMin(rowCount, start + chunkSize)});
+    }
+    return chunks;
+}
+
+void addIssue(QVector<IntegrityIssue> &issues, int row, IntegrityIssue::Kind kind, int column,
+              qint64 expected = 0, qint64 actual = 0)
+{
+    IntegrityIssue issue;
+    issue.row = row;
+    issue.column = column;
+    issue.kind = kind;
+    issue.expected = expected;
+    issue.actual = actual;
+    issues.append(issue);
+}
+
+inline bool differs(qint64 expected, qint64 actual)
+{
+    return qAbs(expected - actual) > ToleranceCents;
+}
+
+enum AmountIndex {
+    Total = ColTotalDeposit - ColTotalDeposit,
+    Salary = ColSalary - ColTotalDeposit,
+    Fixed = ColFixedDeposit - ColTotalDeposit,
+    Expense = ColExpense - ColTotalDeposit,
+    Monthly = ColMonthlyDeposit - ColTotalDeposit,
+    Disposable = ColDisposable - ColTotalDeposit
+};
+
+} // namespace
+
+/**
+ * @brief 生成可读的问题描述
+ */
+QString IntegrityIssue::message() const
+{
+    const QString rowText = QString("第%1行").arg(row + 1);
+    switch (kind) {
+    case InvalidDate:
+        return rowText + "：记账日期无效";
+    case DateNotIncreasing:
+        return rowText + "：记账日期不晚于上一行";
+    case NonPositiveTotal:
+        return rowText + "：当前总存款金额必须大于0";
+    case NegativeAmount:
+        return rowText + "：工资或定期余额为负数";
+    case FixedExceedsTotal:
+        return rowText + "：定期余额大于当前总存款金额";
+    case TotalExceedsIncome:
+        return rowText + QString("：总存款 %1 大于上一次总存款与当月工资之和 %2")
+                             .arg(LedgerRecord::formatCents(actual), LedgerRecord::formatCents(expected));
+    case MissingRate:
+        return rowText + "：缺少上一行币种到本行币种的汇率，无法推算当月开支";
+    case ExpenseMismatch:
+        return rowText + QString("：当月开支应为 %1，实际为 %2")
+                             .arg(LedgerRecord::formatCents(expected), LedgerRecord::formatCents(actual));
+    case MonthlyDepositMismatch:
+        return rowText + QString("：当月存款应为 %1，实际为 %2")
+                             .arg(LedgerRecord::formatCents(expected), LedgerRecord::formatCents(actual));
+    case DisposableMismatch:
+        return rowText + QString("：当月可支配额度应为 %1，实际为 %2")
+                             .arg(LedgerRecord::formatCents(expected), LedgerRecord::formatCents(actual));
+    }
+    return rowText;
+}
+
+/**
+ * @brief 生成摘要文本
+ * @param maxIssues 最多列出的问题条数
+ */
+QString IntegrityReport::summary(int maxIssues) const
+{
+    QString text = QString("共校验 %1 行（%2 个并行块），耗时 %3 ms，发现 %4 个问题。")
+                       .arg(rowCount).arg(chunkCount).arg(elapsedMs).arg(issues.size());
+    for (int i = 0; i < issues.size() && i < maxIssues; ++i) {
+        text += "\n" + issues[i].message();
+    }
+    if (issues.size() > maxIssues) {
+        text += QString("\n……其余 %1 个问题未列出").arg(issues.size() - maxIssues);
+    }
+    return text;
+}
+
+/**
+ * @brief 校验记录数组
+ * @param records 按行顺序排列的记录
+ * @param rates 换算相邻行总存款的汇率表
+ * @param chunkSize 每个并行块的行数
+ */
+IntegrityReport IntegrityChecker::check(const QVector<LedgerRecord> &records, const ExchangeRates &rates, int chunkSize)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    IntegrityReport report;
+    report.rowCount = records.size();
+    const QVector<Chunk> chunks = splitChunks(records.size(), chunkSize);
+    report.chunkCount = chunks.size();
+
+    // 1. 各块并行校验块内的行和相邻行
+    std::function<QVector<IntegrityIssue>(const Chunk &)> checkChunk = [&records, &rates](const Chunk &chunk) {
+        QVector<IntegrityIssue> issues;
+        for (int row = chunk.start; row < chunk.end; ++row) {
+            checkRow(records[row], row, issues);
+            if (row > chunk.start) {
+                checkPair(records[row - 1], records[row], row, rates, issues);
+            }
+        }
+        return issues;
+    };
+    const QList<QVector<IntegrityIssue>> chunkIssues =
+        QtConcurrent::blockingMapped<QList<QVector<IntegrityIssue>>>(chunks, checkChunk);
+
+    // 2. 边界拼接：前一块的最后一行与后一块的第一行
+    for (int i = 0; i < chunks.size(); ++i) {
+        report.issues += chunkIssues[i];
+        if (i > 0) {
+            const int row = chunks[i].start;
+            checkPair(records[row - 1], records[row], row, rates, report.issues);
+        }
+    }
+
+    std::stable_sort(report.issues.begin(), report.issues.end(),
+                     [](const IntegrityIssue &a, const IntegrityIssue &b) { return a.row < b.row; });
+    report.elapsedMs = timer.elapsed();
+    return report;
+}
+
+/**
+ * @brief 校验只读快照中的所有行，可在工作线程中调用
+ * @param snapshot 账本快照
+ * @param rates 换算相邻行总存款的汇率表
+ * @param chunkSize 每个并行块的行数
+ */
+IntegrityReport IntegrityChecker::check(const LedgerSnapshot &snapshot, const ExchangeRates &rates, int chunkSize)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // 快照的记录已解析好，只需按块拼接成连续数组
+    QVector<LedgerRecord> records;
+    records.reserve(snapshot.rowCount());
+    for (int index = 0; index < snapshot.blockCount(); ++index) {
+        records += snapshot.block(index);
+    }
+
+    IntegrityReport report = check(records, rates, chunkSize);
+    report.elapsedMs = timer.elapsed();
+    return report;
+}
+
+void IntegrityChecker::checkRow(const LedgerRecord &record, int row, QVector<IntegrityIssue> &issues)
+{
+    if (!record.date.isValid()) {
+        addIssue(issues, row, IntegrityIssue::InvalidDate, ColDate);
+    }
+
+    const qint64 total = record.amounts[Total];
+    const qint64 fixed = record.amounts[Fixed];
+    if (!record.hasAmount(Total) || total <= 0) {
+        addIssue(issues, row, IntegrityIssue::NonPositiveTotal, ColTotalDeposit, 0, total);
+    }
+    if (record.amounts[Salary] < 0) {
+        addIssue(issues, row, IntegrityIssue::NegativeAmount, ColSalary, 0, record.amounts[Salary]);
+    }
+    if (fixed < 0) {
+        addIssue(issues, row, IntegrityIssue::NegativeAmount, ColFixedDeposit, 0, fixed);
+    }
+    if (fixed > total) {
+        addIssue(issues, row, IntegrityIssue::FixedExceedsTotal, ColFixedDeposit, total, fixed);
+    }
+
+    // 可支配额度 = 当前总存款金额 - 定期余额，与上一行无关
+    if (record.hasAmount(Disposable) && differs(total - fixed, record.amounts[Disposable])) {
+        addIssue(issues, row, IntegrityIssue::DisposableMismatch, ColDisposable, total - fixed, record.amounts[Disposable]);
+    }
+}
+
+void IntegrityChecker::checkPair(const LedgerRecord &previous, const LedgerRecord &current, int row, const ExchangeRates &rates,
+                                 QVector<IntegrityIssue> &issues)
+{
+    if (previous.date.isValid() && current.date.isValid() && current.date <= previous.date) {
+        addIssue(issues, row, IntegrityIssue::DateNotIncreasing, ColDate);
+    }
+
+    // 上一次总存款按本行日期的汇率换算为本行币种，与录入和重算使用同一规则
+    qint64 previousTotal = 0;
+    if (!rates.convertCents(previous.amounts[Total], previous.currency, current.currency, current.date, previousTotal)) {
+        addIssue(issues, row, IntegrityIssue::MissingRate, ColCurrency);
+        return;
+    }
+    const qint64 total = current.amounts[Total];
+    const qint64 salary = current.amounts[Salary];
+    if (total > previousTotal + salary) {
+        addIssue(issues, row, IntegrityIssue::TotalExceedsIncome, ColTotalDeposit, previousTotal + salary, total);
+    }
+
+    // 当月开支 = 上一次总存款 + 当月工资 - 本次总存款；当月存款 = 当月工资 - 当月开支
+    const qint64 expectedExpense = previousTotal + salary - total;
+    const qint64 expectedMonthly = salary - expectedExpense;
+    if (current.hasAmount(Expense) && differs(expectedExpense, current.amounts[Expense])) {
+        addIssue(issues, row, IntegrityIssue::ExpenseMismatch, ColExpense, expectedExpense, current.amounts[Expense]);
+    }
+    if (current.hasAmount(Monthly) && differs(expectedMonthly, current.amounts[Monthly])) {
+        addIssue(issues, row, IntegrityIssue::MonthlyDepositMismatch, ColMonthlyDeposit, expectedMonthly, current.amounts[Monthly]);
+    }
+}
@@ -0,0 +1,105 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 15:40:18
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 15:40:18
+ * @Description: 全账本并行完整性校验
+ */
+#ifndef INTEGRITYCHECKER_H
+#define INTEGRITYCHECKER_H
+
+#include <QString>
+#include <QVector>
+#include "ledgerrecord.h"
+#include "exchangerates.h"
+
+class LedgerSnapshot;
+
+/**
+ * @brief 单条校验问题
+ */
+struct IntegrityIssue
+{
+    /**
+     * @brief 问题类型
+     */
+    enum Kind {
+        InvalidDate,            //!< 日期无法解析
+        DateNotIncreasing,      //!< 日期没有严格递增
+        NonPositiveTotal,       //!< 当前总存款金额不大于0
+        NegativeAmount,         //!< 工资或定期余额为负数
+        FixedExceedsTotal,      //!< 定期余额大于总存款
+        TotalExceedsIncome,     //!< 总存款大于上一次总存款与当月工资之和
+        MissingRate,            //!< 相邻两行币种不同且缺少汇率，无法推算当月开支
+        ExpenseMismatch,        //!< 当月开支与推算值不一致
+        MonthlyDepositMismatch, //!< 当月存款与推算值不一致
+        DisposableMismatch      //!< 当月可支配额度与推算值不一致
+    };
+
+    int row = -1;               //!< 行号（从0开始）
+    int column = -1;            //!< 相关列号
+    Kind kind = InvalidDate;    //!< 问题类型
+    qint64 expected = 0;        //!< 推算值（分），仅推算类问题有效
+    qint64 actual = 0;          //!< 实际值（分）
+
+    /**
+     * @brief 生成可读的问题描述
+     */
+    QString message() const;
+};
+
+/**
+ * @brief 校验报告
+ */
+struct IntegrityReport
+{
+    int rowCount = 0;                   //!< 校验的行数
+    int chunkCount = 0;                 //!< 并行分块数量
+    qint64 elapsedMs = 0;               //!< 耗时（毫秒）
+    QVector<IntegrityIssue> issues;     //!< 按行号排序的问题列表
+
+    bool isClean() const { return issues.isEmpty(); }
+
+    /**
+     * @brief 生成摘要文本
+     * @param maxIssues 最多列出的问题条数
+     */
+    QString summary(int maxIssues = 20) const;
+};
+
+/*
+    校验流程：
+    1. 把记录按固定行数切分为若干块，交给线程池并行处理；
+       每块内部只校验相邻两行（i-1, i），块的第一行不与前一块比较；
+    2. 所有块完成后做"边界拼接"：逐个校验前一块最后一行与后一块第一行；
+    3. 同时按上一行的总存款重新推算当月开支、当月存款、当月可支配额度，
+       与表中的值比较（容差1分），不一致即报告；
+       上一行币种不同时，其总存款先按本行日期的汇率换算为本行币种，缺少汇率即报告。
+    第一行没有上一行，开支为手工录入，只校验可支配额度。
+*/
+class IntegrityChecker
+{
+public:
+    /**
+     * @brief 校验记录数组
+     * @param records 按行顺序排列的记录
+     * @param rates 换算相邻行总存款的汇率表
+     * @param chunkSize 每个并行块的行数
+     */
+    static IntegrityReport check(const QVector<LedgerRecord> &records, const ExchangeRates &rates = ExchangeRates(), int chunkSize = 65536);
+
+    /**
+     * @brief 校验只读快照中的所有行，可在工作线程中调用
+     * @param snapshot 账本快照
+     * @param rates 换算相邻行总存款的汇率表
+     * @param chunkSize 每个并行块的行数
+     */
+    static IntegrityReport check(const LedgerSnapshot &snapshot, const ExchangeRates &rates = ExchangeRates(), int chunkSize = 65536);
+
+private:
+    static void checkRow(const LedgerRecord &record, int row, QVector<IntegrityIssue> &issues);
+    static void checkPair(const LedgerRecord &previous, const LedgerRecord &current, int row, const ExchangeRates &rates,
+                          QVector<IntegrityIssue> &issues);
+};
+
+#endif // INTEGRITYCHECKER_H
@@ -0,0 +1,459 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 09:30:12
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 09:30:12
+ * @Description: 冷数据列式压缩归档
+ */
+#include "ledgerarchive.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QHash>
+#include <QDebug>
+#include <limits>
+
+namespace {
+
+const quint32 ArchiveMagic = 0x4C475241; // "LGRA"
+const quint16 ArchiveVersion = 2;               //!< 版本2在备注之后增加了币种列
+const quint16 MinArchiveVersion = 1;
+
+/**
+ * @brief 有符号整数转 zigzag 编码，使绝对值小的负数也只占少量字节
+ */
+inline quint64 zigzagEncode(qint64 value)
+{
+    return (static_cast<quint64>(value) << 1) ^ static_cast<quint64>(value >> 63);
+}
+
+inline qint64 zigzagDecode(quint64 value)
+{
+    return static_cast<qint64>(value >> 1) ^ -static_cast<qint64>(value & 1);
+}
+
+inline void writeVarint(QByteArray &out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(static_cast<char>(value));
+}
+
+/**
+ * @brief 顺序读取块数据的游标，越界时置 ok 为 false
+ */
+struct ByteReader
+{
+    const uchar *pos;
+    const uchar *end;
+    bool ok = true;
+
+    quint64 readVarint()
+    {
+        quint64 value = 0;
+        int shift = 0;
+        while (pos < end && shift < 64) {
+            uchar byte = *pos++;
+            value |= static_cast<quint64>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+            shift += 7;
+        }
+        ok = false;
+        return 0;
+    }
+
+    uchar readByte()
+    {
+        if (pos >= end) {
+            ok = false;
+            return 0;
+        }
+        return *pos++;
+    }
+
+    QString readUtf8(int length)
+    {
+        if (length < 0 || end - pos < length) {
+            ok = false;
+            return QString();
+        }
+        QString text = QString::fromUtf8(reinterpret_cast<const char*>(pos), length);
+        pos += length;
+        return text;
+    }
+};
+
+/**
+ * @brief 把一列文本按块内字典编码：字典条目数 + 各条目UTF-8 + 每行字典下标
+ */
+void writeDictionaryColumn(QByteArray &out, const QVector<QString> &values)
+{
+    QHash<QString, quint32> dictionary;
+    QVector<quint32> ids;
+    QVector<QByteArray> entries;
+    ids.reserve(values.size());
+    for (const QString &value : values) {
+        auto it = dictionary.constFind(value);
+        if (it == dictionary.constEnd()) {
+            it = dictionary.insert(value, entries.size());
+            entries.append(value.toUtf8());
+        }
+        ids.append(it.value());
+    }
+    writeVarint(out, entries.size());
+    for (const QByteArray &entry : entries) {
+        writeVarint(out, entry.size());
+        out.append(entry);
+    }
+    for (quint32 id : ids) {
+        writeVarint(out, id);
+    }
+}
+
+/**
+ * @brief 读取字典编码的一列文本
+ * @param reader 数据游标
+ * @param count 行数
+ * @param values 输出的各行文本
+ */
+bool readDictionaryColumn(ByteReader &reader, quint64 count, QVector<QString> &values)
+{
+    const quint64 entryCount = reader.readVarint();
+    if (!reader.ok || entryCount > count) {
+        return false;
+    }
+    QVector<QString> entries;
+    entries.reserve(static_cast<int>(entryCount));
+    for (quint64 i = 0; i < entryCount && reader.ok; ++i) {
+        int length = static_cast<int>(reader.readVarint());
+        entries.append(reader.readUtf8(length));
+    }
+    values.resize(static_cast<int>(count));
+    for (QString &value : values) {
+        quint64 id = reader.readVarint();
+        if (id >= entryCount) {
+            return false;
+        }
+        value = entries[static_cast<int>(id)];
+    }
+    return reader.ok;
+}
+
+} // namespace
+
+/**
+ * @brief 构造函数
+ * @param maxCachedBlocks 最多缓存的解压块数量
+ */
+LedgerArchive::LedgerArchive(int maxCachedBlocks)
+    : blockCache(maxCachedBlocks)
+{
+}
+
+/**
+ * @brief 打开归档文件，仅读取块索引
+ * @param filePath 归档文件路径
+ * @return 成功返回true，文件不存在或格式错误返回false
+ */
+bool LedgerArchive::open(const QString &filePath)
+{
+    close();
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_15);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 blockCount = 0;
+    in >> magic >> version >> blockCount;
+    if (magic != ArchiveMagic || version < MinArchiveVersion || version > ArchiveVersion) {
+        qDebug() << "Invalid archive file:" << filePath;
+        return false;
+    }
+
+    QVector<BlockInfo> index;
+    index.reserve(blockCount);
+    for (quint32 i = 0; i < blockCount && in.status() == QDataStream::Ok; ++i) {
+        BlockInfo info;
+        in >> info.firstDay >> info.lastDay >> info.rowCount >> info.offset >> info.size;
+        index.append(info);
+    }
+    if (in.status() != QDataStream::Ok) {
+        qDebug() << "Truncated archive index:" << filePath;
+        return false;
+    }
+
+    this->filePath = filePath;
+    this->version = version;
+    blocks = index;
+    return true;
+}
+
+/**
+ * @brief 关闭归档并清空缓存
+ */
+void LedgerArchive::close()
+{
+    filePath.clear();
+    version = 0;
+    blocks.clear();
+    blockCache.clear();
+}
+
+bool LedgerArchive::isOpen() const
+{
+    return !filePath.isEmpty();
+}
+
+int LedgerArchive::rowCount() const
+{
+    int total = 0;
+    for (const BlockInfo &info : blocks) {
+        total += info.rowCount;
+    }
+    return total;
+}
+
+QDate LedgerArchive::firstDate() const
+{
+    return blocks.isEmpty() ? QDate() : QDate::fromJulianDay(blocks.first().firstDay);
+}
+
+QDate LedgerArchive::lastDate() const
+{
+    return blocks.isEmpty() ? QDate() : QDate::fromJulianDay(blocks.last().lastDay);
+}
+
+/**
+ * @brief 查询日期范围内的归档记录，按需解压命中的数据块
+ * @param from 起始日期（含），无效日期表示不限
+ * @param to 结束日期（含），无效日期表示不限
+ * @param ok 是否所有命中的数据块都解压成功（输出参数，可为空）；失败的块被跳过
+ * @return 返回按日期排序的记录
+ */
+QVector<LedgerRecord> LedgerArchive::records(const QDate &from, const QDate &to, bool *ok)
+{
+    QVector<LedgerRecord> result;
+    if (ok) {
+        *ok = true;
+    }
+    const qint64 fromDay = from.isValid() ? from.toJulianDay() : std::numeric_limits<qint64>::min();
+    const qint64 toDay = to.isValid() ? to.toJulianDay() : std::numeric_limits<qint64>::max();
+
+    for (int i = 0; i < blocks.size(); ++i) {
+        const BlockInfo &info = blocks[i];
+        // 块索引按日期有序，跳过不重叠的块
+        if (info.lastDay < fromDay) continue;
+        if (info.firstDay > toDay) break;
+
+        const QVector<LedgerRecord> *block = loadBlock(i);
+        if (!block) {
+            if (ok) {
+                *ok = false;
+            }
+            continue;
+        }
+
+        // 完全落在范围内的块直接整体拷贝
+        if (info.firstDay >= fromDay && info.lastDay <= toDay) {
+            result += *block;
+            continue;
+        }
+        for (const LedgerRecord &record : *block) {
+            qint64 day = record.date.toJulianDay();
+            if (day >= fromDay && day <= toDay) {
+                result.append(record);
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief 将记录写入归档文件（覆盖写入）
+ * @param filePath 归档文件路径
+ * @param records 按日期排序的记录
+ * @param rowsPerBlock 每个数据块的行数
+ * @return 成功返回true
+ */
+bool LedgerArchive::write(const QString &filePath, const QVector<LedgerRecord> &records, int rowsPerBlock)
+{
+    rowsPerBlock = qMax(1, rowsPerBlock);
+
+    // 先编码所有数据块，索引中的偏移需要知道块大小
+    QVector<BlockInfo> index;
+    QVector<QByteArray> payloads;
+    for (int start = 0; start < records.size(); start += rowsPerBlock) {
+        int count = qMin(rowsPerBlock, records.size() - start);
+        QByteArray payload = qCompress(encodeBlock(records.constData() + start, count), 9);
+
+        BlockInfo info;
+        info.firstDay = records[start].date.toJulianDay();
+        info.lastDay = records[start + count - 1].date.toJulianDay();
+        info.rowCount = count;
+        info.size = payload.size();
+        index.append(info);
+        payloads.append(payload);
+    }
+
+    // 文件头: magic(4) + version(2) + blockCount(4)；每个索引项: 8 + 8 + 4 + 8 + 4
+    quint64 offset = 4 + 2 + 4 + static_cast<quint64>(index.size()) * (8 + 8 + 4 + 8 + 4);
+    for (BlockInfo &info : index) {
+        info.offset = offset;
+        offset += info.size;
+    }
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_15);
+    out << ArchiveMagic << ArchiveVersion << static_cast<quint32>(index.size());
+    for (const BlockInfo &info : index) {
+        out << info.firstDay << info.lastDay << info.rowCount << info.offset << info.size;
+    }
+    for (const QByteArray &payload : payloads) {
+        out.writeRawData(payload.constData(), payload.size());
+    }
+
+    return out.status() == QDataStream::Ok && file.commit();
+}
+
+/**
+ * @brief 读取并解压一个数据块
+ * @param index 块下标
+ * @return 返回块内记录，失败返回nullptr（指针归缓存所有）
+ */
+const QVector<LedgerRecord> *LedgerArchive::loadBlock(int index)
+{
+    if (QVector<LedgerRecord> *cached = blockCache.object(index)) {
+        return cached;
+    }
+
+    const BlockInfo &info = blocks[index];
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly) || !file.seek(info.offset)) {
+        return nullptr;
+    }
+    QByteArray payload = file.read(info.size);
+    if (payload.size() != static_cast<int>(info.size)) {
+        qDebug() << "Short read on archive block" << index;
+        return nullptr;
+    }
+
+    auto *decoded = new QVector<LedgerRecord>();
+    if (!decodeBlock(qUncompress(payload), version, *decoded)
+            || decoded->size() != static_cast<int>(info.rowCount)) {
+        qDebug() << "Corrupted archive block" << index;
+        delete decoded;
+        return nullptr;
+    }
+
+    blockCache.insert(index, decoded);
+    return decoded;
+}
+
+QByteArray LedgerArchive::encodeBlock(const LedgerRecord *records, int count)
+{
+    QByteArray out;
+    out.reserve(count * 16);
+    writeVarint(out, count);
+
+    // 日期列：首行绝对值，其余为差值
+    qint64 previousDay = 0;
+    for (int i = 0; i < count; ++i) {
+        qint64 day = records[i].date.toJulianDay();
+        writeVarint(out, zigzagEncode(day - previousDay));
+        previousDay = day;
+    }
+
+    // 非空标记列
+    for (int i = 0; i < count; ++i) {
+        out.append(static_cast<char>(records[i].presentMask));
+    }
+
+    // 金额列：逐列对非空值做差分
+    for (int col = 0; col < LedgerAmountColumnCount; ++col) {
+        qint64 previous = 0;
+        for (int i = 0; i < count; ++i) {
+            if (!records[i].hasAmount(col)) continue;
+            writeVarint(out, zigzagEncode(records[i].amounts[col] - previous));
+            previous = records[i].amounts[col];
+        }
+    }
+
+    // 备注列与币种列：字典编码
+    QVector<QString> notes;
+    QVector<QString> currencies;
+    notes.reserve(count);
+    currencies.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        notes.append(records[i].note);
+        currencies.append(records[i].currency);
+    }
+    writeDictionaryColumn(out, notes);
+    writeDictionaryColumn(out, currencies);
+    return out;
+}
+
+bool LedgerArchive::decodeBlock(const QByteArray &data, quint16 version, QVector<LedgerRecord> &records)
+{
+    ByteReader reader{reinterpret_cast<const uchar*>(data.constData()),
+                      reinterpret_cast<const uchar*>(data.constData()) + data.size()};
+
+    const quint64 count = reader.readVarint();
+    if (!reader.ok || count > static_cast<quint64>(data.size())) {
+        return false;
+    }
+    records.resize(static_cast<int>(count));
+
+    qint64 day = 0;
+    for (LedgerRecord &record : records) {
+        day += zigzagDecode(reader.readVarint());
+        record.date = QDate::fromJulianDay(day);
+    }
+
+    for (LedgerRecord &record : records) {
+        record.presentMask = reader.readByte();
+    }
+
+    for (int col = 0; col < LedgerAmountColumnCount; ++col) {
+        qint64 value = 0;
+        for (LedgerRecord &record : records) {
+            if (!record.hasAmount(col)) continue;
+            value += zigzagDecode(reader.readVarint());
+            record.amounts[col] = value;
+        }
+    }
+
+    QVector<QString> notes;
+    if (!readDictionaryColumn(reader, count, notes)) {
+        return false;
+    }
+    for (int i = 0; i < records.size(); ++i) {
+        records[i].note = notes[i];
+    }
+
+    // 版本1的归档没有币种列，记录按默认币种处理
+    if (version >= 2) {
+        QVector<QString> currencies;
+        if (!readDictionaryColumn(reader, count, currencies)) {
+            return false;
+        }
+        for (int i = 0; i < records.size(); ++i) {
+            records[i].currency = currencies[i];
+        }
+    }
+    return reader.ok;
+}
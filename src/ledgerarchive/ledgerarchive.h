@@ -0,0 +1,122 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 09:30:12
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 09:30:12
+ * @Description: 冷数据列式压缩归档
+ */
+#ifndef LEDGERARCHIVE_H
+#define LEDGERARCHIVE_H
+
+#include <QString>
+#include <QVector>
+#include <QCache>
+#include <QDate>
+#include "ledgerrecord.h"
+
+/*
+    归档文件格式（*.lgra）：
+
+    文件头    : magic "LGRA" | 版本号 | 块数量
+    块索引    : 每块一项 { 首日期, 末日期, 行数, 偏移, 压缩后长度 }
+    数据块    : qCompress(列式编码数据)
+
+    每个数据块内按列存放：
+    - 日期：首行儒略日 + 后续行的差值（zigzag varint）
+    - 非空标记：每行 1 字节
+    - 金额：每列单独存放，非空值以"分"为单位与上一个非空值做差，zigzag varint 编码
+    - 备注：块内字典 + 每行字典下标（varint）
+    - 币种（版本2起）：与备注相同的字典编码
+
+    打开归档时只读取块索引，数据块在首次被查询命中时才解压，
+    解压结果放入 QCache，范围查询会跳过日期不重叠的块。
+*/
+class LedgerArchive
+{
+public:
+    /**
+     * @brief 单个数据块的索引项
+     */
+    struct BlockInfo
+    {
+        qint64 firstDay = 0;    //!< 块内首行日期（儒略日）
+        qint64 lastDay = 0;     //!< 块内末行日期（儒略日）
+        quint32 rowCount = 0;   //!< 块内行数
+        quint64 offset = 0;     //!< 压缩数据在文件中的偏移
+        quint32 size = 0;       //!< 压缩数据长度
+    };
+
+    /**
+     * @brief 构造函数
+     * @param maxCachedBlocks 最多缓存的解压块数量
+     */
+    explicit LedgerArchive(int maxCachedBlocks = 16);
+
+    /**
+     * @brief 打开归档文件，仅读取块索引
+     * @param filePath 归档文件路径
+     * @return 成功返回true，文件不存在或格式错误返回false
+     */
+    bool open(const QString &filePath);
+
+    /**
+     * @brief 关闭归档并清空缓存
+     */
+    void close();
+
+    /**
+     * @brief 归档是否已打开
+     */
+    bool isOpen() const;
+
+    /**
+     * @brief 归档中的总行数
+     */
+    int rowCount() const;
+
+    /**
+     * @brief 归档覆盖的最早日期
+     */
+    QDate firstDate() const;
+
+    /**
+     * @brief 归档覆盖的最晚日期
+     */
+    QDate lastDate() const;
+
+    /**
+     * @brief 查询日期范围内的归档记录，按需解压命中的数据块
+     * @param from 起始日期（含），无效日期表示不限
+     * @param to 结束日期（含），无效日期表示不限
+     * @param ok 是否所有命中的数据块都解压成功（输出参数，可为空）；失败的块被跳过
+     * @return 返回按日期排序的记录
+     */
+    QVector<LedgerRecord> records(const QDate &from = QDate(), const QDate &to = QDate(), bool *ok = nullptr);
+
+    /**
+     * @brief 将记录写入归档文件（覆盖写入）
+     * @param filePath 归档文件路径
+     * @param records 按日期排序的记录
+     * @param rowsPerBlock 每个数据块的行数
+     * @return 成功返回true
+     */
+    static bool write(const QString &filePath, const QVector<LedgerRecord> &records, int rowsPerBlock = 512);
+
+private:
+    QString filePath;                               //!< 归档文件路径
+    quint16 version = 0;                            //!< 归档格式版本
+    QVector<BlockInfo> blocks;                      //!< 块索引
+    QCache<int, QVector<LedgerRecord>> blockCache;  //!< 已解压的数据块
+
+    /**
+     * @brief 读取并解压一个数据块
+     * @param index 块下标
+     * @return 返回块内记录，失败返回nullptr（指针归缓存所有）
+     */
+    const QVector<LedgerRecord> *loadBlock(int index);
+
+    static QByteArray encodeBlock(const LedgerRecord *records, int count);
+    static bool decodeBlock(const QByteArray &data, quint16 version, QVector<LedgerRecord> &records);
+};
+
+#endif // LEDGERARCHIVE_H
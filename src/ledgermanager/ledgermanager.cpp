@@ -14,13 +14,20 @@
  */
 #include "ledgermanager.h"
 #include <QFile>
-#include <QTextStream>
 #include <QMessageBox>
 #include <QTableView>
 #include <QDoubleSpinBox>
 #include <QHeaderView>
 #include <QStyleFactory>
+#include <QFileInfo>
 #include <QDebug>
+#include "noteitem.h"
+#include "darkstyle.h"
+#include "amountdelegate.h"
+#include "ledgerstats.h"
+#include <cmath>
+#include <algorithm>
+
 /**
  * @brief 构造函数
  * @param parent 父对象指针
@@ -37,6 +44,7 @@ LedgerManager::LedgerManager(QObject *parent)
 LedgerManager::~LedgerManager()
 {
     delete model;
+    delete storage;
 }
 
 /**
@@ -57,8 +65,59 @@ void LedgerManager::initModel()
     
     // 设置表头
     QStringList headers;
-    headers << "记账日期" << "当前总存款金额" << "当月工资" << "定期余额" << "当月开支" << "当月存款" << "当月可支配额度" << "备注";
+    headers << "记账日期" << "当前总存款金额" << "当月工资" << "定期余额" << "当月开支" << "当月存款" << "当月可支配额度" << "备注" << "币种";
     model->setHorizontalHeaderLabels(headers);
+    
+    // 任何修改都会使数据版本递增，图表等缓存据此判断是否需要重建
+    auto bumpVersion = [this]() { ++modelVersion; };
+    connect(model, &QAbstractItemModel::dataChanged, this, bumpVersion);
+    connect(model, &QAbstractItemModel::rowsInserted, this, bumpVersion);
+    connect(model, &QAbstractItemModel::rowsRemoved, this, bumpVersion);
+    connect(model, &QAbstractItemModel::modelReset, this, bumpVersion);
+    connect(model, &QAbstractItemModel::layoutChanged, this, bumpVersion);
+    
+    // 记录被修改的块，发布快照时只重建这些块
+    connect(model, &QAbstractItemModel::dataChanged, this, [this](const QModelIndex &topLeft, const QModelIndex &bottomRight) {
+        snapshots.markRowsChanged(topLeft.row(), bottomRight.row());
+    });
+    connect(model, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex &, int first, int) {
+        snapshots.markRowsShifted(first);
+    });
+    connect(model, &QAbstractItemModel::rowsRemoved, this, [this](const QModelIndex &, int first, int) {
+        snapshots.markRowsShifted(first);
+    });
+    connect(model, &QAbstractItemModel::modelReset, this, [this]() { snapshots.markAll(); });
+    connect(model, &QAbstractItemModel::layoutChanged, this, [this]() { snapshots.markAll(); });
+    
+    // 编辑历史记录后只重算受影响的行，并只写回这些行
+    recomputeEngine = new RecomputeEngine(this);
+    recomputeEngine->attach(model);
+    recomputeEngine->setExchangeRates(&rates);
+    connect(recomputeEngine, &RecomputeEngine::rowsChanged, this, [this](const QList<int> &rows) {
+        saveRows(rows);
+    });
+    connect(recomputeEngine, &RecomputeEngine::validationFailed, this, [this](const QString &message) {
+        showError("数据验证失败", message);
+    });
+}
+
+/**
+ * @brief 获取数据版本，模型每次被修改都会递增
+ * @return 返回数据版本号
+ */
+quint64 LedgerManager::dataVersion() const
+{
+    return modelVersion;
+}
+
+/**
+ * @brief 发布当前数据版本的只读快照，未修改的块与上一快照共享；
+ *        已归档的往年记录排在模型记录之前（窗口模式除外）
+ * @return 返回快照，可按值交给工作线程读取（必须在GUI线程调用）
+ */
+LedgerSnapshotPtr LedgerManager::snapshot()
+{
+    return snapshots.publish(model, modelVersion);
 }
 
 /**
@@ -69,108 +128,173 @@ void LedgerManager::loadData(const QString &filePath)
 {
     currentFilePath = filePath;
     
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        // 如果文件不存在，创建一个新文件
-        file.open(QIODevice::WriteOnly | QIODevice::Text);
-        file.close();
+    // 批量加载期间暂停重算引擎，加载完成后统一同步
+    recomputeEngine->setSuspended(true);
+    
+    // 重新加载时先清空已有记录，便于同一个管理器复用于多个账本
+    model->removeRows(0, model->rowCount());
+    
+    // 打开同名归档（不存在时忽略），归档记录排在快照的模型记录之前
+    archive.open(archiveFilePath());
+    reloadArchivedRecords();
+    
+    // 收支明细与账本同名保存，两种存储格式共用
+    if (!transactions.open(TransactionLedger::filePathFor(filePath))) {
+        qDebug() << "loadData: failed to read transactions for" << filePath;
+    }
+    if (!rates.open(ExchangeRates::filePathFor(filePath))) {
+        qDebug() << "loadData: failed to read exchange rates for" << filePath;
+    }
+    QStringList ruleErrors;
+    if (!budgetRules.open(BudgetRules::filePathFor(filePath), &ruleErrors)) {
+        qDebug() << "loadData: failed to read budget rules for" << filePath;
+    }
+    if (!ruleErrors.isEmpty()) {
+        qDebug() << "loadData: invalid budget rules" << ruleErrors;
+    }
+    budgetVersion = 0;
+    
+    delete storage;
+    storage = nullptr;
+    
+    residentOffset = 0;
+    residentStartRow = 0;
+    pagedBytes = 0;
+    pager.clear();
+    
+    // CSV与数据库账本都通过存储引擎读取，文件锁与版本戳由存储引擎维护
+    QString error;
+    storage = LedgerStorage::open(filePath, &error);
+    if (!storage) {
+        showError("错误", "无法打开账本：" + error);
+        recomputeEngine->setSuspended(false);
+        recomputeEngine->resync();
+        updateLeadingRecord();
         return;
     }
     
-    QTextStream in(&file);
-    int row = 0;
+    // 窗口模式下跳过常驻窗口之前的记录，它们留在文件中按需分页读取
+    loadWindow(filePath);
     
-    while (!in.atEnd()) {
-        QString line = in.readLine().trimmed();
-        if (line.isEmpty()) continue; // 跳过空行
-        
-        QStringList fields = line.split(",");
-        
-        // 智能判断是否包含序号列（检查第一个字段是否为数字）
-        bool hasIndexColumn = false;
-        if (!fields.isEmpty()) {
-            bool isNumber = false;
-            fields[0].toInt(&isNumber);
-            hasIndexColumn = isNumber;
-        }
-        
-        if (hasIndexColumn) {
-            // 包含序号列，从fields[1]开始加载
-            int startCol = 1;
-            int maxCol = qMin(fields.size() - startCol, 8); // 最多加载8列数据
-            for (int col = 0; col < maxCol; ++col) {
-                QStandardItem *item = new QStandardItem(fields[col + startCol]);
-                model->setItem(row, col, item);
-            }
-            // 如果缺少字段，用空字符串填充
-            for (int col = maxCol; col < 8; ++col) {
-                QStandardItem *item = new QStandardItem("");
-                model->setItem(row, col, item);
-            }
-            row++;
-        } else if (fields.size() >= 8) {
-            // 不包含序号列，直接加载前8个字段
-            for (int col = 0; col < 8; ++col) {
-                QStandardItem *item = new QStandardItem(fields[col]);
-                model->setItem(row, col, item);
-            }
-            row++;
-        }
-        // 对于其他格式，跳过该行
+    QVector<LedgerRecord> records;
+    if (!storage->readFrom(residentOffset, records)) {
+        showError("错误", "读取账本失败：" + storage->errorString());
     }
+    for (const LedgerRecord &record : records) {
+        model->appendRow(record.toItems(&notePool));
+    }
+    fileRowCount = model->rowCount();
     
-    file.close();
+    recomputeEngine->setSuspended(false);
+    recomputeEngine->resync();
+    updateLeadingRecord();
 }
 
 /**
- * @brief 保存账本数据到文件
+ * @brief 保存账本数据到文件（整体重写）
+ * 文件自上次同步后被其它程序修改过时拒绝覆盖，并提示冲突
  * @param filePath 文件路径
+ * @return 成功返回true
  */
-void LedgerManager::saveData(const QString &filePath)
+bool LedgerManager::saveData(const QString &filePath)
 {
-    currentFilePath = filePath;
-    
-    QFile file(filePath);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        showError("错误", "无法打开文件进行保存！");
-        return;
+    if (filePath != currentFilePath || !storage) {
+        delete storage;
+        QString error;
+        storage = LedgerStorage::open(filePath, &error);
+        if (!storage) {
+            showError("错误", "无法打开账本：" + error);
+            return false;
+        }
+        currentFilePath = filePath;
     }
     
-    QTextStream out(&file);
+    // 窗口模式下未载入的历史记录保持不变，只重写模型中的记录
+    if (!storage->writeFrom(residentOffset, modelRecords(0, model->rowCount() - 1))) {
+        showError("错误", "保存失败：" + storage->errorString());
+        return false;
+    }
+    fileRowCount = model->rowCount();
+    showSuccess("成功", "记录已保存！");
+    return true;
+}
+
+/**
+ * @brief 把尚未写入文件的新记录追加到当前文件末尾，不重写已有内容
+ * @return 成功返回true
+ */
+bool LedgerManager::appendNewRecords()
+{
+    if (!storage) {
+        return false;
+    }
+    if (fileRowCount >= model->rowCount()) {
+        return true;
+    }
     
-    for (int row = 0; row < model->rowCount(); ++row) {
-        QString line;
-        
-        // 添加序号（格式：行号+1）
-        line += QString::number(row + 1);
-        
-        // 添加其他字段
-        for (int col = 0; col < model->columnCount(); ++col) {
-            line += ",";
-            
-            QStandardItem *item = model->item(row, col);
-            if (item) {
-                line += item->text();
-            } else {
-                line += "";
-            }
-        }
-        out << line << "\n";
+    // 乐观并发：期间其它程序只追加了记录时先合并进来，再追加本地的新记录
+    QVector<LedgerRecord> appended;
+    if (!storage->readAppended(appended) || !mergeAppendedRecords(appended)) {
+        showError("保存冲突", "账本文件已被其它程序修改，无法自动合并，新记录尚未保存。\n请重新打开账本后再试！");
+        return false;
     }
     
-    file.close();
+    // 写入失败（如磁盘已满）时保留原来的行数，下次保存会重新追加这些记录
+    if (!storage->append(residentOffset + fileRowCount, modelRecords(fileRowCount, model->rowCount() - 1))) {
+        showError("错误", "保存失败：" + storage->errorString());
+        return false;
+    }
+    fileRowCount = model->rowCount();
     showSuccess("成功", "记录已保存！");
+    return true;
+}
+
+/**
+ * @brief 是否有已加入表格但尚未写入文件的新记录（上一次追加失败）
+ */
+bool LedgerManager::hasUnsavedRecords() const
+{
+    return storage && fileRowCount < model->rowCount();
+}
+
+/**
+ * @brief 只把指定的行写回文件，其余行原样保留
+ * @param rows 行号列表
+ * @return 成功返回true
+ */
+bool LedgerManager::saveRows(const QList<int> &rows)
+{
+    if (!storage || rows.isEmpty()) {
+        return false;
+    }
+    
+    // 尚未写入文件的新记录由appendNewRecords追加；窗口模式下行号加上未载入的记录数
+    QMap<int, LedgerRecord> changed;
+    for (int row : rows) {
+        if (row < fileRowCount) {
+            changed.insert(residentOffset + row, LedgerRecord::fromModelRow(model, row));
+        }
+    }
+    if (!changed.isEmpty() && !storage->update(changed)) {
+        showError("错误", "保存失败：" + storage->errorString());
+        return false;
+    }
+    return true;
 }
 
 /**
- * @brief 计算可支配额度
+ * @brief 计算可支配额度，并换算为报表币种
  * @param totalDeposit 当前总存款金额
  * @param fixedDeposit 定期余额
- * @return 返回可支配额度（当前总存款金额 - 定期余额）
+ * @param currency 金额的币种，空表示默认币种
+ * @param date 换算使用的汇率日期，无效日期表示今天
+ * @return 返回可支配额度（当前总存款金额 - 定期余额），缺少汇率时按原币种返回
  */
-double LedgerManager::calculateDisposableAmount(double totalDeposit, double fixedDeposit) const
+double LedgerManager::calculateDisposableAmount(double totalDeposit, double fixedDeposit, const QString &currency, const QDate &date) const
 {
-    return totalDeposit - fixedDeposit;
+    const double disposable = totalDeposit - fixedDeposit;
+    const double factor = rates.rate(currency, reportCurrency, date.isValid() ? date : QDate::currentDate());
+    return std::isnan(factor) ? disposable : disposable * factor;
 }
 
 /**
@@ -180,17 +304,25 @@ double LedgerManager::calculateDisposableAmount(double totalDeposit, double fixe
  * @param expense 当月开支（输出参数）
  * @param monthlyDeposit 当月存款（输出参数）
  * @param hasPreviousRecord 是否有上一次记录
+ * @param currency 当前记录的币种，空表示默认币种
+ * @param date 当前记录的日期，上一次总存款按该日汇率换算为当前币种
+ * @return 上一次记录的币种不同且缺少汇率时返回false，此时不计算当月开支
  */
-void LedgerManager::calculateAmounts(double totalDeposit, double salary, double &expense, double &monthlyDeposit, bool hasPreviousRecord)
+bool LedgerManager::calculateAmounts(double totalDeposit, double salary, double &expense, double &monthlyDeposit, bool hasPreviousRecord,
+                                     const QString &currency, const QDate &date)
 {
     if (hasPreviousRecord) {
-        // 有上一次记录，自动计算当月开支
-        double previousTotalDeposit = getPreviousTotalDeposit();
+        // 有上一次记录，自动计算当月开支；上一次总存款先换算为当前记录的币种
+        double previousTotalDeposit = 0.0;
+        if (!getPreviousTotalDeposit(currency, date, previousTotalDeposit)) {
+            return false;
+        }
         expense = previousTotalDeposit + salary - totalDeposit;
     }
     
     // 计算当月存款 = 当月工资 - 当月开支
     monthlyDeposit = salary - expense;
+    return true;
 }
 
 /**
@@ -199,7 +331,8 @@ void LedgerManager::calculateAmounts(double totalDeposit, double salary, double
  */
 bool LedgerManager::isFirstRecord() const
 {
-    return model->rowCount() == 0;
+    // 归档或窗口模式下模型为空时，之前仍有记录
+    return model->rowCount() == 0 && !recomputeEngine->hasLeadingRecord();
 }
 
 /**
@@ -211,14 +344,20 @@ void LedgerManager::initTableView(QTableView *tableView) const
     // 设置模型
     tableView->setModel(const_cast<QStandardItemModel*>(model));
     
-    // 禁用编辑功能
-    tableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    // 允许双击修改历史记录，派生列由重算引擎设为只读
+    tableView->setEditTriggers(QAbstractItemView::DoubleClicked | QAbstractItemView::EditKeyPressed);
     
     // 设置表格外观
     tableView->setAlternatingRowColors(true);
     
-    // 应用暗色主题样式
-    setupDarkThemeStyle(tableView);
+    // 暗色主题（背景、交替行、网格线、表头）由应用程序级的DarkStyle提供，
+    // 不再设置样式表，单元格走原生绘制路径
+    
+    // 金额列使用缓存字形的快速绘制代理
+    AmountDelegate *amountDelegate = new AmountDelegate(tableView);
+    for (int column = ColTotalDeposit; column <= ColDisposable; ++column) {
+        tableView->setItemDelegateForColumn(column, amountDelegate);
+    }
     
     // 设置列宽
     tableView->resizeColumnsToContents();
@@ -268,60 +407,52 @@ bool LedgerManager::confirmOperation(const QString &title, const QString &messag
     return QMessageBox::question(nullptr, title, message) == QMessageBox::Yes;
 }
 
-/**
- * @brief 设置暗色主题样式
- * @param tableView 表格视图指针
- */
-void LedgerManager::setupDarkThemeStyle(QTableView *tableView) const
-{
-    tableView->setStyleSheet(
-        "QTableView { background-color: #2a2a2a; color: white; }"  // 主背景色和文字颜色
-        "QTableView::item:alternate { background-color: #323232; }"  // 交替行背景色
-        "QTableView { gridline-color: #4a4a4a; }"  // 网格线颜色
-    );
-    
-    tableView->horizontalHeader()->setStyleSheet(
-        "QHeaderView::section { background-color: #3a3a3a; color: #ffffff; padding: 8px; border: 1px solid #4a4a4a; }"
-    );
-}
-
 /**
  * @brief 配置控件样式
  * @param widget 控件指针
  * @param readOnly 是否只读
- * @param readOnlyColor 只读背景颜色
- * @param textColor 文本颜色
  */
-void LedgerManager::configureWidgetStyle(QWidget *widget, bool readOnly, const QString &readOnlyColor, const QString &textColor) const
+void LedgerManager::configureWidgetStyle(QWidget *widget, bool readOnly) const
 {
     QDoubleSpinBox *spinBox = qobject_cast<QDoubleSpinBox*>(widget);
     if (spinBox) {
         spinBox->setReadOnly(readOnly);
-        
-        if (readOnly) {
-            spinBox->setStyleSheet(QString("QDoubleSpinBox:read-only { background-color: %1; color: #888888; }").arg(readOnlyColor));
-        } else {
-            spinBox->setStyleSheet(QString("QDoubleSpinBox { background-color: %1; color: %2; }").arg(readOnlyColor, textColor));
-        }
+        // 只修改调色板，不会触发样式表解析和repolish
+        DarkStyle::setReadOnlyAppearance(spinBox, readOnly);
     }
 }
 
-double LedgerManager::getPreviousTotalDeposit() const
+/**
+ * @brief 获取上一次记录的总存款金额，并换算为指定币种
+ * @param currency 目标币种，空表示默认币种
+ * @param date 换算使用的汇率日期
+ * @param total 换算后的总存款金额（输出参数），没有上一次记录时为0
+ * @return 上一次记录的币种不同且缺少汇率时返回false
+ */
+bool LedgerManager::getPreviousTotalDeposit(const QString &currency, const QDate &date, double &total) const
 {
-    int rowCount = model->rowCount();
-    if (rowCount == 0) {
-        return 0.0;
+    const int index = ColTotalDeposit - ColTotalDeposit;
+    total = 0.0;
+    // 模型中没有记录时，上一条是归档或窗口之前的记录
+    LedgerRecord previous;
+    bool found = false;
+    for (int row = model->rowCount() - 1; row >= 0 && !found; --row) {
+        previous = LedgerRecord::fromModelRow(model, row);
+        found = previous.hasAmount(index);
     }
-    
-    qDebug() << "获取上一次总存款金额，行数:" << rowCount;
-   for (int row = rowCount - 1; row >= 0; --row) {
-        QStandardItem *previousItem = model->item(row, 1); // 获取当前行的总存款金额
-        if (previousItem && !previousItem->text().isEmpty()) {
-            return previousItem->text().toDouble();
-        }
+    if (!found && recomputeEngine->hasLeadingRecord()) {
+        previous = recomputeEngine->leadingRecord();
+        found = previous.hasAmount(index);
     }
-    
-    return 0.0;
+    if (!found) {
+        return true;
+    }
+    qint64 cents = 0;
+    if (!rates.convertCents(previous.amounts[index], previous.currency, currency, date, cents)) {
+        return false;
+    }
+    total = cents / 100.0;
+    return true;
 }
 
 double LedgerManager::getPreviousFixedDeposit() const
@@ -371,10 +502,14 @@ QDate LedgerManager::getPreviousDate() const
         }
     }
     
+    // 模型中没有记录时，返回归档或窗口之前的最后一条记录的日期
+    if (recomputeEngine->hasLeadingRecord()) {
+        return recomputeEngine->leadingRecord().date;
+    }
     return QDate(); // 返回无效日期
 }
 
-bool LedgerManager::addRecord(const QDate &date, double totalDeposit, double salary, double fixedDeposit, double expense, double monthlyDeposit, const QString &note)
+bool LedgerManager::addRecord(const QDate &date, double totalDeposit, double salary, double fixedDeposit, double expense, double monthlyDeposit, const QString &note, const QString &currency)
 {
 
     
@@ -412,9 +547,13 @@ bool LedgerManager::addRecord(const QDate &date, double totalDeposit, double sal
     }
     
     // 验证当前总存款金额是否小于等于上一次总存款金额 + 当月工资
-    int rowCount = model->rowCount();
-    if (rowCount > 0) {
-        double previousTotalDeposit = getPreviousTotalDeposit();
+    if (!isFirstRecord()) {
+        double previousTotalDeposit = 0.0;
+        if (!getPreviousTotalDeposit(currency, date, previousTotalDeposit)) {
+            QMessageBox::warning(nullptr, "数据验证失败", QString("缺少上一次记录的币种到 %1 的汇率，无法校验当前总存款金额！")
+                                 .arg(LedgerRecord::normalizeCurrency(currency)));
+            return false;
+        }
         if (totalDeposit > previousTotalDeposit + salary) {
             QMessageBox::warning(nullptr, "数据验证失败", "当前总存款金额不能大于上一次总存款金额与当月工资之和！");
             qDebug() << "上一次记录的总存款金额:" << previousTotalDeposit << "当前总存款金额:" << totalDeposit << "工资:" << salary;
@@ -430,7 +569,7 @@ bool LedgerManager::addRecord(const QDate &date, double totalDeposit, double sal
     }
     
     // 检查是否为第一次填写且没有输入当月开支
-    if (getRowCount() == 0 && expense == 0.0) {
+    if (isFirstRecord() && expense == 0.0) {
         QMessageBox::warning(nullptr, "警告", "这是第一次填写记录，当月开支为0，请确认是否正确！");
     }
     
@@ -458,10 +597,30 @@ bool LedgerManager::addRecord(const QDate &date, double totalDeposit, double sal
     items << new QStandardItem(expenseStr);
     items << new QStandardItem(monthlyDepositStr);
     items << new QStandardItem(disposableAmountStr);
-    items << new QStandardItem(note);
+    items << createItem(ColNote, note);
+    const QString currencyCode = LedgerRecord::normalizeCurrency(currency);
+    items << new QStandardItem(currencyCode == LedgerRecord::DefaultCurrency ? QString() : currencyCode);
     
+    const bool sketchesCurrent = sketchVersion == modelVersion;
+    const bool rulesCurrent = budgetVersion == modelVersion;
     model->appendRow(items);
     
+    // 分位数草图已是最新时只插入新记录的开支，不必重建
+    if (sketchesCurrent) {
+        const double factor = conversionFactor(model->rowCount() - 1);
+        if (!std::isnan(factor)) {
+            expenseSketches[date.year()].add(expense * factor);
+        }
+        sketchVersion = modelVersion;
+    }
+    
+    // 预算规则的滑动窗口同样只追加新记录
+    if (rulesCurrent) {
+        const int last = model->rowCount() - 1;
+        budgetRules.append(LedgerRecord::fromModelRow(model, last), conversionFactor(last));
+        budgetVersion = modelVersion;
+    }
+    
     return true;
 }
 
@@ -500,4 +659,719 @@ void LedgerManager::cleanEmptyRows()
             model->removeRow(row);
         }
     }
-}
\ No newline at end of file
+}
+
+/**
+ * @brief 将早于截止日期的记录移入列式压缩归档，并从模型中移除
+ * @param cutoff 截止日期（不含）
+ * @return 返回本次归档的行数，失败返回-1
+ */
+int LedgerManager::archiveHistory(const QDate &cutoff)
+{
+    if (!cutoff.isValid() || currentFilePath.isEmpty()) {
+        return -1;
+    }
+    
+    // 归档会删除文件中的记录，窗口模式下文件中还有未载入的记录，不能只按模型处理
+    if (isWindowed()) {
+        showError("错误", "窗口模式下只载入了部分记录，请关闭窗口模式后再归档！");
+        return -1;
+    }
+    
+    // 记录按日期递增，待归档的行集中在模型顶部
+    QVector<LedgerRecord> moved;
+    int row = 0;
+    for (; row < model->rowCount(); ++row) {
+        LedgerRecord record = LedgerRecord::fromModelRow(model, row);
+        if (!record.date.isValid() || record.date >= cutoff) {
+            break;
+        }
+        moved.append(record);
+    }
+    if (moved.isEmpty()) {
+        return 0;
+    }
+    
+    // 与已有归档合并后整体重写（归档是冷数据，重写频率很低）；
+    // 已有归档无法打开或有块解压失败时中止，否则重写会丢掉这些记录
+    const QString path = archiveFilePath();
+    if (QFile::exists(path) && !archive.isOpen() && !archive.open(path)) {
+        showError("错误", "已有归档文件无法读取，为避免覆盖其中的记录，本次未归档！");
+        return -1;
+    }
+    bool archiveIntact = true;
+    const QVector<LedgerRecord> previous = archive.isOpen() ? archive.records(QDate(), QDate(), &archiveIntact) : QVector<LedgerRecord>();
+    if (!archiveIntact) {
+        showError("错误", "已有归档中的部分数据块无法解压，为避免覆盖其中的记录，本次未归档！");
+        return -1;
+    }
+    if (!previous.isEmpty() && previous.last().date >= moved.first().date) {
+        showError("错误", "归档中已存在晚于待归档记录的日期，无法归档！");
+        return -1;
+    }
+    
+    // 先写归档（QSaveFile原子替换），再保存账本：中途失败时记录最多同时存在于两个文件，不会丢失
+    if (!LedgerArchive::write(path, previous + moved)) {
+        showError("错误", "无法写入归档文件！");
+        return -1;
+    }
+    
+    const int savedRowCount = fileRowCount;
+    model->removeRows(0, row);
+    fileRowCount = qMax(0, fileRowCount - row);
+    if (!saveData(currentFilePath)) {
+        // 账本未保存：放回模型中的记录，并把归档恢复为原来的内容
+        recomputeEngine->setSuspended(true);
+        model->insertRows(0, moved.size());
+        for (int i = 0; i < moved.size(); ++i) {
+            const QList<QStandardItem*> items = moved[i].toItems(&notePool);
+            for (int col = 0; col < items.size(); ++col) {
+                model->setItem(i, col, items[col]);
+            }
+        }
+        recomputeEngine->setSuspended(false);
+        recomputeEngine->resync();
+        fileRowCount = savedRowCount;
+        const bool restored = previous.isEmpty() ? QFile::remove(path) : LedgerArchive::write(path, previous);
+        if (!restored) {
+            showError("错误", "账本保存失败且归档无法恢复，归档中可能包含与账本重复的记录！");
+        }
+        archive.open(path);
+        reloadArchivedRecords();
+        updateLeadingRecord();
+        return -1;
+    }
+    archive.open(path);
+    reloadArchivedRecords();
+    updateLeadingRecord();
+    return moved.size();
+}
+
+/**
+ * @brief 查询归档中日期范围内的记录，只解压命中的数据块
+ * @param from 起始日期（含），无效日期表示不限
+ * @param to 结束日期（含），无效日期表示不限
+ * @return 返回按日期排序的记录
+ */
+QVector<LedgerRecord> LedgerManager::queryArchive(const QDate &from, const QDate &to)
+{
+    if (!archive.isOpen()) {
+        return QVector<LedgerRecord>();
+    }
+    return archive.records(from, to);
+}
+
+/**
+ * @brief 快照中排在模型记录之前的归档记录行数（快照行号减去它即为模型行号）
+ */
+int LedgerManager::archivedRowCount() const
+{
+    return snapshots.leadingRecords().size();
+}
+
+/**
+ * @brief 重新读取归档记录，使图表、统计、分位数和预测覆盖已归档的往年记录；
+ *        窗口模式只关注最近的记录，不读入归档
+ */
+void LedgerManager::reloadArchivedRecords()
+{
+    QVector<LedgerRecord> records;
+    if (residentMonths <= 0 && archive.isOpen()) {
+        bool intact = true;
+        records = archive.records(QDate(), QDate(), &intact);
+        if (!intact) {
+            qDebug() << "reloadArchivedRecords: some archive blocks failed to decode";
+        }
+    }
+    if (!records.isEmpty() || archivedRowCount() > 0) {
+        snapshots.setLeadingRecords(records);
+        ++modelVersion;
+    }
+}
+
+/**
+ * @brief 把模型第0行之前的记录交给重算引擎：窗口模式下是未载入的前一条记录，
+ *        否则是归档的最后一条记录；都没有时模型第0行即账本的第一条记录
+ */
+void LedgerManager::updateLeadingRecord()
+{
+    QVector<LedgerRecord> previous;
+    if (residentOffset > 0) {
+        // 常驻窗口与块边界对齐，前一块的最后一条即窗口之前的记录
+        const QVector<LedgerRecord> *block = pager.records(pager.blockForRow(residentOffset - 1));
+        if (block) {
+            previous = *block;
+        }
+    } else if (archive.isOpen() && archive.rowCount() > 0) {
+        previous = archive.records(archive.lastDate(), QDate());
+    }
+    if (previous.isEmpty()) {
+        recomputeEngine->clearLeadingRecord();
+    } else {
+        recomputeEngine->setLeadingRecord(previous.last());
+    }
+}
+
+/**
+ * @brief 获取当前账本对应的归档文件路径
+ * @return 返回与CSV同目录、同名的.lgra文件路径
+ */
+QString LedgerManager::archiveFilePath() const
+{
+    QFileInfo info(currentFilePath);
+    return info.absolutePath() + "/" + info.completeBaseName() + ".lgra";
+}
+
+/**
+ * @brief 创建单元格，备注列使用驻留池保存
+ * @param column 列号
+ * @param text 单元格文本
+ * @return 返回新单元格，由调用方接管所有权
+ */
+QStandardItem *LedgerManager::createItem(int column, const QString &text)
+{
+    if (column == ColNote) {
+        return new NoteItem(&notePool, text);
+    }
+    return new QStandardItem(text);
+}
+
+/**
+ * @brief 查找备注等于指定文本的所有行，只比较驻留句柄
+ * @param note 备注文本
+ * @return 返回行号列表
+ */
+QList<int> LedgerManager::findRowsByNote(const QString &note) const
+{
+    QList<int> rows;
+    const NotePool::Handle handle = notePool.find(note);
+    if (handle == NotePool::InvalidHandle) {
+        return rows;
+    }
+    
+    for (int row = 0; row < model->rowCount(); ++row) {
+        QStandardItem *item = model->item(row, ColNote);
+        if (item && item->type() == NoteItem::Type) {
+            if (static_cast<NoteItem*>(item)->handle() == handle) {
+                rows.append(row);
+            }
+        } else if ((item ? item->text() : QString()) == note) {
+            rows.append(row);
+        }
+    }
+    return rows;
+}
+
+/**
+ * @brief 获取备注驻留池
+ */
+const NotePool &LedgerManager::getNotePool() const
+{
+    return notePool;
+}
+
+/**
+ * @brief 获取当前账本的汇率表
+ */
+const ExchangeRates &LedgerManager::getExchangeRates() const
+{
+    return rates;
+}
+
+/**
+ * @brief 把外部汇率文件合并到当前账本的汇率表
+ * @param sourcePath 汇率文件路径（每行：日期,源币种,目标币种,汇率）
+ * @return 返回导入的条数，失败返回-1
+ */
+int LedgerManager::importExchangeRates(const QString &sourcePath)
+{
+    QString error;
+    const int count = rates.importFile(sourcePath, &error);
+    if (count < 0) {
+        showError("错误", "导入汇率失败：" + error);
+        return -1;
+    }
+    // 换算结果变化，统计和图表需要重建
+    ++modelVersion;
+    return count;
+}
+
+/**
+ * @brief 设置报表币种，统计、图表和可支配额度都换算为该币种
+ * @param currency 币种代码
+ */
+void LedgerManager::setReportingCurrency(const QString &currency)
+{
+    const QString code = currency.isEmpty() ? QString(LedgerRecord::DefaultCurrency) : LedgerRecord::normalizeCurrency(currency);
+    if (code != reportCurrency) {
+        reportCurrency = code;
+        ++modelVersion;
+    }
+}
+
+QString LedgerManager::reportingCurrency() const
+{
+    return reportCurrency;
+}
+
+/**
+ * @brief 获取每行换算到报表币种的系数（按数据版本缓存）
+ * @return 返回与快照行（归档记录 + 模型行）一一对应的系数，缺少汇率的行为NaN
+ */
+const QVector<double> &LedgerManager::conversionFactors()
+{
+    const QVector<LedgerRecord> &archived = snapshots.leadingRecords();
+    const int rowCount = model->rowCount();
+    if (factorVersion == modelVersion && factorCache.size() == archived.size() + rowCount) {
+        return factorCache;
+    }
+    
+    QStringList currencies;
+    QVector<qint64> days;
+    currencies.reserve(archived.size() + rowCount);
+    days.reserve(archived.size() + rowCount);
+    for (const LedgerRecord &record : archived) {
+        days.append(record.date.isValid() ? record.date.toJulianDay() : QDate::currentDate().toJulianDay());
+        currencies.append(LedgerRecord::normalizeCurrency(record.currency));
+    }
+    for (int row = 0; row < rowCount; ++row) {
+        QStandardItem *dateItem = model->item(row, ColDate);
+        QStandardItem *currencyItem = model->item(row, ColCurrency);
+        const QDate date = dateItem ? LedgerRecord::parseDate(dateItem->text()) : QDate();
+        days.append(date.isValid() ? date.toJulianDay() : QDate::currentDate().toJulianDay());
+        currencies.append(currencyItem ? LedgerRecord::normalizeCurrency(currencyItem->text()) : QString());
+    }
+    factorCache = rates.factors(currencies, days, reportCurrency);
+    factorVersion = modelVersion;
+    return factorCache;
+}
+
+/**
+ * @brief 获取某一行换算到报表币种的系数
+ * @param row 行号
+ */
+double LedgerManager::conversionFactor(int row) const
+{
+    const LedgerRecord record = LedgerRecord::fromModelRow(model, row);
+    return rates.rate(record.currency, reportCurrency, record.date.isValid() ? record.date : QDate::currentDate());
+}
+
+/**
+ * @brief 把整列金额换算为报表币种（批量向量化换算）
+ * @param column 金额列号
+ * @return 返回与快照行对应的换算后金额，空单元格或缺少汇率为NaN
+ */
+QVector<double> LedgerManager::convertedColumn(int column)
+{
+    QVector<double> values = snapshot()->column(column);
+    const QVector<double> &factors = conversionFactors();
+    LedgerStats::multiply(values.constData(), factors.constData(), values.data(), qMin(values.size(), factors.size()));
+    return values;
+}
+
+/**
+ * @brief 缺少汇率、无法换算的行数
+ */
+int LedgerManager::missingRateRows()
+{
+    const QVector<double> &factors = conversionFactors();
+    return static_cast<int>(std::count_if(factors.cbegin(), factors.cend(), [](double factor) {
+        return std::isnan(factor);
+    }));
+}
+
+/**
+ * @brief 数据版本变化后按换算后的当月开支重建各年的分位数草图
+ */
+void LedgerManager::rebuildExpenseSketches()
+{
+    if (sketchVersion == modelVersion) {
+        return;
+    }
+    expenseSketches.clear();
+    const LedgerSnapshotPtr current = snapshot();
+    const QVector<double> expenses = convertedColumn(ColExpense);
+    for (int row = 0; row < expenses.size(); ++row) {
+        const QDate &date = current->record(row).date;
+        if (date.isValid() && !std::isnan(expenses[row])) {
+            expenseSketches[date.year()].add(expenses[row]);
+        }
+    }
+    sketchVersion = modelVersion;
+}
+
+/**
+ * @brief 获取有当月开支记录的年份（升序）
+ */
+QList<int> LedgerManager::expenseYears()
+{
+    rebuildExpenseSketches();
+    return expenseSketches.keys();
+}
+
+/**
+ * @brief 获取某年当月开支（换算为报表币种）的分位数草图
+ * @param year 年份
+ * @return 返回草图，该年没有记录时返回空草图
+ */
+const QuantileSketch &LedgerManager::expenseSketch(int year)
+{
+    static const QuantileSketch empty;
+    rebuildExpenseSketches();
+    auto it = expenseSketches.constFind(year);
+    return it == expenseSketches.constEnd() ? empty : it.value();
+}
+
+/**
+ * @brief 合并各年份的草图，得到全部当月开支的分位数草图
+ */
+QuantileSketch LedgerManager::mergedExpenseSketch()
+{
+    rebuildExpenseSketches();
+    QuantileSketch merged;
+    for (const QuantileSketch &sketch : expenseSketches) {
+        merged.merge(sketch);
+    }
+    return merged;
+}
+
+/**
+ * @brief 获取某年当月开支高于该年指定分位数的记账日期
+ * @param year 年份
+ * @param q 分位点（如0.95）
+ */
+QList<QDate> LedgerManager::monthsAboveExpenseQuantile(int year, double q)
+{
+    QList<QDate> result;
+    const QuantileSketch &sketch = expenseSketch(year);
+    if (sketch.isEmpty()) {
+        return result;
+    }
+    const double threshold = sketch.quantile(q);
+    
+    // 与草图使用同一份快照行（含归档记录）；记录按日期排序，只需检查该年的行
+    const LedgerSnapshotPtr current = snapshot();
+    const QVector<double> expenses = convertedColumn(ColExpense);
+    for (int row = expenses.size() - 1; row >= 0; --row) {
+        const QDate &date = current->record(row).date;
+        if (!date.isValid() || date.year() > year) {
+            continue;
+        }
+        if (date.year() < year) {
+            break;
+        }
+        if (!std::isnan(expenses[row]) && expenses[row] > threshold) {
+            result.prepend(date);
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief 数据版本变化后重放最近的记录，恢复预算规则的滑动窗口（只需回看 historyDepth 条）
+ */
+void LedgerManager::syncBudgetRules()
+{
+    if (budgetVersion == modelVersion) {
+        return;
+    }
+    budgetRules.reset();
+    const int rowCount = model->rowCount();
+    for (int row = qMax(0, rowCount - budgetRules.historyDepth()); row < rowCount; ++row) {
+        budgetRules.append(LedgerRecord::fromModelRow(model, row), conversionFactor(row));
+    }
+    budgetVersion = modelVersion;
+}
+
+/**
+ * @brief 用当前账本最近的记录检查一条待录入的记录
+ * @param candidate 待录入的记录
+ * @return 返回触发的规则名称
+ */
+QStringList LedgerManager::checkBudgetRules(const LedgerRecord &candidate)
+{
+    syncBudgetRules();
+    const double factor = rates.rate(candidate.currency, reportCurrency, candidate.date.isValid() ? candidate.date : QDate::currentDate());
+    return budgetRules.evaluate(candidate, factor);
+}
+
+/**
+ * @brief 获取预算规则文本
+ */
+QString LedgerManager::budgetRulesText() const
+{
+    return budgetRules.text();
+}
+
+/**
+ * @brief 替换预算规则并保存到账本同名的规则文件
+ * @param text 规则文本
+ * @param errors 无法编译的规则（输出参数，可为空）
+ * @return 返回编译成功的规则数
+ */
+int LedgerManager::setBudgetRules(const QString &text, QStringList *errors)
+{
+    const int count = budgetRules.setText(text, errors);
+    budgetVersion = 0;
+    if (!currentFilePath.isEmpty() && !budgetRules.save(BudgetRules::filePathFor(currentFilePath))) {
+        showError("错误", "无法保存预算规则文件");
+    }
+    return count;
+}
+
+/**
+ * @brief 获取当前账本的收支明细子账本
+ */
+TransactionLedger &LedgerManager::getTransactions()
+{
+    return transactions;
+}
+
+/**
+ * @brief 由收支明细的月汇总推导某月的当月工资与当月开支
+ * @param date 该月中的任意日期
+ * @param income 收入合计（输出参数，单位：元）
+ * @param expense 支出合计（输出参数，单位：元）
+ * @return 该月有明细时返回true
+ */
+bool LedgerManager::deriveMonthFromTransactions(const QDate &date, double &income, double &expense) const
+{
+    if (!date.isValid()) {
+        return false;
+    }
+    const TransactionLedger::Totals totals = transactions.monthTotals(date.year(), date.month());
+    if (totals.isEmpty()) {
+        return false;
+    }
+    income = totals.income / 100.0;
+    expense = totals.expense / 100.0;
+    return true;
+}
+
+/**
+ * @brief 合并其它进程追加到文件末尾的记录，插到本地尚未写入的新记录之前
+ * @param appended 存储引擎读到的追加记录
+ * @return 日期顺序不冲突时返回true
+ */
+bool LedgerManager::mergeAppendedRecords(const QVector<LedgerRecord> &appended)
+{
+    if (appended.isEmpty()) {
+        storage->acceptAppended();
+        return true;
+    }
+    
+    // 合并后日期必须仍然严格递增
+    QDate previous = fileRowCount > 0 ? LedgerRecord::fromModelRow(model, fileRowCount - 1).date : QDate();
+    for (const LedgerRecord &record : appended) {
+        if (!record.date.isValid() || (previous.isValid() && record.date <= previous)) {
+            return false;
+        }
+        previous = record.date;
+    }
+    if (fileRowCount < model->rowCount() && LedgerRecord::fromModelRow(model, fileRowCount).date <= previous) {
+        return false;
+    }
+    
+    int row = fileRowCount;
+    for (const LedgerRecord &record : appended) {
+        model->insertRow(row++, record.toItems(&notePool));
+    }
+    
+    // 本地新记录的当月开支依赖上一行的总存款，需要按合并后的上一行重算
+    recomputeEngine->recomputeRows(row, row);
+    fileRowCount = row;
+    storage->acceptAppended();
+    return true;
+}
+
+/**
+ * @brief 读取模型中连续若干行的记录
+ * @param first 起始行号
+ * @param last 结束行号（含）
+ */
+QVector<LedgerRecord> LedgerManager::modelRecords(int first, int last) const
+{
+    QVector<LedgerRecord> records;
+    records.reserve(qMax(0, last - first + 1));
+    for (int row = first; row <= last; ++row) {
+        records.append(LedgerRecord::fromModelRow(model, row));
+    }
+    return records;
+}
+
+/**
+ * @brief 把当前账本一次性迁移到另一种存储格式，并切换到新文件
+ * @param targetPath 目标文件路径（后缀决定存储格式）
+ * @return 成功返回true
+ */
+bool LedgerManager::migrateStorage(const QString &targetPath)
+{
+    if (currentFilePath.isEmpty()) {
+        return false;
+    }
+    
+    // 源文件由存储引擎在读取期间加锁
+    QString error;
+    const int count = LedgerStorage::migrate(currentFilePath, targetPath, &error);
+    if (count < 0) {
+        showError("错误", "迁移失败：" + error);
+        return false;
+    }
+    
+    loadData(targetPath);
+    showSuccess("成功", QString("已迁移 %1 条记录").arg(count));
+    return true;
+}
+
+/**
+ * @brief 设置窗口模式，下次loadData时生效
+ * @param months 常驻模型的最近月数，0表示关闭窗口模式（全部载入）
+ * @param maxHistoryBytes 分页读入的历史记录（模型中与块缓存中合计）的内存上限（字节）
+ */
+void LedgerManager::setResidentWindow(int months, qint64 maxHistoryBytes)
+{
+    residentMonths = qMax(0, months);
+    this->maxHistoryBytes = qMax<qint64>(0, maxHistoryBytes);
+}
+
+/**
+ * @brief 当前是否只载入了文件中的部分记录
+ */
+bool LedgerManager::isWindowed() const
+{
+    return residentStartRow > 0;
+}
+
+/**
+ * @brief 窗口模式下建立块索引，并确定常驻窗口的起始记录（只支持CSV账本）
+ * @param filePath CSV文件路径
+ * @return 需要跳过更早的记录时返回true
+ */
+bool LedgerManager::loadWindow(const QString &filePath)
+{
+    if (residentMonths <= 0 || storage->backend() != LedgerStorage::CsvBackend
+            || !pager.index(filePath) || pager.blockCount() == 0) {
+        pager.clear();
+        return false;
+    }
+    
+    // 常驻窗口从包含截止日期的块开始，保证窗口边界与块边界对齐
+    const QDate lastDate = pager.block(pager.blockCount() - 1).lastDate;
+    if (!lastDate.isValid()) {
+        pager.clear();
+        return false;
+    }
+    const int first = qMin(pager.firstBlockEndingOnOrAfter(lastDate.addMonths(-residentMonths)), pager.blockCount() - 1);
+    if (first == 0) {
+        pager.clear();
+        return false;
+    }
+    
+    const HistoryPager::Block &block = pager.block(first);
+    pager.setMaxCacheBytes(maxHistoryBytes);
+    residentOffset = block.firstRow;
+    residentStartRow = block.firstRow;
+    return true;
+}
+
+/**
+ * @brief 把常驻窗口之前的一块历史记录读入模型顶部（表格滚动到顶部时调用）
+ * @return 返回读入的行数；没有更早的记录返回0，超出内存上限或文件已变化返回-1
+ */
+int LedgerManager::pageInHistory()
+{
+    if (residentOffset <= 0) {
+        return 0;
+    }
+    
+    // 文件被其它程序修改后块偏移可能失效，需要重新加载
+    if (storage->isModifiedExternally()) {
+        return -1;
+    }
+    
+    const int index = pager.blockForRow(residentOffset - 1);
+    const QVector<LedgerRecord> *records = pager.records(index);
+    if (!records || records->isEmpty()) {
+        return -1;
+    }
+    
+    // 模型中的分页记录与块缓存共用同一个内存上限，读入后相应缩小缓存
+    const qint64 cost = HistoryPager::estimateBytes(*records);
+    if (pagedBytes + cost > maxHistoryBytes) {
+        return -1;
+    }
+    
+    const int count = records->size();
+    recomputeEngine->setSuspended(true);
+    model->insertRows(0, count);
+    for (int row = 0; row < count; ++row) {
+        const QList<QStandardItem*> items = records->at(row).toItems(&notePool);
+        for (int col = 0; col < items.size(); ++col) {
+            model->setItem(row, col, items[col]);
+        }
+    }
+    recomputeEngine->setSuspended(false);
+    recomputeEngine->resync();
+    
+    residentOffset -= count;
+    fileRowCount += count;
+    pagedBytes += cost;
+    pager.setMaxCacheBytes(maxHistoryBytes - pagedBytes);
+    updateLeadingRecord();
+    return count;
+}
+
+/**
+ * @brief 把分页读入的历史记录移出模型，恢复到只常驻最近记录的状态
+ * @return 返回移出的行数
+ */
+int LedgerManager::pageOutHistory()
+{
+    const int count = pagedHistoryRows();
+    if (count <= 0) {
+        return 0;
+    }
+    
+    // 分页记录上的修改已由saveRows写回文件，可以直接丢弃
+    recomputeEngine->setSuspended(true);
+    model->removeRows(0, count);
+    recomputeEngine->setSuspended(false);
+    recomputeEngine->resync();
+    
+    residentOffset = residentStartRow;
+    fileRowCount -= count;
+    pagedBytes = 0;
+    pager.setMaxCacheBytes(maxHistoryBytes);
+    updateLeadingRecord();
+    return count;
+}
+
+/**
+ * @brief 获取当前分页读入模型的历史记录行数
+ */
+int LedgerManager::pagedHistoryRows() const
+{
+    return residentStartRow - residentOffset;
+}
+
+/**
+ * @brief 按日期范围查询账本记录，归档中的记录按需解压，窗口之外的部分按块从文件读取
+ * @param from 起始日期（含），无效日期表示不限
+ * @param to 结束日期（含），无效日期表示不限
+ * @return 返回按日期排序的记录
+ */
+QVector<LedgerRecord> LedgerManager::queryHistory(const QDate &from, const QDate &to)
+{
+    // 归档中只有早于账本第一条记录的往年记录，排在最前面
+    QVector<LedgerRecord> result = queryArchive(from, to);
+    if (residentOffset > 0 && !storage->isModifiedExternally()) {
+        result += pager.query(from, to, residentOffset);
+    }
+    for (int row = 0; row < model->rowCount(); ++row) {
+        const LedgerRecord record = LedgerRecord::fromModelRow(model, row);
+        if ((!from.isValid() || record.date >= from) && (!to.isValid() || record.date <= to)) {
+            result.append(record);
+        }
+    }
+    return result;
+}
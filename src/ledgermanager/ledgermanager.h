@@ -14,6 +14,18 @@
 #include <QTableView>
 #include <QDoubleSpinBox>
 #include <QMessageBox>
+#include "ledgerrecord.h"
+#include "ledgerarchive.h"
+#include "recomputeengine.h"
+#include "notepool.h"
+#include "ledgerstorage.h"
+#include "historypager.h"
+#include "transactionledger.h"
+#include "exchangerates.h"
+#include "quantilesketch.h"
+#include "ledgersnapshot.h"
+#include "budgetrules.h"
+#include <QMap>
 
 /*
     QStandardItemModel的作用是：
@@ -55,17 +67,45 @@ public:
      */
     QStandardItemModel* getModel() const;
     
+    /**
+     * @brief 获取数据版本，模型每次被修改、或报表币种与汇率变化时都会递增
+     * @return 返回数据版本号
+     */
+    quint64 dataVersion() const;
+    
     /**
      * @brief 从文件加载账本数据
-     * @param filePath 文件路径
+     * @param filePath 文件路径，后缀为.db/.sqlite时使用SQLite存储引擎，否则按CSV读取
      */
     void loadData(const QString &filePath);
     
     /**
-     * @brief 保存账本数据到文件
+     * @brief 保存账本数据到文件（整体重写）
+     * 文件自上次同步后被其它程序修改过时拒绝覆盖，并提示冲突
      * @param filePath 文件路径
+     * @return 成功返回true
+     */
+    bool saveData(const QString &filePath);
+    
+    /**
+     * @brief 把尚未写入文件的新记录追加到当前文件末尾，不重写已有内容
+     * 其它进程在此期间只追加了记录时，先合并它们的记录再追加；
+     * 文件被其它方式修改时视为冲突，不写入
+     * @return 成功返回true
      */
-    void saveData(const QString &filePath);
+    bool appendNewRecords();
+    
+    /**
+     * @brief 是否有已加入表格但尚未写入文件的新记录（上一次追加失败）
+     */
+    bool hasUnsavedRecords() const;
+    
+    /**
+     * @brief 只把指定的行写回当前文件，其余行原样保留（编辑历史记录后使用）
+     * @param rows 行号列表
+     * @return 成功返回true
+     */
+    bool saveRows(const QList<int> &rows);
     
     /**
      * @brief 添加新的记账记录
@@ -76,18 +116,21 @@ public:
      * @param expense 当月开支
      * @param monthlyDeposit 当月存款
      * @param note 备注
+     * @param currency 金额的币种，空或默认币种时不写入币种列
      * @return 添加成功返回true，否则返回false
      */
-    bool addRecord(const QDate &date, double totalDeposit, double salary, double fixedDeposit, double expense, double monthlyDeposit, const QString &note);
+    bool addRecord(const QDate &date, double totalDeposit, double salary, double fixedDeposit, double expense, double monthlyDeposit, const QString &note, const QString &currency = QString());
     
     // 计算相关接口
     /**
-     * @brief 计算当月可支配额度
+     * @brief 计算当月可支配额度，并换算为报表币种
      * @param totalDeposit 当前总存款金额
      * @param fixedDeposit 定期余额
-     * @return 返回可支配额度
+     * @param currency 金额的币种，空表示默认币种
+     * @param date 换算使用的汇率日期，无效日期表示今天
+     * @return 返回以报表币种表示的可支配额度，缺少汇率时按原币种返回
      */
-    double calculateDisposableAmount(double totalDeposit, double fixedDeposit) const;
+    double calculateDisposableAmount(double totalDeposit, double fixedDeposit, const QString &currency = QString(), const QDate &date = QDate()) const;
     
     /**
      * @brief 计算当月开支和存款
@@ -96,11 +139,22 @@ public:
      * @param expense 当月开支（输出参数）
      * @param monthlyDeposit 当月存款（输出参数）
      * @param hasPreviousRecord 是否有上一次记录
+     * @param currency 当前记录的币种，空表示默认币种
+     * @param date 当前记录的日期，上一次总存款按该日汇率换算为当前币种
+     * @return 上一次记录的币种不同且缺少汇率时返回false，此时不计算当月开支
      */
-    void calculateAmounts(double totalDeposit, double salary, double &expense, double &monthlyDeposit, bool hasPreviousRecord = false);
+    bool calculateAmounts(double totalDeposit, double salary, double &expense, double &monthlyDeposit, bool hasPreviousRecord = false,
+                          const QString &currency = QString(), const QDate &date = QDate());
     
     // 数据查询接口
-    double getPreviousTotalDeposit() const;
+    /**
+     * @brief 获取上一次记录的总存款金额，并换算为指定币种
+     * @param currency 目标币种，空表示默认币种
+     * @param date 换算使用的汇率日期
+     * @param total 换算后的总存款金额（输出参数），没有上一次记录时为0
+     * @return 上一次记录的币种不同且缺少汇率时返回false
+     */
+    bool getPreviousTotalDeposit(const QString &currency, const QDate &date, double &total) const;
     double getPreviousFixedDeposit() const;
     
     /**
@@ -115,17 +169,243 @@ public:
     void initTableView(QTableView *tableView) const;
     void configureUI(QDoubleSpinBox *monthlyDepositSpinBox, QDoubleSpinBox *disposableAmountSpinBox, QDoubleSpinBox *expenseSpinBox) const;
     
+    /**
+     * @brief 查找备注等于指定文本的所有行，只比较驻留句柄
+     * @param note 备注文本
+     * @return 返回行号列表
+     */
+    QList<int> findRowsByNote(const QString &note) const;
+    
+    /**
+     * @brief 获取备注驻留池（用于查看去重效果）
+     */
+    const NotePool &getNotePool() const;
+    
+    /**
+     * @brief 把当前账本一次性迁移到另一种存储格式（CSV或SQLite），并切换到新文件
+     * @param targetPath 目标文件路径，后缀为.csv或.db
+     * @return 成功返回true
+     */
+    bool migrateStorage(const QString &targetPath);
+    
+    /**
+     * @brief 发布当前数据版本的只读快照，未修改的块与上一快照共享；
+     *        已归档的往年记录排在模型记录之前（窗口模式除外）
+     * @return 返回快照，可按值交给工作线程读取（必须在GUI线程调用）
+     */
+    LedgerSnapshotPtr snapshot();
+    
+    /**
+     * @brief 快照中排在模型记录之前的归档记录行数（快照行号减去它即为模型行号）
+     */
+    int archivedRowCount() const;
+    
+    // 多币种接口
+    /**
+     * @brief 获取当前账本的汇率表
+     */
+    const ExchangeRates &getExchangeRates() const;
+    
+    /**
+     * @brief 把外部汇率文件合并到当前账本的汇率表
+     * @param sourcePath 汇率文件路径（每行：日期,源币种,目标币种,汇率）
+     * @return 返回导入的条数，失败返回-1
+     */
+    int importExchangeRates(const QString &sourcePath);
+    
+    /**
+     * @brief 设置报表币种，统计、图表和可支配额度都换算为该币种
+     * @param currency 币种代码
+     */
+    void setReportingCurrency(const QString &currency);
+    QString reportingCurrency() const;
+    
+    /**
+     * @brief 获取每行换算到报表币种的系数（按数据版本缓存）
+     * @return 返回与快照行（归档记录 + 模型行）一一对应的系数，缺少汇率的行为NaN
+     */
+    const QVector<double> &conversionFactors();
+    
+    /**
+     * @brief 获取某一行换算到报表币种的系数
+     * @param row 行号
+     */
+    double conversionFactor(int row) const;
+    
+    /**
+     * @brief 把整列金额换算为报表币种（批量向量化换算）
+     * @param column 金额列号
+     * @return 返回与快照行对应的换算后金额，空单元格或缺少汇率为NaN
+     */
+    QVector<double> convertedColumn(int column);
+    
+    /**
+     * @brief 缺少汇率、无法换算的行数
+     */
+    int missingRateRows();
+    
+    // 开支分位数接口（按年维护当月开支的分位数草图，新增记录时增量插入）
+    /**
+     * @brief 获取有当月开支记录的年份（升序）
+     */
+    QList<int> expenseYears();
+    
+    /**
+     * @brief 获取某年当月开支（换算为报表币种）的分位数草图
+     * @param year 年份
+     * @return 返回草图，该年没有记录时返回空草图
+     */
+    const QuantileSketch &expenseSketch(int year);
+    
+    /**
+     * @brief 合并各年份的草图，得到全部当月开支的分位数草图
+     */
+    QuantileSketch mergedExpenseSketch();
+    
+    /**
+     * @brief 获取某年当月开支高于该年指定分位数的记账日期
+     * @param year 年份
+     * @param q 分位点（如0.95）
+     */
+    QList<QDate> monthsAboveExpenseQuantile(int year, double q);
+    
+    // 预算规则接口（规则编译一次，新增记录时只更新滑动窗口和聚合槽）
+    /**
+     * @brief 用当前账本最近的记录检查一条待录入的记录
+     * @param candidate 待录入的记录
+     * @return 返回触发的规则名称
+     */
+    QStringList checkBudgetRules(const LedgerRecord &candidate);
+    
+    /**
+     * @brief 获取预算规则文本
+     */
+    QString budgetRulesText() const;
+    
+    /**
+     * @brief 替换预算规则并保存到账本同名的规则文件
+     * @param text 规则文本
+     * @param errors 无法编译的规则（输出参数，可为空）
+     * @return 返回编译成功的规则数
+     */
+    int setBudgetRules(const QString &text, QStringList *errors = nullptr);
+    
+    // 收支明细接口
+    /**
+     * @brief 获取当前账本的收支明细子账本
+     */
+    TransactionLedger &getTransactions();
+    
+    /**
+     * @brief 由收支明细的月汇总推导某月的当月工资（收入合计）与当月开支（支出合计）
+     * @param date 该月中的任意日期
+     * @param income 收入合计（输出参数，单位：元）
+     * @param expense 支出合计（输出参数，单位：元）
+     * @return 该月有明细时返回true
+     */
+    bool deriveMonthFromTransactions(const QDate &date, double &income, double &expense) const;
+    
+    // 窗口模式接口（内存受限的设备上只常驻最近的记录，仅适用于CSV账本）
+    /**
+     * @brief 设置窗口模式，下次loadData时生效
+     * @param months 常驻模型的最近月数，0表示关闭窗口模式（全部载入）
+     * @param maxHistoryBytes 分页读入的历史记录（模型中与块缓存中合计）的内存上限（字节）
+     */
+    void setResidentWindow(int months, qint64 maxHistoryBytes);
+    
+    /**
+     * @brief 当前是否只载入了文件中的部分记录
+     */
+    bool isWindowed() const;
+    
+    /**
+     * @brief 把常驻窗口之前的一块历史记录读入模型顶部（表格滚动到顶部时调用）
+     * @return 返回读入的行数；没有更早的记录返回0，超出内存上限或文件已变化返回-1
+     */
+    int pageInHistory();
+    
+    /**
+     * @brief 把分页读入的历史记录移出模型，恢复到只常驻最近记录的状态
+     * @return 返回移出的行数
+     */
+    int pageOutHistory();
+    
+    /**
+     * @brief 获取当前分页读入模型的历史记录行数
+     */
+    int pagedHistoryRows() const;
+    
+    /**
+     * @brief 按日期范围查询账本记录，归档中的记录按需解压，窗口之外的部分按块从文件读取
+     * @param from 起始日期（含），无效日期表示不限
+     * @param to 结束日期（含），无效日期表示不限
+     * @return 返回按日期排序的记录
+     */
+    QVector<LedgerRecord> queryHistory(const QDate &from = QDate(), const QDate &to = QDate());
+    
+    // 历史归档接口
+    /**
+     * @brief 将早于截止日期的记录移入列式压缩归档，从模型中移除并保存账本；
+     *        保存失败时放回记录并恢复原归档
+     * @param cutoff 截止日期（不含）
+     * @return 返回本次归档的行数，失败返回-1
+     */
+    int archiveHistory(const QDate &cutoff);
+    
+    /**
+     * @brief 查询归档中日期范围内的记录，只解压命中的数据块
+     * @param from 起始日期（含），无效日期表示不限
+     * @param to 结束日期（含），无效日期表示不限
+     * @return 返回按日期排序的记录
+     */
+    QVector<LedgerRecord> queryArchive(const QDate &from = QDate(), const QDate &to = QDate());
+    
+    /**
+     * @brief 获取当前账本对应的归档文件路径
+     * @return 返回与CSV同目录、同名的.lgra文件路径
+     */
+    QString archiveFilePath() const;
+    
     // 错误提示接口
     void showError(const QString &title, const QString &message) const;
     void showSuccess(const QString &title, const QString &message) const;
     bool confirmOperation(const QString &title, const QString &message) const;
 
 private:
+    NotePool notePool;                  //!< 备注驻留池，必须先于model构造、后于model销毁
     QStandardItemModel *model;
     QString currentFilePath;
+    quint64 modelVersion = 1;           //!< 数据版本号
+    LedgerSnapshotPublisher snapshots;  //!< 按块写时复制的只读快照
+    int fileRowCount = 0;               //!< 文件中已有的记录数，其后的模型行尚未写入
+    LedgerStorage *storage = nullptr;   //!< 存储引擎（CSV或SQLite，打开失败时为空）
+    HistoryPager pager;                 //!< 窗口模式下的历史记录块索引与LRU块缓存
+    int residentMonths = 0;             //!< 常驻模型的最近月数，0表示全部载入
+    qint64 maxHistoryBytes = 0;         //!< 分页读入的历史记录的内存上限
+    qint64 pagedBytes = 0;              //!< 已分页读入模型的历史记录占用的内存
+    int residentOffset = 0;             //!< 模型第0行在文件中的记录序号（前面的记录未载入）
+    int residentStartRow = 0;           //!< 常驻窗口起始记录在文件中的序号
+    LedgerArchive archive;              //!< 冷数据归档（按需解压）
+    TransactionLedger transactions;     //!< 收支明细及其分类/月/年汇总
+    ExchangeRates rates;                //!< 按日期索引的汇率表
+    QString reportCurrency = LedgerRecord::DefaultCurrency; //!< 报表币种
+    QVector<double> factorCache;        //!< 每行换算系数
+    quint64 factorVersion = 0;          //!< 换算系数对应的数据版本
+    QMap<int, QuantileSketch> expenseSketches; //!< 年 → 当月开支分位数草图
+    quint64 sketchVersion = 0;          //!< 分位数草图对应的数据版本
+    BudgetRules budgetRules;            //!< 编译后的预算规则及其滑动窗口
+    quint64 budgetVersion = 0;          //!< 预算规则滑动窗口对应的数据版本
+    RecomputeEngine *recomputeEngine;   //!< 派生列增量重算引擎
     void initModel();
-    void setupDarkThemeStyle(QTableView *tableView) const;
-    void configureWidgetStyle(QWidget *widget, bool readOnly, const QString &readOnlyColor = "#3a3a3a", const QString &textColor = "#ffffff") const;
+    void rebuildExpenseSketches();
+    void reloadArchivedRecords();
+    void updateLeadingRecord();
+    void syncBudgetRules();
+    bool loadWindow(const QString &filePath);
+    QVector<LedgerRecord> modelRecords(int first, int last) const;
+    bool mergeAppendedRecords(const QVector<LedgerRecord> &appended);
+    QStandardItem *createItem(int column, const QString &text);
+    void configureWidgetStyle(QWidget *widget, bool readOnly) const;
     bool isEmptyRow(int row) const;  // 新增
     void cleanEmptyRows();           // 新增
 };
@@ -0,0 +1,169 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 09:12:40
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 09:12:40
+ * @Description: 账本单行记录的类型化表示
+ */
+#include "ledgerrecord.h"
+#include "noteitem.h"
+#include <QStandardItemModel>
+#include <QStringList>
+#include <cmath>
+
+/**
+ * @brief 从模型的一行构造记录
+ * @param model 数据模型指针
+ * @param row 行号
+ * @return 返回记录，日期无法解析时 date 为无效日期
+ */
+LedgerRecord LedgerRecord::fromModelRow(const QStandardItemModel *model, int row)
+{
+    LedgerRecord record;
+    if (!model || row < 0 || row >= model->rowCount()) {
+        return record;
+    }
+
+    QStandardItem *dateItem = model->item(row, ColDate);
+    if (dateItem) {
+        record.date = parseDate(dateItem->text());
+    }
+
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        QStandardItem *item = model->item(row, ColTotalDeposit + i);
+        if (!item) {
+            continue;
+        }
+        bool ok = false;
+        qint64 cents = parseCents(item->text(), &ok);
+        if (ok) {
+            record.amounts[i] = cents;
+            record.presentMask |= (1u << i);
+        }
+    }
+
+    QStandardItem *noteItem = model->item(row, ColNote);
+    if (noteItem) {
+        record.note = noteItem->text();
+    }
+
+    QStandardItem *currencyItem = model->item(row, ColCurrency);
+    if (currencyItem) {
+        record.currency = normalizeCurrency(currencyItem->text());
+    }
+    return record;
+}
+
+/**
+ * @brief 从按列排列的文本构造记录（CSV字段等）
+ * @param fields 各列文本，下标与LedgerColumn一致，缺少的列视为空
+ * @return 返回记录，日期无法解析时 date 为无效日期
+ */
+LedgerRecord LedgerRecord::fromFields(const QStringList &fields)
+{
+    LedgerRecord record;
+    record.date = parseDate(fields.value(ColDate));
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        bool ok = false;
+        qint64 cents = parseCents(fields.value(ColTotalDeposit + i), &ok);
+        if (ok) {
+            record.amounts[i] = cents;
+            record.presentMask |= (1u << i);
+        }
+    }
+    record.note = fields.value(ColNote);
+    record.currency = normalizeCurrency(fields.value(ColCurrency));
+    return record;
+}
+
+/**
+ * @brief 生成可直接插入模型的一行单元格
+ * @param notePool 备注驻留池，非空时备注列使用驻留句柄保存
+ * @return 返回单元格列表，由调用方接管所有权
+ */
+QList<QStandardItem*> LedgerRecord::toItems(NotePool *notePool) const
+{
+    QList<QStandardItem*> items;
+    items << new QStandardItem(date.toString("yyyy/MM/dd"));
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        items << new QStandardItem(hasAmount(i) ? formatCents(amounts[i]) : QString());
+    }
+    if (notePool) {
+        items << new NoteItem(notePool, note);
+    } else {
+        items << new QStandardItem(note);
+    }
+    items << new QStandardItem(currency);
+    return items;
+}
+
+/**
+ * @brief 解析账本中出现过的各种日期格式
+ * @param dateStr 日期字符串
+ * @return 返回日期，无法解析时返回无效日期
+ */
+QDate LedgerRecord::parseDate(const QString &dateStr)
+{
+    static const QStringList formats = {
+        "yyyy/MM/dd", "yyyy/MM/d", "yyyy/M/dd", "yyyy/M/d", // 斜杠分隔的各种格式
+        "yyyy-MM-dd", "yyyy-MM-d", "yyyy-M-dd", "yyyy-M-d", // 破折号分隔的各种格式
+        "MM/dd/yyyy", "MM/d/yyyy", "M/dd/yyyy", "M/d/yyyy", // 月/日/年格式
+        "dd/MM/yyyy", "d/MM/yyyy", "dd/M/yyyy", "d/M/yyyy"  // 日/月/年格式
+    };
+
+    const QString trimmed = dateStr.trimmed();
+    if (trimmed.isEmpty()) {
+        return QDate();
+    }
+    for (const QString &format : formats) {
+        QDate date = QDate::fromString(trimmed, format);
+        if (date.isValid()) {
+            return date;
+        }
+    }
+    return QDate();
+}
+
+/**
+ * @brief 将金额文本转换为分
+ * @param text 金额文本
+ * @param ok 是否为有效金额（输出参数）
+ */
+qint64 LedgerRecord::parseCents(const QString &text, bool *ok)
+{
+    const QString trimmed = text.trimmed();
+    if (trimmed.isEmpty()) {
+        if (ok) *ok = false;
+        return 0;
+    }
+    bool valid = false;
+    double value = trimmed.toDouble(&valid);
+    if (ok) *ok = valid;
+    return valid ? static_cast<qint64>(std::llround(value * 100.0)) : 0;
+}
+
+/**
+ * @brief 将分格式化为两位小数的金额文本
+ */
+QString LedgerRecord::formatCents(qint64 cents)
+{
+    return QString::number(cents / 100.0, 'f', 2);
+}
+
+/**
+ * @brief 规范化币种代码（去除空白并转为大写）
+ * @param text 币种文本
+ * @param ok 是否为空或3位字母代码（输出参数）
+ */
+QString LedgerRecord::normalizeCurrency(const QString &text, bool *ok)
+{
+    const QString code = text.trimmed().toUpper();
+    if (ok) {
+        bool valid = code.isEmpty() || code.size() == 3;
+        for (QChar c : code) {
+            valid = valid && c >= 'A' && c <= 'Z';
+        }
+        *ok = valid;
+    }
+    return code;
+}
@@ -0,0 +1,123 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 09:12:40
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 09:12:40
+ * @Description: 账本单行记录的类型化表示
+ */
+#ifndef LEDGERRECORD_H
+#define LEDGERRECORD_H
+
+#include <QDate>
+#include <QString>
+#include <QList>
+#include <QStringList>
+
+class QStandardItem;
+class QStandardItemModel;
+class NotePool;
+
+/**
+ * @brief 账本模型的列序号
+ */
+enum LedgerColumn {
+    ColDate = 0,            //!< 记账日期
+    ColTotalDeposit,        //!< 当前总存款金额
+    ColSalary,              //!< 当月工资
+    ColFixedDeposit,        //!< 定期余额
+    ColExpense,             //!< 当月开支
+    ColMonthlyDeposit,      //!< 当月存款
+    ColDisposable,          //!< 当月可支配额度
+    ColNote,                //!< 备注
+    ColCurrency,            //!< 币种（ISO 4217代码，空表示人民币）
+    LedgerColumnCount
+};
+
+/**
+ * @brief 金额列数量（ColTotalDeposit ~ ColDisposable）
+ */
+constexpr int LedgerAmountColumnCount = ColDisposable - ColTotalDeposit + 1;
+
+/*
+    LedgerRecord 是模型中一行数据的类型化副本：
+    金额统一以"分"为单位保存为整数，避免浮点误差，也便于差分编码；
+    presentMask 的第 i 位表示第 i 个金额列是否有值（CSV 中允许空单元格）。
+    currency 为该行金额的币种，旧账本没有币种列，空值按人民币处理。
+*/
+struct LedgerRecord
+{
+    QDate date;                                     //!< 记账日期
+    qint64 amounts[LedgerAmountColumnCount] = {};   //!< 金额列（单位：分）
+    quint8 presentMask = 0;                         //!< 金额列非空标记
+    QString note;                                   //!< 备注
+    QString currency;                               //!< 币种，空表示DefaultCurrency
+
+    static constexpr const char *DefaultCurrency = "CNY";   //!< 账本的默认币种
+
+    /**
+     * @brief 判断某个金额列是否有值
+     * @param index 金额列下标（0 对应 ColTotalDeposit）
+     */
+    bool hasAmount(int index) const { return presentMask & (1u << index); }
+
+    /**
+     * @brief 读取金额（单位：元）
+     * @param index 金额列下标（0 对应 ColTotalDeposit）
+     */
+    double amount(int index) const { return amounts[index] / 100.0; }
+
+    /**
+     * @brief 该行金额的币种代码，未填写时返回DefaultCurrency
+     */
+    QString currencyCode() const { return currency.isEmpty() ? QString(DefaultCurrency) : currency; }
+
+    /**
+     * @brief 从模型的一行构造记录
+     * @param model 数据模型指针
+     * @param row 行号
+     * @return 返回记录，日期无法解析时 date 为无效日期
+     */
+    static LedgerRecord fromModelRow(const QStandardItemModel *model, int row);
+
+    /**
+     * @brief 从按列排列的文本构造记录（CSV字段等）
+     * @param fields 各列文本，下标与LedgerColumn一致，缺少的列视为空
+     * @return 返回记录，日期无法解析时 date 为无效日期
+     */
+    static LedgerRecord fromFields(const QStringList &fields);
+
+    /**
+     * @brief 生成可直接插入模型的一行单元格
+     * @param notePool 备注驻留池，非空时备注列使用驻留句柄保存
+     * @return 返回单元格列表，由调用方接管所有权
+     */
+    QList<QStandardItem*> toItems(NotePool *notePool = nullptr) const;
+
+    /**
+     * @brief 解析账本中出现过的各种日期格式
+     * @param dateStr 日期字符串
+     * @return 返回日期，无法解析时返回无效日期
+     */
+    static QDate parseDate(const QString &dateStr);
+
+    /**
+     * @brief 将金额文本转换为分
+     * @param text 金额文本
+     * @param ok 是否为有效金额（输出参数）
+     */
+    static qint64 parseCents(const QString &text, bool *ok);
+
+    /**
+     * @brief 将分格式化为两位小数的金额文本
+     */
+    static QString formatCents(qint64 cents);
+
+    /**
+     * @brief 规范化币种代码（去除空白并转为大写）
+     * @param text 币种文本
+     * @param ok 是否为空或3位字母代码（输出参数）
+     */
+    static QString normalizeCurrency(const QString &text, bool *ok = nullptr);
+};
+
+#endif // LEDGERRECORD_H
@@ -0,0 +1,626 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 23:48:06
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 23:48:06
+ * @Description: 多个账本的流式k路归并与按月对比
+ */
+#include "ledgermerger.h"
+#include "csvledgerstorage.h"
+#include "exchangerates.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QCommandLineParser>
+#include <QMap>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief 金额列的英文别名与中文列名，下标与金额列一致
+ */
+const char *const ColumnAliases[LedgerAmountColumnCount][2] = {
+    {"total", "当前总存款金额"},
+    {"salary", "当月工资"},
+    {"fixed", "定期余额"},
+    {"expense", "当月开支"},
+    {"deposit", "当月存款"},
+    {"disposable", "当月可支配额度"}
+};
+
+/**
+ * @brief 月份编号（年 * 12 + 月 - 1），便于比较和计算去年同月
+ */
+int monthIndex(const QDate &date)
+{
+    return date.year() * 12 + date.month() - 1;
+}
+
+QString monthLabel(int index)
+{
+    return QString("%1/%2").arg(index / 12).arg(index % 12 + 1, 2, 10, QChar('0'));
+}
+
+/**
+ * @brief 对比表中的一个单元格：某账本某月的值
+ */
+struct Cell
+{
+    qint64 cents = 0;
+    bool present = false;
+};
+
+/**
+ * @brief 把一条记录的金额计入单元格：存量列取最后一条，流量列求和
+ */
+void accumulate(Cell &cell, qint64 cents, bool balance)
+{
+    cell.cents = balance ? cents : cell.cents + cents;
+    cell.present = true;
+}
+
+/**
+ * @brief 堆中的一项：某账本当前记录的日期
+ */
+struct HeapEntry
+{
+    QDate date;
+    int source = 0;
+};
+
+/**
+ * @brief 小顶堆的比较函数（std::push_heap 默认是大顶堆，因此取反）
+ */
+bool laterThan(const HeapEntry &a, const HeapEntry &b)
+{
+    if (a.date != b.date) {
+        return a.date > b.date;
+    }
+    return a.source > b.source;
+}
+
+} // namespace
+
+/**
+ * @brief 单个账本的流式游标：逐行读取CSV，只保留当前一条记录
+ */
+class LedgerMerger::Cursor
+{
+public:
+    Cursor(const QString &filePath, const QString &reportCurrency)
+        : file(filePath)
+        , target(reportCurrency)
+    {
+    }
+
+    /**
+     * @brief 打开账本和同名的汇率表
+     */
+    bool open(QString &error)
+    {
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            error = QString("%1: %2").arg(file.fileName(), file.errorString());
+            return false;
+        }
+        stream.setDevice(&file);
+        if (!target.isEmpty()) {
+            rates.open(ExchangeRates::filePathFor(file.fileName()));
+        }
+        return true;
+    }
+
+    /**
+     * @brief 读取下一条记录
+     * @param summary 统计信息与错误（输出参数）
+     * @return 读到记录返回true；读完或出错返回false（出错时 summary.error 非空）
+     */
+    bool next(Summary &summary)
+    {
+        while (stream.readLineInto(&line)) {
+            ++lineNumber;
+            const QStringList fields = CsvLedgerStorage::splitLine(line.trimmed());
+            if (fields.isEmpty()) {
+                continue;
+            }
+            record = LedgerRecord::fromFields(fields);
+            if (!record.date.isValid()) {
+                ++summary.skipped;
+                continue;
+            }
+            if (lastDate.isValid() && record.date < lastDate) {
+                summary.error = QString("%1 第%2行：日期 %3 早于上一条记录，账本未按日期排序")
+                                    .arg(file.fileName()).arg(lineNumber).arg(record.date.toString("yyyy/MM/dd"));
+                return false;
+            }
+            lastDate = record.date;
+            ++summary.records;
+            convert();
+            if (rateMissing) {
+                ++summary.missingRates;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    const LedgerRecord &current() const { return record; }
+
+    /**
+     * @brief 当前记录是否因缺少汇率而保留了原币种
+     */
+    bool isRateMissing() const { return rateMissing; }
+
+private:
+    /**
+     * @brief 把当前记录的金额换算为目标币种，同币种不查汇率
+     */
+    void convert()
+    {
+        rateMissing = false;
+        if (target.isEmpty() || record.currencyCode() == target) {
+            return;
+        }
+        const double factor = rates.rate(record.currency, target, record.date);
+        if (std::isnan(factor)) {
+            rateMissing = true;
+            return;
+        }
+        for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+            record.amounts[i] = qRound64(record.amounts[i] * factor);
+        }
+        record.currency = target == LedgerRecord::DefaultCurrency ? QString() : target;
+    }
+
+    QFile file;                 //!< 账本文件
+    QTextStream stream;         //!< 带缓冲的文本流
+    QString line;               //!< 行缓冲，逐行复用
+    qint64 lineNumber = 0;      //!< 当前行号（从1开始）
+    LedgerRecord record;        //!< 当前记录
+    QDate lastDate;             //!< 上一条记录的日期，用于检查排序
+    QString target;             //!< 换算成的币种，为空表示不换算
+    ExchangeRates rates;        //!< 该账本的汇率表
+    bool rateMissing = false;   //!< 当前记录缺少汇率
+};
+
+/**
+ * @brief 构造函数
+ * @param sources 输入账本，顺序决定同日记录的先后和对比表的列顺序
+ * @param reportCurrency 换算成的币种，为空表示不换算（各账本须使用同一币种）
+ */
+LedgerMerger::LedgerMerger(const QVector<Source> &sources, const QString &reportCurrency)
+    : sources(sources)
+    , reportCurrency(LedgerRecord::normalizeCurrency(reportCurrency))
+{
+}
+
+QString LedgerMerger::labelFor(int source) const
+{
+    const Source &input = sources[source];
+    return input.label.isEmpty() ? QFileInfo(input.filePath).completeBaseName() : input.label;
+}
+
+/**
+ * @brief 按日期归并所有账本，依次把每条记录交给回调
+ * @param visit 回调，参数为账本序号、（已换算的）记录和是否缺少汇率，返回false时停止
+ * @param summary 统计信息与错误（输出参数）
+ * @return 全部读完返回true
+ */
+template<typename Visitor>
+bool LedgerMerger::forEachRecord(Visitor visit, Summary &summary) const
+{
+    std::vector<std::unique_ptr<Cursor>> cursors;
+    std::vector<HeapEntry> heap;
+    cursors.reserve(sources.size());
+    heap.reserve(sources.size());
+    for (int i = 0; i < sources.size(); ++i) {
+        cursors.push_back(std::make_unique<Cursor>(sources[i].filePath, reportCurrency));
+        if (!cursors[i]->open(summary.error)) {
+            return false;
+        }
+        if (cursors[i]->next(summary)) {
+            heap.push_back({cursors[i]->current().date, i});
+        } else if (!summary.error.isEmpty()) {
+            return false;
+        }
+    }
+    std::make_heap(heap.begin(), heap.end(), laterThan);
+
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), laterThan);
+        const int source = heap.back().source;
+        Cursor &cursor = *cursors[source];
+        if (!visit(source, cursor.current(), cursor.isRateMissing())) {
+            return false;
+        }
+        // 从同一账本补入下一条，读完的账本退出堆
+        if (cursor.next(summary)) {
+            heap.back().date = cursor.current().date;
+            std::push_heap(heap.begin(), heap.end(), laterThan);
+        } else if (!summary.error.isEmpty()) {
+            return false;
+        } else {
+            heap.pop_back();
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 把所有账本按月合并为一个账本CSV，每月一行
+ * @param outputPath 输出文件路径
+ */
+LedgerMerger::Summary LedgerMerger::merge(const QString &outputPath) const
+{
+    Summary summary;
+    QSaveFile file(outputPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        summary.error = QString("%1: %2").arg(outputPath, file.errorString());
+        return summary;
+    }
+    QTextStream out(&file);
+
+    QStringList labels;
+    for (int i = 0; i < sources.size(); ++i) {
+        labels << labelFor(i);
+    }
+
+    const int total = ColTotalDeposit - ColTotalDeposit;
+    const int salary = ColSalary - ColTotalDeposit;
+    const int fixed = ColFixedDeposit - ColTotalDeposit;
+    const int expense = ColExpense - ColTotalDeposit;
+
+    // 各账本最近一次的存量（总存款、定期），当月没有记录的账本沿用上月的值
+    QVector<Cell> totals(sources.size());
+    QVector<Cell> fixeds(sources.size());
+    Cell salaries;              //!< 当月工资合计
+    Cell expenses;              //!< 当月开支合计，只用于第一行（没有上一行可推算）
+    QStringList notes;          //!< 当月各记录的备注，前加来源账本的标签
+    QDate lastDate;             //!< 当月最后一条记录的日期，作为合并行的日期
+    qint64 previousTotal = 0;   //!< 上一行的总存款
+    int currentMonth = -1;
+    int row = 0;
+    QString currency;
+
+    // 派生列按账本的规则重算（与 RecomputeEngine、IntegrityChecker 一致）：
+    // 当月开支 = 上一行总存款 + 当月工资 - 本行总存款，当月存款 = 工资 - 开支，可支配 = 总存款 - 定期
+    auto flush = [&]() {
+        if (currentMonth < 0) {
+            return;
+        }
+        LedgerRecord merged;
+        merged.date = lastDate;
+        merged.currency = currency == LedgerRecord::DefaultCurrency ? QString() : currency;
+        merged.note = notes.join(" ");
+        for (int i = 0; i < sources.size(); ++i) {
+            merged.amounts[total] += totals[i].cents;
+            merged.amounts[fixed] += fixeds[i].cents;
+        }
+        merged.amounts[salary] = salaries.cents;
+        merged.amounts[expense] = row > 0 ? previousTotal + salaries.cents - merged.amounts[total] : expenses.cents;
+        merged.amounts[ColMonthlyDeposit - ColTotalDeposit] = merged.amounts[salary] - merged.amounts[expense];
+        merged.amounts[ColDisposable - ColTotalDeposit] = merged.amounts[total] - merged.amounts[fixed];
+        merged.presentMask = static_cast<quint8>((1u << LedgerAmountColumnCount) - 1);
+
+        out << CsvLedgerStorage::formatLine(row++, merged) << "\n";
+        previousTotal = merged.amounts[total];
+        salaries = Cell();
+        expenses = Cell();
+        notes.clear();
+    };
+
+    const bool ok = forEachRecord([&](int source, const LedgerRecord &record, bool rateMissing) {
+        if (rateMissing) {
+            return true;
+        }
+        // 合并后每行只有一个币种：不换算时各账本必须使用同一币种
+        if (currency.isEmpty()) {
+            currency = reportCurrency.isEmpty() ? record.currencyCode() : reportCurrency;
+        } else if (reportCurrency.isEmpty() && record.currencyCode() != currency) {
+            summary.error = QString("账本中同时出现 %1 和 %2，请指定换算成的币种").arg(currency, record.currencyCode());
+            return false;
+        }
+        const int month = monthIndex(record.date);
+        if (month != currentMonth) {
+            flush();
+            currentMonth = month;
+        }
+        if (record.hasAmount(total)) {
+            accumulate(totals[source], record.amounts[total], true);
+        }
+        if (record.hasAmount(fixed)) {
+            accumulate(fixeds[source], record.amounts[fixed], true);
+        }
+        if (record.hasAmount(salary)) {
+            accumulate(salaries, record.amounts[salary], false);
+        }
+        if (record.hasAmount(expense)) {
+            accumulate(expenses, record.amounts[expense], false);
+        }
+        if (!record.note.isEmpty()) {
+            notes << QString("[%1] %2").arg(labels[source], record.note);
+        }
+        lastDate = record.date;
+        return true;
+    }, summary);
+    if (ok) {
+        flush();
+    }
+    out.flush();
+
+    if (!ok) {
+        file.cancelWriting();
+        return summary;
+    }
+    if (!file.commit()) {
+        summary.error = QString("%1: %2").arg(outputPath, file.errorString());
+        return summary;
+    }
+    summary.outputRows = row;
+    summary.ok = true;
+    return summary;
+}
+
+/**
+ * @brief 按月对比各账本的某个金额列，输出CSV表格
+ * @param outputPath 输出文件路径
+ * @param comparison 对比方式
+ * @param column 金额列下标（0 对应 ColTotalDeposit）
+ */
+LedgerMerger::Summary LedgerMerger::compare(const QString &outputPath, Comparison comparison, int column) const
+{
+    Summary summary;
+    if (column < 0 || column >= LedgerAmountColumnCount) {
+        summary.error = QString("金额列下标 %1 超出范围").arg(column);
+        return summary;
+    }
+    QSaveFile file(outputPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        summary.error = QString("%1: %2").arg(outputPath, file.errorString());
+        return summary;
+    }
+    QTextStream out(&file);
+
+    const bool balance = isBalanceColumn(column);
+    const QString unit = reportCurrency.isEmpty() ? QString() : QString("（%1）").arg(reportCurrency);
+    if (comparison == ByMember) {
+        QStringList header = {QString("月份")};
+        for (int i = 0; i < sources.size(); ++i) {
+            header << labelFor(i) + unit;
+        }
+        out << header.join(",") << "\n";
+    } else {
+        out << QString("月份,%1%2,去年同月,同比(%)").arg(QString::fromUtf8(ColumnAliases[column][1]), unit) << "\n";
+    }
+
+    // 只保留当前月份的一行单元格，以及同比所需的最近12个月合计
+    QVector<Cell> cells(sources.size());
+    QVector<Cell> carried(sources.size());  //!< 存量列各账本最近一次的值，同比合计时补齐当月没有记录的账本
+    QMap<int, Cell> recentTotals;
+    int currentMonth = -1;
+    QString currency;
+
+    auto flush = [&]() {
+        if (currentMonth < 0) {
+            return;
+        }
+        QStringList fields = {monthLabel(currentMonth)};
+        if (comparison == ByMember) {
+            for (const Cell &cell : cells) {
+                fields << (cell.present ? LedgerRecord::formatCents(cell.cents) : QString());
+            }
+        } else {
+            Cell total;
+            for (int i = 0; i < cells.size(); ++i) {
+                if (cells[i].present) {
+                    carried[i] = cells[i];
+                }
+                const Cell &cell = balance ? carried[i] : cells[i];
+                if (cell.present) {
+                    accumulate(total, cell.cents, false);
+                }
+            }
+            const Cell previous = recentTotals.value(currentMonth - 12);
+            fields << (total.present ? LedgerRecord::formatCents(total.cents) : QString());
+            fields << (previous.present ? LedgerRecord::formatCents(previous.cents) : QString());
+            if (total.present && previous.present && previous.cents != 0) {
+                fields << QString::number((total.cents - previous.cents) * 100.0 / qAbs(previous.cents), 'f', 1);
+            } else {
+                fields << QString();
+            }
+            recentTotals.insert(currentMonth, total);
+            while (!recentTotals.isEmpty() && recentTotals.firstKey() < currentMonth - 12) {
+                recentTotals.erase(recentTotals.begin());
+            }
+        }
+        out << fields.join(",") << "\n";
+        ++summary.outputRows;
+        cells.fill(Cell());
+    };
+
+    const bool ok = forEachRecord([&](int source, const LedgerRecord &record, bool rateMissing) {
+        if (rateMissing) {
+            return true;
+        }
+        // 不换算时各账本必须使用同一币种，否则合计和对比没有意义
+        if (reportCurrency.isEmpty()) {
+            if (currency.isEmpty()) {
+                currency = record.currencyCode();
+            } else if (record.currencyCode() != currency) {
+                summary.error = QString("账本中同时出现 %1 和 %2，请指定换算成的币种").arg(currency, record.currencyCode());
+                return false;
+            }
+        }
+        const int month = monthIndex(record.date);
+        if (month != currentMonth) {
+            flush();
+            currentMonth = month;
+        }
+        if (record.hasAmount(column)) {
+            accumulate(cells[source], record.amounts[column], balance);
+        }
+        return true;
+    }, summary);
+    if (ok) {
+        flush();
+    }
+    out.flush();
+
+    if (!ok) {
+        file.cancelWriting();
+        return summary;
+    }
+    if (!file.commit()) {
+        summary.error = QString("%1: %2").arg(outputPath, file.errorString());
+        return summary;
+    }
+    summary.ok = true;
+    return summary;
+}
+
+/**
+ * @brief 解析金额列名（total/salary/fixed/expense/deposit/disposable 或中文列名）
+ * @param name 列名
+ * @return 返回金额列下标，无法识别返回-1
+ */
+int LedgerMerger::columnForName(const QString &name)
+{
+    const QString key = name.trimmed().toLower();
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        if (key == QLatin1String(ColumnAliases[i][0]) || key == QString::fromUtf8(ColumnAliases[i][1])) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief 判断金额列是否为存量列（按月取最后一条记录的值，而不是求和）
+ * @param column 金额列下标
+ */
+bool LedgerMerger::isBalanceColumn(int column)
+{
+    return column == ColTotalDeposit - ColTotalDeposit
+        || column == ColFixedDeposit - ColTotalDeposit
+        || column == ColDisposable - ColTotalDeposit;
+}
+
+/**
+ * @brief 判断命令行是否请求了合并账本
+ */
+bool LedgerMerger::isRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--merge-ledgers") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 解析命令行并执行合并或对比
+ * @param arguments 命令行参数（含程序名）
+ * @return 返回进程退出码
+ */
+int LedgerMerger::runFromCommandLine(const QStringList &arguments)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("按日期流式合并或按月对比多个账本");
+    parser.addHelpOption();
+    QCommandLineOption outputOption("merge-ledgers", "输出文件", "file");
+    QCommandLineOption compareOption("compare", "输出按月对比表而不是合并账本：member（各账本对比）或 yoy（合计同比）", "mode");
+    QCommandLineOption columnOption("column", "对比的金额列：total、salary、fixed、expense、deposit、disposable（默认expense）", "column", "expense");
+    QCommandLineOption currencyOption("currency", "按各账本的汇率表换算成的币种（默认不换算）", "code");
+    parser.addOption(outputOption);
+    parser.addOption(compareOption);
+    parser.addOption(columnOption);
+    parser.addOption(currencyOption);
+    parser.addPositionalArgument("ledgers", "按日期排序的CSV账本，标签=路径 指定标签，@file 表示从文件中按行读取列表", "[ledger.csv...]");
+    parser.process(arguments);
+
+    // 展开 @file 形式的账本列表
+    QStringList entries;
+    for (const QString &argument : parser.positionalArguments()) {
+        if (!argument.startsWith('@')) {
+            entries << argument;
+            continue;
+        }
+        QFile listFile(argument.mid(1));
+        if (!listFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            err << "无法读取账本列表: " << listFile.fileName() << Qt::endl;
+            return 2;
+        }
+        QTextStream in(&listFile);
+        while (!in.atEnd()) {
+            QString line = in.readLine().trimmed();
+            if (!line.isEmpty()) {
+                entries << line;
+            }
+        }
+    }
+    QVector<Source> sources;
+    for (const QString &entry : entries) {
+        const int separator = entry.indexOf('=');
+        Source source;
+        source.filePath = separator > 0 ? entry.mid(separator + 1) : entry;
+        source.label = separator > 0 ? entry.left(separator) : QString();
+        sources.append(source);
+    }
+
+    const QString outputPath = parser.value(outputOption);
+    if (outputPath.isEmpty() || sources.isEmpty()) {
+        err << "用法: Ledger --merge-ledgers <输出文件> [--compare member|yoy] [--column expense] [--currency CNY] [标签=]ledger.csv..." << Qt::endl;
+        return 2;
+    }
+    bool validCurrency = false;
+    const QString currency = LedgerRecord::normalizeCurrency(parser.value(currencyOption), &validCurrency);
+    if (!validCurrency) {
+        err << "币种须为3位字母代码: " << parser.value(currencyOption) << Qt::endl;
+        return 2;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    LedgerMerger merger(sources, currency);
+    Summary summary;
+    if (parser.isSet(compareOption)) {
+        const QString mode = parser.value(compareOption).toLower();
+        const int column = columnForName(parser.value(columnOption));
+        if (column < 0) {
+            err << "无法识别的金额列: " << parser.value(columnOption) << Qt::endl;
+            return 2;
+        }
+        if (mode == "member") {
+            summary = merger.compare(outputPath, ByMember, column);
+        } else if (mode == "yoy") {
+            summary = merger.compare(outputPath, YearOverYear, column);
+        } else {
+            err << "不支持的对比方式: " << mode << Qt::endl;
+            return 2;
+        }
+    } else {
+        summary = merger.merge(outputPath);
+    }
+
+    if (!summary.ok) {
+        err << summary.error << Qt::endl;
+        return 1;
+    }
+    if (summary.missingRates > 0) {
+        err << QString("%1 条记录缺少到 %2 的汇率").arg(summary.missingRates).arg(currency) << Qt::endl;
+    }
+    out << QString("已读取 %1 个账本的 %2 条记录（跳过 %3 行），写出 %4 行，耗时 %5 ms")
+               .arg(sources.size()).arg(summary.records).arg(summary.skipped)
+               .arg(summary.outputRows).arg(timer.elapsed()) << Qt::endl;
+    return 0;
+}
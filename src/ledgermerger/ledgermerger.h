@@ -0,0 +1,129 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 23:48:06
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 23:48:06
+ * @Description: 多个账本的流式k路归并与按月对比
+ */
+#ifndef LEDGERMERGER_H
+#define LEDGERMERGER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "ledgerrecord.h"
+
+/*
+    把多个按日期排序的CSV账本（每位家庭成员或每个账户一个）合并或对比：
+
+    1. 每个账本一个游标，逐行读取、解析，同一时刻每个账本只在内存中保留一条记录；
+    2. 各游标的当前记录放入以（日期, 账本序号）为键的小顶堆，每次弹出最早的一条
+       并从同一账本补入下一条，得到全局按日期排序的记录流（日期相同时按账本顺序）；
+    3. 合并：记录流按月聚合为新账本的一行，各账本的总存款、定期取最近一次的值
+       （当月没有记录时沿用上月）后相加，工资取当月合计，当月开支、当月存款和
+       可支配额度按账本的规则由相邻两行重算，备注前加上来源账本的标签；
+       对比：记录流按月聚合后逐月写出一行，存量列（总存款、定期、可支配）取当月
+       最后一条记录的值，流量列（工资、开支、当月存款）取当月合计。
+
+    内存占用只与账本数量有关（k 条记录 + 一行合并或对比结果 + 同比所需的最近12个月），
+    与文件大小无关，可以处理远大于内存的账本。输入账本必须按日期排序，
+    发现日期倒退时停止并报告所在的文件和行号。
+*/
+class LedgerMerger
+{
+public:
+    /**
+     * @brief 对比方式
+     */
+    enum Comparison {
+        ByMember,           //!< 按月对比各账本（成员间对比）
+        YearOverYear        //!< 各账本按月合计后与去年同月对比
+    };
+
+    /**
+     * @brief 输入账本
+     */
+    struct Source
+    {
+        QString filePath;   //!< CSV账本路径
+        QString label;      //!< 标签（用于合并后备注的前缀和对比表的列名），为空时使用文件名
+    };
+
+    /**
+     * @brief 合并或对比的结果
+     */
+    struct Summary
+    {
+        bool ok = false;            //!< 是否成功
+        QString error;              //!< 失败原因
+        qint64 records = 0;         //!< 读取的记录数
+        qint64 skipped = 0;         //!< 日期无法解析而跳过的行数
+        qint64 missingRates = 0;    //!< 缺少汇率而未计入的记录数
+        qint64 outputRows = 0;      //!< 写出的行数
+    };
+
+    /**
+     * @brief 构造函数
+     * @param sources 输入账本，顺序决定同日记录的先后和对比表的列顺序
+     * @param reportCurrency 换算成的币种，为空表示不换算（各账本须使用同一币种）
+     */
+    explicit LedgerMerger(const QVector<Source> &sources, const QString &reportCurrency = QString());
+
+    /**
+     * @brief 把所有账本按月合并为一个账本CSV，每月一行
+     * @param outputPath 输出文件路径
+     */
+    Summary merge(const QString &outputPath) const;
+
+    /**
+     * @brief 按月对比各账本的某个金额列，输出CSV表格
+     * @param outputPath 输出文件路径
+     * @param comparison 对比方式
+     * @param column 金额列下标（0 对应 ColTotalDeposit）
+     */
+    Summary compare(const QString &outputPath, Comparison comparison, int column) const;
+
+    /**
+     * @brief 解析金额列名（total/salary/fixed/expense/deposit/disposable 或中文列名）
+     * @param name 列名
+     * @return 返回金额列下标，无法识别返回-1
+     */
+    static int columnForName(const QString &name);
+
+    /**
+     * @brief 判断金额列是否为存量列（按月取最后一条记录的值，而不是求和）
+     * @param column 金额列下标
+     */
+    static bool isBalanceColumn(int column);
+
+    /**
+     * @brief 判断命令行是否请求了合并账本
+     */
+    static bool isRequested(int argc, char *argv[]);
+
+    /**
+     * @brief 解析命令行并执行合并或对比
+     * @param arguments 命令行参数（含程序名）
+     * @return 返回进程退出码
+     */
+    static int runFromCommandLine(const QStringList &arguments);
+
+private:
+    class Cursor;
+
+    /**
+     * @brief 按日期归并所有账本，依次把每条记录交给回调
+     * @param visit 回调，参数为账本序号、（已换算的）记录和是否缺少汇率，返回false时停止
+     * @param summary 统计信息与错误（输出参数）
+     * @return 全部读完返回true
+     */
+    template<typename Visitor>
+    bool forEachRecord(Visitor visit, Summary &summary) const;
+
+    QString labelFor(int source) const;
+
+    QVector<Source> sources;        //!< 输入账本
+    QString reportCurrency;         //!< 换算成的币种，为空表示不换算
+};
+
+#endif // LEDGERMERGER_H
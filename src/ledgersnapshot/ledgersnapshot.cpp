@@ -0,0 +1,126 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 21:16:03
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 21:16:03
+ * @Description: 按块写时复制的只读账本快照，供工作线程读取
+ */
+#include "ledgersnapshot.h"
+#include <limits>
+
+/**
+ * @brief 取出某个金额列，空值记为 NaN（与 LedgerStats 的约定一致）
+ * @param column 模型列号（ColTotalDeposit ~ ColDisposable）
+ */
+QVector<double> LedgerSnapshot::column(int column) const
+{
+    const int index = column - ColTotalDeposit;
+    const double empty = std::numeric_limits<double>::quiet_NaN();
+    QVector<double> values;
+    values.reserve(rows);
+    for (const QSharedPointer<const Block> &block : blocks) {
+        for (const LedgerRecord &record : *block) {
+            values.append(record.hasAmount(index) ? record.amount(index) : empty);
+        }
+    }
+    return values;
+}
+
+/**
+ * @brief 由一组记录直接构造快照，不经过模型，可在工作线程中调用（批量渲染等场景）
+ * @param records 记录
+ * @param version 数据版本
+ */
+LedgerSnapshotPtr LedgerSnapshot::fromRecords(const QVector<LedgerRecord> &records, quint64 version)
+{
+    LedgerSnapshot *snapshot = new LedgerSnapshot();
+    snapshot->dataVersion = version;
+    snapshot->rows = records.size();
+    for (int first = 0; first < snapshot->rows; first += BlockRows) {
+        snapshot->blocks.append(QSharedPointer<const Block>(new Block(records.mid(first, BlockRows))));
+    }
+    return LedgerSnapshotPtr(snapshot);
+}
+
+/**
+ * @brief 标记行内容发生变化（dataChanged）
+ */
+void LedgerSnapshotPublisher::markRowsChanged(int first, int last)
+{
+    first += leading.size();
+    last += leading.size();
+    for (int block = first / LedgerSnapshot::BlockRows; block <= last / LedgerSnapshot::BlockRows; ++block) {
+        dirtyBlocks.insert(block);
+    }
+}
+
+/**
+ * @brief 标记从某行起行号发生移动（插入或删除行），其后的块全部视为脏块
+ */
+void LedgerSnapshotPublisher::markRowsShifted(int first)
+{
+    dirtyFromBlock = qMin(dirtyFromBlock, (qMax(0, first) + leading.size()) / LedgerSnapshot::BlockRows);
+}
+
+/**
+ * @brief 标记全部块为脏块（模型重置、排序等）
+ */
+void LedgerSnapshotPublisher::markAll()
+{
+    dirtyFromBlock = 0;
+}
+
+/**
+ * @brief 设置排在模型记录之前的记录（如已归档的往年记录），全部块视为脏块
+ * @param records 按日期排序的记录
+ */
+void LedgerSnapshotPublisher::setLeadingRecords(const QVector<LedgerRecord> &records)
+{
+    leading = records;
+    published.reset();
+    markAll();
+}
+
+/**
+ * @brief 发布（前置记录 + ）模型当前内容的快照，未修改的块与上一版本共享
+ * @param model 数据模型（必须在模型所在线程调用）
+ * @param version 模型的数据版本，与上一快照相同时直接返回上一快照
+ */
+LedgerSnapshotPtr LedgerSnapshotPublisher::publish(const QStandardItemModel *model, quint64 version)
+{
+    if (published && published->dataVersion == version) {
+        return published;
+    }
+
+    LedgerSnapshot *snapshot = new LedgerSnapshot();
+    snapshot->dataVersion = version;
+    const int leadingRows = leading.size();
+    snapshot->rows = leadingRows + (model ? model->rowCount() : 0);
+
+    const int blockCount = (snapshot->rows + LedgerSnapshot::BlockRows - 1) / LedgerSnapshot::BlockRows;
+    snapshot->blocks.reserve(blockCount);
+    for (int index = 0; index < blockCount; ++index) {
+        const int first = index * LedgerSnapshot::BlockRows;
+        const int count = qMin(LedgerSnapshot::BlockRows, snapshot->rows - first);
+
+        // 未被标记且行数相同的块直接共享上一版本的数据
+        if (published && index < published->blocks.size() && index < dirtyFromBlock
+                && !dirtyBlocks.contains(index) && published->blocks[index]->size() == count) {
+            snapshot->blocks.append(published->blocks[index]);
+            ++snapshot->reusedBlocks;
+            continue;
+        }
+
+        LedgerSnapshot::Block *block = new LedgerSnapshot::Block();
+        block->reserve(count);
+        for (int row = first; row < first + count; ++row) {
+            block->append(row < leadingRows ? leading[row] : LedgerRecord::fromModelRow(model, row - leadingRows));
+        }
+        snapshot->blocks.append(QSharedPointer<const LedgerSnapshot::Block>(block));
+    }
+
+    published = LedgerSnapshotPtr(snapshot);
+    dirtyBlocks.clear();
+    dirtyFromBlock = std::numeric_limits<int>::max();
+    return published;
+}
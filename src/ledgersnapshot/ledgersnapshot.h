@@ -0,0 +1,135 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 21:16:03
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 21:16:03
+ * @Description: 按块写时复制的只读账本快照，供工作线程读取
+ */
+#ifndef LEDGERSNAPSHOT_H
+#define LEDGERSNAPSHOT_H
+
+#include <QVector>
+#include <QSet>
+#include <QSharedPointer>
+#include <QStandardItemModel>
+#include "ledgerrecord.h"
+
+class LedgerSnapshot;
+typedef QSharedPointer<const LedgerSnapshot> LedgerSnapshotPtr;
+
+/*
+    QStandardItemModel 只能在GUI线程读写，图表、汇总等耗时计算若直接读模型，
+    就必须在GUI线程执行。LedgerSnapshot 是某个数据版本下全部记录的不可变副本：
+
+    - 记录按 BlockRows 行分块，每块是一个 QSharedPointer<const Block>；
+    - 发布新版本时，只有被修改过的块重新从模型读取，其余块与上一版本共享
+      （写时复制），追加一条记录只复制末尾一块；
+    - 快照与块都通过原子引用计数共享，工作线程持有快照期间，GUI线程可以
+      继续修改模型、发布新版本，旧版本的块在最后一个持有者释放时才析构。
+
+    快照在GUI线程由 LedgerSnapshotPublisher 发布，再按值交给工作线程；
+    工作线程只读取不可变数据，读取方不加锁，写入方也不必等待读取方。
+*/
+class LedgerSnapshot
+{
+public:
+    typedef QVector<LedgerRecord> Block;
+    static constexpr int BlockRows = 256;   //!< 每块行数
+
+    quint64 version() const { return dataVersion; }
+    int rowCount() const { return rows; }
+    int blockCount() const { return blocks.size(); }
+    const Block &block(int index) const { return *blocks[index]; }
+
+    /**
+     * @brief 获取某一行的记录
+     * @param row 行号（0 ~ rowCount()-1）
+     */
+    const LedgerRecord &record(int row) const { return (*blocks[row / BlockRows])[row % BlockRows]; }
+
+    /**
+     * @brief 取出某个金额列，空值记为 NaN（与 LedgerStats 的约定一致）
+     * @param column 模型列号（ColTotalDeposit ~ ColDisposable）
+     */
+    QVector<double> column(int column) const;
+
+    /**
+     * @brief 由一组记录直接构造快照，不经过模型，可在工作线程中调用（批量渲染等场景）
+     * @param records 记录
+     * @param version 数据版本
+     */
+    static LedgerSnapshotPtr fromRecords(const QVector<LedgerRecord> &records, quint64 version = 0);
+
+    /**
+     * @brief 与上一版本共享的块数（调试与统计用）
+     */
+    int sharedBlocks() const { return reusedBlocks; }
+
+private:
+    friend class LedgerSnapshotPublisher;
+    LedgerSnapshot() = default;
+
+    quint64 dataVersion = 0;                        //!< 对应的数据版本
+    int rows = 0;                                   //!< 总行数
+    int reusedBlocks = 0;                           //!< 从上一版本共享的块数
+    QVector<QSharedPointer<const Block>> blocks;    //!< 记录块
+};
+
+/*
+    LedgerSnapshotPublisher 由模型的所有者在GUI线程使用：模型发出修改信号时
+    用 markRowsChanged / markRowsShifted / markAll 标记脏块，需要快照时调用
+    publish，只重建脏块并发布新的快照。
+
+    不在模型中的早期记录（已归档的往年记录）可以用 setLeadingRecords 排在
+    模型记录之前，快照第 leadingRows() 行对应模型第0行；标记脏块时传入的
+    仍是模型行号。
+*/
+class LedgerSnapshotPublisher
+{
+public:
+    /**
+     * @brief 标记行内容发生变化（dataChanged）
+     */
+    void markRowsChanged(int first, int last);
+
+    /**
+     * @brief 标记从某行起行号发生移动（插入或删除行），其后的块全部视为脏块
+     */
+    void markRowsShifted(int first);
+
+    /**
+     * @brief 标记全部块为脏块（模型重置、排序等）
+     */
+    void markAll();
+
+    /**
+     * @brief 设置排在模型记录之前的记录（如已归档的往年记录），全部块视为脏块
+     * @param records 按日期排序的记录
+     */
+    void setLeadingRecords(const QVector<LedgerRecord> &records);
+
+    /**
+     * @brief 排在模型记录之前的记录
+     */
+    const QVector<LedgerRecord> &leadingRecords() const { return leading; }
+
+    /**
+     * @brief 发布（前置记录 + ）模型当前内容的快照，未修改的块与上一版本共享
+     * @param model 数据模型（必须在模型所在线程调用）
+     * @param version 模型的数据版本，与上一快照相同时直接返回上一快照
+     */
+    LedgerSnapshotPtr publish(const QStandardItemModel *model, quint64 version);
+
+    /**
+     * @brief 最近一次发布的快照，尚未发布时为空
+     */
+    LedgerSnapshotPtr current() const { return published; }
+
+private:
+    LedgerSnapshotPtr published;        //!< 最近一次发布的快照
+    QVector<LedgerRecord> leading;      //!< 排在模型记录之前的记录
+    QSet<int> dirtyBlocks;              //!< 内容被修改过的块
+    int dirtyFromBlock = 0;             //!< 从该块起全部视为脏块
+};
+
+#endif // LEDGERSNAPSHOT_H
@@ -0,0 +1,299 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 10:45:03
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 10:45:03
+ * @Description: 金额列统计（SIMD加速）
+ */
+#include "ledgerstats.h"
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LEDGERSTATS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const double PositiveInf = std::numeric_limits<double>::infinity();
+const double NegativeInf = -std::numeric_limits<double>::infinity();
+
+/**
+ * @brief 第一遍扫描的中间结果
+ */
+struct Partial
+{
+    double count = 0.0;
+    double min = PositiveInf;
+    double max = NegativeInf;
+    double sum = 0.0;
+};
+
+using AccumulateFn = void (*)(const double *, qsizetype, Partial &);
+using DeviationFn = double (*)(const double *, qsizetype, double);
+using MultiplyFn = void (*)(const double *, const double *, double *, qsizetype);
+
+// ---------------- 通用实现 ----------------
+
+void accumulateScalar(const double *values, qsizetype size, Partial &partial)
+{
+    for (qsizetype i = 0; i < size; ++i) {
+        const double x = values[i];
+        if (x != x) continue; // NaN 表示空值
+        partial.count += 1.0;
+        partial.min = x < partial.min ? x : partial.min;
+        partial.max = x > partial.max ? x : partial.max;
+        partial.sum += x;
+    }
+}
+
+double deviationScalar(const double *values, qsizetype size, double mean)
+{
+    double total = 0.0;
+    for (qsizetype i = 0; i < size; ++i) {
+        const double x = values[i];
+        if (x != x) continue;
+        total += (x - mean) * (x - mean);
+    }
+    return total;
+}
+
+void multiplyScalar(const double *values, const double *factors, double *out, qsizetype size)
+{
+    for (qsizetype i = 0; i < size; ++i) {
+        out[i] = values[i] * factors[i]; // NaN 自然传播
+    }
+}
+
+#ifdef LEDGERSTATS_X86
+
+// ---------------- SSE2 实现（每次处理2个double） ----------------
+
+__attribute__((target("sse2")))
+void accumulateSse2(const double *values, qsizetype size, Partial &partial)
+{
+    const __m128d posInf = _mm_set1_pd(PositiveInf);
+    const __m128d negInf = _mm_set1_pd(NegativeInf);
+    const __m128d one = _mm_set1_pd(1.0);
+    __m128d vmin = posInf;
+    __m128d vmax = negInf;
+    __m128d vsum = _mm_setzero_pd();
+    __m128d vcount = _mm_setzero_pd();
+
+    qsizetype i = 0;
+    for (; i + 2 <= size; i += 2) {
+        const __m128d x = _mm_loadu_pd(values + i);
+        const __m128d present = _mm_cmpord_pd(x, x); // 非NaN的通道全1
+        const __m128d valid = _mm_and_pd(present, x);
+        vmin = _mm_min_pd(vmin, _mm_or_pd(valid, _mm_andnot_pd(present, posInf)));
+        vmax = _mm_max_pd(vmax, _mm_or_pd(valid, _mm_andnot_pd(present, negInf)));
+        vsum = _mm_add_pd(vsum, valid);
+        vcount = _mm_add_pd(vcount, _mm_and_pd(present, one));
+    }
+
+    alignas(16) double lanes[4][2];
+    _mm_store_pd(lanes[0], vmin);
+    _mm_store_pd(lanes[1], vmax);
+    _mm_store_pd(lanes[2], vsum);
+    _mm_store_pd(lanes[3], vcount);
+    for (int lane = 0; lane < 2; ++lane) {
+        partial.min = qMin(partial.min, lanes[0][lane]);
+        partial.max = qMax(partial.max, lanes[1][lane]);
+        partial.sum += lanes[2][lane];
+        partial.count += lanes[3][lane];
+    }
+
+    accumulateScalar(values + i, size - i, partial);
+}
+
+__attribute__((target("sse2")))
+double deviationSse2(const double *values, qsizetype size, double mean)
+{
+    const __m128d vmean = _mm_set1_pd(mean);
+    __m128d vtotal = _mm_setzero_pd();
+
+    qsizetype i = 0;
+    for (; i + 2 <= size; i += 2) {
+        const __m128d x = _mm_loadu_pd(values + i);
+        const __m128d present = _mm_cmpord_pd(x, x);
+        const __m128d diff = _mm_and_pd(present, _mm_sub_pd(x, vmean));
+        vtotal = _mm_add_pd(vtotal, _mm_mul_pd(diff, diff));
+    }
+
+    alignas(16) double lanes[2];
+    _mm_store_pd(lanes, vtotal);
+    return lanes[0] + lanes[1] + deviationScalar(values + i, size - i, mean);
+}
+
+__attribute__((target("sse2")))
+void multiplySse2(const double *values, const double *factors, double *out, qsizetype size)
+{
+    qsizetype i = 0;
+    for (; i + 2 <= size; i += 2) {
+        _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(values + i), _mm_loadu_pd(factors + i)));
+    }
+    multiplyScalar(values + i, factors + i, out + i, size - i);
+}
+
+// ---------------- AVX2 实现（每次处理4个double） ----------------
+
+__attribute__((target("avx2")))
+void accumulateAvx2(const double *values, qsizetype size, Partial &partial)
+{
+    const __m256d posInf = _mm256_set1_pd(PositiveInf);
+    const __m256d negInf = _mm256_set1_pd(NegativeInf);
+    const __m256d one = _mm256_set1_pd(1.0);
+    __m256d vmin = posInf;
+    __m256d vmax = negInf;
+    __m256d vsum = _mm256_setzero_pd();
+    __m256d vcount = _mm256_setzero_pd();
+
+    qsizetype i = 0;
+    for (; i + 4 <= size; i += 4) {
+        const __m256d x = _mm256_loadu_pd(values + i);
+        const __m256d present = _mm256_cmp_pd(x, x, _CMP_ORD_Q);
+        vmin = _mm256_min_pd(vmin, _mm256_blendv_pd(posInf, x, present));
+        vmax = _mm256_max_pd(vmax, _mm256_blendv_pd(negInf, x, present));
+        vsum = _mm256_add_pd(vsum, _mm256_and_pd(present, x));
+        vcount = _mm256_add_pd(vcount, _mm256_and_pd(present, one));
+    }
+
+    // MinGW-w64 的GCC不能保证栈上变量的32字节对齐（GCC bug 54412），用非对齐存储
+    double lanes[4][4];
+    _mm256_storeu_pd(lanes[0], vmin);
+    _mm256_storeu_pd(lanes[1], vmax);
+    _mm256_storeu_pd(lanes[2], vsum);
+    _mm256_storeu_pd(lanes[3], vcount);
+    for (int lane = 0; lane < 4; ++lane) {
+        partial.min = qMin(partial.min, lanes[0][lane]);
+        partial.max = qMax(partial.max, lanes[1][lane]);
+        partial.sum += lanes[2][lane];
+        partial.count += lanes[3][lane];
+    }
+
+    accumulateScalar(values + i, size - i, partial);
+}
+
+__attribute__((target("avx2")))
+double deviationAvx2(const double *values, qsizetype size, double mean)
+{
+    const __m256d vmean = _mm256_set1_pd(mean);
+    __m256d vtotal = _mm256_setzero_pd();
+
+    qsizetype i = 0;
+    for (; i + 4 <= size; i += 4) {
+        const __m256d x = _mm256_loadu_pd(values + i);
+        const __m256d present = _mm256_cmp_pd(x, x, _CMP_ORD_Q);
+        const __m256d diff = _mm256_and_pd(present, _mm256_sub_pd(x, vmean));
+        vtotal = _mm256_add_pd(vtotal, _mm256_mul_pd(diff, diff));
+    }
+
+    double lanes[4];
+    _mm256_storeu_pd(lanes, vtotal);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + deviationScalar(values + i, size - i, mean);
+}
+
+__attribute__((target("avx2")))
+void multiplyAvx2(const double *values, const double *factors, double *out, qsizetype size)
+{
+    qsizetype i = 0;
+    for (; i + 4 <= size; i += 4) {
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(values + i), _mm256_loadu_pd(factors + i)));
+    }
+    multiplyScalar(values + i, factors + i, out + i, size - i);
+}
+
+#endif // LEDGERSTATS_X86
+
+/**
+ * @brief 统计内核函数表
+ */
+struct Kernel
+{
+    const char *name;
+    AccumulateFn accumulate;
+    DeviationFn deviation;
+    MultiplyFn multiply;
+};
+
+Kernel selectKernel()
+{
+#ifdef LEDGERSTATS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {"avx2", accumulateAvx2, deviationAvx2, multiplyAvx2};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return {"sse2", accumulateSse2, deviationSse2, multiplySse2};
+    }
+#endif
+    return {"scalar", accumulateScalar, deviationScalar, multiplyScalar};
+}
+
+/**
+ * @brief 首次使用时检测CPU并固定内核
+ */
+const Kernel &activeKernel()
+{
+    static const Kernel kernel = selectKernel();
+    return kernel;
+}
+
+} // namespace
+
+/**
+ * @brief 统计数组中的非空值
+ * @param values 数据指针，NaN 表示空值
+ * @param size 元素数量
+ */
+ColumnStats LedgerStats::compute(const double *values, qsizetype size)
+{
+    ColumnStats stats;
+    if (!values || size <= 0) {
+        return stats;
+    }
+
+    const Kernel &kernel = activeKernel();
+    Partial partial;
+    kernel.accumulate(values, size, partial);
+    if (partial.count == 0.0) {
+        return stats;
+    }
+
+    stats.count = static_cast<qint64>(partial.count);
+    stats.min = partial.min;
+    stats.max = partial.max;
+    stats.sum = partial.sum;
+    stats.mean = partial.sum / partial.count;
+    // 用离差平方和求方差，避免 sum(x^2) - n*mean^2 在大金额下的精度损失
+    stats.variance = kernel.deviation(values, size, stats.mean) / partial.count;
+    return stats;
+}
+
+ColumnStats LedgerStats::compute(const QVector<double> &values)
+{
+    return compute(values.constData(), values.size());
+}
+
+/**
+ * @brief 逐元素相乘：out[i] = values[i] * factors[i]，用于按行汇率换算整列金额
+ * @param values 金额，NaN 表示空值
+ * @param factors 每行的换算系数，NaN 表示缺少汇率
+ * @param out 输出（可与values相同）
+ * @param size 元素数量
+ */
+void LedgerStats::multiply(const double *values, const double *factors, double *out, qsizetype size)
+{
+    if (!values || !factors || !out || size <= 0) {
+        return;
+    }
+    activeKernel().multiply(values, factors, out, size);
+}
+
+/**
+ * @brief 当前使用的统计内核名称（"avx2" / "sse2" / "scalar"）
+ */
+const char *LedgerStats::kernelName()
+{
+    return activeKernel().name;
+}
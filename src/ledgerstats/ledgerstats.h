@@ -0,0 +1,65 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 10:45:03
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 10:45:03
+ * @Description: 金额列统计（SIMD加速）
+ */
+#ifndef LEDGERSTATS_H
+#define LEDGERSTATS_H
+
+#include <QVector>
+#include <cmath>
+
+/**
+ * @brief 单列金额的统计结果
+ */
+struct ColumnStats
+{
+    qint64 count = 0;       //!< 非空值数量
+    double min = 0.0;       //!< 最小值
+    double max = 0.0;       //!< 最大值
+    double sum = 0.0;       //!< 合计
+    double mean = 0.0;      //!< 平均值
+    double variance = 0.0;  //!< 总体方差
+
+    /**
+     * @brief 标准差（波动率）
+     */
+    double stddev() const { return std::sqrt(variance); }
+    bool isEmpty() const { return count == 0; }
+};
+
+/*
+    金额列以 double 数组表示，空单元格用 NaN 占位。
+    统计内核按运行时检测到的指令集选择 AVX2 / SSE2 / 通用实现：
+    第一遍一次性求出 count/min/max/sum，第二遍求离差平方和得到方差，
+    两遍都是按向量宽度批量处理，NaN 通过掩码剔除，没有逐元素分支。
+*/
+class LedgerStats
+{
+public:
+    /**
+     * @brief 统计数组中的非空值
+     * @param values 数据指针，NaN 表示空值
+     * @param size 元素数量
+     */
+    static ColumnStats compute(const double *values, qsizetype size);
+    static ColumnStats compute(const QVector<double> &values);
+
+    /**
+     * @brief 逐元素相乘：out[i] = values[i] * factors[i]，用于按行汇率换算整列金额
+     * @param values 金额，NaN 表示空值
+     * @param factors 每行的换算系数，NaN 表示缺少汇率
+     * @param out 输出（可与values相同）
+     * @param size 元素数量
+     */
+    static void multiply(const double *values, const double *factors, double *out, qsizetype size);
+
+    /**
+     * @brief 当前使用的统计内核名称（"avx2" / "sse2" / "scalar"）
+     */
+    static const char *kernelName();
+};
+
+#endif // LEDGERSTATS_H
@@ -0,0 +1,450 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 18:20:44
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 18:20:44
+ * @Description: CSV文件存储引擎
+ */
+#include "csvledgerstorage.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QLockFile>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QDebug>
+
+namespace {
+
+const int LockTimeoutMs = 5000;         //!< 等待其它进程释放文件锁的最长时间
+const int LockStaleMs = 30000;          //!< 持有者崩溃后锁文件被视为失效的时间
+const int StampTailBytes = 64;          //!< 版本戳中记录的文件末尾字节数
+
+} // namespace
+
+/**
+ * @brief 构造函数
+ * @param filePath CSV文件路径
+ */
+CsvLedgerStorage::CsvLedgerStorage(const QString &filePath)
+    : filePath(filePath)
+{
+}
+
+/**
+ * @brief 判断CSV中的一行是否为一条记录
+ * @param line 已去除首尾空白的行
+ */
+bool CsvLedgerStorage::isRecordLine(const QString &line)
+{
+    if (line.isEmpty()) {
+        return false;
+    }
+    QStringList fields = line.split(",");
+    bool isNumber = false;
+    fields[0].toInt(&isNumber);
+    return isNumber || fields.size() >= 8;
+}
+
+/**
+ * @brief 把CSV中的一行解析为LedgerColumnCount个字段（智能判断是否包含序号列，缺少的字段用空字符串填充）
+ * @param line 已去除首尾空白的行
+ * @return 返回LedgerColumnCount个字段；不是记录行时返回空列表
+ */
+QStringList CsvLedgerStorage::splitLine(const QString &line)
+{
+    if (!isRecordLine(line)) {
+        return QStringList();
+    }
+    QStringList fields = line.split(",");
+    bool isNumber = false;
+    fields[0].toInt(&isNumber);
+    if (isNumber) {
+        // 包含序号列，从fields[1]开始
+        fields.removeFirst();
+    }
+    fields = fields.mid(0, LedgerColumnCount);
+    while (fields.size() < LedgerColumnCount) {
+        fields.append(QString());
+    }
+    return fields;
+}
+
+/**
+ * @brief 把一条记录格式化为CSV行（不含换行符）
+ * @param row 行号，序号为行号+1
+ * @param record 记录
+ */
+QString CsvLedgerStorage::formatLine(int row, const LedgerRecord &record)
+{
+    QString line = QString::number(row + 1);
+    line += "," + record.date.toString("yyyy/MM/dd");
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        line += ",";
+        if (record.hasAmount(i)) {
+            line += LedgerRecord::formatCents(record.amounts[i]);
+        }
+    }
+    line += "," + record.note;
+    // 币种列只在非默认币种时写出，旧格式的账本保持原样
+    if (!record.currency.isEmpty()) {
+        line += "," + record.currency;
+    }
+    return line;
+}
+
+bool CsvLedgerStorage::readAll(QVector<LedgerRecord> &records)
+{
+    return readFrom(0, records);
+}
+
+bool CsvLedgerStorage::writeAll(const QVector<LedgerRecord> &records)
+{
+    return writeFrom(0, records);
+}
+
+/**
+ * @brief 从某一行起读取记录，之前的记录行只跳过不解析
+ * @param firstRow 起始行号
+ * @param records 读到的记录（输出参数）
+ */
+bool CsvLedgerStorage::readFrom(int firstRow, QVector<LedgerRecord> &records)
+{
+    records.clear();
+
+    // 读取期间持有文件锁，避免读到其它进程写了一半的内容；拿不到锁时仍然读取
+    QLockFile lock(filePath + ".lock");
+    lock.setStaleLockTime(LockStaleMs);
+    if (!lock.tryLock(LockTimeoutMs)) {
+        qDebug() << "CsvLedgerStorage: ledger is locked by another process, reading anyway";
+    }
+
+    if (!readRecords(firstRow, records)) {
+        return false;
+    }
+    stamp = readStamp();
+    synced = true;
+    return true;
+}
+
+/**
+ * @brief 用给定记录替换某一行之后的全部记录，之前的行原样复制
+ * @param firstRow 起始行号，文件中的记录少于该行数时失败
+ * @param records 新记录
+ */
+bool CsvLedgerStorage::writeFrom(int firstRow, const QVector<LedgerRecord> &records)
+{
+    QLockFile lock(filePath + ".lock");
+    if (!lockForWrite(lock) || !checkUnchanged()) {
+        return false;
+    }
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        lastError = file.errorString();
+        return false;
+    }
+    QTextStream out(&file);
+    if (firstRow > 0) {
+        QFile source(filePath);
+        if (!source.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            lastError = source.errorString();
+            file.cancelWriting();
+            return false;
+        }
+        QTextStream in(&source);
+        if (!copyRecordLines(in, out, firstRow)) {
+            lastError = QString("文件中的记录少于 %1 条").arg(firstRow);
+            file.cancelWriting();
+            return false;
+        }
+    }
+    for (int i = 0; i < records.size(); ++i) {
+        out << formatLine(firstRow + i, records[i]) << "\n";
+    }
+    out.flush();
+    if (out.status() != QTextStream::Ok || !file.commit()) {
+        lastError = file.errorString();
+        return false;
+    }
+    stamp = readStamp();
+    synced = true;
+    return true;
+}
+
+bool CsvLedgerStorage::append(int firstRow, const QVector<LedgerRecord> &records)
+{
+    QLockFile lock(filePath + ".lock");
+    if (!lockForWrite(lock) || !checkUnchanged()) {
+        return false;
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        lastError = file.errorString();
+        return false;
+    }
+    QTextStream out(&file);
+    // 最后一行没有换行符时先补上，避免新记录接在旧记录的同一行
+    if (!stamp.tail.isEmpty() && !stamp.tail.endsWith('\n')) {
+        out << "\n";
+    }
+    for (int i = 0; i < records.size(); ++i) {
+        out << formatLine(firstRow + i, records[i]) << "\n";
+    }
+    out.flush();
+    if (out.status() != QTextStream::Ok || file.error() != QFileDevice::NoError) {
+        lastError = file.errorString();
+        return false;
+    }
+    file.close();
+    if (file.error() != QFileDevice::NoError) {
+        lastError = file.errorString();
+        return false;
+    }
+    stamp = readStamp();
+    synced = true;
+    return true;
+}
+
+/**
+ * @brief 按行号改写记录：逐行复制文件，只替换指定的记录行
+ * @param records 行号到新记录的映射
+ */
+bool CsvLedgerStorage::update(const QMap<int, LedgerRecord> &records)
+{
+    if (records.isEmpty()) {
+        return true;
+    }
+    QLockFile lock(filePath + ".lock");
+    if (!lockForWrite(lock) || !checkUnchanged()) {
+        return false;
+    }
+
+    QFile source(filePath);
+    if (!source.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        lastError = source.errorString();
+        return false;
+    }
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        lastError = file.errorString();
+        return false;
+    }
+    QTextStream in(&source);
+    QTextStream out(&file);
+    QString line;
+    int row = 0;
+    int replaced = 0;
+    while (in.readLineInto(&line)) {
+        if (!isRecordLine(line.trimmed())) {
+            out << line << "\n";
+            continue;
+        }
+        auto it = records.constFind(row++);
+        if (it != records.constEnd()) {
+            out << formatLine(it.key(), it.value()) << "\n";
+            ++replaced;
+        } else {
+            out << line << "\n";
+        }
+    }
+    source.close();
+    if (replaced != records.size()) {
+        lastError = QString("行号 %1 超出范围").arg(records.lastKey());
+        file.cancelWriting();
+        return false;
+    }
+    out.flush();
+    if (out.status() != QTextStream::Ok || !file.commit()) {
+        lastError = file.errorString();
+        return false;
+    }
+    stamp = readStamp();
+    synced = true;
+    return true;
+}
+
+QVector<LedgerRecord> CsvLedgerStorage::query(const QDate &from, const QDate &to)
+{
+    QVector<LedgerRecord> all;
+    QVector<LedgerRecord> result;
+    readRecords(0, all);
+    for (const LedgerRecord &record : all) {
+        if ((!from.isValid() || record.date >= from) && (!to.isValid() || record.date <= to)) {
+            result.append(record);
+        }
+    }
+    return result;
+}
+
+QVector<LedgerRecord> CsvLedgerStorage::queryByTotalDeposit(qint64 minCents, qint64 maxCents)
+{
+    QVector<LedgerRecord> all;
+    QVector<LedgerRecord> result;
+    readRecords(0, all);
+    const int index = 0; // 金额列下标0对应ColTotalDeposit
+    for (const LedgerRecord &record : all) {
+        if (record.hasAmount(index) && record.amounts[index] >= minCents && record.amounts[index] <= maxCents) {
+            result.append(record);
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief 文件在本实例上次读写之后是否被其它程序修改过
+ */
+bool CsvLedgerStorage::isModifiedExternally() const
+{
+    return synced && readStamp() != stamp;
+}
+
+/**
+ * @brief 读取其它程序在本实例上次读写之后追加到末尾的记录
+ * @param records 追加的记录（输出参数）
+ * @return 文件未变化或只是被追加时返回true；被其它方式修改时返回false
+ */
+bool CsvLedgerStorage::readAppended(QVector<LedgerRecord> &records)
+{
+    records.clear();
+    // 只有读到追加的记录时才记下新的版本戳，失败后 acceptAppended 不会接受他人的改写
+    appendedStamp = FileStamp();
+    const FileStamp current = readStamp();
+    if (!synced || current == stamp) {
+        return true;
+    }
+    if (stamp.size < 0 || current.size <= stamp.size) {
+        lastError = "账本文件已被其它程序修改";
+        return false;
+    }
+
+    // 已同步部分的末尾字节不变，才说明文件只是被追加
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        lastError = file.errorString();
+        return false;
+    }
+    file.seek(stamp.size - stamp.tail.size());
+    if (file.read(stamp.tail.size()) != stamp.tail) {
+        lastError = "账本文件已被其它程序修改";
+        return false;
+    }
+    const QStringList lines = QString::fromUtf8(file.readAll()).split('\n');
+    for (const QString &line : lines) {
+        const QStringList fields = splitLine(line.trimmed());
+        if (!fields.isEmpty()) {
+            records.append(LedgerRecord::fromFields(fields));
+        }
+    }
+    appendedStamp = current;
+    return true;
+}
+
+/**
+ * @brief 调用方已合并readAppended读到的记录，之后的写入以追加后的内容为准
+ */
+void CsvLedgerStorage::acceptAppended()
+{
+    if (synced && appendedStamp.size >= 0) {
+        stamp = appendedStamp;
+    }
+}
+
+/**
+ * @brief 从某一行起解析记录，不改变同步状态（查询用）
+ * @param firstRow 起始行号
+ * @param records 读到的记录（输出参数）
+ */
+bool CsvLedgerStorage::readRecords(int firstRow, QVector<LedgerRecord> &records)
+{
+    records.clear();
+    QFile file(filePath);
+    if (!file.exists()) {
+        return true;
+    }
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        lastError = file.errorString();
+        return false;
+    }
+    QTextStream in(&file);
+    QString line;
+    int row = 0;
+    while (in.readLineInto(&line)) {
+        const QString trimmed = line.trimmed();
+        if (row < firstRow) {
+            row += isRecordLine(trimmed) ? 1 : 0;
+            continue;
+        }
+        const QStringList fields = splitLine(trimmed);
+        if (!fields.isEmpty()) {
+            records.append(LedgerRecord::fromFields(fields));
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 读取文件当前的版本戳
+ * @return 返回版本戳，文件不存在时大小为-1
+ */
+CsvLedgerStorage::FileStamp CsvLedgerStorage::readStamp() const
+{
+    FileStamp current;
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return current;
+    }
+    current.size = file.size();
+    current.modified = QFileInfo(file).lastModified().toMSecsSinceEpoch();
+    // 修改时间精度有限，再比较末尾字节以发现同一时刻内的写入
+    file.seek(qMax<qint64>(0, current.size - StampTailBytes));
+    current.tail = file.read(StampTailBytes);
+    return current;
+}
+
+/**
+ * @brief 获取写入用的文件锁（建议锁，只对同样使用锁的程序有效）
+ * @param lock 锁对象
+ * @return 成功返回true，超时返回false
+ */
+bool CsvLedgerStorage::lockForWrite(QLockFile &lock)
+{
+    lock.setStaleLockTime(LockStaleMs);
+    if (!lock.tryLock(LockTimeoutMs)) {
+        lastError = "账本文件正被其它程序使用，请稍后重试！";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 写入前检查文件自上次读写后没有被其它程序修改（调用方须已持有文件锁）
+ * @return 未被修改返回true
+ */
+bool CsvLedgerStorage::checkUnchanged()
+{
+    if (synced && readStamp() != stamp) {
+        lastError = "账本文件已被其它程序修改，为避免覆盖他人的修改，本次未保存。\n请重新打开账本后再试！";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 逐行复制前若干条记录（连同其间的非记录行）
+ * @param in 源文件
+ * @param out 目标文件
+ * @param count 记录数
+ * @return 源文件中的记录不少于count条时返回true
+ */
+bool CsvLedgerStorage::copyRecordLines(QTextStream &in, QTextStream &out, int count)
+{
+    QString line;
+    int row = 0;
+    while (row < count && in.readLineInto(&line)) {
+        out << line << "\n";
+        row += isRecordLine(line.trimmed()) ? 1 : 0;
+    }
+    return row == count;
+}
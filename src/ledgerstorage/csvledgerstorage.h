@@ -0,0 +1,100 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 18:20:44
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 18:20:44
+ * @Description: CSV文件存储引擎
+ */
+#ifndef CSVLEDGERSTORAGE_H
+#define CSVLEDGERSTORAGE_H
+
+#include "ledgerstorage.h"
+#include <QStringList>
+#include <QByteArray>
+
+class QLockFile;
+class QTextStream;
+
+/*
+    CSV 每行为"序号,日期,6个金额列,备注[,币种]"，旧文件允许没有序号列，
+    没有币种列的行按默认币种处理。
+    CSV 没有索引，查询需要读取整个文件；按行改写与重写某行之后的记录都是
+    逐行流式复制，未改动的行原样保留，内存占用与文件大小无关。
+
+    同一个CSV可能同时被其它程序（或另一个实例）编辑，因此：
+    - 每次写入都持有建议锁（文件名 + ".lock"），读取时拿不到锁仍然读取；
+    - 每次读写后记录文件的版本戳（大小、修改时间、末尾字节），写入前发现
+      版本戳变化说明期间有人修改过文件，拒绝写入以免覆盖他人的修改；
+    - 文件只是被追加时，readAppended 读出追加的记录，调用方合并后用
+      acceptAppended 接受新的版本戳，再追加自己的记录。
+*/
+class CsvLedgerStorage : public LedgerStorage
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param filePath CSV文件路径
+     */
+    explicit CsvLedgerStorage(const QString &filePath);
+
+    /**
+     * @brief 判断CSV中的一行是否为一条记录
+     * @param line 已去除首尾空白的行
+     */
+    static bool isRecordLine(const QString &line);
+
+    /**
+     * @brief 把CSV中的一行解析为LedgerColumnCount个字段（智能判断是否包含序号列，缺少的字段用空字符串填充）
+     * @param line 已去除首尾空白的行
+     * @return 返回LedgerColumnCount个字段；不是记录行时返回空列表
+     */
+    static QStringList splitLine(const QString &line);
+
+    /**
+     * @brief 把一条记录格式化为CSV行（不含换行符）
+     * @param row 行号，序号为行号+1
+     * @param record 记录
+     */
+    static QString formatLine(int row, const LedgerRecord &record);
+
+    Backend backend() const override { return CsvBackend; }
+    bool readAll(QVector<LedgerRecord> &records) override;
+    bool writeAll(const QVector<LedgerRecord> &records) override;
+    bool readFrom(int firstRow, QVector<LedgerRecord> &records) override;
+    bool writeFrom(int firstRow, const QVector<LedgerRecord> &records) override;
+    bool append(int firstRow, const QVector<LedgerRecord> &records) override;
+    bool update(const QMap<int, LedgerRecord> &records) override;
+    QVector<LedgerRecord> query(const QDate &from, const QDate &to) override;
+    QVector<LedgerRecord> queryByTotalDeposit(qint64 minCents, qint64 maxCents) override;
+    bool isModifiedExternally() const override;
+    bool readAppended(QVector<LedgerRecord> &records) override;
+    void acceptAppended() override;
+
+private:
+    /**
+     * @brief 文件版本戳：上次读写后文件的大小、修改时间和末尾字节
+     */
+    struct FileStamp {
+        qint64 size = -1;
+        qint64 modified = 0;
+        QByteArray tail;
+        bool operator==(const FileStamp &other) const
+        {
+            return size == other.size && modified == other.modified && tail == other.tail;
+        }
+        bool operator!=(const FileStamp &other) const { return !(*this == other); }
+    };
+
+    QString filePath;                   //!< CSV文件路径
+    FileStamp stamp;                    //!< 上次与文件同步时的版本戳
+    FileStamp appendedStamp;            //!< readAppended 读到的版本戳，acceptAppended 后生效
+    bool synced = false;                //!< 是否已读写过文件（此后写入前检查版本戳）
+
+    bool readRecords(int firstRow, QVector<LedgerRecord> &records);
+    FileStamp readStamp() const;
+    bool lockForWrite(QLockFile &lock);
+    bool checkUnchanged();
+    bool copyRecordLines(QTextStream &in, QTextStream &out, int count);
+};
+
+#endif // CSVLEDGERSTORAGE_H
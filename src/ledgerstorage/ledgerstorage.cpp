@@ -0,0 +1,126 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 18:20:44
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 18:20:44
+ * @Description: 账本存储引擎的公共接口
+ */
+#include "ledgerstorage.h"
+#include "csvledgerstorage.h"
+#include "sqliteledgerstorage.h"
+#include <QFileInfo>
+
+/**
+ * @brief 根据文件后缀判断存储引擎类型
+ * @param filePath 文件路径
+ */
+LedgerStorage::Backend LedgerStorage::backendForPath(const QString &filePath)
+{
+    const QString suffix = QFileInfo(filePath).suffix().toLower();
+    if (suffix == "db" || suffix == "sqlite" || suffix == "sqlite3") {
+        return SqliteBackend;
+    }
+    return CsvBackend;
+}
+
+/**
+ * @brief 创建与文件后缀对应的存储引擎并打开文件
+ * @param filePath 文件路径
+ * @param error 失败时输出错误信息
+ * @return 返回存储引擎，由调用方接管所有权；打开失败时返回nullptr
+ */
+LedgerStorage *LedgerStorage::open(const QString &filePath, QString *error)
+{
+    if (backendForPath(filePath) == CsvBackend) {
+        return new CsvLedgerStorage(filePath);
+    }
+
+    SqliteLedgerStorage *storage = new SqliteLedgerStorage(filePath);
+    if (!storage->isOpen()) {
+        if (error) {
+            *error = storage->errorString();
+        }
+        delete storage;
+        return nullptr;
+    }
+    return storage;
+}
+
+/**
+ * @brief 把一个账本文件的全部记录复制到另一种（或同种）存储格式的文件中
+ * @param sourcePath 源文件路径
+ * @param targetPath 目标文件路径，已有内容会被替换
+ * @param error 失败时输出错误信息
+ * @return 返回复制的记录数，失败时返回-1
+ */
+int LedgerStorage::migrate(const QString &sourcePath, const QString &targetPath, QString *error)
+{
+    if (QFileInfo(sourcePath).absoluteFilePath() == QFileInfo(targetPath).absoluteFilePath()) {
+        if (error) {
+            *error = "源文件与目标文件相同";
+        }
+        return -1;
+    }
+
+    LedgerStorage *source = open(sourcePath, error);
+    if (!source) {
+        return -1;
+    }
+    QVector<LedgerRecord> records;
+    const bool readOk = source->readAll(records);
+    if (!readOk && error) {
+        *error = source->errorString();
+    }
+    delete source;
+    if (!readOk) {
+        return -1;
+    }
+
+    LedgerStorage *target = open(targetPath, error);
+    if (!target) {
+        return -1;
+    }
+    const bool writeOk = target->writeAll(records);
+    if (!writeOk && error) {
+        *error = target->errorString();
+    }
+    delete target;
+    return writeOk ? records.size() : -1;
+}
+
+/**
+ * @brief 从某一行起读取记录，默认读取全部记录后丢弃之前的部分
+ * @param firstRow 起始行号
+ * @param records 读到的记录（输出参数）
+ */
+bool LedgerStorage::readFrom(int firstRow, QVector<LedgerRecord> &records)
+{
+    if (!readAll(records)) {
+        return false;
+    }
+    records.remove(0, qBound(0, firstRow, records.size()));
+    return true;
+}
+
+/**
+ * @brief 用给定记录替换某一行之后的全部记录，默认读出之前的记录后整体重写
+ * @param firstRow 起始行号，存储中的记录少于该行数时失败
+ * @param records 新记录
+ */
+bool LedgerStorage::writeFrom(int firstRow, const QVector<LedgerRecord> &records)
+{
+    if (firstRow <= 0) {
+        return writeAll(records);
+    }
+    QVector<LedgerRecord> all;
+    if (!readAll(all)) {
+        return false;
+    }
+    if (all.size() < firstRow) {
+        lastError = QString("存储中只有 %1 条记录，少于起始行号 %2").arg(all.size()).arg(firstRow);
+        return false;
+    }
+    all.resize(firstRow);
+    all += records;
+    return writeAll(all);
+}
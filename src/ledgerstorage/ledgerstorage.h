@@ -0,0 +1,145 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 18:20:44
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 18:20:44
+ * @Description: 账本存储引擎的公共接口
+ */
+#ifndef LEDGERSTORAGE_H
+#define LEDGERSTORAGE_H
+
+#include <QString>
+#include <QVector>
+#include <QMap>
+#include "ledgerrecord.h"
+
+/*
+    账本记录按行号（序号 = 行号 + 1）组织，所有存储引擎都提供：
+    - readAll/writeAll：整体读取与整体重写；
+    - readFrom/writeFrom：只读取或重写某行之后的记录（窗口模式），之前的记录保持不变；
+    - append：在末尾追加新记录；
+    - update：按行号改写若干条记录；
+    - query/queryByTotalDeposit：按日期或总存款金额范围查询；
+    - readAppended/acceptAppended/isModifiedExternally：与其它程序并发写入时的
+      乐观并发控制，各引擎用自己的版本戳判断存储内容是否被其它程序修改过，
+      默认实现视为没有外部修改。
+    存储引擎由文件后缀决定：.csv 使用 CsvLedgerStorage，
+    .db/.sqlite/.sqlite3 使用 SqliteLedgerStorage。
+    migrate 在两种引擎之间一次性复制全部记录。
+*/
+class LedgerStorage
+{
+public:
+    /**
+     * @brief 存储引擎类型
+     */
+    enum Backend {
+        CsvBackend,
+        SqliteBackend
+    };
+
+    virtual ~LedgerStorage() = default;
+
+    /**
+     * @brief 根据文件后缀判断存储引擎类型
+     * @param filePath 文件路径
+     */
+    static Backend backendForPath(const QString &filePath);
+
+    /**
+     * @brief 创建与文件后缀对应的存储引擎并打开文件
+     * @param filePath 文件路径
+     * @param error 失败时输出错误信息
+     * @return 返回存储引擎，由调用方接管所有权；打开失败时返回nullptr
+     */
+    static LedgerStorage *open(const QString &filePath, QString *error = nullptr);
+
+    /**
+     * @brief 把一个账本文件的全部记录复制到另一种（或同种）存储格式的文件中
+     * @param sourcePath 源文件路径
+     * @param targetPath 目标文件路径，已有内容会被替换
+     * @param error 失败时输出错误信息
+     * @return 返回复制的记录数，失败时返回-1
+     */
+    static int migrate(const QString &sourcePath, const QString &targetPath, QString *error = nullptr);
+
+    virtual Backend backend() const = 0;
+
+    /**
+     * @brief 读取全部记录，按行号排序
+     */
+    virtual bool readAll(QVector<LedgerRecord> &records) = 0;
+
+    /**
+     * @brief 用给定记录整体替换存储内容
+     */
+    virtual bool writeAll(const QVector<LedgerRecord> &records) = 0;
+
+    /**
+     * @brief 从某一行起读取记录，之前的记录不解析
+     * @param firstRow 起始行号
+     * @param records 读到的记录（输出参数）
+     */
+    virtual bool readFrom(int firstRow, QVector<LedgerRecord> &records);
+
+    /**
+     * @brief 用给定记录替换某一行之后的全部记录，之前的记录保持不变
+     * @param firstRow 起始行号，存储中的记录少于该行数时失败
+     * @param records 新记录
+     */
+    virtual bool writeFrom(int firstRow, const QVector<LedgerRecord> &records);
+
+    /**
+     * @brief 在末尾追加记录
+     * @param firstRow 第一条新记录的行号（等于已有记录数）
+     * @param records 新记录
+     */
+    virtual bool append(int firstRow, const QVector<LedgerRecord> &records) = 0;
+
+    /**
+     * @brief 按行号改写记录
+     * @param records 行号到新记录的映射
+     */
+    virtual bool update(const QMap<int, LedgerRecord> &records) = 0;
+
+    /**
+     * @brief 查询日期范围内的记录
+     * @param from 起始日期（含），无效日期表示不限
+     * @param to 结束日期（含），无效日期表示不限
+     */
+    virtual QVector<LedgerRecord> query(const QDate &from, const QDate &to) = 0;
+
+    /**
+     * @brief 查询总存款金额范围内的记录
+     * @param minCents 最小值（含，单位：分）
+     * @param maxCents 最大值（含，单位：分）
+     */
+    virtual QVector<LedgerRecord> queryByTotalDeposit(qint64 minCents, qint64 maxCents) = 0;
+
+    /**
+     * @brief 存储内容在本实例上次读写之后是否被其它程序修改过
+     */
+    virtual bool isModifiedExternally() const { return false; }
+
+    /**
+     * @brief 读取其它程序在本实例上次读写之后追加到末尾的记录，不改变同步状态
+     * @param records 追加的记录（输出参数）
+     * @return 没有外部修改或只是被追加时返回true；被其它方式修改时返回false
+     */
+    virtual bool readAppended(QVector<LedgerRecord> &records) { records.clear(); return true; }
+
+    /**
+     * @brief 调用方已合并readAppended读到的记录，之后的写入以追加后的内容为准
+     */
+    virtual void acceptAppended() {}
+
+    /**
+     * @brief 最近一次失败的错误信息
+     */
+    QString errorString() const { return lastError; }
+
+protected:
+    QString lastError;                  //!< 最近一次失败的错误信息
+};
+
+#endif // LEDGERSTORAGE_H
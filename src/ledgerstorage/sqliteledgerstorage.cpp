@@ -0,0 +1,434 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 18:20:44
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 18:20:44
+ * @Description: SQLite存储引擎
+ */
+#include "sqliteledgerstorage.h"
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QAtomicInt>
+#include <QStringList>
+
+namespace {
+
+const char *const RecordColumns =
+    "seq, date, total_deposit, salary, fixed_deposit, expense, monthly_deposit, disposable, note, currency";
+
+QAtomicInt connectionCounter;           //!< 用于生成唯一的连接名
+
+/**
+ * @brief 日期以ISO格式保存，字典序即时间顺序，date索引可直接用于范围查询
+ */
+QString dateKey(const QDate &date)
+{
+    return date.isValid() ? date.toString(Qt::ISODate) : QString("");
+}
+
+} // namespace
+
+/**
+ * @brief 构造函数，打开（不存在时创建）数据库文件并建立表结构
+ * @param filePath 数据库文件路径
+ */
+SqliteLedgerStorage::SqliteLedgerStorage(const QString &filePath)
+    : connectionName(QString("ledger_sqlite_%1").arg(connectionCounter.fetchAndAddRelaxed(1)))
+{
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    db.setDatabaseName(filePath);
+    if (!db.open()) {
+        lastError = db.lastError().text();
+        return;
+    }
+
+    opened = exec("PRAGMA journal_mode=WAL")
+        && exec("PRAGMA synchronous=NORMAL")
+        && exec("CREATE TABLE IF NOT EXISTS records ("
+                "seq INTEGER PRIMARY KEY, "
+                "date TEXT NOT NULL, "
+                "total_deposit INTEGER, "
+                "salary INTEGER, "
+                "fixed_deposit INTEGER, "
+                "expense INTEGER, "
+                "monthly_deposit INTEGER, "
+                "disposable INTEGER, "
+                "note TEXT NOT NULL DEFAULT '', "
+                "currency TEXT NOT NULL DEFAULT '')")
+        && ensureColumn("currency", "TEXT NOT NULL DEFAULT ''")
+        && exec("CREATE TABLE IF NOT EXISTS ledger_meta ("
+                "id INTEGER PRIMARY KEY CHECK (id = 0), "
+                "revision INTEGER NOT NULL)")
+        && exec("INSERT OR IGNORE INTO ledger_meta (id, revision) VALUES (0, 0)")
+        && exec("CREATE INDEX IF NOT EXISTS idx_records_date ON records(date)")
+        && exec("CREATE INDEX IF NOT EXISTS idx_records_total_deposit ON records(total_deposit)");
+}
+
+/**
+ * @brief 析构函数，关闭并移除本实例的数据库连接
+ */
+SqliteLedgerStorage::~SqliteLedgerStorage()
+{
+    {
+        QSqlDatabase db = QSqlDatabase::database(connectionName, false);
+        if (db.isOpen()) {
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+}
+
+/**
+ * @brief 数据库是否已成功打开
+ */
+bool SqliteLedgerStorage::isOpen() const
+{
+    return opened;
+}
+
+bool SqliteLedgerStorage::readAll(QVector<LedgerRecord> &records)
+{
+    return readFrom(0, records);
+}
+
+bool SqliteLedgerStorage::writeAll(const QVector<LedgerRecord> &records)
+{
+    return writeFrom(0, records);
+}
+
+/**
+ * @brief 从某一行起读取记录，并记下同一时刻的版本戳
+ * @param firstRow 起始行号
+ * @param records 读到的记录（输出参数）
+ */
+bool SqliteLedgerStorage::readFrom(int firstRow, QVector<LedgerRecord> &records)
+{
+    lastError.clear();
+    records.clear();
+    QSqlDatabase db = database();
+    // 记录与版本戳在同一个读事务中读取，对应数据库的同一个版本
+    if (!db.transaction()) {
+        lastError = db.lastError().text();
+        return false;
+    }
+    records = select(" WHERE seq > ?", {qMax(0, firstRow)});
+    const Stamp current = readStamp();
+    db.commit();
+    if (!lastError.isEmpty()) {
+        records.clear();
+        return false;
+    }
+    stamp = current;
+    synced = true;
+    return true;
+}
+
+/**
+ * @brief 用给定记录替换某一行之后的全部记录，之前的记录保持不变
+ * @param firstRow 起始行号，数据库中的记录少于该行数时失败
+ * @param records 新记录
+ */
+bool SqliteLedgerStorage::writeFrom(int firstRow, const QVector<LedgerRecord> &records)
+{
+    firstRow = qMax(0, firstRow);
+    return writeTransaction([this, firstRow, &records]() {
+        const qint64 rows = readStamp().rows;
+        if (rows < firstRow) {
+            lastError = QString("存储中只有 %1 条记录，少于起始行号 %2").arg(rows).arg(firstRow);
+            return false;
+        }
+        QSqlQuery query(database());
+        if (!query.prepare("DELETE FROM records WHERE seq > ?")) {
+            return fail(query);
+        }
+        query.bindValue(0, firstRow);
+        if (!query.exec()) {
+            return fail(query);
+        }
+        return insertRecords(firstRow, records) && exec("UPDATE ledger_meta SET revision = revision + 1 WHERE id = 0");
+    });
+}
+
+bool SqliteLedgerStorage::append(int firstRow, const QVector<LedgerRecord> &records)
+{
+    // 只追加不改变 revision，其它实例据此判断可以合并
+    return writeTransaction([this, firstRow, &records]() {
+        return insertRecords(firstRow, records);
+    });
+}
+
+bool SqliteLedgerStorage::update(const QMap<int, LedgerRecord> &records)
+{
+    return writeTransaction([this, &records]() {
+        // 同一条预编译语句按主键覆盖各行
+        QSqlQuery query(database());
+        if (!query.prepare(QString("REPLACE INTO records (%1) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)").arg(RecordColumns))) {
+            return fail(query);
+        }
+        for (auto it = records.constBegin(); it != records.constEnd(); ++it) {
+            bindRecord(query, it.key(), it.value());
+            if (!query.exec()) {
+                return fail(query);
+            }
+        }
+        return exec("UPDATE ledger_meta SET revision = revision + 1 WHERE id = 0");
+    });
+}
+
+QVector<LedgerRecord> SqliteLedgerStorage::query(const QDate &from, const QDate &to)
+{
+    QStringList conditions;
+    QVariantList values;
+    if (from.isValid()) {
+        conditions << "date >= ?";
+        values << dateKey(from);
+    }
+    if (to.isValid()) {
+        conditions << "date <= ?";
+        values << dateKey(to);
+    }
+    return select(conditions.isEmpty() ? QString() : " WHERE " + conditions.join(" AND "), values);
+}
+
+QVector<LedgerRecord> SqliteLedgerStorage::queryByTotalDeposit(qint64 minCents, qint64 maxCents)
+{
+    return select(" WHERE total_deposit BETWEEN ? AND ?", {minCents, maxCents});
+}
+
+/**
+ * @brief 数据库在本实例上次读写之后是否被其它程序修改过
+ */
+bool SqliteLedgerStorage::isModifiedExternally() const
+{
+    return synced && readStamp() != stamp;
+}
+
+/**
+ * @brief 读取其它程序在本实例上次读写之后追加的记录（序号大于已同步的最大序号）
+ * @param records 追加的记录（输出参数）
+ * @return 数据库未变化或只是被追加时返回true；已有记录被改写时返回false
+ */
+bool SqliteLedgerStorage::readAppended(QVector<LedgerRecord> &records)
+{
+    lastError.clear();
+    records.clear();
+    // 只有读到追加的记录时才记下新的版本戳，失败后 acceptAppended 不会接受他人的改写
+    appendedStamp = Stamp();
+    const Stamp current = readStamp();
+    if (!synced || current == stamp) {
+        return true;
+    }
+    if (current.revision != stamp.revision || current.rows <= stamp.rows) {
+        lastError = "账本数据库已被其它程序修改";
+        return false;
+    }
+    records = select(" WHERE seq > ? AND seq <= ?", {stamp.rows, current.rows});
+    if (!lastError.isEmpty() || records.size() != current.rows - stamp.rows) {
+        if (lastError.isEmpty()) {
+            lastError = "账本数据库已被其它程序修改";
+        }
+        records.clear();
+        return false;
+    }
+    appendedStamp = current;
+    return true;
+}
+
+/**
+ * @brief 调用方已合并readAppended读到的记录，之后的写入以追加后的内容为准
+ */
+void SqliteLedgerStorage::acceptAppended()
+{
+    if (synced && appendedStamp.rows >= 0) {
+        stamp = appendedStamp;
+    }
+}
+
+/**
+ * @brief 获取本实例的数据库连接
+ */
+QSqlDatabase SqliteLedgerStorage::database() const
+{
+    return QSqlDatabase::database(connectionName, false);
+}
+
+/**
+ * @brief 读取数据库当前的版本戳
+ * @return 返回版本戳，读取失败时各项为-1
+ */
+SqliteLedgerStorage::Stamp SqliteLedgerStorage::readStamp() const
+{
+    Stamp current;
+    QSqlQuery query(database());
+    query.setForwardOnly(true);
+    // seq 为行号+1 且连续，最大序号即记录数，走主键B树而不扫描全表
+    if (query.exec("SELECT (SELECT revision FROM ledger_meta WHERE id = 0), (SELECT IFNULL(MAX(seq), 0) FROM records)")
+            && query.next()) {
+        current.revision = query.value(0).toLongLong();
+        current.rows = query.value(1).toLongLong();
+    }
+    return current;
+}
+
+/**
+ * @brief 写入前检查数据库自上次读写后没有被其它程序修改（须在写事务中调用）
+ * @return 未被修改返回true
+ */
+bool SqliteLedgerStorage::checkUnchanged()
+{
+    if (synced && readStamp() != stamp) {
+        lastError = "账本数据库已被其它程序修改，为避免覆盖他人的修改，本次未保存。\n请重新打开账本后再试！";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 在一个事务中检查版本戳并执行写操作，提交后记下新的版本戳
+ * @param write 写操作，失败时返回false（可设置lastError）
+ * @return 成功返回true，失败时事务回滚
+ */
+bool SqliteLedgerStorage::writeTransaction(const std::function<bool()> &write)
+{
+    lastError.clear();
+    QSqlDatabase db = database();
+    if (!db.transaction()) {
+        lastError = db.lastError().text();
+        return false;
+    }
+    // 检查之后若有其它连接先提交，本事务升级为写事务时会失败，不会覆盖对方的修改
+    const bool ok = checkUnchanged() && write();
+    const Stamp written = ok ? readStamp() : Stamp();
+    if (!ok || !db.commit()) {
+        if (lastError.isEmpty()) {
+            lastError = db.lastError().text();
+        }
+        db.rollback();
+        return false;
+    }
+    stamp = written;
+    synced = true;
+    return true;
+}
+
+/**
+ * @brief 执行一条不带参数的SQL语句
+ */
+bool SqliteLedgerStorage::exec(const QString &sql)
+{
+    QSqlQuery query(database());
+    if (!query.exec(sql)) {
+        return fail(query);
+    }
+    return true;
+}
+
+/**
+ * @brief 旧版本创建的数据库缺少某列时补上该列
+ * @param column 列名
+ * @param definition 列定义
+ */
+bool SqliteLedgerStorage::ensureColumn(const QString &column, const QString &definition)
+{
+    QSqlQuery query(database());
+    if (!query.exec("PRAGMA table_info(records)")) {
+        return fail(query);
+    }
+    while (query.next()) {
+        if (query.value(1).toString() == column) {
+            return true;
+        }
+    }
+    return exec(QString("ALTER TABLE records ADD COLUMN %1 %2").arg(column, definition));
+}
+
+/**
+ * @brief 用同一条预编译语句写入多条记录（调用方负责事务）
+ * @param firstRow 第一条记录的行号
+ * @param records 记录
+ */
+bool SqliteLedgerStorage::insertRecords(int firstRow, const QVector<LedgerRecord> &records)
+{
+    QSqlQuery query(database());
+    if (!query.prepare(QString("INSERT INTO records (%1) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)").arg(RecordColumns))) {
+        return fail(query);
+    }
+    for (int i = 0; i < records.size(); ++i) {
+        bindRecord(query, firstRow + i, records[i]);
+        if (!query.exec()) {
+            return fail(query);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 记录查询失败的错误信息
+ * @return 总是返回false
+ */
+bool SqliteLedgerStorage::fail(const QSqlQuery &query)
+{
+    lastError = query.lastError().text();
+    return false;
+}
+
+/**
+ * @brief 按RecordColumns的顺序绑定一条记录，序号为行号+1（与CSV一致）
+ */
+void SqliteLedgerStorage::bindRecord(QSqlQuery &query, int row, const LedgerRecord &record)
+{
+    query.bindValue(0, row + 1);
+    query.bindValue(1, dateKey(record.date));
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        query.bindValue(2 + i, record.hasAmount(i) ? QVariant(record.amounts[i])
+                                                   : QVariant(QMetaType::fromType<qint64>()));
+    }
+    query.bindValue(2 + LedgerAmountColumnCount, record.note);
+    query.bindValue(3 + LedgerAmountColumnCount, record.currency);
+}
+
+/**
+ * @brief 从查询结果的当前行读取一条记录
+ */
+LedgerRecord SqliteLedgerStorage::readRecord(const QSqlQuery &query)
+{
+    LedgerRecord record;
+    record.date = QDate::fromString(query.value(1).toString(), Qt::ISODate);
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        const QVariant value = query.value(2 + i);
+        if (!value.isNull()) {
+            record.amounts[i] = value.toLongLong();
+            record.presentMask |= (1u << i);
+        }
+    }
+    record.note = query.value(2 + LedgerAmountColumnCount).toString();
+    record.currency = query.value(3 + LedgerAmountColumnCount).toString();
+    return record;
+}
+
+/**
+ * @brief 按条件查询记录，条件中的参数按顺序绑定
+ * @param where 以" WHERE"开头的条件子句，可为空
+ * @param values 条件参数
+ */
+QVector<LedgerRecord> SqliteLedgerStorage::select(const QString &where, const QVariantList &values)
+{
+    QVector<LedgerRecord> records;
+    QSqlQuery query(database());
+    query.setForwardOnly(true);
+    if (!query.prepare(QString("SELECT %1 FROM records%2 ORDER BY seq").arg(RecordColumns, where))) {
+        fail(query);
+        return records;
+    }
+    for (int i = 0; i < values.size(); ++i) {
+        query.bindValue(i, values[i]);
+    }
+    if (!query.exec()) {
+        fail(query);
+        return records;
+    }
+    while (query.next()) {
+        records.append(readRecord(query));
+    }
+    return records;
+}
@@ -0,0 +1,92 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 18:20:44
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 18:20:44
+ * @Description: SQLite存储引擎
+ */
+#ifndef SQLITELEDGERSTORAGE_H
+#define SQLITELEDGERSTORAGE_H
+
+#include "ledgerstorage.h"
+#include <QSqlDatabase>
+#include <functional>
+
+class QSqlQuery;
+
+/*
+    使用 QtSql 自带的 QSQLITE 驱动：
+    - 打开时启用 WAL 日志（读写互不阻塞）并设置 synchronous=NORMAL；
+    - records 表以行号 seq 为主键（B 树），另有 date 与 total_deposit 索引，
+      追加、按行改写和范围查询都是 O(log n)；
+    - 金额以"分"为单位保存为 INTEGER，空单元格保存为 NULL；
+    - 所有写操作使用预编译语句，并在一个事务中批量提交。
+    每个实例使用独立的数据库连接名，可在不同线程中各自创建实例。
+
+    SQLite 只保证单条事务的原子性，不知道两次读写之间别的程序改过哪些行，
+    因此与 CsvLedgerStorage 一样做乐观并发控制：
+    - ledger_meta 表的 revision 在每次改写已有记录（writeAll/writeFrom/update）时加1，
+      版本戳由 revision 与最大序号组成；
+    - 写入事务先检查版本戳与上次读写时一致，不一致说明期间有人修改过，拒绝写入；
+    - 只有最大序号变大说明其它程序只追加了记录，readAppended 读出 seq 更大的记录，
+      调用方合并后用 acceptAppended 接受新的版本戳，再追加自己的记录。
+*/
+class SqliteLedgerStorage : public LedgerStorage
+{
+public:
+    /**
+     * @brief 构造函数，打开（不存在时创建）数据库文件并建立表结构
+     * @param filePath 数据库文件路径
+     */
+    explicit SqliteLedgerStorage(const QString &filePath);
+    ~SqliteLedgerStorage() override;
+
+    /**
+     * @brief 数据库是否已成功打开
+     */
+    bool isOpen() const;
+
+    Backend backend() const override { return SqliteBackend; }
+    bool readAll(QVector<LedgerRecord> &records) override;
+    bool writeAll(const QVector<LedgerRecord> &records) override;
+    bool readFrom(int firstRow, QVector<LedgerRecord> &records) override;
+    bool writeFrom(int firstRow, const QVector<LedgerRecord> &records) override;
+    bool append(int firstRow, const QVector<LedgerRecord> &records) override;
+    bool update(const QMap<int, LedgerRecord> &records) override;
+    QVector<LedgerRecord> query(const QDate &from, const QDate &to) override;
+    QVector<LedgerRecord> queryByTotalDeposit(qint64 minCents, qint64 maxCents) override;
+    bool isModifiedExternally() const override;
+    bool readAppended(QVector<LedgerRecord> &records) override;
+    void acceptAppended() override;
+
+private:
+    /**
+     * @brief 数据库版本戳：改写计数与最大序号
+     */
+    struct Stamp {
+        qint64 revision = -1;
+        qint64 rows = -1;
+        bool operator==(const Stamp &other) const { return revision == other.revision && rows == other.rows; }
+        bool operator!=(const Stamp &other) const { return !(*this == other); }
+    };
+
+    QString connectionName;             //!< 本实例独占的数据库连接名
+    bool opened = false;                //!< 是否已打开并建立表结构
+    Stamp stamp;                        //!< 上次与数据库同步时的版本戳
+    Stamp appendedStamp;                //!< readAppended 读到的版本戳，acceptAppended 后生效
+    bool synced = false;                //!< 是否已读写过数据库（此后写入前检查版本戳）
+
+    QSqlDatabase database() const;
+    Stamp readStamp() const;
+    bool checkUnchanged();
+    bool writeTransaction(const std::function<bool()> &write);
+    bool exec(const QString &sql);
+    bool ensureColumn(const QString &column, const QString &definition);
+    bool insertRecords(int firstRow, const QVector<LedgerRecord> &records);
+    bool fail(const QSqlQuery &query);
+    static void bindRecord(QSqlQuery &query, int row, const LedgerRecord &record);
+    static LedgerRecord readRecord(const QSqlQuery &query);
+    QVector<LedgerRecord> select(const QString &where, const QVariantList &values);
+};
+
+#endif // SQLITELEDGERSTORAGE_H
@@ -0,0 +1,72 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 17:20:05
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 17:20:05
+ * @Description: 以驻留句柄保存备注的表格单元格
+ */
+#include "noteitem.h"
+
+/**
+ * @brief 构造函数
+ * @param pool 驻留池（生命周期必须长于本单元格）
+ * @param text 备注文本
+ */
+NoteItem::NoteItem(NotePool *pool, const QString &text)
+    : pool(pool)
+    , noteHandle(pool->intern(text))
+{
+}
+
+NoteItem::~NoteItem()
+{
+    pool->release(noteHandle);
+}
+
+QVariant NoteItem::data(int role) const
+{
+    if (role == Qt::DisplayRole || role == Qt::EditRole) {
+        return pool->text(noteHandle);
+    }
+    return QStandardItem::data(role);
+}
+
+void NoteItem::setData(const QVariant &value, int role)
+{
+    if (role != Qt::DisplayRole && role != Qt::EditRole) {
+        QStandardItem::setData(value, role);
+        return;
+    }
+
+    NotePool::Handle handle = pool->intern(value.toString());
+    if (handle == noteHandle) {
+        pool->release(handle); // 文本未变化，抵消本次驻留
+        return;
+    }
+    pool->release(noteHandle);
+    noteHandle = handle;
+    emitDataChanged();
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+/**
+ * @brief Qt6 视图通过 multiData 一次读取多个角色，同样需要从驻留池取文本
+ */
+void NoteItem::multiData(QModelRoleDataSpan roleDataSpan) const
+{
+    QStandardItem::multiData(roleDataSpan);
+    for (QModelRoleData &roleData : roleDataSpan) {
+        if (roleData.role() == Qt::DisplayRole || roleData.role() == Qt::EditRole) {
+            roleData.setData(pool->text(noteHandle));
+        }
+    }
+}
+#endif
+
+QStandardItem *NoteItem::clone() const
+{
+    NoteItem *item = new NoteItem(pool);
+    item->noteHandle = noteHandle;
+    pool->retain(noteHandle);
+    return item;
+}
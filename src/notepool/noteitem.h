@@ -0,0 +1,49 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 17:20:05
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 17:20:05
+ * @Description: 以驻留句柄保存备注的表格单元格
+ */
+#ifndef NOTEITEM_H
+#define NOTEITEM_H
+
+#include <QStandardItem>
+#include "notepool.h"
+
+/**
+ * @brief 备注列单元格：自身只保存一个32位句柄，文本由 NotePool 提供。
+ *        显示/编辑角色的读写都经过驻留池，其它角色仍由 QStandardItem 保存。
+ */
+class NoteItem : public QStandardItem
+{
+public:
+    enum { Type = QStandardItem::UserType + 1 };
+
+    /**
+     * @brief 构造函数
+     * @param pool 驻留池（生命周期必须长于本单元格）
+     * @param text 备注文本
+     */
+    NoteItem(NotePool *pool, const QString &text = QString());
+    ~NoteItem() override;
+
+    int type() const override { return Type; }
+    QVariant data(int role = Qt::UserRole + 1) const override;
+    void setData(const QVariant &value, int role = Qt::UserRole + 1) override;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    void multiData(QModelRoleDataSpan roleDataSpan) const override;
+#endif
+    QStandardItem *clone() const override;
+
+    /**
+     * @brief 备注句柄，相同备注的句柄相同
+     */
+    NotePool::Handle handle() const { return noteHandle; }
+
+private:
+    NotePool *pool;                 //!< 驻留池
+    NotePool::Handle noteHandle;    //!< 备注句柄
+};
+
+#endif // NOTEITEM_H
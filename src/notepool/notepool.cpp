@@ -0,0 +1,201 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 17:20:05
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 17:20:05
+ * @Description: 备注字符串驻留池
+ */
+#include "notepool.h"
+#include <QHash>
+
+NotePool::NotePool()
+{
+    rehash(64);
+}
+
+/**
+ * @brief 驻留一个备注并增加引用计数
+ * @param text 备注文本
+ * @return 返回句柄，空文本返回 EmptyHandle
+ */
+NotePool::Handle NotePool::intern(QStringView text)
+{
+    if (text.isEmpty()) {
+        return EmptyHandle;
+    }
+
+    const size_t hash = qHash(text);
+    const qsizetype slot = findSlot(text, hash);
+    if (slot >= 0) {
+        Handle handle = buckets[slot];
+        ++entries[handle - 1].refCount;
+        return handle;
+    }
+
+    // 装载因子（含删除标记）超过 0.7 时先扩容
+    if ((usedSlots + 1) * 10 > buckets.size() * 7) {
+        rehash(buckets.size() * 2);
+    }
+
+    // 新备注：复用空闲句柄或分配新句柄，文本追加到 arena 末尾
+    Handle handle;
+    if (!freeHandles.isEmpty()) {
+        handle = freeHandles.takeLast();
+    } else {
+        entries.append(Entry());
+        handle = entries.size();
+    }
+    Entry &entry = entries[handle - 1];
+    entry.offset = arena.size();
+    entry.length = text.size();
+    entry.refCount = 1;
+    entry.hash = hash;
+    arena.append(text);
+    ++liveCount;
+    insertSlot(handle);
+    return handle;
+}
+
+/**
+ * @brief 查找已驻留的备注，不改变引用计数
+ * @return 返回句柄，不存在时返回 InvalidHandle
+ */
+NotePool::Handle NotePool::find(QStringView text) const
+{
+    if (text.isEmpty()) {
+        return EmptyHandle;
+    }
+    const qsizetype slot = findSlot(text, qHash(text));
+    return slot >= 0 ? buckets[slot] : InvalidHandle;
+}
+
+void NotePool::retain(Handle handle)
+{
+    if (handle != EmptyHandle && handle <= static_cast<Handle>(entries.size())) {
+        ++entries[handle - 1].refCount;
+    }
+}
+
+void NotePool::release(Handle handle)
+{
+    if (handle == EmptyHandle || handle > static_cast<Handle>(entries.size())) {
+        return;
+    }
+    Entry &entry = entries[handle - 1];
+    if (entry.refCount == 0 || --entry.refCount > 0) {
+        return;
+    }
+
+    // 引用归零：移出哈希表，句柄可复用，文本留作垃圾等待压缩
+    removeSlot(handle);
+    freeHandles.append(handle);
+    garbageChars += entry.length;
+    --liveCount;
+
+    if (garbageChars > 4096 && garbageChars * 2 > arena.size()) {
+        compact();
+    }
+}
+
+/**
+ * @brief 读取句柄对应的文本
+ */
+QString NotePool::text(Handle handle) const
+{
+    return view(handle).toString();
+}
+
+QStringView NotePool::view(Handle handle) const
+{
+    if (handle == EmptyHandle || handle > static_cast<Handle>(entries.size())) {
+        return QStringView();
+    }
+    const Entry &entry = entries[handle - 1];
+    return QStringView(arena).mid(entry.offset, entry.length);
+}
+
+/**
+ * @brief 压缩 arena，回收已释放备注占用的空间，句柄保持不变
+ */
+void NotePool::compact()
+{
+    QString packed;
+    packed.reserve(arena.size() - garbageChars);
+    for (Entry &entry : entries) {
+        if (entry.refCount == 0) {
+            entry.offset = entry.length = 0;
+            continue;
+        }
+        const quint32 offset = packed.size();
+        packed.append(QStringView(arena).mid(entry.offset, entry.length));
+        entry.offset = offset;
+    }
+    arena = packed;
+    arena.squeeze();
+    garbageChars = 0;
+
+    // 顺便清除哈希表中的删除标记
+    rehash(buckets.size());
+}
+
+qsizetype NotePool::findSlot(QStringView text, size_t hash) const
+{
+    const qsizetype mask = buckets.size() - 1;
+    for (qsizetype i = hash & mask;; i = (i + 1) & mask) {
+        const quint32 handle = buckets[i];
+        if (handle == EmptySlot) {
+            return -1;
+        }
+        if (handle == DeletedSlot) {
+            continue;
+        }
+        const Entry &entry = entries[handle - 1];
+        if (entry.hash == hash && view(handle) == text) {
+            return i;
+        }
+    }
+}
+
+void NotePool::insertSlot(Handle handle)
+{
+    const qsizetype mask = buckets.size() - 1;
+    for (qsizetype i = entries[handle - 1].hash & mask;; i = (i + 1) & mask) {
+        if (buckets[i] == EmptySlot || buckets[i] == DeletedSlot) {
+            if (buckets[i] == EmptySlot) {
+                ++usedSlots;
+            }
+            buckets[i] = handle;
+            return;
+        }
+    }
+}
+
+void NotePool::removeSlot(Handle handle)
+{
+    const qsizetype mask = buckets.size() - 1;
+    for (qsizetype i = entries[handle - 1].hash & mask;; i = (i + 1) & mask) {
+        if (buckets[i] == EmptySlot) {
+            return;
+        }
+        if (buckets[i] == handle) {
+            buckets[i] = DeletedSlot;
+            return;
+        }
+    }
+}
+
+void NotePool::rehash(int capacity)
+{
+    // 容量保持为2的幂，便于用掩码取模
+    int size = 64;
+    while (size < capacity || size * 7 < liveCount * 10) {
+        size *= 2;
+    }
+    buckets.fill(EmptySlot, size);
+    usedSlots = 0;
+    for (int i = 0; i < entries.size(); ++i) {
+        if (entries[i].refCount > 0) {
+            insertSlot(i + 1);
+        }
+    }
+}
@@ -0,0 +1,93 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 17:20:05
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 17:20:05
+ * @Description: 备注字符串驻留池
+ */
+#ifndef NOTEPOOL_H
+#define NOTEPOOL_H
+
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+/*
+    备注大多重复（空、房租、年终奖……），逐条保存 QString 浪费内存。
+    NotePool 把每个不同的备注只在一块连续的 UTF-16 区域（arena）中保存一次，
+    对外只暴露 32 位句柄：
+    - 句柄 0 固定表示空备注，不占用任何存储；
+    - 每个句柄带引用计数，计数归零后句柄进入空闲链表，文本留在 arena 中成为垃圾；
+    - 垃圾超过一半时自动压缩 arena，压缩只移动文本、更新偏移，句柄保持不变；
+    - 查找使用以句柄为槽位的开放寻址哈希表，比较备注只需比较句柄。
+*/
+class NotePool
+{
+public:
+    using Handle = quint32;
+    static constexpr Handle EmptyHandle = 0;    //!< 空备注
+    static constexpr Handle InvalidHandle = 0xFFFFFFFFu;
+
+    NotePool();
+
+    /**
+     * @brief 驻留一个备注并增加引用计数
+     * @param text 备注文本
+     * @return 返回句柄，空文本返回 EmptyHandle
+     */
+    Handle intern(QStringView text);
+
+    /**
+     * @brief 查找已驻留的备注，不改变引用计数
+     * @return 返回句柄，不存在时返回 InvalidHandle
+     */
+    Handle find(QStringView text) const;
+
+    void retain(Handle handle);
+    void release(Handle handle);
+
+    /**
+     * @brief 读取句柄对应的文本
+     */
+    QString text(Handle handle) const;
+    QStringView view(Handle handle) const;
+
+    /**
+     * @brief 压缩 arena，回收已释放备注占用的空间，句柄保持不变
+     */
+    void compact();
+
+    int uniqueCount() const { return liveCount; }
+    qsizetype arenaBytes() const { return arena.size() * qsizetype(sizeof(QChar)); }
+    qsizetype garbageBytes() const { return garbageChars * qsizetype(sizeof(QChar)); }
+
+private:
+    /**
+     * @brief 句柄对应的条目，下标 = 句柄 - 1
+     */
+    struct Entry
+    {
+        quint32 offset = 0;     //!< 文本在 arena 中的偏移
+        quint32 length = 0;     //!< 文本长度（QChar个数）
+        quint32 refCount = 0;   //!< 引用计数，0表示空闲
+        size_t hash = 0;        //!< 文本哈希值
+    };
+
+    static constexpr quint32 EmptySlot = 0;
+    static constexpr quint32 DeletedSlot = 0xFFFFFFFFu;
+
+    QString arena;              //!< 所有备注文本连续存放
+    QVector<Entry> entries;     //!< 句柄条目
+    QVector<Handle> freeHandles;//!< 可复用的句柄
+    QVector<quint32> buckets;   //!< 开放寻址哈希表，存放句柄
+    int usedSlots = 0;          //!< 已占用槽位（含删除标记）
+    int liveCount = 0;          //!< 存活的不同备注数量
+    qsizetype garbageChars = 0; //!< arena 中的垃圾字符数
+
+    qsizetype findSlot(QStringView text, size_t hash) const;
+    void insertSlot(Handle handle);
+    void removeSlot(Handle handle);
+    void rehash(int capacity);
+};
+
+#endif // NOTEPOOL_H
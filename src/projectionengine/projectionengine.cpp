@@ -0,0 +1,567 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 22:31:18
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 22:31:18
+ * @Description: 并行蒙特卡洛存款预测
+ */
+#include "projectionengine.h"
+#include "quantilesketch.h"
+#include <QMap>
+#include <QElapsedTimer>
+#include <cmath>
+#include <functional>
+#include <utility>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PROJECTIONENGINE_X86 1
+#include <immintrin.h>
+#endif
+
+const double ProjectionEngine::BandQuantiles[ProjectionEngine::BandCount] = { 0.05, 0.25, 0.50, 0.75, 0.95 };
+
+namespace {
+
+constexpr int LaneCount = 1024;             //!< 每组同时推进的路径数
+constexpr int ChunkPaths = 16 * LaneCount;  //!< 每个并行块的路径数
+constexpr int BaseWindow = 12;              //!< 工资、开支基数取最近的记录数
+constexpr int NoiseWindow = 36;             //!< 结余波动取最近的记录数
+
+/**
+ * @brief Philox4x32-10 计数器型随机数：同一(计数器, 密钥)总是得到同样的4个32位随机数
+ * @param c 计数器，输出时为随机数
+ * @param k0 密钥低32位
+ * @param k1 密钥高32位
+ */
+inline void philox4x32(quint32 c[4], quint32 k0, quint32 k1)
+{
+    for (int round = 0; round < 10; ++round) {
+        const quint64 p0 = quint64(0xD2511F53u) * c[0];
+        const quint64 p1 = quint64(0xCD9E8D57u) * c[2];
+        const quint32 n0 = quint32(p1 >> 32) ^ c[1] ^ k0;
+        const quint32 n2 = quint32(p0 >> 32) ^ c[3] ^ k1;
+        c[0] = n0;
+        c[1] = quint32(p1);
+        c[2] = n2;
+        c[3] = quint32(p0);
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+}
+
+/**
+ * @brief 取4个32位随机数各自的低16位或高16位作为均匀数，得到近似标准正态数（Irwin-Hall：4个均匀数之和标准化）
+ * @param r 随机数
+ * @param shift 0 取低16位，16 取高16位
+ */
+inline double approximateNormal(const quint32 r[4], int shift)
+{
+    constexpr double scale = 1.0 / 65536.0;
+    const quint32 sum = ((r[0] >> shift) & 0xFFFFu) + ((r[1] >> shift) & 0xFFFFu)
+                      + ((r[2] >> shift) & 0xFFFFu) + ((r[3] >> shift) & 0xFFFFu);
+    return (sum * scale - 2.0) * 1.7320508075688772;
+}
+
+/**
+ * @brief 由4个32位随机数得到两个精确的标准正态数（Box-Muller）
+ */
+inline void exactNormals(const quint32 r[4], double &z0, double &z1)
+{
+    constexpr double scale = 1.0 / 4294967296.0;
+    const double u0 = (double(r[0]) + 1.0) * scale;      // (0, 1]
+    const double u1 = double(r[1]) * scale;
+    const double radius = std::sqrt(-2.0 * std::log(u0));
+    z0 = radius * std::cos(6.283185307179586 * u1);
+    z1 = radius * std::sin(6.283185307179586 * u1);
+}
+
+// ---------------- 逐月推进的内核 ----------------
+
+using NoiseFn = void (*)(quint64, int, quint32, quint32, quint32, double *, double *);
+using StepFn = void (*)(double *, double *, double *, const double *, const double *, const double *, int, double, double);
+
+/**
+ * @brief 为一组路径生成相邻两个月的噪声：一次 Philox 调用的128位拆成两组16位均匀数
+ * @param firstPath 首条路径编号
+ * @param lanes 路径数
+ * @param counter 月份对（(月份 - 1) / 2）
+ * @param k0 密钥低32位
+ * @param k1 密钥高32位
+ * @param noise 第一个月的噪声（输出）
+ * @param nextNoise 第二个月的噪声（输出）
+ */
+void noiseScalar(quint64 firstPath, int lanes, quint32 counter, quint32 k0, quint32 k1, double *noise, double *nextNoise)
+{
+    for (int i = 0; i < lanes; ++i) {
+        const quint64 path = firstPath + quint64(i);
+        quint32 r[4] = { quint32(path), quint32(path >> 32), counter, 0u };
+        philox4x32(r, k0, k1);
+        noise[i] = approximateNormal(r, 0);
+        nextNoise[i] = approximateNormal(r, 16);
+    }
+}
+
+/**
+ * @brief 推进一个月：工资、开支按各自的月增长倍数复利，余额加上结余与波动
+ */
+void stepScalar(double *balance, double *salary, double *expense, const double *salaryStep, const double *expenseStep,
+                const double *noise, int lanes, double noiseFixed, double noisePerSalary)
+{
+    for (int i = 0; i < lanes; ++i) {
+        salary[i] *= salaryStep[i];
+        expense[i] *= expenseStep[i];
+        balance[i] += salary[i] - expense[i] + (noiseFixed + noisePerSalary * salary[i]) * noise[i];
+    }
+}
+
+#ifdef PROJECTIONENGINE_X86
+
+// ---------------- AVX2 实现（噪声每次8条路径，推进每次4条路径） ----------------
+
+/**
+ * @brief 8个32位整数两两相乘，得到乘积的高32位和低32位
+ */
+__attribute__((target("avx2")))
+inline void mulhilo8(__m256i a, __m256i m, __m256i &hi, __m256i &lo)
+{
+    const __m256i even = _mm256_mul_epu32(a, m);
+    const __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+    lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+    hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+}
+
+/**
+ * @brief 8个16位均匀数之和标准化为近似正态数，写出8个double
+ */
+__attribute__((target("avx2")))
+inline void storeNormals8(__m256i sum, double *out)
+{
+    const __m256d scale = _mm256_set1_pd(1.0 / 65536.0);
+    const __m256d two = _mm256_set1_pd(2.0);
+    const __m256d sqrt3 = _mm256_set1_pd(1.7320508075688772);
+    const __m256d low = _mm256_cvtepi32_pd(_mm256_castsi256_si128(sum));
+    const __m256d high = _mm256_cvtepi32_pd(_mm256_extracti128_si256(sum, 1));
+    _mm256_storeu_pd(out, _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(low, scale), two), sqrt3));
+    _mm256_storeu_pd(out + 4, _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(high, scale), two), sqrt3));
+}
+
+__attribute__((target("avx2")))
+void noiseAvx2(quint64 firstPath, int lanes, quint32 counter, quint32 k0, quint32 k1, double *noise, double *nextNoise)
+{
+    const __m256i m0 = _mm256_set1_epi32(int(0xD2511F53u));
+    const __m256i m1 = _mm256_set1_epi32(int(0xCD9E8D57u));
+    const __m256i mask = _mm256_set1_epi32(0xFFFF);
+
+    int i = 0;
+    for (; i + 8 <= lanes; i += 8) {
+        // MinGW-w64 的GCC不能保证栈上变量的32字节对齐（GCC bug 54412），用非对齐读取
+        quint32 pathLow[8];
+        quint32 pathHigh[8];
+        for (int lane = 0; lane < 8; ++lane) {
+            const quint64 path = firstPath + quint64(i + lane);
+            pathLow[lane] = quint32(path);
+            pathHigh[lane] = quint32(path >> 32);
+        }
+        __m256i c0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pathLow));
+        __m256i c1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pathHigh));
+        __m256i c2 = _mm256_set1_epi32(int(counter));
+        __m256i c3 = _mm256_setzero_si256();
+        quint32 key0 = k0;
+        quint32 key1 = k1;
+        for (int round = 0; round < 10; ++round) {
+            __m256i hi0, lo0, hi1, lo1;
+            mulhilo8(c0, m0, hi0, lo0);
+            mulhilo8(c2, m1, hi1, lo1);
+            c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), _mm256_set1_epi32(int(key0)));
+            c1 = lo1;
+            c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), _mm256_set1_epi32(int(key1)));
+            c3 = lo0;
+            key0 += 0x9E3779B9u;
+            key1 += 0xBB67AE85u;
+        }
+
+        const __m256i lowSum = _mm256_add_epi32(
+            _mm256_add_epi32(_mm256_and_si256(c0, mask), _mm256_and_si256(c1, mask)),
+            _mm256_add_epi32(_mm256_and_si256(c2, mask), _mm256_and_si256(c3, mask)));
+        const __m256i highSum = _mm256_add_epi32(
+            _mm256_add_epi32(_mm256_srli_epi32(c0, 16), _mm256_srli_epi32(c1, 16)),
+            _mm256_add_epi32(_mm256_srli_epi32(c2, 16), _mm256_srli_epi32(c3, 16)));
+        storeNormals8(lowSum, noise + i);
+        storeNormals8(highSum, nextNoise + i);
+    }
+    noiseScalar(firstPath + quint64(i), lanes - i, counter, k0, k1, noise + i, nextNoise + i);
+}
+
+__attribute__((target("avx2")))
+void stepAvx2(double *balance, double *salary, double *expense, const double *salaryStep, const double *expenseStep,
+              const double *noise, int lanes, double noiseFixed, double noisePerSalary)
+{
+    const __m256d fixed = _mm256_set1_pd(noiseFixed);
+    const __m256d perSalary = _mm256_set1_pd(noisePerSalary);
+    int i = 0;
+    for (; i + 4 <= lanes; i += 4) {
+        const __m256d s = _mm256_mul_pd(_mm256_loadu_pd(salary + i), _mm256_loadu_pd(salaryStep + i));
+        const __m256d e = _mm256_mul_pd(_mm256_loadu_pd(expense + i), _mm256_loadu_pd(expenseStep + i));
+        const __m256d amplitude = _mm256_add_pd(fixed, _mm256_mul_pd(perSalary, s));
+        const __m256d delta = _mm256_add_pd(_mm256_sub_pd(s, e), _mm256_mul_pd(amplitude, _mm256_loadu_pd(noise + i)));
+        _mm256_storeu_pd(salary + i, s);
+        _mm256_storeu_pd(expense + i, e);
+        _mm256_storeu_pd(balance + i, _mm256_add_pd(_mm256_loadu_pd(balance + i), delta));
+    }
+    stepScalar(balance + i, salary + i, expense + i, salaryStep + i, expenseStep + i, noise + i,
+               lanes - i, noiseFixed, noisePerSalary);
+}
+
+#endif // PROJECTIONENGINE_X86
+
+/**
+ * @brief 模拟内核函数表
+ */
+struct Kernel
+{
+    const char *name;
+    NoiseFn noise;
+    StepFn step;
+};
+
+Kernel selectKernel()
+{
+#ifdef PROJECTIONENGINE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {"avx2", noiseAvx2, stepAvx2};
+    }
+#endif
+    return {"scalar", noiseScalar, stepScalar};
+}
+
+/**
+ * @brief 首次使用时检测CPU并固定内核
+ */
+const Kernel &activeKernel()
+{
+    static const Kernel kernel = selectKernel();
+    return kernel;
+}
+
+/**
+ * @brief 样本均值与标准差（样本数不足2时标准差为0）
+ */
+void meanAndStd(const double *values, int count, double &mean, double &std)
+{
+    mean = 0.0;
+    std = 0.0;
+    if (count <= 0) {
+        return;
+    }
+    for (int i = 0; i < count; ++i) {
+        mean += values[i];
+    }
+    mean /= count;
+    if (count < 2) {
+        return;
+    }
+    double squares = 0.0;
+    for (int i = 0; i < count; ++i) {
+        squares += (values[i] - mean) * (values[i] - mean);
+    }
+    std = std::sqrt(squares / (count - 1));
+}
+
+/**
+ * @brief 最近 window 个值的均值
+ */
+double recentMean(const QVector<double> &values, int window)
+{
+    const int count = qMin(window, values.size());
+    double mean = 0.0;
+    double std = 0.0;
+    meanAndStd(values.constData() + values.size() - count, count, mean, std);
+    return mean;
+}
+
+/**
+ * @brief 由各年均值拟合年化对数增长率，历史不足时保留默认值
+ * @param byYear 年份 → (金额之和, 记录数)
+ * @param mean 增长率均值（输入为默认值）
+ * @param std 增长率标准差（输入为默认值）
+ */
+void fitGrowth(const QMap<int, QPair<double, int>> &byYear, double &mean, double &std)
+{
+    QVector<double> rates;
+    int previousYear = 0;
+    double previousMean = 0.0;
+    for (auto it = byYear.constBegin(); it != byYear.constEnd(); ++it) {
+        const double yearMean = it.value().first / it.value().second;
+        if (previousMean > 0.0 && yearMean > 0.0 && it.key() == previousYear + 1) {
+            rates.append(std::log(yearMean / previousMean));
+        }
+        previousYear = it.key();
+        previousMean = yearMean;
+    }
+
+    double rateMean = 0.0;
+    double rateStd = 0.0;
+    meanAndStd(rates.constData(), rates.size(), rateMean, rateStd);
+    if (!rates.isEmpty()) {
+        mean = qBound(-0.3, rateMean, 0.3);
+    }
+    if (rates.size() >= 2) {
+        std = qBound(0.01, rateStd, 0.2);
+    }
+}
+
+/**
+ * @brief 并行块：一段连续编号的路径
+ */
+struct Chunk
+{
+    qint64 first = 0;   //!< 首条路径编号
+    int count = 0;      //!< 路径数
+};
+
+/**
+ * @brief 一次模拟的采样时点与分块，由各子任务共享只读
+ */
+struct Plan
+{
+    int months = 0;                 //!< 模拟月数
+    int stepMonths = 0;             //!< 分位线的时间间隔（月）
+    QVector<int> sampleSlot;        //!< 各月份对应的采样下标，-1 表示不采样
+    QVector<int> sampleMonths;      //!< 各采样时点的月份
+    QVector<Chunk> chunks;          //!< 路径分块
+};
+
+/**
+ * @brief 确定采样时点并把路径分块
+ * @param years 预测年数
+ * @param paths 路径数
+ * @param stepMonths 分位线的时间间隔（月）
+ */
+Plan makePlan(int years, qint64 paths, int stepMonths)
+{
+    Plan plan;
+    plan.months = years * 12;
+    plan.stepMonths = qBound(1, stepMonths, 12);
+
+    // 每 stepMonths 个月及最后一个月采样一次
+    plan.sampleSlot.fill(-1, plan.months + 1);
+    for (int month = 1; month <= plan.months; ++month) {
+        if (month % plan.stepMonths == 0 || month == plan.months) {
+            plan.sampleSlot[month] = plan.sampleMonths.size();
+            plan.sampleMonths.append(month);
+        }
+    }
+
+    for (qint64 first = 0; first < paths; first += ChunkPaths) {
+        Chunk chunk;
+        chunk.first = first;
+        chunk.count = int(qMin<qint64>(ChunkPaths, paths - first));
+        plan.chunks.append(chunk);
+    }
+    return plan;
+}
+
+/**
+ * @brief 模拟一个块内的全部路径，把采样时点的余额插入该块的草图
+ * @param p 模拟参数
+ * @param chunk 路径范围
+ * @param months 模拟月数
+ * @param sampleSlot 各月份对应的采样下标，-1 表示不采样
+ * @param sampleCount 采样时点数（不含起点）
+ * @param seed 随机数种子
+ * @param token 取消标记
+ */
+QVector<QuantileSketch> simulateChunk(const ProjectionEngine::Parameters &p, const Chunk &chunk, int months,
+                                      const QVector<int> &sampleSlot, int sampleCount, quint64 seed,
+                                      const TaskScheduler::CancellationToken &token)
+{
+    QVector<QuantileSketch> sketches(sampleCount);
+    const quint32 k0 = quint32(seed);
+    const quint32 k1 = quint32(seed >> 32);
+
+    // 波动随工资水平同比例放大；没有工资记录时保持固定幅度
+    const double noisePerSalary = p.salary > 0.0 ? p.monthlyNoiseStd / p.salary : 0.0;
+    const double noiseFixed = p.salary > 0.0 ? 0.0 : p.monthlyNoiseStd;
+
+    QVector<double> balanceBuffer(LaneCount), salaryBuffer(LaneCount), expenseBuffer(LaneCount);
+    QVector<double> salaryStepBuffer(LaneCount), expenseStepBuffer(LaneCount);
+    QVector<double> noiseBuffer(LaneCount), nextNoiseBuffer(LaneCount);
+    double *balance = balanceBuffer.data();
+    double *salary = salaryBuffer.data();
+    double *expense = expenseBuffer.data();
+    double *salaryStep = salaryStepBuffer.data();
+    double *expenseStep = expenseStepBuffer.data();
+    double *noise = noiseBuffer.data();
+    double *nextNoise = nextNoiseBuffer.data();
+    const Kernel &kernel = activeKernel();
+
+    for (int base = 0; base < chunk.count; base += LaneCount) {
+        if (token.isCancelled()) {
+            return QVector<QuantileSketch>();
+        }
+        const int lanes = qMin(LaneCount, chunk.count - base);
+        const qint64 firstPath = chunk.first + base;
+
+        // 每条路径抽取自己的年增长率，换算为月增长倍数（计数器第4个字为1，与逐月随机数区分）
+        for (int i = 0; i < lanes; ++i) {
+            const quint64 path = quint64(firstPath + i);
+            quint32 r[4] = { quint32(path), quint32(path >> 32), 0u, 1u };
+            philox4x32(r, k0, k1);
+            double zSalary = 0.0;
+            double zExpense = 0.0;
+            exactNormals(r, zSalary, zExpense);
+            salaryStep[i] = std::exp((p.salaryGrowthMean + p.salaryGrowthStd * zSalary) / 12.0);
+            expenseStep[i] = std::exp((p.expenseGrowthMean + p.expenseGrowthStd * zExpense) / 12.0);
+            balance[i] = p.startBalance;
+            salary[i] = p.salary;
+            expense[i] = p.expense;
+        }
+
+        // 逐月推进：奇数月生成本月和下月的噪声，再在结构数组上推进全部路径
+        for (int month = 1; month <= months; ++month) {
+            if ((month - 1) % 2 == 0) {
+                kernel.noise(quint64(firstPath), lanes, quint32((month - 1) / 2), k0, k1, noise, nextNoise);
+            } else {
+                std::swap(noise, nextNoise);
+            }
+            kernel.step(balance, salary, expense, salaryStep, expenseStep, noise, lanes, noiseFixed, noisePerSalary);
+            const int slot = sampleSlot[month];
+            if (slot >= 0) {
+                sketches[slot].add(balance, lanes);
+            }
+        }
+    }
+    return sketches;
+}
+
+} // namespace
+
+/**
+ * @brief 由账本快照拟合模拟参数
+ * @param snapshot 账本快照
+ * @param factors 每行换算到报表币种的系数，NaN表示缺少汇率（该行不参与拟合），为空表示不换算
+ */
+ProjectionEngine::Parameters ProjectionEngine::fit(const LedgerSnapshot &snapshot, const QVector<double> &factors)
+{
+    Parameters p;
+    QVector<double> salaries, expenses, nets;
+    QMap<int, QPair<double, int>> salaryByYear, expenseByYear;
+    const int totalIndex = ColTotalDeposit - ColTotalDeposit;
+    const int salaryIndex = ColSalary - ColTotalDeposit;
+    const int expenseIndex = ColExpense - ColTotalDeposit;
+
+    for (int row = 0; row < snapshot.rowCount(); ++row) {
+        const LedgerRecord &record = snapshot.record(row);
+        const double factor = row < factors.size() ? factors[row] : 1.0;
+        if (!record.date.isValid() || std::isnan(factor)) {
+            continue;
+        }
+        ++p.historyRecords;
+
+        if (record.hasAmount(totalIndex) && (!p.startDate.isValid() || record.date >= p.startDate)) {
+            p.startDate = record.date;
+            p.startBalance = record.amount(totalIndex) * factor;
+        }
+
+        const int year = record.date.year();
+        if (record.hasAmount(salaryIndex)) {
+            const double value = record.amount(salaryIndex) * factor;
+            salaries.append(value);
+            salaryByYear[year].first += value;
+            ++salaryByYear[year].second;
+        }
+        if (record.hasAmount(expenseIndex)) {
+            const double value = record.amount(expenseIndex) * factor;
+            expenses.append(value);
+            expenseByYear[year].first += value;
+            ++expenseByYear[year].second;
+        }
+        if (record.hasAmount(salaryIndex) && record.hasAmount(expenseIndex)) {
+            nets.append((record.amount(salaryIndex) - record.amount(expenseIndex)) * factor);
+        }
+    }
+
+    p.salary = recentMean(salaries, BaseWindow);
+    p.expense = recentMean(expenses, BaseWindow);
+    fitGrowth(salaryByYear, p.salaryGrowthMean, p.salaryGrowthStd);
+    fitGrowth(expenseByYear, p.expenseGrowthMean, p.expenseGrowthStd);
+
+    const int noiseCount = qMin(NoiseWindow, nets.size());
+    double netMean = 0.0;
+    meanAndStd(nets.constData() + nets.size() - noiseCount, noiseCount, netMean, p.monthlyNoiseStd);
+    return p;
+}
+
+/**
+ * @brief 把模拟拆成一批子任务提交到调度器，全部完成后合并草图并输出分位线
+ * @param scheduler 任务调度器
+ * @param key 任务键，同一键下的旧模拟被取消
+ * @param priority 优先级
+ * @param parameters 模拟参数
+ * @param years 预测年数
+ * @param paths 路径数
+ * @param stepMonths 分位线的时间间隔（月）
+ * @param seed 随机数种子
+ * @param done 在GUI线程中调用的回调，参数为预测结果
+ * @return 返回任务编号
+ */
+quint64 ProjectionEngine::submit(TaskScheduler *scheduler, const QString &key, TaskScheduler::Priority priority,
+                                 const Parameters &parameters, int years, qint64 paths, int stepMonths, quint64 seed,
+                                 std::function<void(const Result &)> done)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!parameters.isValid() || years <= 0 || paths <= 0) {
+        Result result;
+        result.parameters = parameters;
+        return scheduler->submit(key, priority, [result](const TaskScheduler::CancellationToken &) { return result; },
+                                 done);
+    }
+
+    // 每块一个子任务，按调用者的优先级与其它任务一起排队，不另占线程
+    QSharedPointer<const Plan> plan = QSharedPointer<const Plan>::create(makePlan(years, paths, stepMonths));
+    return scheduler->submitBatch(
+        key, priority, plan->chunks.size(),
+        [parameters, plan, seed](int index, const TaskScheduler::CancellationToken &token) {
+            return simulateChunk(parameters, plan->chunks[index], plan->months, plan->sampleSlot,
+                                 plan->sampleMonths.size(), seed, token);
+        },
+        [parameters, plan, paths, timer](const QVector<QVector<QuantileSketch>> &chunkSketches,
+                                         const TaskScheduler::CancellationToken &token) {
+            Result result;
+            result.parameters = parameters;
+            if (token.isCancelled()) {
+                result.cancelled = true;
+                return result;
+            }
+
+            // 合并各块的草图
+            const int sampleCount = plan->sampleMonths.size();
+            QVector<QuantileSketch> merged(sampleCount);
+            for (const QVector<QuantileSketch> &sketches : chunkSketches) {
+                for (int slot = 0; slot < sketches.size(); ++slot) {
+                    merged[slot].merge(sketches[slot]);
+                }
+            }
+
+            result.paths = paths;
+            result.stepMonths = plan->stepMonths;
+            result.dates.reserve(sampleCount + 1);
+            result.dates.append(parameters.startDate);
+            for (int band = 0; band < BandCount; ++band) {
+                result.bands[band].reserve(sampleCount + 1);
+                result.bands[band].append(parameters.startBalance);
+            }
+            for (int slot = 0; slot < sampleCount; ++slot) {
+                result.dates.append(parameters.startDate.addMonths(plan->sampleMonths[slot]));
+                for (int band = 0; band < BandCount; ++band) {
+                    result.bands[band].append(merged[slot].quantile(BandQuantiles[band]));
+                }
+            }
+            result.elapsedMs = timer.elapsed();
+            return result;
+        },
+        done);
+}
@@ -0,0 +1,328 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 20:41:26
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 20:41:26
+ * @Description: 可合并的流式分位数草图（KLL）
+ */
+#include "quantilesketch.h"
+#include <QDataStream>
+#include <QIODevice>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const quint32 SketchMagic = 0x4B4C4C31; // "KLL1"
+const int MinLevelCapacity = 2;
+
+} // namespace
+
+/**
+ * @brief 构造函数
+ * @param k 精度参数，越大越精确、占用内存越多
+ */
+QuantileSketch::QuantileSketch(int k)
+    : k(qMax(8, k))
+{
+    levels.resize(1);
+    updateCapacity();
+}
+
+/**
+ * @brief 清空草图
+ */
+void QuantileSketch::clear()
+{
+    n = 0;
+    minValue = 0;
+    maxValue = 0;
+    levels.clear();
+    levels.resize(1);
+    retainedCount = 0;
+    updateCapacity();
+    sortedValid = false;
+}
+
+/**
+ * @brief 第 level 层的容量：越靠近顶层越大，顶层为 k
+ */
+int QuantileSketch::levelCapacity(int level) const
+{
+    const int depth = levels.size() - 1 - level;
+    return qMax(MinLevelCapacity, static_cast<int>(std::ceil(k * std::pow(2.0 / 3.0, depth))));
+}
+
+/**
+ * @brief 层数变化后重新计算并缓存各层容量（压缩时频繁查询，避免每次调用 pow）
+ */
+void QuantileSketch::updateCapacity()
+{
+    capacities.resize(levels.size());
+    totalCapacity = 0;
+    for (int level = 0; level < levels.size(); ++level) {
+        capacities[level] = levelCapacity(level);
+        totalCapacity += capacities[level];
+    }
+}
+
+/**
+ * @brief 压缩时选择保留奇数位还是偶数位（xorshift64）
+ */
+int QuantileSketch::nextCoin()
+{
+    coinState ^= coinState << 13;
+    coinState ^= coinState >> 7;
+    coinState ^= coinState << 17;
+    return static_cast<int>(coinState >> 63);
+}
+
+/**
+ * @brief 插入一个值，摊还 O(log k)
+ * @param value 值，NaN 被忽略
+ */
+void QuantileSketch::add(double value)
+{
+    if (std::isnan(value)) {
+        return;
+    }
+    if (n == 0) {
+        minValue = maxValue = value;
+    } else {
+        minValue = qMin(minValue, value);
+        maxValue = qMax(maxValue, value);
+    }
+    ++n;
+    levels[0].append(value);
+    ++retainedCount;
+    sortedValid = false;
+    if (retainedCount > totalCapacity) {
+        compress();
+    }
+}
+
+/**
+ * @brief 批量插入，全部放入最低层后只压缩一次
+ * @param values 值数组，NaN 被忽略
+ * @param count 值个数
+ */
+void QuantileSketch::add(const double *values, int count)
+{
+    QVector<double> &bottom = levels[0];
+    bottom.reserve(bottom.size() + count);
+    for (int i = 0; i < count; ++i) {
+        const double value = values[i];
+        if (std::isnan(value)) {
+            continue;
+        }
+        if (n == 0) {
+            minValue = maxValue = value;
+        } else {
+            minValue = qMin(minValue, value);
+            maxValue = qMax(maxValue, value);
+        }
+        ++n;
+        bottom.append(value);
+        ++retainedCount;
+    }
+    sortedValid = false;
+    if (retainedCount > totalCapacity) {
+        compress();
+    }
+}
+
+/**
+ * @brief 从最低的满层开始压缩，直到总保留量不超过总容量
+ */
+void QuantileSketch::compress()
+{
+    while (retainedCount > totalCapacity) {
+        int level = 0;
+        while (level < levels.size() && levels[level].size() < capacity(level)) {
+            ++level;
+        }
+        if (level == levels.size()) {
+            break;
+        }
+        if (level + 1 == levels.size()) {
+            // 增加一层后下层容量随之缩小
+            levels.append(QVector<double>());
+            updateCapacity();
+        }
+
+        QVector<double> &buffer = levels[level];
+        QVector<double> &upper = levels[level + 1];
+        std::sort(buffer.begin(), buffer.end());
+
+        // 个数为奇数时最小值留在本层，其余两两一组晋升其中一个
+        const int keep = buffer.size() % 2;
+        const int pairs = (buffer.size() - keep) / 2;
+        const int offset = nextCoin();
+        upper.reserve(upper.size() + pairs);
+        for (int i = keep + offset; i < buffer.size(); i += 2) {
+            upper.append(buffer[i]);
+        }
+        buffer.resize(keep);
+        retainedCount -= pairs;
+    }
+}
+
+/**
+ * @brief 把另一个草图合并进来，合并后等价于对两组数据共同建立的草图
+ * @param other 另一个草图
+ */
+void QuantileSketch::merge(const QuantileSketch &other)
+{
+    if (other.n == 0) {
+        return;
+    }
+    if (n == 0) {
+        minValue = other.minValue;
+        maxValue = other.maxValue;
+    } else {
+        minValue = qMin(minValue, other.minValue);
+        maxValue = qMax(maxValue, other.maxValue);
+    }
+    n += other.n;
+
+    if (levels.size() < other.levels.size()) {
+        levels.resize(other.levels.size());
+    }
+    for (int level = 0; level < other.levels.size(); ++level) {
+        levels[level] += other.levels[level];
+    }
+    retainedCount += other.retainedCount;
+    sortedValid = false;
+    updateCapacity();
+    compress();
+}
+
+/**
+ * @brief 各层的值按值排序并附带权重，查询时使用
+ */
+const QVector<QPair<double, qint64>> &QuantileSketch::sortedView() const
+{
+    if (sortedValid) {
+        return sorted;
+    }
+    sorted.clear();
+    sorted.reserve(retainedCount);
+    for (int level = 0; level < levels.size(); ++level) {
+        const qint64 weight = qint64(1) << level;
+        for (double value : levels[level]) {
+            sorted.append(qMakePair(value, weight));
+        }
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const QPair<double, qint64> &a, const QPair<double, qint64> &b) {
+        return a.first < b.first;
+    });
+    sortedValid = true;
+    return sorted;
+}
+
+/**
+ * @brief 估算分位数
+ * @param q 分位点，0 ~ 1（0.5 为中位数）
+ * @return 返回分位数，草图为空时返回NaN
+ */
+double QuantileSketch::quantile(double q) const
+{
+    if (n == 0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    if (q <= 0) {
+        return minValue;
+    }
+    if (q >= 1) {
+        return maxValue;
+    }
+
+    // 压缩时两两合并为一个双倍权重的值，各层权重之和始终等于 n
+    const double target = q * n;
+    qint64 cumulative = 0;
+    for (const auto &item : sortedView()) {
+        cumulative += item.second;
+        if (cumulative >= target) {
+            return item.first;
+        }
+    }
+    return maxValue;
+}
+
+/**
+ * @brief 估算不大于某值的数据所占比例
+ * @param value 值
+ * @return 返回 0 ~ 1 的比例，草图为空时返回0
+ */
+double QuantileSketch::rank(double value) const
+{
+    if (n == 0) {
+        return 0;
+    }
+    qint64 below = 0;
+    for (const auto &item : sortedView()) {
+        if (item.first > value) {
+            break;
+        }
+        below += item.second;
+    }
+    return double(below) / n;
+}
+
+/**
+ * @brief 序列化草图，用于在账本之间传递后合并
+ */
+QByteArray QuantileSketch::toByteArray() const
+{
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_15);
+    out << SketchMagic << qint32(k) << n << minValue << maxValue << qint32(levels.size());
+    for (const QVector<double> &level : levels) {
+        out << level;
+    }
+    return data;
+}
+
+/**
+ * @brief 从序列化数据恢复草图
+ * @param data toByteArray的输出
+ * @param ok 成功时输出true
+ */
+QuantileSketch QuantileSketch::fromByteArray(const QByteArray &data, bool *ok)
+{
+    if (ok) {
+        *ok = false;
+    }
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_15);
+
+    quint32 magic = 0;
+    qint32 k = 0;
+    in >> magic >> k;
+    if (magic != SketchMagic || k <= 0) {
+        return QuantileSketch();
+    }
+    QuantileSketch sketch(k);
+    qint32 levelCount = 0;
+    in >> sketch.n >> sketch.minValue >> sketch.maxValue >> levelCount;
+    if (in.status() != QDataStream::Ok || levelCount <= 0 || levelCount > 62) {
+        return QuantileSketch();
+    }
+    sketch.levels.resize(levelCount);
+    sketch.retainedCount = 0;
+    for (QVector<double> &level : sketch.levels) {
+        in >> level;
+        sketch.retainedCount += level.size();
+    }
+    if (in.status() != QDataStream::Ok) {
+        return QuantileSketch();
+    }
+    sketch.updateCapacity();
+    sketch.compress();
+    if (ok) {
+        *ok = true;
+    }
+    return sketch;
+}
@@ -0,0 +1,116 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 20:41:26
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 20:41:26
+ * @Description: 可合并的流式分位数草图（KLL）
+ */
+#ifndef QUANTILESKETCH_H
+#define QUANTILESKETCH_H
+
+#include <QVector>
+#include <QByteArray>
+#include <QPair>
+
+/*
+    KLL 草图把数据分层保存：第 h 层的每个值代表 2^h 个原始值。
+    新值追加到第 0 层；某层超过容量时排序，随机选取奇数位或偶数位的一半
+    晋升到上一层，另一半丢弃（压缩）。第 h 层的容量为 k·(2/3)^(H-1-h)（至少2），
+    H 为层数，因此总保留量约为 3k，与数据量无关。
+    压缩时对大小约为 k 的层排序，摊还到每次插入为 O(log k)；
+    秩误差约为 1.65/k（k = 200 时约 1%）。
+    两个草图逐层拼接后再压缩即完成合并，可以跨年份、跨分类、跨账本汇总，
+    toByteArray/fromByteArray 用于在账本之间传递草图。
+    值较少（不超过容量）时草图不会压缩，分位数是精确的。
+*/
+class QuantileSketch
+{
+public:
+    /**
+     * @brief 构造函数
+     * @param k 精度参数，越大越精确、占用内存越多
+     */
+    explicit QuantileSketch(int k = 200);
+
+    /**
+     * @brief 插入一个值，摊还 O(log k)
+     * @param value 值，NaN 被忽略
+     */
+    void add(double value);
+
+    /**
+     * @brief 批量插入，全部放入最低层后只压缩一次
+     * @param values 值数组，NaN 被忽略
+     * @param count 值个数
+     */
+    void add(const double *values, int count);
+
+    /**
+     * @brief 把另一个草图合并进来，合并后等价于对两组数据共同建立的草图
+     * @param other 另一个草图
+     */
+    void merge(const QuantileSketch &other);
+
+    /**
+     * @brief 清空草图
+     */
+    void clear();
+
+    /**
+     * @brief 估算分位数
+     * @param q 分位点，0 ~ 1（0.5 为中位数）
+     * @return 返回分位数，草图为空时返回NaN
+     */
+    double quantile(double q) const;
+
+    /**
+     * @brief 估算不大于某值的数据所占比例
+     * @param value 值
+     * @return 返回 0 ~ 1 的比例，草图为空时返回0
+     */
+    double rank(double value) const;
+
+    qint64 count() const { return n; }
+    bool isEmpty() const { return n == 0; }
+    double min() const { return minValue; }
+    double max() const { return maxValue; }
+
+    /**
+     * @brief 当前保留的值个数（内存占用约为 8 字节 × 该值）
+     */
+    int retained() const { return retainedCount; }
+
+    /**
+     * @brief 序列化草图，用于在账本之间传递后合并
+     */
+    QByteArray toByteArray() const;
+
+    /**
+     * @brief 从序列化数据恢复草图
+     * @param data toByteArray的输出
+     * @param ok 成功时输出true
+     */
+    static QuantileSketch fromByteArray(const QByteArray &data, bool *ok = nullptr);
+
+private:
+    int levelCapacity(int level) const;
+    int capacity(int level) const { return capacities[level]; }
+    void updateCapacity();
+    void compress();
+    int nextCoin();
+    const QVector<QPair<double, qint64>> &sortedView() const;
+
+    int k;                                          //!< 精度参数
+    qint64 n = 0;                                   //!< 已插入的值个数
+    double minValue = 0;                            //!< 精确最小值
+    double maxValue = 0;                            //!< 精确最大值
+    QVector<QVector<double>> levels;                //!< 各层保留的值，第h层权重为2^h
+    int retainedCount = 0;                          //!< 各层保留值总数
+    QVector<int> capacities;                        //!< 各层容量
+    int totalCapacity = 0;                          //!< 各层容量之和
+    quint64 coinState = 0x9E3779B97F4A7C15ULL;      //!< 压缩时选择奇偶位的随机数状态
+    mutable QVector<QPair<double, qint64>> sorted;  //!< (值, 权重)按值排序，查询时按需重建
+    mutable bool sortedValid = false;               //!< sorted是否与各层一致
+};
+
+#endif // QUANTILESKETCH_H
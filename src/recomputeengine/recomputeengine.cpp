@@ -0,0 +1,377 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 16:35:52
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 16:35:52
+ * @Description: 编辑历史记录后的增量重算引擎
+ */
+#include "recomputeengine.h"
+#include "exchangerates.h"
+#include <QStandardItemModel>
+#include <QMap>
+
+namespace {
+
+inline int amountIndex(int column)
+{
+    return column - ColTotalDeposit;
+}
+
+} // namespace
+
+RecomputeEngine::RecomputeEngine(QObject *parent)
+    : QObject(parent)
+{
+}
+
+/**
+ * @brief 绑定数据模型并建立影子副本
+ * @param model 数据模型指针
+ */
+void RecomputeEngine::attach(QStandardItemModel *model)
+{
+    if (this->model) {
+        disconnect(this->model, nullptr, this, nullptr);
+    }
+    this->model = model;
+    connect(model, &QStandardItemModel::itemChanged, this, &RecomputeEngine::onItemChanged);
+    connect(model, &QStandardItemModel::rowsInserted, this, &RecomputeEngine::onRowsInserted);
+    connect(model, &QStandardItemModel::rowsRemoved, this, &RecomputeEngine::onRowsRemoved);
+    resync();
+}
+
+/**
+ * @brief 设置换算相邻两行总存款使用的汇率表
+ * @param rates 汇率表指针，由调用方持有；为空时只有同币种的相邻行能推算当月开支
+ */
+void RecomputeEngine::setExchangeRates(const ExchangeRates *rates)
+{
+    this->rates = rates;
+}
+
+/**
+ * @brief 设置模型第0行之前的一条记录（归档的最后一条或窗口模式下未载入的记录）
+ * @param record 前一条记录，只用于推算第0行的当月开支，不写回
+ */
+void RecomputeEngine::setLeadingRecord(const LedgerRecord &record)
+{
+    leading = record;
+    hasLeading = true;
+    if (model && !rows.isEmpty()) {
+        applyFlags(0);
+    }
+}
+
+/**
+ * @brief 模型第0行即账本的第一条记录
+ */
+void RecomputeEngine::clearLeadingRecord()
+{
+    leading = LedgerRecord();
+    hasLeading = false;
+    if (model && !rows.isEmpty()) {
+        applyFlags(0);
+    }
+}
+
+/**
+ * @brief 暂停或恢复监听（批量加载数据期间应暂停）
+ * @param suspended 是否暂停
+ */
+void RecomputeEngine::setSuspended(bool suspended)
+{
+    this->suspended = suspended;
+}
+
+/**
+ * @brief 从模型重新建立影子副本，并设置派生列为只读
+ */
+void RecomputeEngine::resync()
+{
+    rows.clear();
+    if (!model) {
+        return;
+    }
+    rows.reserve(model->rowCount());
+    for (int row = 0; row < model->rowCount(); ++row) {
+        rows.append(LedgerRecord::fromModelRow(model, row));
+        applyFlags(row);
+    }
+}
+
+/**
+ * @brief 重算指定范围内各行的派生列（外部插入前序行后使用）
+ * @param first 起始行号
+ * @param last 结束行号（含）
+ * @return 返回有单元格变化的行号
+ */
+QList<int> RecomputeEngine::recomputeRows(int first, int last)
+{
+    QList<int> changed;
+    for (int row = qMax(0, first); row <= last && row < rows.size(); ++row) {
+        if (recomputeRow(row)) {
+            changed.append(row);
+        }
+    }
+    return changed;
+}
+
+void RecomputeEngine::onItemChanged(QStandardItem *item)
+{
+    if (suspended || updating || !item || item->parent()) {
+        return;
+    }
+
+    const int row = item->row();
+    const int column = item->column();
+    if (row < 0 || row >= rows.size()) {
+        return;
+    }
+
+    QString error;
+    if (!acceptEdit(row, column, item->text(), error)) {
+        // 还原为影子副本中的旧值
+        writeCell(row, column);
+        emit validationFailed(error);
+        return;
+    }
+    // 规范化用户输入（如 1234.5 -> 1234.50）
+    writeCell(row, column);
+
+    // 脏行按行号排序处理；修改总存款或币种会影响下一行的当月开支
+    QMap<int, bool> dirty;
+    dirty.insert(row, true);
+    if ((column == ColTotalDeposit || column == ColCurrency) && row + 1 < rows.size()) {
+        dirty.insert(row + 1, true);
+    }
+
+    QList<int> changed;
+    changed.append(row);
+    for (auto it = dirty.constBegin(); it != dirty.constEnd(); ++it) {
+        if (recomputeRow(it.key()) && it.key() != row) {
+            changed.append(it.key());
+        }
+    }
+    emit rowsChanged(changed);
+}
+
+void RecomputeEngine::onRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if (suspended || parent.isValid()) {
+        return;
+    }
+    for (int row = first; row <= last; ++row) {
+        rows.insert(row, LedgerRecord::fromModelRow(model, row));
+        applyFlags(row);
+    }
+    if (first == 0 && last + 1 < rows.size()) {
+        applyFlags(last + 1);
+    }
+}
+
+void RecomputeEngine::onRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (suspended || parent.isValid()) {
+        return;
+    }
+    rows.remove(first, qMin(last, rows.size() - 1) - first + 1);
+    if (first == 0 && !rows.isEmpty()) {
+        applyFlags(0); // 没有前一条记录时，新的第0行当月开支变为可编辑
+    }
+}
+
+/**
+ * @brief 校验并接收用户输入
+ * @return 合法返回true，并更新影子副本
+ */
+bool RecomputeEngine::acceptEdit(int row, int column, const QString &text, QString &error)
+{
+    LedgerRecord &record = rows[row];
+
+    if (column == ColDate) {
+        QDate date = LedgerRecord::parseDate(text);
+        if (!date.isValid()) {
+            error = "记账日期无效！";
+            return false;
+        }
+        const LedgerRecord *previous = row > 0 ? &rows[row - 1] : (hasLeading ? &leading : nullptr);
+        if ((previous && previous->date.isValid() && date <= previous->date)
+                || (row + 1 < rows.size() && rows[row + 1].date.isValid() && date >= rows[row + 1].date)) {
+            error = "记账日期必须晚于上一行且早于下一行！";
+            return false;
+        }
+        const QDate previousDate = record.date;
+        record.date = date;
+        qint64 total = 0;
+        if (hasPredecessor(row) && !previousTotal(row, total)) {
+            record.date = previousDate;
+            error = "缺少该日期上一行币种到本行币种的汇率，无法推算当月开支！";
+            return false;
+        }
+        return true;
+    }
+
+    if (column == ColNote) {
+        record.note = text;
+        return true;
+    }
+
+    if (column == ColCurrency) {
+        bool ok = false;
+        const QString code = LedgerRecord::normalizeCurrency(text, &ok);
+        if (!ok) {
+            error = "币种须为3位字母代码（如 USD、HKD），留空表示人民币！";
+            return false;
+        }
+        const QString previousCurrency = record.currency;
+        record.currency = code == LedgerRecord::DefaultCurrency ? QString() : code;
+        // 相邻行的总存款须能换算，否则当月开支无法推算
+        qint64 total = 0;
+        if ((hasPredecessor(row) && !previousTotal(row, total)) || (row + 1 < rows.size() && !previousTotal(row + 1, total))) {
+            record.currency = previousCurrency;
+            error = QString("缺少 %1 与相邻记录币种之间的汇率，不能修改币种！").arg(code);
+            return false;
+        }
+        return true;
+    }
+
+    if (isDerived(row, column)) {
+        error = "该列由其它列自动计算，不能直接修改！";
+        return false;
+    }
+
+    bool ok = false;
+    const qint64 cents = LedgerRecord::parseCents(text, &ok);
+    if (!ok || (column != ColExpense && cents < 0)) {
+        error = "请输入有效的非负金额！";
+        return false;
+    }
+    const int index = amountIndex(column);
+    if (column == ColTotalDeposit && cents <= 0) {
+        error = "当前总存款金额必须大于0！";
+        return false;
+    }
+    const qint64 total = column == ColTotalDeposit ? cents : record.amounts[amountIndex(ColTotalDeposit)];
+    const qint64 fixed = column == ColFixedDeposit ? cents : record.amounts[amountIndex(ColFixedDeposit)];
+    if (fixed > total) {
+        error = "定期余额不能大于当前总存款金额！";
+        return false;
+    }
+
+    record.amounts[index] = cents;
+    record.presentMask |= (1u << index);
+    return true;
+}
+
+/**
+ * @brief 判断某一行的某一列是否由其它列推算得到
+ */
+bool RecomputeEngine::isDerived(int row, int column) const
+{
+    if (column == ColMonthlyDeposit || column == ColDisposable) {
+        return true;
+    }
+    // 账本第一条记录的当月开支为手工录入
+    return column == ColExpense && hasPredecessor(row);
+}
+
+/**
+ * @brief 获取上一条记录的总存款，并换算为本行的币种
+ * @param row 行号，hasPredecessor(row)须为true
+ * @param total 换算后的总存款（输出参数，单位：分）
+ * @return 缺少汇率时返回false
+ */
+bool RecomputeEngine::previousTotal(int row, qint64 &total) const
+{
+    static const ExchangeRates identity;    // 未设置汇率表时只能换算同一币种
+    const LedgerRecord &previous = row > 0 ? rows[row - 1] : leading;
+    const LedgerRecord &record = rows[row];
+    return (rates ? *rates : identity).convertCents(previous.amounts[amountIndex(ColTotalDeposit)], previous.currency,
+                                                    record.currency, record.date, total);
+}
+
+/**
+ * @brief 重算一行的派生列，只写回变化的单元格
+ * @return 有单元格变化返回true
+ */
+bool RecomputeEngine::recomputeRow(int row)
+{
+    LedgerRecord &record = rows[row];
+    const qint64 total = record.amounts[amountIndex(ColTotalDeposit)];
+    const qint64 salary = record.amounts[amountIndex(ColSalary)];
+    const qint64 fixed = record.amounts[amountIndex(ColFixedDeposit)];
+
+    // 缺少汇率时保留原有的当月开支，由完整性检查报告
+    qint64 expense = record.amounts[amountIndex(ColExpense)];
+    qint64 previous = 0;
+    if (hasPredecessor(row) && previousTotal(row, previous)) {
+        expense = previous + salary - total;
+    }
+
+    const qint64 derived[][2] = {
+        {ColExpense, expense},
+        {ColMonthlyDeposit, salary - expense},
+        {ColDisposable, total - fixed}
+    };
+
+    bool changed = false;
+    for (const auto &cell : derived) {
+        const int column = static_cast<int>(cell[0]);
+        const int index = amountIndex(column);
+        if (record.hasAmount(index) && record.amounts[index] == cell[1]) {
+            continue;
+        }
+        record.amounts[index] = cell[1];
+        record.presentMask |= (1u << index);
+        writeCell(row, column);
+        changed = true;
+    }
+    return changed;
+}
+
+/**
+ * @brief 把影子副本中的单元格写回模型（不触发重算）
+ */
+void RecomputeEngine::writeCell(int row, int column)
+{
+    const LedgerRecord &record = rows[row];
+    QString text;
+    if (column == ColDate) {
+        text = record.date.toString("yyyy/MM/dd");
+    } else if (column == ColNote) {
+        text = record.note;
+    } else if (column == ColCurrency) {
+        text = record.currency;
+    } else {
+        const int index = amountIndex(column);
+        text = record.hasAmount(index) ? LedgerRecord::formatCents(record.amounts[index]) : QString();
+    }
+
+    QStandardItem *item = model->item(row, column);
+    if (!item || item->text() == text) {
+        return;
+    }
+    updating = true;
+    item->setText(text);
+    updating = false;
+}
+
+/**
+ * @brief 设置一行中派生列的只读属性
+ */
+void RecomputeEngine::applyFlags(int row)
+{
+    updating = true;
+    for (int column = 0; column < LedgerColumnCount; ++column) {
+        QStandardItem *item = model->item(row, column);
+        if (!item) {
+            continue;
+        }
+        Qt::ItemFlags flags = item->flags();
+        Qt::ItemFlags wanted = isDerived(row, column) ? (flags & ~Qt::ItemIsEditable) : (flags | Qt::ItemIsEditable);
+        if (flags != wanted) {
+            item->setFlags(wanted);
+        }
+    }
+    updating = false;
+}
@@ -0,0 +1,164 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 16:35:52
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 16:35:52
+ * @Description: 编辑历史记录后的增量重算引擎
+ */
+#ifndef RECOMPUTEENGINE_H
+#define RECOMPUTEENGINE_H
+
+#include <QObject>
+#include <QVector>
+#include <QList>
+#include "ledgerrecord.h"
+
+class QStandardItem;
+class QStandardItemModel;
+class ExchangeRates;
+
+/*
+    派生列的依赖关系：
+        当月可支配额度[r] = 总存款[r] - 定期余额[r]
+        当月开支[r]       = 总存款[r-1] + 当月工资[r] - 总存款[r]   （r > 0）
+        当月存款[r]       = 当月工资[r] - 当月开支[r]
+    账本的第一条记录没有上一行，当月开支为手工录入；归档或窗口模式下模型第0行
+    之前还有记录，由 setLeadingRecord 提供，第0行的当月开支同样由推算得到。
+    相邻两行币种不同时，总存款[r-1] 先按第r行日期的汇率换算为第r行的币种；
+    缺少汇率的币种或日期修改会被拒绝。
+
+    引擎维护一份与模型同步的类型化影子副本，用户修改某个单元格后：
+    1. 校验新值（日期须严格位于相邻两行之间，金额须为非负数字），不合法则还原；
+    2. 把被修改的行标记为脏行；若修改的是总存款，下一行也是脏行；
+    3. 按行号顺序重算脏行的派生列，只有数值真正变化的单元格才会 setText，
+       因此 dataChanged 只覆盖变化的单元格，重算范围最多两行，与账本长度无关；
+    4. 通过 rowsChanged 通知持久化层，只写回这些行。
+*/
+class RecomputeEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RecomputeEngine(QObject *parent = nullptr);
+
+    /**
+     * @brief 绑定数据模型并建立影子副本
+     * @param model 数据模型指针
+     */
+    void attach(QStandardItemModel *model);
+
+    /**
+     * @brief 设置换算相邻两行总存款使用的汇率表
+     * @param rates 汇率表指针，由调用方持有；为空时只有同币种的相邻行能推算当月开支
+     */
+    void setExchangeRates(const ExchangeRates *rates);
+
+    /**
+     * @brief 设置模型第0行之前的一条记录（归档的最后一条或窗口模式下未载入的记录）
+     * @param record 前一条记录，只用于推算第0行的当月开支，不写回
+     */
+    void setLeadingRecord(const LedgerRecord &record);
+
+    /**
+     * @brief 模型第0行即账本的第一条记录
+     */
+    void clearLeadingRecord();
+
+    /**
+     * @brief 是否设置了模型第0行之前的记录
+     */
+    bool hasLeadingRecord() const { return hasLeading; }
+
+    /**
+     * @brief 模型第0行之前的记录，hasLeadingRecord()为false时无意义
+     */
+    const LedgerRecord &leadingRecord() const { return leading; }
+
+    /**
+     * @brief 暂停或恢复监听（批量加载数据期间应暂停）
+     * @param suspended 是否暂停
+     */
+    void setSuspended(bool suspended);
+
+    /**
+     * @brief 从模型重新建立影子副本，并设置派生列为只读
+     */
+    void resync();
+
+    /**
+     * @brief 重算指定范围内各行的派生列（外部插入前序行后使用）
+     * @param first 起始行号
+     * @param last 结束行号（含）
+     * @return 返回有单元格变化的行号
+     */
+    QList<int> recomputeRows(int first, int last);
+
+signals:
+    /**
+     * @brief 有行被修改或重算
+     * @param rows 按升序排列的行号
+     */
+    void rowsChanged(const QList<int> &rows);
+
+    /**
+     * @brief 用户输入不合法，已还原
+     * @param message 提示信息
+     */
+    void validationFailed(const QString &message);
+
+private slots:
+    void onItemChanged(QStandardItem *item);
+    void onRowsInserted(const QModelIndex &parent, int first, int last);
+    void onRowsRemoved(const QModelIndex &parent, int first, int last);
+
+private:
+    QStandardItemModel *model = nullptr;
+    const ExchangeRates *rates = nullptr;   //!< 换算相邻行总存款的汇率表
+    QVector<LedgerRecord> rows;     //!< 与模型同步的影子副本
+    LedgerRecord leading;           //!< 模型第0行之前的记录
+    bool hasLeading = false;        //!< 是否有模型第0行之前的记录
+    bool suspended = false;         //!< 是否暂停监听
+    bool updating = false;          //!< 引擎自身正在写回模型
+
+    /**
+     * @brief 校验并接收用户输入
+     * @return 合法返回true，并更新影子副本
+     */
+    bool acceptEdit(int row, int column, const QString &text, QString &error);
+
+    /**
+     * @brief 某一行之前是否还有记录（第0行之前可能有归档或未载入的记录）
+     */
+    bool hasPredecessor(int row) const { return row > 0 || hasLeading; }
+
+    /**
+     * @brief 判断某一行的某一列是否由其它列推算得到
+     */
+    bool isDerived(int row, int column) const;
+
+    /**
+     * @brief 获取上一条记录的总存款，并换算为本行的币种
+     * @param row 行号，hasPredecessor(row)须为true
+     * @param total 换算后的总存款（输出参数，单位：分）
+     * @return 缺少汇率时返回false
+     */
+    bool previousTotal(int row, qint64 &total) const;
+
+    /**
+     * @brief 重算一行的派生列，只写回变化的单元格
+     * @return 有单元格变化返回true
+     */
+    bool recomputeRow(int row);
+
+    /**
+     * @brief 把影子副本中的单元格写回模型（不触发重算）
+     */
+    void writeCell(int row, int column);
+
+    /**
+     * @brief 设置一行中派生列的只读属性
+     */
+    void applyFlags(int row);
+};
+
+#endif // RECOMPUTEENGINE_H
@@ -0,0 +1,356 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 14:20:37
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 14:20:37
+ * @Description: 无界面批量图表与报告渲染
+ */
+#include "reportrenderer.h"
+#include "curveGraph.h"
+#include "ledgerstats.h"
+#include "ledgerstorage.h"
+#include "ledgersnapshot.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QPainter>
+#include <QPdfWriter>
+#include <QPageSize>
+#include <QSvgGenerator>
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QThreadPool>
+#include <QCommandLineParser>
+#include <QFuture>
+#include <QtConcurrent/QtConcurrentMap>
+#include <cstring>
+#include <functional>
+#include <memory>
+
+namespace {
+
+/**
+ * @brief PDF统计表中各金额列的名称，下标对应金额列
+ */
+const char *const ColumnTitles[LedgerAmountColumnCount] = {
+    "当前总存款金额", "当月工资", "定期余额", "当月开支", "当月存款", "当月可支配额度"
+};
+
+} // namespace
+
+/**
+ * @brief 工作线程准备好的单个账本数据
+ */
+struct ReportRenderer::Prepared
+{
+    Result result;                                  //!< 渲染结果（准备失败时已写入原因）
+    CurveGraph::SeriesData data;                    //!< 曲线数据
+    ColumnStats stats[LedgerAmountColumnCount];     //!< 各金额列的统计结果
+};
+
+ReportRenderer::ReportRenderer(const Options &options)
+    : options(options)
+{
+}
+
+/**
+ * @brief 析构函数，释放GUI线程中复用的图表
+ */
+ReportRenderer::~ReportRenderer()
+{
+    delete curveGraph;
+}
+
+/**
+ * @brief 读取、计算在线程池中并行，绘制在GUI线程中依次进行；
+ *        绘制当前一批的同时，线程池已在准备下一批
+ * @param ledgerFiles 账本文件列表
+ * @return 返回每个账本的渲染结果（顺序与输入一致）
+ */
+QVector<ReportRenderer::Result> ReportRenderer::renderAll(const QStringList &ledgerFiles)
+{
+    QDir().mkpath(options.outputDir);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(options.threads > 0 ? options.threads : QThread::idealThreadCount());
+    const int batchSize = qMax(1, pool.maxThreadCount()) * 2;
+
+    std::function<Prepared(const QString &)> prepare = [this](const QString &ledgerFile) {
+        return prepareOne(ledgerFile);
+    };
+    QVector<Result> results;
+    results.reserve(ledgerFiles.size());
+    QFuture<Prepared> pending = QtConcurrent::mapped(&pool, ledgerFiles.mid(0, batchSize), prepare);
+    for (int first = 0; first < ledgerFiles.size(); first += batchSize) {
+        QList<Prepared> batch = pending.results();
+        if (first + batchSize < ledgerFiles.size()) {
+            pending = QtConcurrent::mapped(&pool, ledgerFiles.mid(first + batchSize, batchSize), prepare);
+        }
+        for (Prepared &prepared : batch) {
+            renderOne(prepared);
+            results.append(prepared.result);
+        }
+    }
+    return results;
+}
+
+/**
+ * @brief 判断命令行是否请求了批量渲染
+ */
+bool ReportRenderer::isRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--render-reports") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 解析命令行并执行批量渲染
+ * @param arguments 命令行参数（含程序名）
+ * @return 返回进程退出码
+ */
+int ReportRenderer::runFromCommandLine(const QStringList &arguments)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("批量渲染账本存款趋势图与PDF报告");
+    parser.addHelpOption();
+    QCommandLineOption outputOption("render-reports", "输出目录", "dir");
+    QCommandLineOption formatOption("format", "输出格式：png、svg 或 pdf（默认png）", "format", "png");
+    QCommandLineOption sizeOption("size", "图表尺寸，如1280x720", "WxH", "1280x720");
+    QCommandLineOption threadsOption("threads", "线程数（默认CPU核心数）", "n", "0");
+    parser.addOption(outputOption);
+    parser.addOption(formatOption);
+    parser.addOption(sizeOption);
+    parser.addOption(threadsOption);
+    parser.addPositionalArgument("ledgers", "账本CSV文件，@file 表示从文件中按行读取列表", "[ledger.csv...]");
+    parser.process(arguments);
+
+    Options options;
+    options.outputDir = parser.value(outputOption);
+    options.threads = parser.value(threadsOption).toInt();
+
+    const QString format = parser.value(formatOption).toLower();
+    if (format == "png") {
+        options.format = Png;
+    } else if (format == "svg") {
+        options.format = Svg;
+    } else if (format == "pdf") {
+        options.format = Pdf;
+    } else {
+        err << "不支持的输出格式: " << format << Qt::endl;
+        return 2;
+    }
+
+    const QStringList size = parser.value(sizeOption).split('x');
+    if (size.size() == 2 && size[0].toInt() > 0 && size[1].toInt() > 0) {
+        options.size = QSize(size[0].toInt(), size[1].toInt());
+    }
+
+    // 展开 @file 形式的账本列表
+    QStringList ledgerFiles;
+    for (const QString &argument : parser.positionalArguments()) {
+        if (!argument.startsWith('@')) {
+            ledgerFiles << argument;
+            continue;
+        }
+        QFile listFile(argument.mid(1));
+        if (!listFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            err << "无法读取账本列表: " << listFile.fileName() << Qt::endl;
+            return 2;
+        }
+        QTextStream in(&listFile);
+        while (!in.atEnd()) {
+            QString line = in.readLine().trimmed();
+            if (!line.isEmpty()) {
+                ledgerFiles << line;
+            }
+        }
+    }
+    if (options.outputDir.isEmpty() || ledgerFiles.isEmpty()) {
+        err << "用法: Ledger --render-reports <输出目录> [--format png|svg|pdf] [--size WxH] ledger.csv..." << Qt::endl;
+        return 2;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    ReportRenderer renderer(options);
+    const QVector<Result> results = renderer.renderAll(ledgerFiles);
+
+    int failures = 0;
+    for (const Result &result : results) {
+        if (!result.ok) {
+            ++failures;
+            err << result.ledgerFile << ": " << result.error << Qt::endl;
+        }
+    }
+    out << QString("已渲染 %1 个账本，失败 %2 个，耗时 %3 ms")
+               .arg(results.size() - failures).arg(failures).arg(timer.elapsed()) << Qt::endl;
+    return failures == 0 ? 0 : 1;
+}
+
+/**
+ * @brief 读取账本并计算曲线数据与统计结果（工作线程，线程安全）
+ * @param ledgerFile 账本文件
+ */
+ReportRenderer::Prepared ReportRenderer::prepareOne(const QString &ledgerFile) const
+{
+    Prepared prepared;
+    Result &result = prepared.result;
+    result.ledgerFile = ledgerFile;
+    result.outputFile = outputPathFor(ledgerFile);
+
+    // 存储引擎会为不存在的文件创建空账本，批量模式下直接报错
+    if (!QFileInfo::exists(ledgerFile)) {
+        result.error = "文件不存在";
+        return prepared;
+    }
+
+    // 存储引擎在本线程创建、使用并销毁（SQLite连接不能跨线程）
+    QVector<LedgerRecord> records;
+    {
+        std::unique_ptr<LedgerStorage> storage(LedgerStorage::open(ledgerFile, &result.error));
+        if (!storage) {
+            return prepared;
+        }
+        if (!storage->readAll(records)) {
+            result.error = storage->errorString();
+            return prepared;
+        }
+    }
+
+    const LedgerSnapshotPtr snapshot = LedgerSnapshot::fromRecords(records);
+    prepared.data = CurveGraph::buildSeries(*snapshot, QVector<double>());
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        prepared.stats[i] = LedgerStats::compute(snapshot->column(ColTotalDeposit + i));
+    }
+    return prepared;
+}
+
+/**
+ * @brief 把准备好的数据绘制到输出文件（GUI线程）
+ * @param prepared 准备好的数据，失败原因写入其中的结果
+ */
+void ReportRenderer::renderOne(Prepared &prepared)
+{
+    if (!prepared.result.error.isEmpty()) {
+        return;
+    }
+    if (!curveGraph) {
+        curveGraph = new CurveGraph();
+        curveGraph->setAnimationPointLimit(0); // 离屏渲染不需要动画
+    }
+    curveGraph->applySeries(prepared.data);
+    prepared.result.ok = writeOutput(prepared, prepared.result.error);
+}
+
+bool ReportRenderer::writeOutput(const Prepared &prepared, QString &error)
+{
+    const QString &ledgerFile = prepared.result.ledgerFile;
+    const QString &outputFile = prepared.result.outputFile;
+    const QRectF chartRect(QPointF(0, 0), QSizeF(options.size));
+
+    switch (options.format) {
+    case Png: {
+        QImage image(options.size, QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::white);
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing);
+        curveGraph->render(&painter, chartRect);
+        painter.end();
+        if (!image.save(outputFile, "PNG")) {
+            error = "无法写入PNG文件";
+            return false;
+        }
+        return true;
+    }
+    case Svg: {
+        QSvgGenerator generator;
+        generator.setFileName(outputFile);
+        generator.setSize(options.size);
+        generator.setViewBox(chartRect);
+        generator.setTitle(QFileInfo(ledgerFile).completeBaseName());
+        QPainter painter;
+        if (!painter.begin(&generator)) {
+            error = "无法写入SVG文件";
+            return false;
+        }
+        curveGraph->render(&painter, chartRect);
+        return painter.end();
+    }
+    case Pdf: {
+        QPdfWriter writer(outputFile);
+        writer.setPageSize(QPageSize(QPageSize::A4));
+        writer.setPageOrientation(QPageLayout::Landscape);
+        writer.setResolution(96);
+        writer.setTitle(QFileInfo(ledgerFile).completeBaseName());
+        QPainter painter;
+        if (!painter.begin(&writer)) {
+            error = "无法写入PDF文件";
+            return false;
+        }
+        painter.setRenderHint(QPainter::Antialiasing);
+
+        // 页面上方：标题；中间：趋势图；下方：各金额列统计
+        const QRect page = painter.viewport();
+        QFont titleFont = painter.font();
+        titleFont.setPointSize(16);
+        titleFont.setBold(true);
+        painter.setFont(titleFont);
+        painter.drawText(QRect(0, 0, page.width(), 40), Qt::AlignCenter,
+                         QString("%1 存款趋势报告").arg(QFileInfo(ledgerFile).completeBaseName()));
+
+        const int chartHeight = page.height() * 3 / 5;
+        curveGraph->render(&painter, QRectF(0, 48, page.width(), chartHeight));
+
+        QFont bodyFont = painter.font();
+        bodyFont.setPointSize(10);
+        bodyFont.setBold(false);
+        painter.setFont(bodyFont);
+
+        const QStringList headers = {"统计项", "记录数", "最小值", "最大值", "平均值", "标准差"};
+        const int columnWidth = page.width() / headers.size();
+        const int rowHeight = 22;
+        int y = 48 + chartHeight + 16;
+        for (int i = 0; i < headers.size(); ++i) {
+            painter.drawText(QRect(i * columnWidth, y, columnWidth, rowHeight), Qt::AlignCenter, headers[i]);
+        }
+        for (int column = ColTotalDeposit; column <= ColDisposable; ++column) {
+            y += rowHeight;
+            const ColumnStats &stats = prepared.stats[column - ColTotalDeposit];
+            const QStringList cells = {
+                QString::fromUtf8(ColumnTitles[column - ColTotalDeposit]),
+                QString::number(stats.count),
+                QString::number(stats.min, 'f', 2),
+                QString::number(stats.max, 'f', 2),
+                QString::number(stats.mean, 'f', 2),
+                QString::number(stats.stddev(), 'f', 2)
+            };
+            for (int i = 0; i < cells.size(); ++i) {
+                painter.drawText(QRect(i * columnWidth, y, columnWidth, rowHeight), Qt::AlignCenter, cells[i]);
+            }
+        }
+        return painter.end();
+    }
+    }
+    return false;
+}
+
+/**
+ * @brief 输出文件路径：输出目录/账本文件名.扩展名
+ */
+QString ReportRenderer::outputPathFor(const QString &ledgerFile) const
+{
+    static const char *const extensions[] = {"png", "svg", "pdf"};
+    QFileInfo info(ledgerFile);
+    // 不同目录下可能有同名账本，用上级目录名区分
+    QString baseName = info.dir().dirName() + "_" + info.completeBaseName();
+    return QDir(options.outputDir).filePath(baseName + "." + extensions[options.format]);
+}
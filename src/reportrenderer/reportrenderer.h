@@ -0,0 +1,109 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 14:20:37
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 14:20:37
+ * @Description: 无界面批量图表与报告渲染
+ */
+#ifndef REPORTRENDERER_H
+#define REPORTRENDERER_H
+
+#include <QString>
+#include <QStringList>
+#include <QSize>
+#include <QVector>
+
+class CurveGraph;
+
+/*
+    批量渲染流程：
+    1. main() 检测到 --render-reports 参数后，在创建 QApplication 之前
+       把平台插件设为 offscreen，全程不创建任何窗口；
+    2. 账本按批通过 QtConcurrent 分发到线程池，工作线程只做线程安全的部分：
+       经 LedgerStorage 读取记录、构造快照、CurveGraph::buildSeries 计算曲线数据
+       和各金额列统计，不创建任何 QObject；
+    3. QChart / QGraphicsScene 只能在GUI线程使用，因此同一个 CurveGraph（含离屏场景）
+       在GUI线程中依次接收各账本的曲线数据并绘制到 QImage（PNG）、
+       QSvgGenerator（SVG）或 QPdfWriter（PDF）；每批处理完再准备下一批，
+       同时驻留的曲线数据不超过一批。
+    批量模式不经过 LedgerManager，错误只记录在结果中，不弹出消息框。
+*/
+class ReportRenderer
+{
+public:
+    /**
+     * @brief 输出格式
+     */
+    enum Format {
+        Png,
+        Svg,
+        Pdf
+    };
+
+    /**
+     * @brief 渲染选项
+     */
+    struct Options
+    {
+        QString outputDir;              //!< 输出目录
+        Format format = Png;            //!< 输出格式
+        QSize size = QSize(1280, 720);  //!< 图表尺寸（像素）
+        int threads = 0;                //!< 线程数，0表示使用CPU核心数
+    };
+
+    /**
+     * @brief 单个账本的渲染结果
+     */
+    struct Result
+    {
+        QString ledgerFile;     //!< 账本文件
+        QString outputFile;     //!< 输出文件
+        bool ok = false;        //!< 是否成功
+        QString error;          //!< 失败原因
+    };
+
+    explicit ReportRenderer(const Options &options);
+    ~ReportRenderer();
+
+    /**
+     * @brief 并行渲染所有账本
+     * @param ledgerFiles 账本文件列表
+     * @return 返回每个账本的渲染结果（顺序与输入一致）
+     */
+    QVector<Result> renderAll(const QStringList &ledgerFiles);
+
+    /**
+     * @brief 判断命令行是否请求了批量渲染
+     */
+    static bool isRequested(int argc, char *argv[]);
+
+    /**
+     * @brief 解析命令行并执行批量渲染
+     * @param arguments 命令行参数（含程序名）
+     * @return 返回进程退出码
+     */
+    static int runFromCommandLine(const QStringList &arguments);
+
+private:
+    struct Prepared;
+
+    Options options;
+    CurveGraph *curveGraph = nullptr;   //!< GUI线程中复用的图表（首次绘制时创建）
+
+    /**
+     * @brief 读取账本并计算曲线数据与统计结果（工作线程，线程安全）
+     * @param ledgerFile 账本文件
+     */
+    Prepared prepareOne(const QString &ledgerFile) const;
+
+    /**
+     * @brief 把准备好的数据绘制到输出文件（GUI线程）
+     * @param prepared 准备好的数据，失败原因写入其中的结果
+     */
+    void renderOne(Prepared &prepared);
+
+    bool writeOutput(const Prepared &prepared, QString &error);
+    QString outputPathFor(const QString &ledgerFile) const;
+};
+
+#endif // REPORTRENDERER_H
@@ -0,0 +1,338 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 20:21:36
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 20:21:36
+ * @Description: 银行流水CSV流式导入与去重
+ */
+#include "statementimporter.h"
+#include "ledgerrecord.h"
+#include <QFile>
+#include <QStringDecoder>
+#include <QVector>
+
+namespace {
+
+const int ImportBatchSize = 4096;       //!< 每批写入收支明细的流水数
+
+/**
+ * @brief 64位整数混合函数（splitmix64的末尾变换），使指纹各位分布均匀
+ */
+quint64 mix64(quint64 value)
+{
+    value ^= value >> 30;
+    value *= 0xBF58476D1CE4E5B9ull;
+    value ^= value >> 27;
+    value *= 0x94D049BB133111EBull;
+    value ^= value >> 31;
+    return value;
+}
+
+/**
+ * @brief 第n次出现的同一指纹对应的键
+ */
+quint64 occurrenceKey(quint64 fingerprint, quint32 occurrence)
+{
+    return mix64(fingerprint + occurrence * 0x9E3779B97F4A7C15ull);
+}
+
+/**
+ * @brief 64位键的开放寻址哈希集合（线性探测，负载不超过1/2）
+ * 键本身已是均匀的哈希值，直接取低位作为槽位；0表示空槽，键0映射为1
+ */
+class FingerprintSet
+{
+public:
+    explicit FingerprintSet(qsizetype expected)
+    {
+        qsizetype capacity = 16;
+        while (capacity < expected * 2) {
+            capacity <<= 1;
+        }
+        table.fill(0, capacity);
+        mask = quint64(capacity - 1);
+    }
+
+    bool contains(quint64 key) const
+    {
+        key = key ? key : 1;
+        for (quint64 slot = key & mask;; slot = (slot + 1) & mask) {
+            if (table[slot] == key) {
+                return true;
+            }
+            if (table[slot] == 0) {
+                return false;
+            }
+        }
+    }
+
+    /**
+     * @brief 插入键
+     * @return 键已存在时返回false
+     */
+    bool insert(quint64 key)
+    {
+        key = key ? key : 1;
+        if ((used + 1) * 2 > table.size()) {
+            grow();
+        }
+        quint64 slot = key & mask;
+        for (; table[slot] != 0; slot = (slot + 1) & mask) {
+            if (table[slot] == key) {
+                return false;
+            }
+        }
+        table[slot] = key;
+        ++used;
+        return true;
+    }
+
+    /**
+     * @brief 登记同一指纹的下一次出现
+     * @return 返回本次出现对应的键
+     */
+    quint64 claim(quint64 fingerprint)
+    {
+        for (quint32 occurrence = 0;; ++occurrence) {
+            const quint64 key = occurrenceKey(fingerprint, occurrence);
+            if (insert(key)) {
+                return key;
+            }
+        }
+    }
+
+private:
+    void grow()
+    {
+        const QVector<quint64> old = table;
+        table.fill(0, old.size() * 2);
+        mask = quint64(table.size() - 1);
+        for (quint64 key : old) {
+            if (key != 0) {
+                quint64 slot = key & mask;
+                while (table[slot] != 0) {
+                    slot = (slot + 1) & mask;
+                }
+                table[slot] = key;
+            }
+        }
+    }
+
+    QVector<quint64> table;     //!< 槽位，0表示空
+    quint64 mask = 0;           //!< 容量-1（容量为2的幂）
+    qsizetype used = 0;         //!< 已占用槽位数
+};
+
+/**
+ * @brief 解析流水中的金额：忽略千分位、货币符号和空白，括号表示负数
+ * @param text 金额文本
+ * @param cents 金额（输出参数，单位：分）
+ * @return 解析成功返回true
+ */
+bool parseAmount(QStringView text, qint64 &cents)
+{
+    QString cleaned;
+    cleaned.reserve(text.size());
+    bool negative = false;
+    for (QChar c : text) {
+        if (c.isDigit() || c == '.' || c == '-') {
+            cleaned.append(c);
+        } else if (c == '(') {
+            negative = true;
+        }
+    }
+    bool ok = false;
+    cents = LedgerRecord::parseCents(cleaned, &ok);
+    if (negative) {
+        cents = -qAbs(cents);
+    }
+    return ok;
+}
+
+} // namespace
+
+/**
+ * @brief 计算一笔流水的内容指纹（FNV-1a后再做一次混合）
+ * @param julianDay 日期（儒略日）
+ * @param cents 金额（分）
+ * @param description 已规范化的摘要
+ */
+quint64 StatementImporter::fingerprint(qint64 julianDay, qint64 cents, QStringView description)
+{
+    quint64 hash = 0xCBF29CE484222325ull;
+    auto feed = [&hash](quint64 value, int bytes) {
+        for (int i = 0; i < bytes; ++i) {
+            hash ^= (value >> (i * 8)) & 0xFF;
+            hash *= 0x100000001B3ull;
+        }
+    };
+    feed(quint64(julianDay), 8);
+    feed(quint64(cents), 8);
+    for (QChar c : description) {
+        feed(c.unicode(), 2);
+    }
+    return mix64(hash);
+}
+
+/**
+ * @brief 按分隔符拆分一行，支持双引号包裹的字段和转义的双引号
+ */
+QStringList StatementImporter::splitRow(QStringView line, QChar separator)
+{
+    QStringList fields;
+    QString field;
+    bool quoted = false;
+    for (qsizetype i = 0; i < line.size(); ++i) {
+        const QChar c = line[i];
+        if (quoted) {
+            if (c == '"') {
+                if (i + 1 < line.size() && line[i + 1] == '"') {
+                    field.append('"');
+                    ++i;
+                } else {
+                    quoted = false;
+                }
+            } else {
+                field.append(c);
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == separator) {
+            fields.append(field.trimmed());
+            field.clear();
+        } else {
+            field.append(c);
+        }
+    }
+    fields.append(field.trimmed());
+    return fields;
+}
+
+/**
+ * @brief 把流水文件导入收支明细，丢弃已导入过的流水
+ * @param filePath 流水CSV文件路径
+ * @param mapping 列映射
+ * @param ledger 收支明细子账本
+ */
+StatementImporter::Result StatementImporter::importFile(const QString &filePath, const ColumnMapping &mapping, TransactionLedger &ledger)
+{
+    Result result;
+    const bool splitAmounts = mapping.debitColumn >= 0 || mapping.creditColumn >= 0;
+    if (mapping.dateColumn < 0 || (!splitAmounts && mapping.amountColumn < 0)) {
+        result.error = "列映射缺少日期列或金额列";
+        return result;
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.error = "无法打开流水文件";
+        return result;
+    }
+    QStringDecoder decoder(mapping.encoding.toUtf8().constData());
+    if (!decoder.isValid()) {
+        result.error = "不支持的文件编码：" + mapping.encoding;
+        return result;
+    }
+
+    // 已有明细逐笔登记到集合中，同一指纹出现多次时登记为不同的键
+    FingerprintSet existing(ledger.count() + file.size() / 64);
+    for (int i = 0; i < ledger.count(); ++i) {
+        const TransactionLedger::Transaction &transaction = ledger.at(i);
+        existing.claim(fingerprint(transaction.julianDay, transaction.cents, ledger.noteView(transaction)));
+    }
+    FingerprintSet seen(file.size() / 64);
+
+    QVector<TransactionLedger::Entry> batch;
+    batch.reserve(ImportBatchSize);
+    auto flush = [&]() {
+        if (batch.isEmpty()) {
+            return true;
+        }
+        if (!ledger.addAll(batch)) {
+            return false;
+        }
+        result.imported += batch.size();
+        batch.clear();
+        return true;
+    };
+
+    // 流水通常按日期排列，相邻行日期相同时复用上一次的解析结果
+    QString lastDateText;
+    QDate lastDate;
+    int skippedHeader = 0;
+    while (!file.atEnd()) {
+        QString line = decoder.decode(file.readLine());
+        while (line.endsWith('\n') || line.endsWith('\r')) {
+            line.chop(1);
+        }
+        if (skippedHeader < mapping.headerLines) {
+            ++skippedHeader;
+            continue;
+        }
+        if (line.trimmed().isEmpty()) {
+            continue;
+        }
+        ++result.lines;
+
+        const QStringList fields = splitRow(line, mapping.separator);
+        const QString dateText = fields.value(mapping.dateColumn);
+        if (dateText != lastDateText) {
+            lastDateText = dateText;
+            if (!mapping.dateFormat.isEmpty()) {
+                lastDate = QDate::fromString(dateText, mapping.dateFormat);
+            } else {
+                // 带时间的日期只取日期部分
+                lastDate = LedgerRecord::parseDate(dateText.section(' ', 0, 0));
+            }
+        }
+
+        qint64 cents = 0;
+        bool ok = false;
+        if (splitAmounts) {
+            qint64 debit = 0;
+            qint64 credit = 0;
+            if (parseAmount(fields.value(mapping.debitColumn), debit) && debit != 0) {
+                cents = -qAbs(debit);
+                ok = true;
+            } else if (parseAmount(fields.value(mapping.creditColumn), credit) && credit != 0) {
+                cents = qAbs(credit);
+                ok = true;
+            }
+        } else {
+            ok = parseAmount(fields.value(mapping.amountColumn), cents);
+            if (mapping.negateAmounts) {
+                cents = -cents;
+            }
+        }
+        if (!lastDate.isValid() || !ok || cents == 0) {
+            ++result.malformed;
+            continue;
+        }
+
+        TransactionLedger::Entry entry;
+        entry.date = lastDate;
+        entry.cents = cents;
+        entry.note = TransactionLedger::normalizeField(fields.value(mapping.descriptionColumn));
+        const QString category = mapping.categoryColumn >= 0 ? fields.value(mapping.categoryColumn).trimmed() : QString();
+        entry.category = category.isEmpty() ? mapping.defaultCategory : category;
+
+        // 本文件中第k次出现的指纹，只有已有明细中也出现过k次才算重复
+        const quint64 key = seen.claim(fingerprint(lastDate.toJulianDay(), cents, entry.note));
+        if (existing.contains(key)) {
+            ++result.duplicates;
+            continue;
+        }
+
+        batch.append(entry);
+        if (batch.size() >= ImportBatchSize && !flush()) {
+            result.error = "无法写入收支明细";
+            return result;
+        }
+    }
+    if (!flush()) {
+        result.error = "无法写入收支明细";
+        return result;
+    }
+    result.ok = true;
+    return result;
+}
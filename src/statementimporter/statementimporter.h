@@ -0,0 +1,84 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 20:21:36
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 20:21:36
+ * @Description: 银行流水CSV流式导入与去重
+ */
+#ifndef STATEMENTIMPORTER_H
+#define STATEMENTIMPORTER_H
+
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include "transactionledger.h"
+
+/*
+    每月导出的银行流水时间段互相重叠，StatementImporter 把流水逐行导入收支明细，
+    并丢弃已经导入过的流水：
+    - 按 ColumnMapping 从每行取出日期、金额（单列带符号，或支出/收入两列）、摘要和分类；
+    - 每笔流水的指纹为 (日期, 金额, 摘要) 的 64 位内容哈希，放入开放寻址（线性探测）
+      哈希集合，查重与插入都是期望 O(1)；
+    - 同一天同金额同摘要的流水可能确实发生多次，因此指纹再混入"第几次出现"：
+      流水中第 k 次出现的指纹只有在已有明细中也出现过至少 k 次时才视为重复；
+    - 按行流式读取，每满 ImportBatchSize 笔调用一次 TransactionLedger::addAll，
+      内存占用只与哈希集合和一个批次有关。
+*/
+class StatementImporter
+{
+public:
+    /**
+     * @brief 流水文件的列映射，列号从0开始，-1表示没有该列
+     */
+    struct ColumnMapping
+    {
+        int dateColumn = 0;             //!< 交易日期
+        int amountColumn = 1;           //!< 带符号金额（收入为正、支出为负）
+        int debitColumn = -1;           //!< 支出金额列（与creditColumn配合使用，取代amountColumn）
+        int creditColumn = -1;          //!< 收入金额列
+        int descriptionColumn = 2;      //!< 摘要，保存为明细备注
+        int categoryColumn = -1;        //!< 分类，没有时使用defaultCategory
+        int headerLines = 1;            //!< 跳过的表头行数
+        QChar separator = ',';          //!< 分隔符
+        QString dateFormat;             //!< 日期格式（如"yyyyMMdd"），为空时自动识别常见格式
+        QString encoding = "UTF-8";     //!< 文件编码
+        bool negateAmounts = false;     //!< 金额列中支出为正数时设为true
+        QString defaultCategory = "导入";
+    };
+
+    /**
+     * @brief 导入结果
+     */
+    struct Result
+    {
+        bool ok = false;
+        QString error;                  //!< 失败原因
+        qint64 lines = 0;               //!< 读取的数据行数（不含表头）
+        qint64 imported = 0;            //!< 新增的明细数
+        qint64 duplicates = 0;          //!< 因重复而丢弃的行数
+        qint64 malformed = 0;           //!< 无法解析的行数
+    };
+
+    /**
+     * @brief 把流水文件导入收支明细，丢弃已导入过的流水
+     * @param filePath 流水CSV文件路径
+     * @param mapping 列映射
+     * @param ledger 收支明细子账本
+     */
+    static Result importFile(const QString &filePath, const ColumnMapping &mapping, TransactionLedger &ledger);
+
+    /**
+     * @brief 计算一笔流水的内容指纹
+     * @param julianDay 日期（儒略日）
+     * @param cents 金额（分）
+     * @param description 已规范化的摘要
+     */
+    static quint64 fingerprint(qint64 julianDay, qint64 cents, QStringView description);
+
+    /**
+     * @brief 按分隔符拆分一行，支持双引号包裹的字段和转义的双引号
+     */
+    static QStringList splitRow(QStringView line, QChar separator);
+};
+
+#endif // STATEMENTIMPORTER_H
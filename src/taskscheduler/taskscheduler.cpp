@@ -0,0 +1,307 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 21:52:40
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 21:52:40
+ * @Description: 带优先级、可取消的后台计算调度器（工作窃取线程池）
+ */
+#include "taskscheduler.h"
+#include <QThread>
+#include <QElapsedTimer>
+#include <QMetaObject>
+#include <algorithm>
+
+/**
+ * @brief 构造函数
+ * @param threadCount 工作线程数，不大于0时使用CPU核心数
+ * @param parent 父对象指针
+ */
+TaskScheduler::TaskScheduler(int threadCount, QObject *parent)
+    : QObject(parent)
+{
+    if (threadCount <= 0) {
+        threadCount = qMax(1, QThread::idealThreadCount());
+    }
+    workers.reserve(threadCount);
+    for (int i = 0; i < threadCount; ++i) {
+        workers.append(new Worker());
+    }
+    for (int i = 0; i < threadCount; ++i) {
+        workers[i]->thread = QThread::create([this, i]() { runWorker(i); });
+        workers[i]->thread->start();
+    }
+}
+
+/**
+ * @brief 析构函数，取消全部任务并等待工作线程退出
+ */
+TaskScheduler::~TaskScheduler()
+{
+    for (const auto &latest : latestByKey) {
+        latest.second.flag->storeRelaxed(1);
+    }
+    {
+        QMutexLocker locker(&sleepMutex);
+        stopping = true;
+        wakeCondition.wakeAll();
+    }
+    for (Worker *worker : workers) {
+        worker->thread->wait();
+        delete worker->thread;
+        delete worker;
+    }
+}
+
+/**
+ * @brief 提交任务（类型擦除形式）
+ * @param key 任务键，非空时取消同一键下尚未交付的旧任务
+ * @param priority 优先级
+ * @param work 在工作线程中执行的函数
+ * @param done 在调度器所在线程中调用的回调
+ * @return 返回任务编号
+ */
+quint64 TaskScheduler::post(const QString &key, Priority priority,
+                            std::function<void(const CancellationToken &)> work, std::function<void()> done)
+{
+    Task task;
+    task.id = registerTask(key, task.token);
+    task.key = key;
+    task.work = std::move(work);
+    task.done = std::move(done);
+    const quint64 id = task.id;
+    enqueue(priority, std::move(task));
+    return id;
+}
+
+/**
+ * @brief 提交一批子任务（类型擦除形式）
+ * @param key 任务键，非空时取消同一键下尚未交付的旧任务
+ * @param priority 优先级
+ * @param count 子任务数，不大于0时只执行finish
+ * @param part 在工作线程中执行的子任务，参数为子任务序号
+ * @param finish 最后一个子任务完成后在同一工作线程中执行
+ * @param done 在调度器所在线程中调用的回调
+ * @return 返回任务编号
+ */
+quint64 TaskScheduler::postBatch(const QString &key, Priority priority, int count,
+                                 std::function<void(int, const CancellationToken &)> part,
+                                 std::function<void(const CancellationToken &)> finish, std::function<void()> done)
+{
+    if (count <= 0) {
+        return post(key, priority, std::move(finish), std::move(done));
+    }
+
+    // 各子任务共享编号、键和取消标记，由剩余计数决定哪个子任务负责汇总与交付
+    CancellationToken batchToken;
+    const quint64 id = registerTask(key, batchToken);
+    QSharedPointer<QAtomicInt> remaining = QSharedPointer<QAtomicInt>::create(count);
+    for (int index = 0; index < count; ++index) {
+        Task task;
+        task.id = id;
+        task.key = key;
+        task.work = [part, index](const CancellationToken &token) { part(index, token); };
+        task.done = done;
+        task.token = batchToken;
+        task.finish = finish;
+        task.remaining = remaining;
+        enqueue(priority, std::move(task));
+    }
+    return id;
+}
+
+/**
+ * @brief 分配任务编号和取消标记，非空键下的旧任务被新任务取代
+ * @param key 任务键
+ * @param token 新任务的取消标记（输出参数）
+ * @return 返回任务编号
+ */
+quint64 TaskScheduler::registerTask(const QString &key, CancellationToken &token)
+{
+    const quint64 id = nextId++;
+    token.flag = QSharedPointer<QAtomicInt>::create(0);
+    if (!key.isEmpty()) {
+        cancel(key);
+        latestByKey.insert(key, qMakePair(id, token));
+    }
+    return id;
+}
+
+/**
+ * @brief 把任务轮流放入各工作线程的队列并唤醒一个空闲线程
+ * @param priority 优先级
+ * @param task 任务
+ */
+void TaskScheduler::enqueue(Priority priority, Task task)
+{
+    Worker *worker = workers[nextWorker];
+    nextWorker = (nextWorker + 1) % workers.size();
+    {
+        QMutexLocker locker(&worker->mutex);
+        worker->queues[qBound(0, int(priority), PriorityCount - 1)].push_back(std::move(task));
+    }
+    queuedTasks.ref();
+
+    QMutexLocker locker(&sleepMutex);
+    wakeCondition.wakeOne();
+}
+
+/**
+ * @brief 取消某个键下尚未交付的任务
+ */
+void TaskScheduler::cancel(const QString &key)
+{
+    auto it = latestByKey.find(key);
+    if (it != latestByKey.end()) {
+        it->second.flag->storeRelaxed(1);
+        latestByKey.erase(it);
+    }
+}
+
+/**
+ * @brief 设置每批交付结果最多占用的时间
+ * @param ms 毫秒数
+ */
+void TaskScheduler::setDeliveryBudget(int ms)
+{
+    deliveryBudgetMs = qMax(1, ms);
+}
+
+/**
+ * @brief 按优先级取一个任务：先取自己队列的尾部，再窃取其它线程队列的头部
+ * @param self 当前工作线程下标
+ * @param task 取出的任务（输出参数）
+ * @param priority 任务的优先级（输出参数）
+ * @return 取到任务返回true
+ */
+bool TaskScheduler::takeTask(int self, Task &task, int &priority)
+{
+    for (priority = 0; priority < PriorityCount; ++priority) {
+        {
+            Worker *own = workers[self];
+            QMutexLocker locker(&own->mutex);
+            std::deque<Task> &queue = own->queues[priority];
+            if (!queue.empty()) {
+                task = std::move(queue.back());
+                queue.pop_back();
+                queuedTasks.deref();
+                return true;
+            }
+        }
+        for (int offset = 1; offset < workers.size(); ++offset) {
+            Worker *victim = workers[(self + offset) % workers.size()];
+            QMutexLocker locker(&victim->mutex);
+            std::deque<Task> &queue = victim->queues[priority];
+            if (!queue.empty()) {
+                task = std::move(queue.front());
+                queue.pop_front();
+                queuedTasks.deref();
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 工作线程主循环
+ * @param self 当前工作线程下标
+ */
+void TaskScheduler::runWorker(int self)
+{
+    forever {
+        Task task;
+        int priority = Background;
+        if (!takeTask(self, task, priority)) {
+            QMutexLocker locker(&sleepMutex);
+            if (stopping) {
+                return;
+            }
+            if (queuedTasks.loadAcquire() == 0) {
+                wakeCondition.wait(&sleepMutex);
+            }
+            continue;
+        }
+
+        // 排队期间已被取代的任务直接丢弃
+        if (task.token.isCancelled()) {
+            continue;
+        }
+        task.work(task.token);
+        if (task.token.isCancelled()) {
+            continue;
+        }
+        if (task.remaining) {
+            // 同批还有子任务未完成时由它们继续；最后完成的子任务汇总并交付
+            if (task.remaining->deref()) {
+                continue;
+            }
+            task.finish(task.token);
+            if (task.token.isCancelled()) {
+                continue;
+            }
+        }
+
+        Result result;
+        result.id = task.id;
+        result.key = task.key;
+        result.priority = priority;
+        result.done = std::move(task.done);
+        result.token = task.token;
+
+        QMutexLocker locker(&resultMutex);
+        results.append(std::move(result));
+        if (!deliveryScheduled) {
+            deliveryScheduled = true;
+            QMetaObject::invokeMethod(this, [this]() { deliverResults(); }, Qt::QueuedConnection);
+        }
+    }
+}
+
+/**
+ * @brief 在调度器所在线程中批量交付结果，按优先级调用回调，超出时间预算的留到下一轮
+ */
+void TaskScheduler::deliverResults()
+{
+    QVector<Result> batch;
+    {
+        QMutexLocker locker(&resultMutex);
+        batch.swap(results);
+        deliveryScheduled = false;
+    }
+    std::stable_sort(batch.begin(), batch.end(), [](const Result &a, const Result &b) {
+        return a.priority < b.priority;
+    });
+
+    QElapsedTimer timer;
+    timer.start();
+    int index = 0;
+    for (; index < batch.size(); ++index) {
+        if (index > 0 && timer.elapsed() >= deliveryBudgetMs) {
+            break;
+        }
+        const Result &result = batch[index];
+        if (result.token.isCancelled()) {
+            continue;
+        }
+        if (!result.key.isEmpty()) {
+            // 只交付同一键下最新提交的任务
+            auto it = latestByKey.find(result.key);
+            if (it == latestByKey.end() || it->first != result.id) {
+                continue;
+            }
+            latestByKey.erase(it);
+        }
+        if (result.done) {
+            result.done();
+        }
+    }
+
+    if (index < batch.size()) {
+        QMutexLocker locker(&resultMutex);
+        results = batch.mid(index) + results;
+        if (!deliveryScheduled) {
+            deliveryScheduled = true;
+            QMetaObject::invokeMethod(this, [this]() { deliverResults(); }, Qt::QueuedConnection);
+        }
+    }
+}
@@ -0,0 +1,225 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 21:52:40
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 21:52:40
+ * @Description: 带优先级、可取消的后台计算调度器（工作窃取线程池）
+ */
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QSharedPointer>
+#include <deque>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+class QThread;
+
+/*
+    图表重建、统计、校验等计算提交到 TaskScheduler，在工作线程中执行：
+
+    - 每个工作线程有自己的任务队列（每个优先级一个双端队列），新任务轮流放入
+      各线程的队列；线程先从自己队列的尾部取任务，空闲时从其它线程队列的头部
+      窃取，按 Interactive → Visible → Background 的顺序查找，高优先级任务总是先执行；
+    - 任务可以带一个键，同一键提交新任务时旧任务被取消：尚未开始的直接丢弃，
+      已在执行的通过 CancellationToken 感知并尽早返回，其结果也不会交付；
+    - 可拆分的计算用 submitBatch 提交为一批子任务，子任务按同一优先级分散到各线程
+      的队列并共享取消标记，最后完成的子任务所在线程负责汇总，再交付一次结果；
+      这样并行计算也受优先级约束，不会在工作线程之外再启动线程池而超额占用CPU；
+    - 结果由工作线程放入结果队列，再通过一次排队调用批量交付到调度器所在线程
+      （GUI线程），按优先级顺序调用回调；每批最多占用 deliveryBudgetMs 毫秒，
+      剩余结果留到下一轮事件循环，界面不会因大量结果而卡顿。
+
+    任务函数运行在工作线程中，只能访问自身捕获的数据（如 LedgerSnapshot），
+    不能访问模型和界面；回调在GUI线程中执行。
+*/
+class TaskScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 任务优先级，数值越小越先执行
+     */
+    enum Priority {
+        Interactive,        //!< 交互式重算（用户正在等待的结果）
+        Visible,            //!< 当前可见的图表数据
+        Background,         //!< 后台索引、校验与报表
+        PriorityCount
+    };
+
+    /**
+     * @brief 取消标记，任务函数可在循环中轮询
+     */
+    class CancellationToken
+    {
+    public:
+        bool isCancelled() const { return flag && flag->loadRelaxed() != 0; }
+
+    private:
+        friend class TaskScheduler;
+        QSharedPointer<QAtomicInt> flag;
+    };
+
+    /**
+     * @brief 构造函数
+     * @param threadCount 工作线程数，不大于0时使用CPU核心数
+     * @param parent 父对象指针
+     */
+    explicit TaskScheduler(int threadCount = 0, QObject *parent = nullptr);
+
+    /**
+     * @brief 析构函数，取消全部任务并等待工作线程退出
+     */
+    ~TaskScheduler();
+
+    /**
+     * @brief 提交任务
+     * @param key 任务键，非空时取消同一键下尚未交付的旧任务
+     * @param priority 优先级
+     * @param work 在工作线程中执行的函数，参数为取消标记，返回值交给done
+     * @param done 在调度器所在线程中调用的回调，参数为work的返回值
+     * @return 返回任务编号
+     */
+    template <typename Work, typename Done>
+    quint64 submit(const QString &key, Priority priority, Work work, Done done)
+    {
+        typedef typename std::decay<decltype(work(std::declval<const CancellationToken &>()))>::type Result;
+        QSharedPointer<Result> result = QSharedPointer<Result>::create();
+        return post(key, priority,
+                    [work, result](const CancellationToken &token) { *result = work(token); },
+                    [done, result]() { done(*result); });
+    }
+
+    /**
+     * @brief 提交一批可并行执行的子任务，全部完成后汇总
+     * @param key 任务键，非空时取消同一键下尚未交付的旧任务（整批一起取消）
+     * @param priority 优先级
+     * @param count 子任务数
+     * @param part 在工作线程中执行的子任务，参数为子任务序号和取消标记，返回值交给reduce
+     * @param reduce 全部子任务完成后在工作线程中调用，参数为按序号排列的子任务结果和取消标记，返回值交给done
+     * @param done 在调度器所在线程中调用的回调，参数为reduce的返回值
+     * @return 返回任务编号
+     */
+    template <typename Part, typename Reduce, typename Done>
+    quint64 submitBatch(const QString &key, Priority priority, int count, Part part, Reduce reduce, Done done)
+    {
+        typedef typename std::decay<decltype(part(0, std::declval<const CancellationToken &>()))>::type PartResult;
+        typedef typename std::decay<decltype(reduce(std::declval<const QVector<PartResult> &>(),
+                                                    std::declval<const CancellationToken &>()))>::type Result;
+        QSharedPointer<QVector<PartResult>> parts = QSharedPointer<QVector<PartResult>>::create(qMax(0, count));
+        QSharedPointer<Result> result = QSharedPointer<Result>::create();
+        return postBatch(key, priority, count,
+                         [part, parts](int index, const CancellationToken &token) {
+                             (*parts)[index] = part(index, token);
+                         },
+                         [reduce, parts, result](const CancellationToken &token) { *result = reduce(*parts, token); },
+                         [done, result]() { done(*result); });
+    }
+
+    /**
+     * @brief 提交任务（类型擦除形式）
+     * @param key 任务键，非空时取消同一键下尚未交付的旧任务
+     * @param priority 优先级
+     * @param work 在工作线程中执行的函数
+     * @param done 在调度器所在线程中调用的回调
+     * @return 返回任务编号
+     */
+    quint64 post(const QString &key, Priority priority,
+                 std::function<void(const CancellationToken &)> work, std::function<void()> done);
+
+    /**
+     * @brief 提交一批子任务（类型擦除形式）
+     * @param key 任务键，非空时取消同一键下尚未交付的旧任务
+     * @param priority 优先级
+     * @param count 子任务数，不大于0时只执行finish
+     * @param part 在工作线程中执行的子任务，参数为子任务序号
+     * @param finish 最后一个子任务完成后在同一工作线程中执行
+     * @param done 在调度器所在线程中调用的回调
+     * @return 返回任务编号
+     */
+    quint64 postBatch(const QString &key, Priority priority, int count,
+                      std::function<void(int, const CancellationToken &)> part,
+                      std::function<void(const CancellationToken &)> finish, std::function<void()> done);
+
+    /**
+     * @brief 取消某个键下尚未交付的任务
+     */
+    void cancel(const QString &key);
+
+    /**
+     * @brief 设置每批交付结果最多占用的时间
+     * @param ms 毫秒数
+     */
+    void setDeliveryBudget(int ms);
+
+    int threadCount() const { return workers.size(); }
+
+private:
+    /**
+     * @brief 排队中的任务
+     */
+    struct Task
+    {
+        quint64 id = 0;
+        QString key;
+        std::function<void(const CancellationToken &)> work;
+        std::function<void()> done;
+        CancellationToken token;
+        std::function<void(const CancellationToken &)> finish;  //!< 批内最后完成的子任务执行的汇总，独立任务为空
+        QSharedPointer<QAtomicInt> remaining;                   //!< 批内尚未完成的子任务数，独立任务为空
+    };
+
+    /**
+     * @brief 等待交付的结果
+     */
+    struct Result
+    {
+        quint64 id = 0;
+        QString key;
+        int priority = Background;
+        std::function<void()> done;
+        CancellationToken token;
+    };
+
+    /**
+     * @brief 工作线程及其各优先级的任务队列
+     */
+    struct Worker
+    {
+        QMutex mutex;
+        std::deque<Task> queues[PriorityCount];
+        QThread *thread = nullptr;
+    };
+
+    quint64 registerTask(const QString &key, CancellationToken &token);
+    void enqueue(Priority priority, Task task);
+    bool takeTask(int self, Task &task, int &priority);
+    void runWorker(int self);
+    void deliverResults();
+
+    QVector<Worker*> workers;                       //!< 工作线程
+    QMutex sleepMutex;                              //!< 保护空闲等待与退出标记
+    QWaitCondition wakeCondition;                   //!< 有新任务时唤醒空闲线程
+    QAtomicInt queuedTasks;                         //!< 排队中的任务数
+    bool stopping = false;                          //!< 正在退出
+
+    QMutex resultMutex;                             //!< 保护结果队列
+    QVector<Result> results;                        //!< 等待交付的结果
+    bool deliveryScheduled = false;                 //!< 已安排下一批交付
+
+    QHash<QString, QPair<quint64, CancellationToken>> latestByKey; //!< 键 → 最新提交的任务（仅调度器线程访问）
+    quint64 nextId = 1;                             //!< 下一个任务编号
+    int nextWorker = 0;                             //!< 下一个接收新任务的工作线程
+    int deliveryBudgetMs = 8;                       //!< 每批交付的时间上限
+};
+
+#endif // TASKSCHEDULER_H
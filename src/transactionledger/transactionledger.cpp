@@ -0,0 +1,296 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 19:48:12
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 19:48:12
+ * @Description: 收支明细子账本与分类/月/年三级汇总
+ */
+#include "transactionledger.h"
+#include "ledgerrecord.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QDebug>
+#include <algorithm>
+
+/**
+ * @brief 获取账本对应的明细文件路径
+ * @param ledgerPath 账本文件路径
+ * @return 返回与账本同目录、同名的.tx.csv文件路径
+ */
+QString TransactionLedger::filePathFor(const QString &ledgerPath)
+{
+    QFileInfo info(ledgerPath);
+    return info.absolutePath() + "/" + info.completeBaseName() + ".tx.csv";
+}
+
+/**
+ * @brief 读取明细文件并重建汇总，文件不存在时得到空的子账本
+ * @param filePath 明细文件路径
+ * @return 文件存在但无法读取时返回false
+ */
+bool TransactionLedger::open(const QString &filePath)
+{
+    clear();
+    this->filePath = filePath;
+
+    QFile file(filePath);
+    if (!file.exists()) {
+        return true;
+    }
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return false;
+    }
+
+    QTextStream in(&file);
+    int skipped = 0;
+    while (!in.atEnd()) {
+        const QString line = in.readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        const QStringList fields = line.split(',');
+        bool ok = false;
+        const QDate date = fields.size() >= 3 ? LedgerRecord::parseDate(fields[0]) : QDate();
+        const qint64 cents = fields.size() >= 3 ? LedgerRecord::parseCents(fields[2], &ok) : 0;
+        if (!date.isValid() || !ok) {
+            ++skipped;
+            continue;
+        }
+
+        Transaction transaction;
+        transaction.julianDay = qint32(date.toJulianDay());
+        transaction.category = categoryId(fields[1].trimmed());
+        transaction.cents = cents;
+        if (fields.size() > 3) {
+            transaction.note = notes.intern(fields.mid(3).join(QChar(0xFF0C)).trimmed());
+        }
+        insert(transaction);
+    }
+    if (skipped > 0) {
+        qDebug() << "TransactionLedger: skipped" << skipped << "malformed lines in" << filePath;
+    }
+    return true;
+}
+
+/**
+ * @brief 清空明细和汇总
+ */
+void TransactionLedger::clear()
+{
+    for (const Transaction &transaction : transactions) {
+        notes.release(transaction.note);
+    }
+    transactions.clear();
+    categoryNames.clear();
+    categoryIds.clear();
+    categoryRollup.clear();
+    monthRollup.clear();
+    yearRollup.clear();
+    monthCategoryList.clear();
+    expenseSketches.clear();
+}
+
+/**
+ * @brief 新增一笔明细，追加到明细文件并增量更新汇总
+ * @param date 日期
+ * @param category 分类
+ * @param cents 金额（分），收入为正、支出为负
+ * @param note 备注
+ * @return 成功返回true
+ */
+bool TransactionLedger::add(const QDate &date, const QString &category, qint64 cents, const QString &note)
+{
+    if (!date.isValid() || cents == 0) {
+        return false;
+    }
+    Entry entry;
+    entry.date = date;
+    entry.category = category;
+    entry.cents = cents;
+    entry.note = note;
+    return addAll({entry});
+}
+
+/**
+ * @brief 批量新增明细：一次打开文件顺序写入全部明细后再更新汇总
+ * @param entries 明细列表，日期无效或金额为0的条目被忽略
+ * @return 成功返回true
+ */
+bool TransactionLedger::addAll(const QVector<Entry> &entries)
+{
+    if (filePath.isEmpty()) {
+        return false;
+    }
+
+    // 先写文件再更新内存，写入失败时内存与文件保持一致
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+        return false;
+    }
+    QVector<Entry> accepted;
+    accepted.reserve(entries.size());
+    QTextStream out(&file);
+    for (const Entry &entry : entries) {
+        if (!entry.date.isValid() || entry.cents == 0) {
+            continue;
+        }
+        Entry normalized = entry;
+        normalized.category = normalizeField(entry.category);
+        normalized.note = normalizeField(entry.note);
+        out << normalized.date.toString("yyyy/MM/dd") << "," << normalized.category << "," << LedgerRecord::formatCents(normalized.cents);
+        if (!normalized.note.isEmpty()) {
+            out << "," << normalized.note;
+        }
+        out << "\n";
+        accepted.append(normalized);
+    }
+    out.flush();
+    if (file.error() != QFileDevice::NoError) {
+        return false;
+    }
+
+    transactions.reserve(transactions.size() + accepted.size());
+    for (const Entry &entry : accepted) {
+        Transaction transaction;
+        transaction.julianDay = qint32(entry.date.toJulianDay());
+        transaction.category = categoryId(entry.category);
+        transaction.cents = entry.cents;
+        transaction.note = notes.intern(entry.note);
+        insert(transaction);
+    }
+    return true;
+}
+
+/**
+ * @brief 把分类或备注规范化为明细文件中保存的形式（去除首尾空白，逗号替换为全角逗号）
+ */
+QString TransactionLedger::normalizeField(const QString &text)
+{
+    QString result = text.trimmed();
+    result.replace(',', QChar(0xFF0C));
+    result.replace('\n', ' ');
+    return result;
+}
+
+/**
+ * @brief 获取有明细的年份（升序）
+ */
+QList<int> TransactionLedger::years() const
+{
+    QList<int> result = yearRollup.keys();
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+/**
+ * @brief 获取某年有明细的月份（升序）
+ */
+QList<int> TransactionLedger::months(int year) const
+{
+    QList<int> result;
+    for (int month = 1; month <= 12; ++month) {
+        if (monthRollup.contains(monthKey(year, month))) {
+            result.append(month);
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief 获取某月有明细的分类编号（按首次出现顺序）
+ */
+QVector<quint32> TransactionLedger::monthCategories(int year, int month) const
+{
+    return monthCategoryList.value(monthKey(year, month));
+}
+
+TransactionLedger::Totals TransactionLedger::yearTotals(int year) const
+{
+    return yearRollup.value(year);
+}
+
+TransactionLedger::Totals TransactionLedger::monthTotals(int year, int month) const
+{
+    return monthRollup.value(monthKey(year, month));
+}
+
+TransactionLedger::Totals TransactionLedger::categoryTotals(int year, int month, quint32 category) const
+{
+    return categoryRollup.value(categoryKey(monthKey(year, month), category));
+}
+
+/**
+ * @brief 获取某年某分类单笔支出金额（元，正数）的分位数草图
+ * @return 该年该分类没有支出时返回nullptr
+ */
+const QuantileSketch *TransactionLedger::expenseSketch(int year, quint32 category) const
+{
+    auto it = expenseSketches.constFind(sketchKey(year, category));
+    return it == expenseSketches.constEnd() ? nullptr : &it.value();
+}
+
+/**
+ * @brief 合并各年份的草图，得到某分类全部单笔支出的分位数草图
+ * @param category 分类编号
+ */
+QuantileSketch TransactionLedger::categoryExpenseSketch(quint32 category) const
+{
+    QuantileSketch merged;
+    for (int year : yearRollup.keys()) {
+        if (const QuantileSketch *sketch = expenseSketch(year, category)) {
+            merged.merge(*sketch);
+        }
+    }
+    return merged;
+}
+
+/**
+ * @brief 把一笔金额累加到汇总值
+ */
+void TransactionLedger::accumulate(Totals &totals, qint64 cents)
+{
+    if (cents >= 0) {
+        totals.income += cents;
+    } else {
+        totals.expense -= cents;
+    }
+    ++totals.count;
+}
+
+/**
+ * @brief 获取分类编号，新分类分配下一个编号
+ */
+quint32 TransactionLedger::categoryId(const QString &name)
+{
+    auto it = categoryIds.constFind(name);
+    if (it != categoryIds.constEnd()) {
+        return it.value();
+    }
+    const quint32 id = quint32(categoryNames.size());
+    categoryNames.append(name);
+    categoryIds.insert(name, id);
+    return id;
+}
+
+/**
+ * @brief 保存明细并逐级更新汇总：分类×月、月、年各更新一个条目
+ */
+void TransactionLedger::insert(const Transaction &transaction)
+{
+    transactions.append(transaction);
+
+    const QDate date = QDate::fromJulianDay(transaction.julianDay);
+    const int month = monthKey(date.year(), date.month());
+
+    Totals &categoryTotals = categoryRollup[categoryKey(month, transaction.category)];
+    if (categoryTotals.isEmpty()) {
+        monthCategoryList[month].append(transaction.category);
+    }
+    accumulate(categoryTotals, transaction.cents);
+    accumulate(monthRollup[month], transaction.cents);
+    accumulate(yearRollup[date.year()], transaction.cents);
+    if (transaction.cents < 0) {
+        expenseSketches[sketchKey(date.year(), transaction.category)].add(-transaction.cents / 100.0);
+    }
+}
@@ -0,0 +1,174 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 19:48:12
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 19:48:12
+ * @Description: 收支明细子账本与分类/月/年三级汇总
+ */
+#ifndef TRANSACTIONLEDGER_H
+#define TRANSACTIONLEDGER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QDate>
+#include "notepool.h"
+#include "quantilesketch.h"
+
+/*
+    月度账本中每行是一次月末快照，当月开支只能由"上月总存款 + 工资 - 本月总存款"推算。
+    TransactionLedger 记录每一笔带分类的收入/支出，并维护三级汇总：
+    分类×月 → 月 → 年。每插入一笔明细只更新这三个哈希表中的各一个条目，
+    摊还 O(1)，不需要重新遍历明细；月度记录的当月工资/当月开支由月汇总得到。
+
+    明细保存在账本同目录的 <账本名>.tx.csv 中，每行"日期,分类,金额"加可选的备注，
+    金额以元为单位，收入为正、支出为负；新增明细只追加到文件末尾。
+    明细本身按 24 字节紧凑保存（儒略日、分、分类编号、备注句柄），百万级明细约占 24MB。
+    每笔支出同时插入所属（年, 分类）的分位数草图，单笔支出的中位数、P90 等
+    直接从草图读取，跨年份或跨分类时合并草图，不需要排序明细。
+*/
+class TransactionLedger
+{
+public:
+    /**
+     * @brief 汇总值（单位：分）
+     */
+    struct Totals
+    {
+        qint64 income = 0;      //!< 收入合计
+        qint64 expense = 0;     //!< 支出合计（正数）
+        qint64 count = 0;       //!< 明细笔数
+        qint64 net() const { return income - expense; }
+        bool isEmpty() const { return count == 0; }
+    };
+
+    /**
+     * @brief 一笔收支明细
+     */
+    struct Transaction
+    {
+        qint32 julianDay = 0;                       //!< 日期（儒略日）
+        quint32 category = 0;                       //!< 分类编号
+        qint64 cents = 0;                           //!< 金额（分），收入为正、支出为负
+        NotePool::Handle note = NotePool::EmptyHandle;  //!< 备注句柄
+    };
+
+    /**
+     * @brief 待新增的明细
+     */
+    struct Entry
+    {
+        QDate date;             //!< 日期
+        QString category;       //!< 分类
+        qint64 cents = 0;       //!< 金额（分），收入为正、支出为负
+        QString note;           //!< 备注
+    };
+
+    TransactionLedger() = default;
+
+    /**
+     * @brief 获取账本对应的明细文件路径
+     * @param ledgerPath 账本文件路径
+     * @return 返回与账本同目录、同名的.tx.csv文件路径
+     */
+    static QString filePathFor(const QString &ledgerPath);
+
+    /**
+     * @brief 读取明细文件并重建汇总，文件不存在时得到空的子账本
+     * @param filePath 明细文件路径
+     * @return 文件存在但无法读取时返回false
+     */
+    bool open(const QString &filePath);
+
+    /**
+     * @brief 清空明细和汇总
+     */
+    void clear();
+
+    /**
+     * @brief 新增一笔明细，追加到明细文件并增量更新汇总
+     * @param date 日期
+     * @param category 分类
+     * @param cents 金额（分），收入为正、支出为负
+     * @param note 备注
+     * @return 成功返回true
+     */
+    bool add(const QDate &date, const QString &category, qint64 cents, const QString &note = QString());
+
+    /**
+     * @brief 批量新增明细：一次打开文件顺序写入全部明细后再更新汇总（导入流水使用）
+     * @param entries 明细列表，日期无效或金额为0的条目被忽略
+     * @return 成功返回true
+     */
+    bool addAll(const QVector<Entry> &entries);
+
+    /**
+     * @brief 把分类或备注规范化为明细文件中保存的形式（去除首尾空白，逗号替换为全角逗号）
+     */
+    static QString normalizeField(const QString &text);
+
+    int count() const { return transactions.size(); }
+    const Transaction &at(int index) const { return transactions[index]; }
+    QString categoryName(quint32 category) const { return categoryNames.value(category); }
+    QString noteText(const Transaction &transaction) const { return notes.text(transaction.note); }
+    QStringView noteView(const Transaction &transaction) const { return notes.view(transaction.note); }
+
+    /**
+     * @brief 获取全部分类名称（按首次出现顺序）
+     */
+    QStringList categories() const { return categoryNames; }
+
+    /**
+     * @brief 获取有明细的年份（升序）
+     */
+    QList<int> years() const;
+
+    /**
+     * @brief 获取某年有明细的月份（升序）
+     */
+    QList<int> months(int year) const;
+
+    /**
+     * @brief 获取某月有明细的分类编号（按首次出现顺序）
+     */
+    QVector<quint32> monthCategories(int year, int month) const;
+
+    Totals yearTotals(int year) const;
+    Totals monthTotals(int year, int month) const;
+    Totals categoryTotals(int year, int month, quint32 category) const;
+
+    /**
+     * @brief 获取某年某分类单笔支出金额（元，正数）的分位数草图
+     * @return 该年该分类没有支出时返回nullptr
+     */
+    const QuantileSketch *expenseSketch(int year, quint32 category) const;
+
+    /**
+     * @brief 合并各年份的草图，得到某分类全部单笔支出的分位数草图
+     * @param category 分类编号
+     */
+    QuantileSketch categoryExpenseSketch(quint32 category) const;
+
+private:
+    static int monthKey(int year, int month) { return year * 12 + (month - 1); }
+    static quint64 categoryKey(int monthKey, quint32 category) { return (quint64(quint32(monthKey)) << 32) | category; }
+    static quint64 sketchKey(int year, quint32 category) { return (quint64(quint32(year)) << 32) | category; }
+    static void accumulate(Totals &totals, qint64 cents);
+
+    quint32 categoryId(const QString &name);
+    void insert(const Transaction &transaction);
+
+    QString filePath;                               //!< 明细文件路径
+    QVector<Transaction> transactions;              //!< 全部明细（按录入顺序）
+    NotePool notes;                                 //!< 明细备注驻留池
+    QStringList categoryNames;                      //!< 分类编号 → 名称
+    QHash<QString, quint32> categoryIds;            //!< 名称 → 分类编号
+    QHash<quint64, Totals> categoryRollup;          //!< (月, 分类) → 汇总
+    QHash<int, Totals> monthRollup;                 //!< 月 → 汇总
+    QHash<int, Totals> yearRollup;                  //!< 年 → 汇总
+    QHash<int, QVector<quint32>> monthCategoryList; //!< 月 → 有明细的分类
+    QHash<quint64, QuantileSketch> expenseSketches; //!< (年, 分类) → 单笔支出分位数草图
+};
+
+#endif // TRANSACTIONLEDGER_H
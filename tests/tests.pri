@@ -0,0 +1,17 @@
+# 各测试共用的配置：只依赖 Qt Test，被测模块的源文件直接编译进测试程序
+QT += testlib gui
+QT -= widgets
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+LEDGER_SRC = $$PWD/../src
+
+# 账本记录的头文件包含路径，被测模块的路径由各测试自己添加
+INCLUDEPATH += $$LEDGER_SRC/ledgermanager $$LEDGER_SRC/notepool
+
+# 账本记录及其依赖的备注驻留池，多数被测模块都需要
+LEDGER_RECORD_SOURCES = \
+    $$LEDGER_SRC/ledgermanager/ledgerrecord.cpp \
+    $$LEDGER_SRC/notepool/notepool.cpp \
+    $$LEDGER_SRC/notepool/noteitem.cpp
@@ -0,0 +1,14 @@
+# 单元测试：qmake tests/tests.pro && make check
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    tst_quantilesketch \
+    tst_ledgerarchive \
+    tst_statementimporter \
+    tst_budgetrules \
+    tst_taskscheduler \
+    tst_ledgersnapshot \
+    tst_recomputeengine \
+    tst_csvledgerstorage \
+    tst_historypager \
+    tst_ledgermerger
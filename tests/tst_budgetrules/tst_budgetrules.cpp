@@ -0,0 +1,327 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 23:59:05
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 23:59:05
+ * @Description: BudgetRules 单元测试：规则编译、字节码求值与增量聚合
+ */
+#include <QtTest>
+#include <QRandomGenerator>
+#include <cmath>
+#include <limits>
+#include "budgetrules.h"
+
+namespace {
+
+const int SalaryIndex = ColSalary - ColTotalDeposit;
+const int FixedIndex = ColFixedDeposit - ColTotalDeposit;
+const int ExpenseIndex = ColExpense - ColTotalDeposit;
+const double NaN = std::numeric_limits<double>::quiet_NaN();
+
+/**
+ * @brief 设置记录的一个金额列（元），NaN 表示空单元格
+ */
+void setAmount(LedgerRecord &record, int index, double yuan)
+{
+    if (std::isnan(yuan)) {
+        record.presentMask &= quint8(~(1u << index));
+        return;
+    }
+    record.amounts[index] = qRound64(yuan * 100);
+    record.presentMask |= quint8(1u << index);
+}
+
+/**
+ * @brief 构造一条只有工资和开支的记录
+ */
+LedgerRecord makeRecord(double salary, double expense)
+{
+    LedgerRecord record;
+    record.date = QDate(2024, 1, 31);
+    setAmount(record, SalaryIndex, salary);
+    setAmount(record, ExpenseIndex, expense);
+    return record;
+}
+
+/**
+ * @brief 直接在全部历史上计算聚合值，作为增量结果的对照
+ * @param function prev/avg/sum/min/max
+ * @param history 历史开支（NaN 表示空）
+ * @param window 窗口长度
+ */
+double bruteForce(const QString &function, const QVector<double> &history, int window)
+{
+    if (function == "prev") {
+        return history.isEmpty() ? NaN : history.last();
+    }
+    QVector<double> values;
+    for (qsizetype i = qMax<qsizetype>(0, history.size() - window); i < history.size(); ++i) {
+        if (!std::isnan(history[i])) {
+            values.append(history[i]);
+        }
+    }
+    if (values.isEmpty()) {
+        return NaN;
+    }
+    double result = function == "min" || function == "max" ? values.first() : 0.0;
+    for (double value : values) {
+        if (function == "min") {
+            result = qMin(result, value);
+        } else if (function == "max") {
+            result = qMax(result, value);
+        } else {
+            result += value;
+        }
+    }
+    return function == "avg" ? result / values.size() : result;
+}
+
+} // namespace
+
+class TestBudgetRules : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void defaultRulesCompile();
+    void reportsCompileErrors();
+    void evaluatesExpressions_data();
+    void evaluatesExpressions();
+    void missingValuesNeverFire();
+    void incrementalAggregatesMatchBruteForce_data();
+    void incrementalAggregatesMatchBruteForce();
+    void sharesAggregateSlots();
+    void resetClearsHistory();
+};
+
+/**
+ * @brief 默认规则全部可以编译
+ */
+void TestBudgetRules::defaultRulesCompile()
+{
+    BudgetRules rules;
+    QStringList errors;
+    QCOMPARE(rules.setText(BudgetRules::defaultText(), &errors), 3);
+    QVERIFY2(errors.isEmpty(), qPrintable(errors.join('\n')));
+    QCOMPARE(rules.historyDepth(), 6);
+}
+
+/**
+ * @brief 无法编译的规则被跳过，错误信息带行号，其余规则照常生效
+ */
+void TestBudgetRules::reportsCompileErrors()
+{
+    BudgetRules rules;
+    QStringList errors;
+    const QString text =
+        "# 注释\n"
+        "正常: expense > 100\n"
+        "不完整: expense >\n"
+        "没有名称的行\n"
+        "未知列: bonus > 1\n"
+        "窗口为0: avg(expense, 0) > 1\n"
+        "窗口过大: avg(expense, 241) > 1\n"
+        "参数不是列: avg(1, 3) > 1\n"
+        "括号不配对: (expense > 1\n"
+        "多余内容: expense > 1 2\n"
+        "全角冒号：开支 > 200\n";
+    QCOMPARE(rules.setText(text, &errors), 2);
+    QCOMPARE(int(errors.size()), 8);
+    QVERIFY(errors[0].startsWith("第3行"));
+    QVERIFY(errors[1].contains("缺少规则名称"));
+    QVERIFY(errors[2].contains("bonus"));
+    QCOMPARE(rules.ruleName(0), QString("正常"));
+    QCOMPARE(rules.ruleName(1), QString("全角冒号"));
+
+    QString error;
+    QVERIFY(!rules.addRule("栈", "expense > (salary", &error));
+    QVERIFY(!error.isEmpty());
+    QCOMPARE(rules.ruleCount(), 2);
+
+    QCOMPARE(rules.evaluate(makeRecord(0, 150)), QStringList() << "正常");
+    QCOMPARE(rules.evaluate(makeRecord(0, 250)), QStringList() << "正常" << "全角冒号");
+}
+
+void TestBudgetRules::evaluatesExpressions_data()
+{
+    QTest::addColumn<QString>("expression");
+    QTest::addColumn<double>("salary");
+    QTest::addColumn<double>("expense");
+    QTest::addColumn<bool>("fires");
+
+    QTest::newRow("乘法优先") << "salary - expense * 2 > 100" << 1000.0 << 400.0 << true;
+    QTest::newRow("乘法优先-不触发") << "salary - expense * 2 > 100" << 1000.0 << 450.0 << false;
+    QTest::newRow("括号") << "(salary - expense) * 2 > 1000" << 1000.0 << 400.0 << true;
+    QTest::newRow("负号") << "-expense < -300" << 0.0 << 400.0 << true;
+    QTest::newRow("除法") << "expense / salary >= 0.5" << 1000.0 << 500.0 << true;
+    QTest::newRow("除以0") << "expense / salary >= 0" << 0.0 << 500.0 << false;
+    QTest::newRow("and") << "salary > 0 and expense > salary" << 100.0 << 200.0 << true;
+    QTest::newRow("&&") << "salary > 0 && expense > salary" << 0.0 << 200.0 << false;
+    QTest::newRow("or") << "salary > 500 or expense > 500" << 100.0 << 600.0 << true;
+    QTest::newRow("not") << "not (expense > 500)" << 0.0 << 100.0 << true;
+    QTest::newRow("!") << "!(expense > 500)" << 0.0 << 600.0 << false;
+    QTest::newRow("等于") << "expense == 12.34" << 0.0 << 12.34 << true;
+    QTest::newRow("不等于") << "expense != salary" << 5.0 << 5.0 << false;
+    QTest::newRow("中文列名") << "当月开支 > 工资" << 100.0 << 200.0 << true;
+    QTest::newRow("中文括号与乘号") << "开支 > 2 × （工资 - 50）" << 100.0 << 120.0 << true;
+}
+
+/**
+ * @brief 字节码的运算符、优先级与列名
+ */
+void TestBudgetRules::evaluatesExpressions()
+{
+    QFETCH(QString, expression);
+    QFETCH(double, salary);
+    QFETCH(double, expense);
+    QFETCH(bool, fires);
+
+    BudgetRules rules;
+    QString error;
+    QVERIFY2(rules.addRule("规则", expression, &error), qPrintable(error));
+    QCOMPARE(int(rules.evaluate(makeRecord(salary, expense)).size()), fires ? 1 : 0);
+}
+
+/**
+ * @brief 空单元格、缺少汇率和缺少历史记录时，规则不会触发
+ */
+void TestBudgetRules::missingValuesNeverFire()
+{
+    BudgetRules rules;
+    QVERIFY(rules.addRule("大于", "expense > 1"));
+    QVERIFY(rules.addRule("小于", "expense < 1"));
+    QVERIFY(rules.addRule("定期减少", "fixed < prev(fixed)"));
+
+    QVERIFY(rules.evaluate(makeRecord(100, NaN)).isEmpty());
+    QVERIFY(rules.evaluate(makeRecord(100, 50), NaN).isEmpty());
+
+    // 取反与逻辑运算同样不会因空值触发
+    BudgetRules negated;
+    QVERIFY(negated.addRule("不大于", "not expense > 1"));
+    QVERIFY(negated.addRule("取反", "!expense"));
+    QVERIFY(negated.addRule("或", "expense > 1 or salary > 1"));
+    QVERIFY(negated.addRule("且", "not (expense > 1 and salary > 1)"));
+    QVERIFY(negated.evaluate(makeRecord(100, NaN)).isEmpty());
+    QCOMPARE(negated.evaluate(makeRecord(100, 0.5)), QStringList() << "不大于" << "或" << "且");
+
+    // 没有上一条记录时 prev 为空
+    LedgerRecord record = makeRecord(100, 0.5);
+    setAmount(record, FixedIndex, 10);
+    QCOMPARE(rules.evaluate(record), QStringList() << "小于");
+
+    LedgerRecord previous = makeRecord(100, 0.5);
+    setAmount(previous, FixedIndex, 20);
+    rules.append(previous);
+    QCOMPARE(rules.evaluate(record), QStringList() << "小于" << "定期减少");
+
+    // 缺少汇率的历史记录按空值处理
+    rules.append(previous, NaN);
+    QCOMPARE(rules.evaluate(record), QStringList() << "小于");
+
+    // 换算系数同时作用于历史和待录入的记录：换算后上一条定期为2
+    rules.append(previous, 0.1);
+    QCOMPARE(rules.evaluate(record), QStringList() << "小于");
+    QCOMPARE(rules.evaluate(record, 0.1), QStringList() << "小于" << "定期减少");
+}
+
+void TestBudgetRules::incrementalAggregatesMatchBruteForce_data()
+{
+    QTest::addColumn<QString>("function");
+    QTest::addColumn<int>("window");
+
+    QTest::newRow("prev") << "prev" << 1;
+    QTest::newRow("avg 1") << "avg" << 1;
+    QTest::newRow("avg 6") << "avg" << 6;
+    QTest::newRow("sum 4") << "sum" << 4;
+    QTest::newRow("sum 12") << "sum" << 12;
+    QTest::newRow("min 3") << "min" << 3;
+    QTest::newRow("max 5") << "max" << 5;
+}
+
+/**
+ * @brief 逐条追加带空单元格的随机记录，每一步的增量聚合值都与直接计算的结果一致
+ *
+ * 以待录入记录的工资列作为探针：规则"聚合(expense) > salary"在工资略低于聚合值时
+ * 触发、略高于聚合值时不触发，聚合值为空时两者都不触发
+ */
+void TestBudgetRules::incrementalAggregatesMatchBruteForce()
+{
+    QFETCH(QString, function);
+    QFETCH(int, window);
+
+    const QString call = function == "prev" ? QString("prev(expense)") : QString("%1(expense, %2)").arg(function).arg(window);
+    BudgetRules rules;
+    QString error;
+    QVERIFY2(rules.addRule(call, call + " > salary", &error), qPrintable(error));
+    QCOMPARE(rules.historyDepth(), window);
+
+    QRandomGenerator generator(20261019);
+    QVector<double> history;
+    for (int step = 0; step < 300; ++step) {
+        const double expected = bruteForce(function, history, window);
+        const QStringList below = rules.evaluate(makeRecord(std::isnan(expected) ? 0.0 : expected - 0.5, 0));
+        const QStringList above = rules.evaluate(makeRecord(std::isnan(expected) ? 0.0 : expected + 0.5, 0));
+        if (std::isnan(expected)) {
+            QVERIFY2(below.isEmpty() && above.isEmpty(), qPrintable(QString("第%1步应为空值").arg(step)));
+        } else {
+            QVERIFY2(below.size() == 1 && above.isEmpty(),
+                     qPrintable(QString("第%1步：期望 %2").arg(step).arg(expected)));
+        }
+
+        // 约五分之一的记录开支为空，连续空值可以使整个窗口为空
+        const bool missing = generator.bounded(5) == 0 || (step >= 100 && step < 115);
+        const double expense = missing ? NaN : generator.bounded(100000) / 100.0 - 100.0;
+        history.append(expense);
+        rules.append(makeRecord(1000, expense));
+    }
+}
+
+/**
+ * @brief 多条规则引用相同的聚合时共用一个槽，各自的结果不受影响
+ */
+void TestBudgetRules::sharesAggregateSlots()
+{
+    BudgetRules rules;
+    QVERIFY(rules.addRule("高于均值", "expense > avg(expense, 3)"));
+    QVERIFY(rules.addRule("高于均值1.5倍", "expense > 1.5 * avg(expense, 3)"));
+    QVERIFY(rules.addRule("高于最大值", "expense > max(expense, 3)"));
+    QCOMPARE(rules.historyDepth(), 3);
+
+    for (double expense : {100.0, 200.0, 300.0}) {
+        rules.append(makeRecord(0, expense));
+    }
+    QCOMPARE(rules.evaluate(makeRecord(0, 250)), QStringList() << "高于均值");
+    QCOMPARE(rules.evaluate(makeRecord(0, 310)), QStringList() << "高于均值" << "高于均值1.5倍" << "高于最大值");
+
+    // 最早的100移出窗口后均值为 (200 + 300 + 50) / 3
+    rules.append(makeRecord(0, 50));
+    QCOMPARE(rules.evaluate(makeRecord(0, 190)), QStringList() << "高于均值");
+    QCOMPARE(rules.evaluate(makeRecord(0, 180)), QStringList());
+}
+
+/**
+ * @brief reset 清空历史但保留规则；setText 替换规则
+ */
+void TestBudgetRules::resetClearsHistory()
+{
+    BudgetRules rules;
+    QVERIFY(rules.addRule("开支增加", "expense > prev(expense)"));
+    rules.append(makeRecord(0, 100));
+    QCOMPARE(int(rules.evaluate(makeRecord(0, 150)).size()), 1);
+
+    rules.reset();
+    QCOMPARE(rules.ruleCount(), 1);
+    QVERIFY(rules.evaluate(makeRecord(0, 150)).isEmpty());
+
+    rules.append(makeRecord(0, 200));
+    QVERIFY(rules.evaluate(makeRecord(0, 150)).isEmpty());
+    QCOMPARE(int(rules.evaluate(makeRecord(0, 250)).size()), 1);
+
+    QCOMPARE(rules.setText("新规则: salary > 0"), 1);
+    QCOMPARE(rules.historyDepth(), 0);
+    QCOMPARE(rules.evaluate(makeRecord(1, 0)), QStringList() << "新规则");
+}
+
+QTEST_APPLESS_MAIN(TestBudgetRules)
+
+#include "tst_budgetrules.moc"
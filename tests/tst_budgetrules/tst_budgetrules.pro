@@ -0,0 +1,10 @@
+include(../tests.pri)
+
+TARGET = tst_budgetrules
+
+INCLUDEPATH += $$LEDGER_SRC/budgetrules
+
+SOURCES += \
+    tst_budgetrules.cpp \
+    $$LEDGER_SRC/budgetrules/budgetrules.cpp \
+    $$LEDGER_RECORD_SOURCES
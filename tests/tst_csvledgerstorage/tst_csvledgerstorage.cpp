@@ -0,0 +1,274 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 23:59:55
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 23:59:55
+ * @Description: CsvLedgerStorage 单元测试：读写往返、按行改写、追加与并发修改检测
+ */
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include "csvledgerstorage.h"
+
+namespace {
+
+/**
+ * @brief 第 index 条测试记录：每 5 条中有一条没有定期余额，每 4 条中有一条是港币
+ */
+LedgerRecord makeRecord(int index, const QString &note = QString())
+{
+    LedgerRecord record;
+    record.date = QDate(2018, 1, 31).addMonths(index);
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        if (i == ColFixedDeposit - ColTotalDeposit && index % 5 == 0) {
+            continue;
+        }
+        record.amounts[i] = 10000000 + qint64(index) * 12345 + i;
+        record.presentMask |= quint8(1u << i);
+    }
+    record.note = note.isNull() ? QString("第%1条").arg(index) : note;
+    record.currency = index % 4 == 3 ? QString("HKD") : QString();
+    return record;
+}
+
+/**
+ * @brief makeRecord(first) ~ makeRecord(first+count-1)
+ */
+QVector<LedgerRecord> makeRecords(int first, int count)
+{
+    QVector<LedgerRecord> records;
+    for (int i = first; i < first + count; ++i) {
+        records.append(makeRecord(i));
+    }
+    return records;
+}
+
+/**
+ * @brief 逐条比较两组记录，不一致时返回第一处差异
+ */
+QString firstDifference(const QVector<LedgerRecord> &actual, const QVector<LedgerRecord> &expected)
+{
+    if (actual.size() != expected.size()) {
+        return QString("记录数 %1，期望 %2").arg(actual.size()).arg(expected.size());
+    }
+    for (int i = 0; i < actual.size(); ++i) {
+        const LedgerRecord &a = actual[i];
+        const LedgerRecord &e = expected[i];
+        bool same = a.date == e.date && a.presentMask == e.presentMask && a.note == e.note && a.currency == e.currency;
+        for (int column = 0; same && column < LedgerAmountColumnCount; ++column) {
+            same = !e.hasAmount(column) || a.amounts[column] == e.amounts[column];
+        }
+        if (!same) {
+            return QString("第%1条：%2，期望 %3").arg(i).arg(CsvLedgerStorage::formatLine(i, a),
+                                                       CsvLedgerStorage::formatLine(i, e));
+        }
+    }
+    return QString();
+}
+
+/**
+ * @brief 用一个新实例读出文件中的全部记录
+ */
+QVector<LedgerRecord> readBack(const QString &path)
+{
+    CsvLedgerStorage storage(path);
+    QVector<LedgerRecord> records;
+    storage.readAll(records);
+    return records;
+}
+
+} // namespace
+
+class TestCsvLedgerStorage : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void writeReadRoundTrip();
+    void readsLegacyLines();
+    void writeFromKeepsEarlierRows();
+    void updateReplacesRows();
+    void readsRecordsAppendedElsewhere();
+    void rejectsWriteAfterExternalRewrite();
+};
+
+/**
+ * @brief 整体写入后由另一个实例读出，空单元格、备注与币种保持不变；查询按条件过滤
+ */
+void TestCsvLedgerStorage::writeReadRoundTrip()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("ledger.csv");
+    const QVector<LedgerRecord> records = makeRecords(0, 20);
+
+    CsvLedgerStorage storage(path);
+    QCOMPARE(storage.backend(), LedgerStorage::CsvBackend);
+    QVERIFY2(storage.writeAll(records), qPrintable(storage.errorString()));
+    QVERIFY(!storage.isModifiedExternally());
+
+    const QString difference = firstDifference(readBack(path), records);
+    QVERIFY2(difference.isEmpty(), qPrintable(difference));
+
+    QVector<LedgerRecord> tail;
+    QVERIFY(storage.readFrom(15, tail));
+    QVERIFY(firstDifference(tail, records.mid(15)).isEmpty());
+
+    QVERIFY(firstDifference(storage.query(records[3].date, records[6].date), records.mid(3, 4)).isEmpty());
+    QVERIFY(firstDifference(storage.queryByTotalDeposit(records[18].amounts[0], records[19].amounts[0]),
+                            records.mid(18)).isEmpty());
+}
+
+/**
+ * @brief 旧格式的行（没有序号列、没有币种列、最后一行没有换行符）可以读出，也可以在其后追加
+ */
+void TestCsvLedgerStorage::readsLegacyLines()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("ledger.csv");
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("2020/01/31,1000.00,200.00,,50.00,150.00,1000.00,旧备注\n"
+               "2,2020/02/29,1100.00,200.00,,100.00,100.00,1100.00,,USD");
+    file.close();
+
+    CsvLedgerStorage storage(path);
+    QVector<LedgerRecord> records;
+    QVERIFY(storage.readAll(records));
+    QCOMPARE(int(records.size()), 2);
+    QCOMPARE(records[0].note, QString("旧备注"));
+    QVERIFY(!records[0].hasAmount(ColFixedDeposit - ColTotalDeposit));
+    QCOMPARE(records[1].amounts[0], qint64(110000));
+    QCOMPARE(records[1].currency, QString("USD"));
+
+    QVERIFY2(storage.append(2, makeRecords(2, 1)), qPrintable(storage.errorString()));
+    const QVector<LedgerRecord> restored = readBack(path);
+    QCOMPARE(int(restored.size()), 3);
+    QVERIFY(firstDifference(restored.mid(2), makeRecords(2, 1)).isEmpty());
+}
+
+/**
+ * @brief writeFrom 只重写某行之后的记录，行数不足时失败且文件不变
+ */
+void TestCsvLedgerStorage::writeFromKeepsEarlierRows()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("ledger.csv");
+    CsvLedgerStorage storage(path);
+    QVERIFY(storage.writeAll(makeRecords(0, 10)));
+
+    const QVector<LedgerRecord> replacement = makeRecords(100, 3);
+    QVERIFY2(storage.writeFrom(6, replacement), qPrintable(storage.errorString()));
+    QVERIFY(firstDifference(readBack(path), makeRecords(0, 6) + replacement).isEmpty());
+
+    QVERIFY(!storage.writeFrom(20, replacement));
+    QVERIFY(!storage.errorString().isEmpty());
+    QCOMPARE(int(readBack(path).size()), 9);
+}
+
+/**
+ * @brief update 只替换指定行，行号超出范围时失败且文件不变
+ */
+void TestCsvLedgerStorage::updateReplacesRows()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("ledger.csv");
+    CsvLedgerStorage storage(path);
+    QVector<LedgerRecord> records = makeRecords(0, 8);
+    QVERIFY(storage.writeAll(records));
+
+    QMap<int, LedgerRecord> changes;
+    changes.insert(2, makeRecord(2, "改过"));
+    changes.insert(7, makeRecord(50));
+    QVERIFY2(storage.update(changes), qPrintable(storage.errorString()));
+    records[2] = changes[2];
+    records[7] = changes[7];
+    QVERIFY(firstDifference(readBack(path), records).isEmpty());
+
+    QMap<int, LedgerRecord> outOfRange;
+    outOfRange.insert(8, makeRecord(8));
+    QVERIFY(!storage.update(outOfRange));
+    QVERIFY(firstDifference(readBack(path), records).isEmpty());
+}
+
+/**
+ * @brief 另一个实例追加记录后，本实例的写入被拒绝；读出追加的记录并接受后可以继续追加
+ */
+void TestCsvLedgerStorage::readsRecordsAppendedElsewhere()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("ledger.csv");
+    CsvLedgerStorage mine(path);
+    QVERIFY(mine.writeAll(makeRecords(0, 5)));
+
+    CsvLedgerStorage other(path);
+    QVector<LedgerRecord> records;
+    QVERIFY(other.readAll(records));
+    QVERIFY2(other.append(5, makeRecords(5, 2)), qPrintable(other.errorString()));
+
+    QVERIFY(mine.isModifiedExternally());
+    QVERIFY(!mine.append(5, makeRecords(100, 1)));
+    QVERIFY(!mine.errorString().isEmpty());
+
+    QVector<LedgerRecord> appended;
+    QVERIFY(mine.readAppended(appended));
+    QVERIFY(firstDifference(appended, makeRecords(5, 2)).isEmpty());
+    // 只读取不接受时，同步状态不变
+    QVERIFY(mine.isModifiedExternally());
+
+    mine.acceptAppended();
+    QVERIFY(!mine.isModifiedExternally());
+    QVERIFY2(mine.append(7, makeRecords(7, 1)), qPrintable(mine.errorString()));
+    QVERIFY(firstDifference(readBack(path), makeRecords(0, 8)).isEmpty());
+
+    // 没有外部修改时读不到追加的记录
+    QVERIFY(mine.readAppended(appended));
+    QVERIFY(appended.isEmpty());
+}
+
+/**
+ * @brief 另一个实例改写了已有的行时，readAppended 报告冲突，各种写入都被拒绝，文件保持对方写入的内容
+ */
+void TestCsvLedgerStorage::rejectsWriteAfterExternalRewrite()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("ledger.csv");
+    CsvLedgerStorage mine(path);
+    QVERIFY(mine.writeAll(makeRecords(0, 5)));
+
+    // 对方改写第0行并使文件变短
+    CsvLedgerStorage other(path);
+    QVector<LedgerRecord> records;
+    QVERIFY(other.readAll(records));
+    QMap<int, LedgerRecord> changes;
+    changes.insert(0, makeRecord(0, ""));
+    QVERIFY(other.update(changes));
+    const QVector<LedgerRecord> theirs = readBack(path);
+
+    QVERIFY(mine.isModifiedExternally());
+    QVector<LedgerRecord> appended;
+    QVERIFY(!mine.readAppended(appended));
+    QVERIFY(!mine.errorString().isEmpty());
+    mine.acceptAppended();
+
+    QMap<int, LedgerRecord> mineChanges;
+    mineChanges.insert(1, makeRecord(1, "我的修改"));
+    QVERIFY(!mine.update(mineChanges));
+    QVERIFY(!mine.append(5, makeRecords(5, 1)));
+    QVERIFY(!mine.writeAll(makeRecords(0, 3)));
+    QVERIFY(firstDifference(readBack(path), theirs).isEmpty());
+
+    // 重新读取后以新内容为准，可以再次写入
+    QVERIFY(mine.readAll(records));
+    QVERIFY(!mine.isModifiedExternally());
+    QVERIFY(mine.update(mineChanges));
+}
+
+QTEST_APPLESS_MAIN(TestCsvLedgerStorage)
+
+#include "tst_csvledgerstorage.moc"
@@ -0,0 +1,15 @@
+include(../tests.pri)
+
+# LedgerStorage::open 按后缀创建两种存储引擎，SQLite 引擎随公共接口一起编译
+QT += sql
+
+TARGET = tst_csvledgerstorage
+
+INCLUDEPATH += $$LEDGER_SRC/ledgerstorage
+
+SOURCES += \
+    tst_csvledgerstorage.cpp \
+    $$LEDGER_SRC/ledgerstorage/ledgerstorage.cpp \
+    $$LEDGER_SRC/ledgerstorage/csvledgerstorage.cpp \
+    $$LEDGER_SRC/ledgerstorage/sqliteledgerstorage.cpp \
+    $$LEDGER_RECORD_SOURCES
@@ -0,0 +1,236 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 23:59:58
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 23:59:58
+ * @Description: HistoryPager 单元测试：块索引、按块读取、范围查询与缓存上限
+ */
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include "historypager.h"
+#include "csvledgerstorage.h"
+
+namespace {
+
+const int RecordCount = 1000;   //!< 测试文件的记录数
+const int RowsPerBlock = 64;    //!< 测试使用的每块记录数
+
+/**
+ * @brief 第 index 条测试记录，每天一条；备注含多字节字符，检验按字节偏移定位
+ */
+LedgerRecord makeRecord(int index)
+{
+    LedgerRecord record;
+    record.date = QDate(2000, 1, 1).addDays(index);
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        record.amounts[i] = qint64(index) * 100 + i;
+        record.presentMask |= quint8(1u << i);
+    }
+    record.note = index % 3 == 0 ? QString("第%1条记录").arg(index) : QString();
+    record.currency = index % 7 == 0 ? QString("EUR") : QString();
+    return record;
+}
+
+/**
+ * @brief makeRecord(first) ~ makeRecord(first+count-1)
+ */
+QVector<LedgerRecord> makeRecords(int first, int count)
+{
+    QVector<LedgerRecord> records;
+    for (int i = first; i < first + count; ++i) {
+        records.append(makeRecord(i));
+    }
+    return records;
+}
+
+/**
+ * @brief 写出 RecordCount 条记录的CSV，每隔若干条插入一个空行
+ */
+bool writeLedger(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    for (int i = 0; i < RecordCount; ++i) {
+        file.write(CsvLedgerStorage::formatLine(i, makeRecord(i)).toUtf8() + "\n");
+        if (i % 50 == 7) {
+            file.write("\n");
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 逐条比较两组记录，不一致时返回第一处差异
+ */
+QString firstDifference(const QVector<LedgerRecord> &actual, const QVector<LedgerRecord> &expected)
+{
+    if (actual.size() != expected.size()) {
+        return QString("记录数 %1，期望 %2").arg(actual.size()).arg(expected.size());
+    }
+    for (int i = 0; i < actual.size(); ++i) {
+        const QString a = CsvLedgerStorage::formatLine(i, actual[i]);
+        const QString e = CsvLedgerStorage::formatLine(i, expected[i]);
+        if (a != e) {
+            return QString("第%1条：%2，期望 %3").arg(i).arg(a, e);
+        }
+    }
+    return QString();
+}
+
+} // namespace
+
+class TestHistoryPager : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void indexBuildsBlocks();
+    void findsBlocks();
+    void readsEveryBlock();
+    void queryHonoursDatesAndEndRow();
+    void cacheStaysWithinLimit();
+    void truncatedFileReturnsNull();
+
+private:
+    QTemporaryDir dir;
+    QString path;
+};
+
+void TestHistoryPager::init()
+{
+    QVERIFY(dir.isValid());
+    path = dir.filePath("ledger.csv");
+    QVERIFY(writeLedger(path));
+}
+
+/**
+ * @brief 索引按每块记录数切分，记录首行号与首末日期；文件不存在时失败
+ */
+void TestHistoryPager::indexBuildsBlocks()
+{
+    HistoryPager pager(RowsPerBlock);
+    QVERIFY(pager.index(path));
+    QCOMPARE(pager.sourcePath(), path);
+    QCOMPARE(pager.recordCount(), RecordCount);
+    QCOMPARE(pager.blockCount(), (RecordCount + RowsPerBlock - 1) / RowsPerBlock);
+    for (int index = 0; index < pager.blockCount(); ++index) {
+        const HistoryPager::Block &block = pager.block(index);
+        const int firstRow = index * RowsPerBlock;
+        QCOMPARE(block.firstRow, firstRow);
+        QCOMPARE(block.rowCount, qMin(RowsPerBlock, RecordCount - firstRow));
+        QCOMPARE(block.firstDate, makeRecord(firstRow).date);
+        QCOMPARE(block.lastDate, makeRecord(firstRow + block.rowCount - 1).date);
+    }
+
+    QVERIFY(!pager.index(dir.filePath("missing.csv")));
+    QCOMPARE(pager.recordCount(), 0);
+    QCOMPARE(pager.blockCount(), 0);
+}
+
+/**
+ * @brief 按行号和按日期二分查找块
+ */
+void TestHistoryPager::findsBlocks()
+{
+    HistoryPager pager(RowsPerBlock);
+    QVERIFY(pager.index(path));
+    const int lastBlock = pager.blockCount() - 1;
+
+    QCOMPARE(pager.blockForRow(-1), -1);
+    QCOMPARE(pager.blockForRow(0), 0);
+    QCOMPARE(pager.blockForRow(RowsPerBlock - 1), 0);
+    QCOMPARE(pager.blockForRow(RowsPerBlock), 1);
+    QCOMPARE(pager.blockForRow(RecordCount - 1), lastBlock);
+    QCOMPARE(pager.blockForRow(RecordCount), -1);
+
+    QCOMPARE(pager.firstBlockEndingOnOrAfter(QDate(1999, 1, 1)), 0);
+    QCOMPARE(pager.firstBlockEndingOnOrAfter(makeRecord(RowsPerBlock - 1).date), 0);
+    QCOMPARE(pager.firstBlockEndingOnOrAfter(makeRecord(RowsPerBlock).date), 1);
+    QCOMPARE(pager.firstBlockEndingOnOrAfter(makeRecord(RecordCount).date), pager.blockCount());
+}
+
+/**
+ * @brief 每一块按偏移定位读出的记录与写入的一致，再次读取命中缓存
+ */
+void TestHistoryPager::readsEveryBlock()
+{
+    HistoryPager pager(RowsPerBlock);
+    QVERIFY(pager.index(path));
+    for (int index = 0; index < pager.blockCount(); ++index) {
+        const HistoryPager::Block &block = pager.block(index);
+        const QVector<LedgerRecord> *records = pager.records(index);
+        QVERIFY(records);
+        const QString difference = firstDifference(*records, makeRecords(block.firstRow, block.rowCount));
+        QVERIFY2(difference.isEmpty(), qPrintable(QString("块%1 %2").arg(index).arg(difference)));
+    }
+    QVERIFY(pager.cachedBytes() > 0);
+    QCOMPARE(pager.records(0), pager.records(0));
+    QVERIFY(!pager.records(-1));
+    QVERIFY(!pager.records(pager.blockCount()));
+}
+
+/**
+ * @brief 查询只返回日期范围内且行号小于上限的记录
+ */
+void TestHistoryPager::queryHonoursDatesAndEndRow()
+{
+    HistoryPager pager(RowsPerBlock);
+    QVERIFY(pager.index(path));
+
+    QVERIFY(firstDifference(pager.query(QDate(), QDate(), RecordCount), makeRecords(0, RecordCount)).isEmpty());
+    QVERIFY(firstDifference(pager.query(makeRecord(100).date, makeRecord(300).date, RecordCount),
+                            makeRecords(100, 201)).isEmpty());
+    // 常驻在模型中的记录（行号不小于 endRow）不返回
+    QVERIFY(firstDifference(pager.query(makeRecord(100).date, QDate(), 250), makeRecords(100, 150)).isEmpty());
+    QVERIFY(pager.query(QDate(), QDate(), 0).isEmpty());
+    QVERIFY(pager.query(QDate(1990, 1, 1), QDate(1999, 12, 31), RecordCount).isEmpty());
+}
+
+/**
+ * @brief 缓存占用不超过上限；单个块超过上限时不进入缓存，但仍能读出
+ */
+void TestHistoryPager::cacheStaysWithinLimit()
+{
+    HistoryPager pager(RowsPerBlock);
+    QVERIFY(pager.index(path));
+    const qint64 blockBytes = HistoryPager::estimateBytes(*pager.records(0));
+    pager.setMaxCacheBytes(blockBytes * 3);
+    QCOMPARE(pager.maxCacheBytes(), blockBytes * 3);
+
+    for (int index = 0; index < pager.blockCount(); ++index) {
+        QVERIFY(pager.records(index));
+        QVERIFY(pager.cachedBytes() <= pager.maxCacheBytes());
+    }
+    QVERIFY(pager.cachedBytes() > 0);
+    // 被淘汰的块重新从文件读取
+    QVERIFY(firstDifference(*pager.records(0), makeRecords(0, RowsPerBlock)).isEmpty());
+
+    pager.setMaxCacheBytes(1);
+    QCOMPARE(pager.cachedBytes(), qint64(0));
+    const QVector<LedgerRecord> *records = pager.records(1);
+    QVERIFY(records);
+    QVERIFY(firstDifference(*records, makeRecords(RowsPerBlock, RowsPerBlock)).isEmpty());
+    QCOMPARE(pager.cachedBytes(), qint64(0));
+}
+
+/**
+ * @brief 建立索引后文件被截短，读不全的块返回空指针
+ */
+void TestHistoryPager::truncatedFileReturnsNull()
+{
+    HistoryPager pager(RowsPerBlock);
+    QVERIFY(pager.index(path));
+    QFile file(path);
+    QVERIFY(file.resize(pager.block(pager.blockCount() - 1).offset + 10));
+
+    QVERIFY(!pager.records(pager.blockCount() - 1));
+    QVERIFY(pager.records(0));
+}
+
+QTEST_APPLESS_MAIN(TestHistoryPager)
+
+#include "tst_historypager.moc"
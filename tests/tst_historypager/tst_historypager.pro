@@ -0,0 +1,16 @@
+include(../tests.pri)
+
+# 分页器借用 CSV 存储引擎的行解析，存储引擎的公共接口又依赖 SQLite 引擎
+QT += sql
+
+TARGET = tst_historypager
+
+INCLUDEPATH += $$LEDGER_SRC/historypager $$LEDGER_SRC/ledgerstorage
+
+SOURCES += \
+    tst_historypager.cpp \
+    $$LEDGER_SRC/historypager/historypager.cpp \
+    $$LEDGER_SRC/ledgerstorage/ledgerstorage.cpp \
+    $$LEDGER_SRC/ledgerstorage/csvledgerstorage.cpp \
+    $$LEDGER_SRC/ledgerstorage/sqliteledgerstorage.cpp \
+    $$LEDGER_RECORD_SOURCES
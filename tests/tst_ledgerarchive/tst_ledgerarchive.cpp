@@ -0,0 +1,233 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 23:58:40
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 23:58:40
+ * @Description: LedgerArchive 单元测试：列式编码的写入、读取与范围查询
+ */
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include "ledgerarchive.h"
+
+namespace {
+
+const qint64 Missing = -1;  //!< makeRecord 中表示空单元格
+
+/**
+ * @brief 构造一条记录
+ * @param date 日期
+ * @param amounts 各金额列（分），Missing 表示空单元格
+ * @param note 备注
+ * @param currency 币种
+ */
+LedgerRecord makeRecord(const QDate &date, const QVector<qint64> &amounts, const QString &note = QString(),
+                        const QString &currency = QString())
+{
+    LedgerRecord record;
+    record.date = date;
+    for (int i = 0; i < amounts.size() && i < LedgerAmountColumnCount; ++i) {
+        if (amounts[i] != Missing) {
+            record.amounts[i] = amounts[i];
+            record.presentMask |= quint8(1u << i);
+        }
+    }
+    record.note = note;
+    record.currency = currency;
+    return record;
+}
+
+/**
+ * @brief 记录的文本形式，用于比较和失败信息
+ */
+QString describe(const LedgerRecord &record)
+{
+    QStringList fields;
+    fields << record.date.toString(Qt::ISODate);
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        fields << (record.hasAmount(i) ? LedgerRecord::formatCents(record.amounts[i]) : QString("-"));
+    }
+    fields << record.note << record.currency;
+    return fields.join('|');
+}
+
+/**
+ * @brief 逐条比较两组记录，不一致时返回第一处差异
+ */
+QString firstDifference(const QVector<LedgerRecord> &actual, const QVector<LedgerRecord> &expected)
+{
+    if (actual.size() != expected.size()) {
+        return QString("记录数 %1，期望 %2").arg(actual.size()).arg(expected.size());
+    }
+    for (int i = 0; i < actual.size(); ++i) {
+        const LedgerRecord &a = actual[i];
+        const LedgerRecord &e = expected[i];
+        bool same = a.date == e.date && a.presentMask == e.presentMask && a.note == e.note && a.currency == e.currency;
+        for (int column = 0; same && column < LedgerAmountColumnCount; ++column) {
+            same = !e.hasAmount(column) || a.amounts[column] == e.amounts[column];
+        }
+        if (!same) {
+            return QString("第%1条：%2，期望 %3").arg(i).arg(describe(a), describe(e));
+        }
+    }
+    return QString();
+}
+
+/**
+ * @brief 覆盖编码各分支的一组记录：空单元格、负数与大额差值、重复与空备注、多币种、同日多条
+ */
+QVector<LedgerRecord> sampleRecords()
+{
+    QVector<LedgerRecord> records;
+    const QDate start(2019, 1, 31);
+    for (int month = 0; month < 30; ++month) {
+        const QDate date = start.addMonths(month);
+        const qint64 total = 5000000 + month * 123456;
+        const qint64 salary = month % 7 == 3 ? Missing : 1200000 + month * 100;
+        const qint64 expense = month % 5 == 0 ? -250075 : 800033 - month * 9999;
+        const QString note = month % 3 == 0 ? QString("年终奖, \"备注\"") : (month % 3 == 1 ? QString() : QString("房租"));
+        records.append(makeRecord(date, { total, salary, Missing, expense, total - 4000000, 9000000000LL - month },
+                                  note, month >= 20 ? QString("USD") : QString()));
+    }
+    // 同一天的两条记录保持原有顺序
+    records.append(makeRecord(start.addMonths(30), { 1, Missing, Missing, Missing, Missing, Missing }, "第一条"));
+    records.append(makeRecord(start.addMonths(30), { -1, 0, 0, 0, 0, 0 }, "第二条", "EUR"));
+    return records;
+}
+
+} // namespace
+
+class TestLedgerArchive : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTrip_data();
+    void roundTrip();
+    void rangeQuery();
+    void rejectsForeignFile();
+    void reportsDamagedBlocks();
+};
+
+void TestLedgerArchive::roundTrip_data()
+{
+    QTest::addColumn<int>("rowsPerBlock");
+    QTest::newRow("单块") << 512;
+    QTest::newRow("多块") << 4;
+    QTest::newRow("每块一行") << 1;
+}
+
+/**
+ * @brief 写入后重新打开，索引信息与全部记录（含空单元格、备注和币种）保持不变
+ */
+void TestLedgerArchive::roundTrip()
+{
+    QFETCH(int, rowsPerBlock);
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("ledger.lgra");
+    const QVector<LedgerRecord> records = sampleRecords();
+
+    QVERIFY(LedgerArchive::write(path, records, rowsPerBlock));
+
+    LedgerArchive archive;
+    QVERIFY(archive.open(path));
+    QVERIFY(archive.isOpen());
+    QCOMPARE(archive.rowCount(), int(records.size()));
+    QCOMPARE(archive.firstDate(), records.first().date);
+    QCOMPARE(archive.lastDate(), records.last().date);
+
+    bool ok = false;
+    const QVector<LedgerRecord> restored = archive.records(QDate(), QDate(), &ok);
+    QVERIFY(ok);
+    const QString difference = firstDifference(restored, records);
+    QVERIFY2(difference.isEmpty(), qPrintable(difference));
+
+    // 第二次查询命中缓存，结果相同
+    QVERIFY(firstDifference(archive.records(), records).isEmpty());
+
+    archive.close();
+    QVERIFY(!archive.isOpen());
+    QCOMPARE(archive.rowCount(), 0);
+}
+
+/**
+ * @brief 范围查询只返回日期落在范围内的记录，跨块与块内截断都正确
+ */
+void TestLedgerArchive::rangeQuery()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("ledger.lgra");
+    const QVector<LedgerRecord> records = sampleRecords();
+    QVERIFY(LedgerArchive::write(path, records, 4));
+
+    LedgerArchive archive(2);
+    QVERIFY(archive.open(path));
+
+    const QDate from(2019, 6, 1);
+    const QDate to(2020, 3, 31);
+    QVector<LedgerRecord> expected;
+    for (const LedgerRecord &record : records) {
+        if (record.date >= from && record.date <= to) {
+            expected.append(record);
+        }
+    }
+    QVERIFY(!expected.isEmpty());
+
+    bool ok = false;
+    const QString difference = firstDifference(archive.records(from, to, &ok), expected);
+    QVERIFY(ok);
+    QVERIFY2(difference.isEmpty(), qPrintable(difference));
+
+    QVERIFY(archive.records(QDate(2000, 1, 1), QDate(2018, 12, 31)).isEmpty());
+    QCOMPARE(int(archive.records(records.last().date, QDate()).size()), 2);
+}
+
+/**
+ * @brief 不是归档格式的文件无法打开
+ */
+void TestLedgerArchive::rejectsForeignFile()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("ledger.csv");
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("日期,当前总存款金额\n2020-01-31,100\n");
+    file.close();
+
+    LedgerArchive archive;
+    QVERIFY(!archive.open(path));
+    QVERIFY(!archive.isOpen());
+    QVERIFY(!archive.open(dir.filePath("missing.lgra")));
+}
+
+/**
+ * @brief 数据块损坏时跳过该块并报告失败，其余块照常读出
+ */
+void TestLedgerArchive::reportsDamagedBlocks()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("ledger.lgra");
+    const QVector<LedgerRecord> records = sampleRecords();
+    const int rowsPerBlock = 8;
+    QVERIFY(LedgerArchive::write(path, records, rowsPerBlock));
+
+    // 截去最后一个数据块的末尾
+    QFile file(path);
+    QVERIFY(file.resize(file.size() - 4));
+
+    LedgerArchive archive;
+    QVERIFY(archive.open(path));
+    bool ok = true;
+    const QVector<LedgerRecord> restored = archive.records(QDate(), QDate(), &ok);
+    QVERIFY(!ok);
+    const int intactRows = (int(records.size()) - 1) / rowsPerBlock * rowsPerBlock;
+    QVERIFY(firstDifference(restored, records.mid(0, intactRows)).isEmpty());
+}
+
+QTEST_APPLESS_MAIN(TestLedgerArchive)
+
+#include "tst_ledgerarchive.moc"
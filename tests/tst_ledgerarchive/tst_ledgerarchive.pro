@@ -0,0 +1,10 @@
+include(../tests.pri)
+
+TARGET = tst_ledgerarchive
+
+INCLUDEPATH += $$LEDGER_SRC/ledgerarchive
+
+SOURCES += \
+    tst_ledgerarchive.cpp \
+    $$LEDGER_SRC/ledgerarchive/ledgerarchive.cpp \
+    $$LEDGER_RECORD_SOURCES
@@ -0,0 +1,312 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 23:59:59
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 23:59:59
+ * @Description: LedgerMerger 单元测试：按月合并、单账本往返、汇率换算、排序与币种冲突、按月对比
+ */
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include "ledgermerger.h"
+#include "csvledgerstorage.h"
+#include "exchangerates.h"
+
+namespace {
+
+const qint64 Missing = -1;  //!< makeRecord 中表示空单元格
+
+/**
+ * @brief 构造一条记录，当月存款与可支配额度按账本规则算出
+ * @param date 日期（yyyy/MM/dd）
+ * @param total 总存款（分）
+ * @param salary 当月工资（分）
+ * @param fixed 定期余额（分）
+ * @param expense 当月开支（分），Missing 表示空单元格
+ * @param note 备注
+ * @param currency 币种
+ */
+LedgerRecord makeRecord(const QString &date, qint64 total, qint64 salary, qint64 fixed, qint64 expense = Missing,
+                        const QString &note = QString(), const QString &currency = QString())
+{
+    LedgerRecord record;
+    record.date = LedgerRecord::parseDate(date);
+    const qint64 amounts[LedgerAmountColumnCount] = {
+        total, salary, fixed, expense, expense == Missing ? Missing : salary - expense, total - fixed
+    };
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        if (amounts[i] != Missing) {
+            record.amounts[i] = amounts[i];
+            record.presentMask |= quint8(1u << i);
+        }
+    }
+    record.note = note;
+    record.currency = currency;
+    return record;
+}
+
+/**
+ * @brief 把记录写成CSV账本
+ */
+bool writeLedger(const QString &path, const QVector<LedgerRecord> &records)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+    for (int i = 0; i < records.size(); ++i) {
+        file.write(CsvLedgerStorage::formatLine(i, records[i]).toUtf8() + "\n");
+    }
+    return true;
+}
+
+/**
+ * @brief 读出CSV账本的全部记录
+ */
+QVector<LedgerRecord> readLedger(const QString &path)
+{
+    CsvLedgerStorage storage(path);
+    QVector<LedgerRecord> records;
+    storage.readAll(records);
+    return records;
+}
+
+/**
+ * @brief 读出文本文件的各行
+ */
+QStringList readLines(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return QStringList();
+    }
+    return QString::fromUtf8(file.readAll()).split('\n', Qt::SkipEmptyParts);
+}
+
+/**
+ * @brief 甲的账本：每月一条
+ */
+QVector<LedgerRecord> firstMember()
+{
+    return {
+        makeRecord("2020/01/15", 100000, 10000, 20000, 5000, "甲一月"),
+        makeRecord("2020/02/15", 105000, 10000, 20000, 5000),
+        makeRecord("2020/03/15", 110000, 10000, 30000, 5000),
+    };
+}
+
+/**
+ * @brief 乙的账本：二月没有记录
+ */
+QVector<LedgerRecord> secondMember(const QString &currency = QString())
+{
+    return {
+        makeRecord("2020/01/20", 50000, 8000, 0, 3000, "乙一月", currency),
+        makeRecord("2020/03/10", 60000, 8000, 0, -2000, QString(), currency),
+    };
+}
+
+} // namespace
+
+class TestLedgerMerger : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void mergesByMonth();
+    void singleLedgerRoundTrip();
+    void convertsToReportCurrency();
+    void rejectsUnsortedLedger();
+    void rejectsMixedCurrencies();
+    void comparesByMember();
+    void columnNames();
+
+private:
+    QTemporaryDir dir;
+    QVector<LedgerMerger::Source> sources;
+};
+
+void TestLedgerMerger::init()
+{
+    QVERIFY(dir.isValid());
+    sources = {
+        { dir.filePath("first.csv"), "甲" },
+        { dir.filePath("second.csv"), "乙" },
+    };
+    QFile::remove(ExchangeRates::filePathFor(sources[1].filePath));
+    QVERIFY(writeLedger(sources[0].filePath, firstMember()));
+    QVERIFY(writeLedger(sources[1].filePath, secondMember()));
+}
+
+/**
+ * @brief 两个账本按月合并：存量列相加（没有记录的月份沿用上月），工资求和，
+ *        开支由相邻两行重算，备注带来源标签
+ */
+void TestLedgerMerger::mergesByMonth()
+{
+    const QString output = dir.filePath("merged.csv");
+    const LedgerMerger::Summary summary = LedgerMerger(sources).merge(output);
+    QVERIFY2(summary.ok, qPrintable(summary.error));
+    QCOMPARE(summary.records, qint64(5));
+    QCOMPARE(summary.skipped, qint64(0));
+    QCOMPARE(summary.outputRows, qint64(3));
+
+    const QVector<LedgerRecord> expected = {
+        makeRecord("2020/01/20", 150000, 18000, 20000, 8000, "[甲] 甲一月 [乙] 乙一月"),
+        makeRecord("2020/02/15", 155000, 10000, 20000, 150000 + 10000 - 155000),
+        makeRecord("2020/03/15", 170000, 18000, 30000, 155000 + 18000 - 170000),
+    };
+    const QVector<LedgerRecord> merged = readLedger(output);
+    QCOMPARE(int(merged.size()), int(expected.size()));
+    for (int i = 0; i < merged.size(); ++i) {
+        QCOMPARE(CsvLedgerStorage::formatLine(i, merged[i]), CsvLedgerStorage::formatLine(i, expected[i]));
+    }
+}
+
+/**
+ * @brief 只有一个账本、每月一条且派生列一致时，合并结果与原账本相同（备注加上标签）
+ */
+void TestLedgerMerger::singleLedgerRoundTrip()
+{
+    QVector<LedgerRecord> records;
+    qint64 total = 1000000;
+    for (int month = 0; month < 24; ++month) {
+        const qint64 salary = 20000 + month * 100;
+        const qint64 next = total + salary - 15000 - (month % 4) * 1000;
+        const qint64 expense = month == 0 ? 12345 : total + salary - next;
+        const QString date = QDate(2021, 1, 28).addMonths(month).toString("yyyy/MM/dd");
+        records.append(makeRecord(date, next, salary, month * 1000, expense, month % 5 == 0 ? "年度" : QString()));
+        total = next;
+    }
+    const QString input = dir.filePath("single.csv");
+    QVERIFY(writeLedger(input, records));
+
+    const QString output = dir.filePath("merged.csv");
+    const LedgerMerger::Summary summary = LedgerMerger({ { input, QString() } }).merge(output);
+    QVERIFY2(summary.ok, qPrintable(summary.error));
+    QCOMPARE(summary.outputRows, qint64(records.size()));
+
+    const QVector<LedgerRecord> merged = readLedger(output);
+    QCOMPARE(int(merged.size()), int(records.size()));
+    for (int i = 0; i < records.size(); ++i) {
+        LedgerRecord expected = records[i];
+        if (!expected.note.isEmpty()) {
+            expected.note = "[single] " + expected.note;    // 标签为空时使用文件名
+        }
+        QCOMPARE(CsvLedgerStorage::formatLine(i, merged[i]), CsvLedgerStorage::formatLine(i, expected));
+    }
+}
+
+/**
+ * @brief 指定币种时按各账本自己的汇率表换算；缺少汇率的记录不计入并单独统计
+ */
+void TestLedgerMerger::convertsToReportCurrency()
+{
+    QVERIFY(writeLedger(sources[1].filePath, secondMember("USD")));
+    const QString output = dir.filePath("merged.csv");
+
+    QFile rates(ExchangeRates::filePathFor(sources[1].filePath));
+    QVERIFY(rates.open(QIODevice::WriteOnly | QIODevice::Text));
+    rates.write("2020/01/01,USD,CNY,7\n");
+    rates.close();
+
+    LedgerMerger::Summary summary = LedgerMerger(sources, "cny").merge(output);
+    QVERIFY2(summary.ok, qPrintable(summary.error));
+    QCOMPARE(summary.missingRates, qint64(0));
+    QVector<LedgerRecord> merged = readLedger(output);
+    QCOMPARE(int(merged.size()), 3);
+    QCOMPARE(merged[0].amounts[0], qint64(100000 + 50000 * 7));
+    QCOMPARE(merged[2].amounts[0], qint64(110000 + 60000 * 7));
+    QVERIFY(merged[0].currency.isEmpty());
+
+    // 删除汇率表后，乙的记录不计入合并结果
+    QVERIFY(QFile::remove(rates.fileName()));
+    summary = LedgerMerger(sources, "CNY").merge(output);
+    QVERIFY2(summary.ok, qPrintable(summary.error));
+    QCOMPARE(summary.missingRates, qint64(2));
+    merged = readLedger(output);
+    QCOMPARE(merged[0].amounts[0], qint64(100000));
+    QCOMPARE(merged[0].note, QString("[甲] 甲一月"));
+}
+
+/**
+ * @brief 账本日期倒退时停止，报告文件和行号，不写出输出文件
+ */
+void TestLedgerMerger::rejectsUnsortedLedger()
+{
+    QVector<LedgerRecord> records = firstMember();
+    std::swap(records[1], records[2]);
+    QVERIFY(writeLedger(sources[0].filePath, records));
+
+    const QString output = dir.filePath("unsorted.csv");
+    const LedgerMerger::Summary summary = LedgerMerger(sources).merge(output);
+    QVERIFY(!summary.ok);
+    QVERIFY2(summary.error.contains("first.csv") && summary.error.contains("第3行"), qPrintable(summary.error));
+    QVERIFY(!QFile::exists(output));
+
+    const LedgerMerger::Summary missing = LedgerMerger({ { dir.filePath("missing.csv"), QString() } }).merge(output);
+    QVERIFY(!missing.ok);
+    QVERIFY(!missing.error.isEmpty());
+}
+
+/**
+ * @brief 不指定币种时各账本必须使用同一币种
+ */
+void TestLedgerMerger::rejectsMixedCurrencies()
+{
+    QVERIFY(writeLedger(sources[1].filePath, secondMember("USD")));
+    const QString output = dir.filePath("mixed.csv");
+
+    const LedgerMerger::Summary merged = LedgerMerger(sources).merge(output);
+    QVERIFY(!merged.ok);
+    QVERIFY2(merged.error.contains("CNY") && merged.error.contains("USD"), qPrintable(merged.error));
+    QVERIFY(!QFile::exists(output));
+
+    const LedgerMerger::Summary compared = LedgerMerger(sources).compare(output, LedgerMerger::ByMember, 0);
+    QVERIFY(!compared.ok);
+    QVERIFY(!QFile::exists(output));
+}
+
+/**
+ * @brief 按成员对比：流量列取当月合计，没有记录的月份留空；存量列取当月最后一条
+ */
+void TestLedgerMerger::comparesByMember()
+{
+    const QString output = dir.filePath("compare.csv");
+    const int salary = LedgerMerger::columnForName("salary");
+    LedgerMerger::Summary summary = LedgerMerger(sources).compare(output, LedgerMerger::ByMember, salary);
+    QVERIFY2(summary.ok, qPrintable(summary.error));
+    QCOMPARE(summary.outputRows, qint64(3));
+    QCOMPARE(readLines(output), QStringList() << "月份,甲,乙"
+                                              << "2020/01,100.00,80.00"
+                                              << "2020/02,100.00,"
+                                              << "2020/03,100.00,80.00");
+
+    summary = LedgerMerger(sources).compare(output, LedgerMerger::ByMember, LedgerMerger::columnForName("总存款"));
+    QVERIFY(!summary.ok);
+    summary = LedgerMerger(sources).compare(output, LedgerMerger::ByMember, LedgerMerger::columnForName("total"));
+    QVERIFY2(summary.ok, qPrintable(summary.error));
+    QCOMPARE(readLines(output).at(3), QString("2020/03,1100.00,600.00"));
+}
+
+/**
+ * @brief 金额列名的英文别名与中文列名，存量列与流量列的区分
+ */
+void TestLedgerMerger::columnNames()
+{
+    QCOMPARE(LedgerMerger::columnForName(" Total "), ColTotalDeposit - ColTotalDeposit);
+    QCOMPARE(LedgerMerger::columnForName("当月开支"), ColExpense - ColTotalDeposit);
+    QCOMPARE(LedgerMerger::columnForName("disposable"), ColDisposable - ColTotalDeposit);
+    QCOMPARE(LedgerMerger::columnForName("unknown"), -1);
+
+    QVERIFY(LedgerMerger::isBalanceColumn(ColTotalDeposit - ColTotalDeposit));
+    QVERIFY(LedgerMerger::isBalanceColumn(ColFixedDeposit - ColTotalDeposit));
+    QVERIFY(LedgerMerger::isBalanceColumn(ColDisposable - ColTotalDeposit));
+    QVERIFY(!LedgerMerger::isBalanceColumn(ColSalary - ColTotalDeposit));
+    QVERIFY(!LedgerMerger::isBalanceColumn(ColExpense - ColTotalDeposit));
+}
+
+QTEST_APPLESS_MAIN(TestLedgerMerger)
+
+#include "tst_ledgermerger.moc"
@@ -0,0 +1,17 @@
+include(../tests.pri)
+
+# 合并结果用 CSV 存储引擎读回，存储引擎的公共接口又依赖 SQLite 引擎
+QT += sql
+
+TARGET = tst_ledgermerger
+
+INCLUDEPATH += $$LEDGER_SRC/ledgermerger $$LEDGER_SRC/ledgerstorage $$LEDGER_SRC/exchangerates
+
+SOURCES += \
+    tst_ledgermerger.cpp \
+    $$LEDGER_SRC/ledgermerger/ledgermerger.cpp \
+    $$LEDGER_SRC/exchangerates/exchangerates.cpp \
+    $$LEDGER_SRC/ledgerstorage/ledgerstorage.cpp \
+    $$LEDGER_SRC/ledgerstorage/csvledgerstorage.cpp \
+    $$LEDGER_SRC/ledgerstorage/sqliteledgerstorage.cpp \
+    $$LEDGER_RECORD_SOURCES
@@ -0,0 +1,215 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 23:59:40
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 23:59:40
+ * @Description: LedgerSnapshotPublisher 单元测试：发布内容、写时复制的块共享与前置记录
+ */
+#include <QtTest>
+#include <QStandardItemModel>
+#include <cmath>
+#include "ledgersnapshot.h"
+
+namespace {
+
+const int ModelRows = 600;  //!< 测试模型的行数（跨三个块）
+
+/**
+ * @brief 第 index 条测试记录：每 4 条中有一条没有当月开支，每 3 条中有一条是美元
+ */
+LedgerRecord makeRecord(int index)
+{
+    LedgerRecord record;
+    record.date = QDate(2000, 1, 31).addMonths(index);
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        if (i == ColExpense - ColTotalDeposit && index % 4 == 0) {
+            continue;
+        }
+        record.amounts[i] = qint64(index) * 1000 + i;
+        record.presentMask |= quint8(1u << i);
+    }
+    record.note = QString("第%1条").arg(index);
+    record.currency = index % 3 == 0 ? QString("USD") : QString();
+    return record;
+}
+
+/**
+ * @brief 由 makeRecord(first) ~ makeRecord(first+count-1) 组成的模型
+ */
+void fillModel(QStandardItemModel *model, int first, int count)
+{
+    for (int i = first; i < first + count; ++i) {
+        model->appendRow(makeRecord(i).toItems());
+    }
+}
+
+/**
+ * @brief 两条记录的日期、金额、备注与币种是否一致
+ */
+bool sameRecord(const LedgerRecord &a, const LedgerRecord &b)
+{
+    if (a.date != b.date || a.presentMask != b.presentMask || a.note != b.note || a.currency != b.currency) {
+        return false;
+    }
+    for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+        if (a.hasAmount(i) && a.amounts[i] != b.amounts[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+class TestLedgerSnapshot : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void publishMatchesModel();
+    void sameVersionReturnsPublished();
+    void unchangedBlocksAreShared();
+    void appendRebuildsLastBlockOnly();
+    void leadingRecordsPrecedeModel();
+    void fromRecords();
+};
+
+/**
+ * @brief 首次发布的快照逐行与模型一致，金额列的空值取为 NaN
+ */
+void TestLedgerSnapshot::publishMatchesModel()
+{
+    QStandardItemModel model;
+    fillModel(&model, 0, ModelRows);
+
+    LedgerSnapshotPublisher publisher;
+    QVERIFY(!publisher.current());
+    const LedgerSnapshotPtr snapshot = publisher.publish(&model, 1);
+    QVERIFY(snapshot);
+    QCOMPARE(publisher.current(), snapshot);
+    QCOMPARE(snapshot->version(), quint64(1));
+    QCOMPARE(snapshot->rowCount(), ModelRows);
+    QCOMPARE(snapshot->blockCount(), (ModelRows + LedgerSnapshot::BlockRows - 1) / LedgerSnapshot::BlockRows);
+    QCOMPARE(snapshot->sharedBlocks(), 0);
+    for (int row = 0; row < ModelRows; ++row) {
+        QVERIFY2(sameRecord(snapshot->record(row), makeRecord(row)), qPrintable(QString::number(row)));
+    }
+
+    const QVector<double> expense = snapshot->column(ColExpense);
+    QCOMPARE(int(expense.size()), ModelRows);
+    QVERIFY(std::isnan(expense[0]));
+    QCOMPARE(expense[1], makeRecord(1).amount(ColExpense - ColTotalDeposit));
+}
+
+/**
+ * @brief 数据版本未变时不重建，直接返回上一快照
+ */
+void TestLedgerSnapshot::sameVersionReturnsPublished()
+{
+    QStandardItemModel model;
+    fillModel(&model, 0, 10);
+    LedgerSnapshotPublisher publisher;
+    const LedgerSnapshotPtr first = publisher.publish(&model, 7);
+    QCOMPARE(publisher.publish(&model, 7), first);
+    QVERIFY(publisher.publish(&model, 8) != first);
+}
+
+/**
+ * @brief 只修改一行时只有它所在的块重建，其余块与上一版本共享；旧快照保持不变
+ */
+void TestLedgerSnapshot::unchangedBlocksAreShared()
+{
+    QStandardItemModel model;
+    fillModel(&model, 0, ModelRows);
+    LedgerSnapshotPublisher publisher;
+    const LedgerSnapshotPtr before = publisher.publish(&model, 1);
+
+    const int row = LedgerSnapshot::BlockRows + 10;
+    model.item(row, ColNote)->setText("已修改");
+    publisher.markRowsChanged(row, row);
+    const LedgerSnapshotPtr after = publisher.publish(&model, 2);
+
+    QCOMPARE(after->sharedBlocks(), before->blockCount() - 1);
+    QCOMPARE(&after->block(0), &before->block(0));
+    QVERIFY(&after->block(1) != &before->block(1));
+    QCOMPARE(&after->block(2), &before->block(2));
+    QCOMPARE(after->record(row).note, QString("已修改"));
+    QCOMPARE(before->record(row).note, makeRecord(row).note);
+}
+
+/**
+ * @brief 在末尾追加记录时只重建末尾一块
+ */
+void TestLedgerSnapshot::appendRebuildsLastBlockOnly()
+{
+    QStandardItemModel model;
+    fillModel(&model, 0, ModelRows);
+    LedgerSnapshotPublisher publisher;
+    const LedgerSnapshotPtr before = publisher.publish(&model, 1);
+
+    fillModel(&model, ModelRows, 1);
+    publisher.markRowsShifted(ModelRows);
+    const LedgerSnapshotPtr after = publisher.publish(&model, 2);
+
+    QCOMPARE(after->rowCount(), ModelRows + 1);
+    QCOMPARE(after->sharedBlocks(), before->blockCount() - 1);
+    QVERIFY(sameRecord(after->record(ModelRows), makeRecord(ModelRows)));
+    QCOMPARE(before->rowCount(), ModelRows);
+}
+
+/**
+ * @brief 前置记录排在模型记录之前，标记脏块时的模型行号按前置记录数偏移
+ */
+void TestLedgerSnapshot::leadingRecordsPrecedeModel()
+{
+    const int leadingRows = 300;
+    QVector<LedgerRecord> leading;
+    for (int i = 0; i < leadingRows; ++i) {
+        leading.append(makeRecord(i));
+    }
+    QStandardItemModel model;
+    fillModel(&model, leadingRows, ModelRows);
+
+    LedgerSnapshotPublisher publisher;
+    publisher.publish(&model, 1);
+    publisher.setLeadingRecords(leading);
+    QVERIFY(!publisher.current());
+    QCOMPARE(int(publisher.leadingRecords().size()), leadingRows);
+
+    const LedgerSnapshotPtr before = publisher.publish(&model, 2);
+    QCOMPARE(before->rowCount(), leadingRows + ModelRows);
+    for (int row = 0; row < before->rowCount(); ++row) {
+        QVERIFY2(sameRecord(before->record(row), makeRecord(row)), qPrintable(QString::number(row)));
+    }
+
+    // 模型第0行在快照第 leadingRows 行，位于第二块
+    model.item(0, ColNote)->setText("已修改");
+    publisher.markRowsChanged(0, 0);
+    const LedgerSnapshotPtr after = publisher.publish(&model, 3);
+    QCOMPARE(after->record(leadingRows).note, QString("已修改"));
+    QCOMPARE(after->sharedBlocks(), before->blockCount() - 1);
+    QVERIFY(&after->block(leadingRows / LedgerSnapshot::BlockRows)
+            != &before->block(leadingRows / LedgerSnapshot::BlockRows));
+}
+
+/**
+ * @brief 由记录直接构造的快照与发布的快照按同样方式分块
+ */
+void TestLedgerSnapshot::fromRecords()
+{
+    QVector<LedgerRecord> records;
+    for (int i = 0; i < ModelRows; ++i) {
+        records.append(makeRecord(i));
+    }
+    const LedgerSnapshotPtr snapshot = LedgerSnapshot::fromRecords(records, 5);
+    QCOMPARE(snapshot->version(), quint64(5));
+    QCOMPARE(snapshot->rowCount(), ModelRows);
+    QCOMPARE(snapshot->blockCount(), (ModelRows + LedgerSnapshot::BlockRows - 1) / LedgerSnapshot::BlockRows);
+    QVERIFY(sameRecord(snapshot->record(ModelRows - 1), records.last()));
+
+    QCOMPARE(LedgerSnapshot::fromRecords(QVector<LedgerRecord>())->blockCount(), 0);
+}
+
+QTEST_APPLESS_MAIN(TestLedgerSnapshot)
+
+#include "tst_ledgersnapshot.moc"
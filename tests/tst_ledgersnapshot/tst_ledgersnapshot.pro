@@ -0,0 +1,10 @@
+include(../tests.pri)
+
+TARGET = tst_ledgersnapshot
+
+INCLUDEPATH += $$LEDGER_SRC/ledgersnapshot
+
+SOURCES += \
+    tst_ledgersnapshot.cpp \
+    $$LEDGER_SRC/ledgersnapshot/ledgersnapshot.cpp \
+    $$LEDGER_RECORD_SOURCES
@@ -0,0 +1,236 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 23:58:10
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 23:58:10
+ * @Description: QuantileSketch 单元测试：精确区间、秩误差、合并与序列化
+ */
+#include <QtTest>
+#include <QRandomGenerator>
+#include <algorithm>
+#include <cmath>
+#include "quantilesketch.h"
+
+namespace {
+
+const int SketchK = 200;            //!< 测试使用的精度参数
+const double MaxRankError = 0.02;   //!< 允许的秩误差（理论值约 1.65/k ≈ 0.8%）
+
+/**
+ * @brief 0 ~ count-1 的随机排列（固定种子，结果可重复）
+ */
+QVector<double> shuffledRange(int count, quint32 seed)
+{
+    QVector<double> values(count);
+    for (int i = 0; i < count; ++i) {
+        values[i] = i;
+    }
+    QRandomGenerator generator(seed);
+    for (int i = count - 1; i > 0; --i) {
+        std::swap(values[i], values[generator.bounded(i + 1)]);
+    }
+    return values;
+}
+
+/**
+ * @brief 估算的分位数在 0 ~ count-1 的均匀数据中的真实秩与目标分位点之差的最大值
+ */
+double maxQuantileRankError(const QuantileSketch &sketch, int count)
+{
+    double worst = 0.0;
+    for (int percent = 1; percent < 100; ++percent) {
+        const double q = percent / 100.0;
+        const double trueRank = (sketch.quantile(q) + 1) / count;
+        worst = qMax(worst, std::abs(trueRank - q));
+    }
+    return worst;
+}
+
+} // namespace
+
+class TestQuantileSketch : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void emptySketch();
+    void exactWhenSmall();
+    void rankErrorWithinBound();
+    void batchAddMatchesSingleAdd();
+    void mergeDisjointRanges();
+    void mergeIntoEmpty();
+    void byteArrayRoundTrip();
+    void rejectsCorruptData();
+};
+
+/**
+ * @brief 空草图：分位数为NaN，秩为0，NaN不计入
+ */
+void TestQuantileSketch::emptySketch()
+{
+    QuantileSketch sketch(SketchK);
+    QVERIFY(sketch.isEmpty());
+    QVERIFY(std::isnan(sketch.quantile(0.5)));
+    QCOMPARE(sketch.rank(1.0), 0.0);
+
+    sketch.add(std::nan(""));
+    QVERIFY(sketch.isEmpty());
+    QCOMPARE(sketch.count(), qint64(0));
+}
+
+/**
+ * @brief 值个数不超过容量时不压缩，分位数与秩都是精确的
+ */
+void TestQuantileSketch::exactWhenSmall()
+{
+    QuantileSketch sketch(SketchK);
+    for (double value : shuffledRange(100, 7)) {
+        sketch.add(value + 1);
+    }
+    QCOMPARE(sketch.count(), qint64(100));
+    QCOMPARE(sketch.retained(), 100);
+    QCOMPARE(sketch.min(), 1.0);
+    QCOMPARE(sketch.max(), 100.0);
+    QCOMPARE(sketch.quantile(0.5), 50.0);
+    QCOMPARE(sketch.quantile(0.9), 90.0);
+    QCOMPARE(sketch.quantile(0.0), 1.0);
+    QCOMPARE(sketch.quantile(1.0), 100.0);
+    QCOMPARE(sketch.rank(50.0), 0.5);
+    QCOMPARE(sketch.rank(0.0), 0.0);
+}
+
+/**
+ * @brief 大量数据压缩后，各分位点的秩误差不超过上限，保留量与数据量无关
+ */
+void TestQuantileSketch::rankErrorWithinBound()
+{
+    const int count = 200000;
+    QuantileSketch sketch(SketchK);
+    for (double value : shuffledRange(count, 20261019)) {
+        sketch.add(value);
+    }
+    QCOMPARE(sketch.count(), qint64(count));
+    QCOMPARE(sketch.min(), 0.0);
+    QCOMPARE(sketch.max(), double(count - 1));
+    QVERIFY2(sketch.retained() < 4 * SketchK, qPrintable(QString::number(sketch.retained())));
+
+    const double error = maxQuantileRankError(sketch, count);
+    QVERIFY2(error <= MaxRankError, qPrintable(QString("秩误差 %1").arg(error)));
+
+    for (int percent = 5; percent < 100; percent += 5) {
+        const double value = count * percent / 100.0;
+        QVERIFY(std::abs(sketch.rank(value) - percent / 100.0) <= MaxRankError);
+    }
+}
+
+/**
+ * @brief 批量插入与逐个插入的精度相同
+ */
+void TestQuantileSketch::batchAddMatchesSingleAdd()
+{
+    const int count = 50000;
+    const QVector<double> values = shuffledRange(count, 3);
+    QuantileSketch sketch(SketchK);
+    for (int first = 0; first < count; first += 1000) {
+        sketch.add(values.constData() + first, qMin(1000, count - first));
+    }
+    QCOMPARE(sketch.count(), qint64(count));
+    QVERIFY(maxQuantileRankError(sketch, count) <= MaxRankError);
+}
+
+/**
+ * @brief 两段不相交数据分别建草图后合并，与对全部数据建草图的精度相同
+ */
+void TestQuantileSketch::mergeDisjointRanges()
+{
+    const int count = 100000;
+    const QVector<double> values = shuffledRange(count, 11);
+    QuantileSketch low(SketchK);
+    QuantileSketch high(SketchK);
+    for (double value : values) {
+        (value < count / 2 ? low : high).add(value);
+    }
+    QCOMPARE(low.max(), double(count / 2 - 1));
+    QCOMPARE(high.min(), double(count / 2));
+
+    low.merge(high);
+    QCOMPARE(low.count(), qint64(count));
+    QCOMPARE(low.min(), 0.0);
+    QCOMPARE(low.max(), double(count - 1));
+    QVERIFY(low.retained() < 4 * SketchK);
+    const double error = maxQuantileRankError(low, count);
+    QVERIFY2(error <= MaxRankError, qPrintable(QString("秩误差 %1").arg(error)));
+}
+
+/**
+ * @brief 合并到空草图等价于复制；合并空草图不改变原草图
+ */
+void TestQuantileSketch::mergeIntoEmpty()
+{
+    QuantileSketch source(SketchK);
+    for (double value : shuffledRange(10000, 5)) {
+        source.add(value);
+    }
+
+    QuantileSketch target(SketchK);
+    target.merge(source);
+    QCOMPARE(target.count(), source.count());
+    QCOMPARE(target.min(), source.min());
+    QCOMPARE(target.max(), source.max());
+    QVERIFY(maxQuantileRankError(target, 10000) <= MaxRankError);
+
+    const double median = source.quantile(0.5);
+    source.merge(QuantileSketch(SketchK));
+    QCOMPARE(source.count(), qint64(10000));
+    QCOMPARE(source.quantile(0.5), median);
+}
+
+/**
+ * @brief 序列化后恢复的草图给出相同的分位数，并且可以继续合并
+ */
+void TestQuantileSketch::byteArrayRoundTrip()
+{
+    QuantileSketch sketch(SketchK);
+    for (double value : shuffledRange(30000, 9)) {
+        sketch.add(value);
+    }
+
+    bool ok = false;
+    const QuantileSketch restored = QuantileSketch::fromByteArray(sketch.toByteArray(), &ok);
+    QVERIFY(ok);
+    QCOMPARE(restored.count(), sketch.count());
+    QCOMPARE(restored.retained(), sketch.retained());
+    QCOMPARE(restored.min(), sketch.min());
+    QCOMPARE(restored.max(), sketch.max());
+    for (int percent = 0; percent <= 100; percent += 10) {
+        QCOMPARE(restored.quantile(percent / 100.0), sketch.quantile(percent / 100.0));
+    }
+
+    QuantileSketch merged = restored;
+    merged.merge(sketch);
+    QCOMPARE(merged.count(), qint64(60000));
+    QVERIFY(maxQuantileRankError(merged, 30000) <= MaxRankError);
+}
+
+/**
+ * @brief 截断或无关的数据无法恢复
+ */
+void TestQuantileSketch::rejectsCorruptData()
+{
+    QuantileSketch sketch(SketchK);
+    for (int i = 0; i < 1000; ++i) {
+        sketch.add(i);
+    }
+    const QByteArray data = sketch.toByteArray();
+
+    bool ok = true;
+    QuantileSketch::fromByteArray(data.left(data.size() / 2), &ok);
+    QVERIFY(!ok);
+    ok = true;
+    QuantileSketch::fromByteArray(QByteArray("not a sketch"), &ok);
+    QVERIFY(!ok);
+}
+
+QTEST_APPLESS_MAIN(TestQuantileSketch)
+
+#include "tst_quantilesketch.moc"
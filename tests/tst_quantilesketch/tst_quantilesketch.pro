@@ -0,0 +1,9 @@
+include(../tests.pri)
+
+TARGET = tst_quantilesketch
+
+INCLUDEPATH += $$LEDGER_SRC/quantilesketch
+
+SOURCES += \
+    tst_quantilesketch.cpp \
+    $$LEDGER_SRC/quantilesketch/quantilesketch.cpp
@@ -0,0 +1,278 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 23:59:50
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 23:59:50
+ * @Description: RecomputeEngine 单元测试：派生列的增量重算、非法输入还原、前置记录与跨币种换算
+ */
+#include <QtTest>
+#include <QSignalSpy>
+#include <QStandardItemModel>
+#include <QTemporaryDir>
+#include <QFile>
+#include "recomputeengine.h"
+#include "exchangerates.h"
+
+namespace {
+
+/**
+ * @brief 测试账本的一行手工录入的数据（单位：分）
+ */
+struct Entry
+{
+    QDate date;
+    qint64 total;
+    qint64 salary;
+    qint64 fixed;
+};
+
+/**
+ * @brief 三行人民币记录，第0行的当月开支手工录入为 FirstExpense
+ */
+const Entry Entries[] = {
+    { QDate(2020, 1, 31), 10000000, 1500000, 2000000 },
+    { QDate(2020, 2, 29), 10300000, 1500000, 2000000 },
+    { QDate(2020, 3, 31), 10500000, 1600000, 3000000 },
+};
+const int EntryCount = int(sizeof(Entries) / sizeof(Entries[0]));
+const qint64 FirstExpense = 700000;
+
+/**
+ * @brief 由 Entries 构造模型，派生列按引擎的公式预先算好
+ */
+void fillModel(QStandardItemModel *model)
+{
+    for (int row = 0; row < EntryCount; ++row) {
+        const Entry &entry = Entries[row];
+        const qint64 expense = row == 0 ? FirstExpense : Entries[row - 1].total + entry.salary - entry.total;
+        LedgerRecord record;
+        record.date = entry.date;
+        const qint64 amounts[LedgerAmountColumnCount] = {
+            entry.total, entry.salary, entry.fixed, expense, entry.salary - expense, entry.total - entry.fixed
+        };
+        for (int i = 0; i < LedgerAmountColumnCount; ++i) {
+            record.amounts[i] = amounts[i];
+            record.presentMask |= quint8(1u << i);
+        }
+        model->appendRow(record.toItems());
+    }
+}
+
+/**
+ * @brief 单元格中的金额（分）
+ */
+qint64 cents(const QStandardItemModel &model, int row, int column)
+{
+    return LedgerRecord::parseCents(model.item(row, column)->text(), nullptr);
+}
+
+/**
+ * @brief 单元格是否可编辑
+ */
+bool editable(const QStandardItemModel &model, int row, int column)
+{
+    return model.item(row, column)->flags() & Qt::ItemIsEditable;
+}
+
+} // namespace
+
+class TestRecomputeEngine : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void derivedColumnsReadOnly();
+    void totalEditRecomputesNextRow();
+    void salaryEditStaysInRow();
+    void invalidEdits_data();
+    void invalidEdits();
+    void leadingRecordDerivesFirstRow();
+    void currencyEditNeedsRate();
+};
+
+/**
+ * @brief 派生列只读；没有前一条记录时第0行的当月开支可以手工录入
+ */
+void TestRecomputeEngine::derivedColumnsReadOnly()
+{
+    QStandardItemModel model;
+    fillModel(&model);
+    RecomputeEngine engine;
+    engine.attach(&model);
+
+    QVERIFY(editable(model, 0, ColExpense));
+    QVERIFY(!editable(model, 1, ColExpense));
+    for (int row = 0; row < EntryCount; ++row) {
+        QVERIFY(editable(model, row, ColTotalDeposit));
+        QVERIFY(!editable(model, row, ColMonthlyDeposit));
+        QVERIFY(!editable(model, row, ColDisposable));
+    }
+}
+
+/**
+ * @brief 修改总存款后本行与下一行的派生列重算，通知的行号只有这两行
+ */
+void TestRecomputeEngine::totalEditRecomputesNextRow()
+{
+    QStandardItemModel model;
+    fillModel(&model);
+    RecomputeEngine engine;
+    engine.attach(&model);
+    QSignalSpy changed(&engine, &RecomputeEngine::rowsChanged);
+
+    const qint64 total = 10200000;
+    model.item(1, ColTotalDeposit)->setText("102000");
+
+    QCOMPARE(model.item(1, ColTotalDeposit)->text(), LedgerRecord::formatCents(total));
+    const qint64 expense = Entries[0].total + Entries[1].salary - total;
+    QCOMPARE(cents(model, 1, ColExpense), expense);
+    QCOMPARE(cents(model, 1, ColMonthlyDeposit), Entries[1].salary - expense);
+    QCOMPARE(cents(model, 1, ColDisposable), total - Entries[1].fixed);
+    const qint64 nextExpense = total + Entries[2].salary - Entries[2].total;
+    QCOMPARE(cents(model, 2, ColExpense), nextExpense);
+    QCOMPARE(cents(model, 2, ColMonthlyDeposit), Entries[2].salary - nextExpense);
+
+    QCOMPARE(changed.count(), 1);
+    QCOMPARE(changed.first().first().value<QList<int>>(), QList<int>() << 1 << 2);
+    QCOMPARE(cents(model, 0, ColExpense), FirstExpense);
+}
+
+/**
+ * @brief 修改工资只影响本行
+ */
+void TestRecomputeEngine::salaryEditStaysInRow()
+{
+    QStandardItemModel model;
+    fillModel(&model);
+    RecomputeEngine engine;
+    engine.attach(&model);
+    QSignalSpy changed(&engine, &RecomputeEngine::rowsChanged);
+    const QString nextExpense = model.item(2, ColExpense)->text();
+
+    model.item(1, ColSalary)->setText("16000");
+
+    const qint64 expense = Entries[0].total + 1600000 - Entries[1].total;
+    QCOMPARE(cents(model, 1, ColExpense), expense);
+    QCOMPARE(cents(model, 1, ColMonthlyDeposit), 1600000 - expense);
+    QCOMPARE(model.item(2, ColExpense)->text(), nextExpense);
+    QCOMPARE(changed.count(), 1);
+    QCOMPARE(changed.first().first().value<QList<int>>(), QList<int>() << 1);
+}
+
+void TestRecomputeEngine::invalidEdits_data()
+{
+    QTest::addColumn<int>("row");
+    QTest::addColumn<int>("column");
+    QTest::addColumn<QString>("text");
+    QTest::newRow("当月开支由上一行推算") << 1 << int(ColExpense) << "1";
+    QTest::newRow("当月可支配额度") << 0 << int(ColDisposable) << "1";
+    QTest::newRow("无效日期") << 1 << int(ColDate) << "abc";
+    QTest::newRow("日期早于上一行") << 1 << int(ColDate) << "2020/01/15";
+    QTest::newRow("日期晚于下一行") << 1 << int(ColDate) << "2020/04/01";
+    QTest::newRow("负数工资") << 1 << int(ColSalary) << "-1";
+    QTest::newRow("总存款为0") << 1 << int(ColTotalDeposit) << "0";
+    QTest::newRow("定期余额大于总存款") << 1 << int(ColFixedDeposit) << "200000";
+    QTest::newRow("币种代码无效") << 1 << int(ColCurrency) << "US";
+    QTest::newRow("缺少汇率") << 1 << int(ColCurrency) << "USD";
+}
+
+/**
+ * @brief 不合法的输入被还原为原值并给出提示，不通知持久化层
+ */
+void TestRecomputeEngine::invalidEdits()
+{
+    QFETCH(int, row);
+    QFETCH(int, column);
+    QFETCH(QString, text);
+
+    QStandardItemModel model;
+    fillModel(&model);
+    RecomputeEngine engine;
+    engine.attach(&model);
+    QSignalSpy changed(&engine, &RecomputeEngine::rowsChanged);
+    QSignalSpy failed(&engine, &RecomputeEngine::validationFailed);
+    const QString before = model.item(row, column)->text();
+
+    model.item(row, column)->setText(text);
+
+    QCOMPARE(model.item(row, column)->text(), before);
+    QCOMPARE(failed.count(), 1);
+    QVERIFY(!failed.first().first().toString().isEmpty());
+    QCOMPARE(changed.count(), 0);
+}
+
+/**
+ * @brief 设置前置记录后第0行的当月开支由前置记录推算，日期须晚于前置记录
+ */
+void TestRecomputeEngine::leadingRecordDerivesFirstRow()
+{
+    QStandardItemModel model;
+    fillModel(&model);
+    RecomputeEngine engine;
+    engine.attach(&model);
+
+    LedgerRecord leading;
+    leading.date = QDate(2019, 12, 31);
+    leading.amounts[0] = 9500000;  // 总存款
+    leading.presentMask = 1u;
+    engine.setLeadingRecord(leading);
+    QVERIFY(engine.hasLeadingRecord());
+    QVERIFY(!editable(model, 0, ColExpense));
+
+    QCOMPARE(engine.recomputeRows(0, EntryCount - 1), QList<int>() << 0);
+    const qint64 expense = leading.amounts[0] + Entries[0].salary - Entries[0].total;
+    QCOMPARE(cents(model, 0, ColExpense), expense);
+    QCOMPARE(cents(model, 0, ColMonthlyDeposit), Entries[0].salary - expense);
+
+    QSignalSpy failed(&engine, &RecomputeEngine::validationFailed);
+    model.item(0, ColDate)->setText("2019/12/15");
+    QCOMPARE(failed.count(), 1);
+    QCOMPARE(model.item(0, ColDate)->text(), QString("2020/01/31"));
+
+    engine.clearLeadingRecord();
+    QVERIFY(!engine.hasLeadingRecord());
+    QVERIFY(editable(model, 0, ColExpense));
+}
+
+/**
+ * @brief 有汇率时可以修改币种，下一行按汇率换算上一行的总存款后推算当月开支
+ */
+void TestRecomputeEngine::currencyEditNeedsRate()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("ledger.rates.csv");
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Text));
+    file.write("2020/01/01,USD,CNY,7\n");
+    file.close();
+    ExchangeRates rates;
+    QVERIFY(rates.open(path));
+
+    QStandardItemModel model;
+    fillModel(&model);
+    RecomputeEngine engine;
+    engine.setExchangeRates(&rates);
+    engine.attach(&model);
+    QSignalSpy changed(&engine, &RecomputeEngine::rowsChanged);
+    QSignalSpy failed(&engine, &RecomputeEngine::validationFailed);
+
+    model.item(EntryCount - 1, ColCurrency)->setText("usd");
+    QCOMPARE(failed.count(), 0);
+    QCOMPARE(model.item(EntryCount - 1, ColCurrency)->text(), QString("USD"));
+
+    // 上一行 103000.00 元按 1/7 换算为 14714.29 美元
+    const qint64 expense = 1471429 + Entries[2].salary - Entries[2].total;
+    QCOMPARE(cents(model, EntryCount - 1, ColExpense), expense);
+    QCOMPARE(changed.count(), 1);
+    QCOMPARE(changed.first().first().value<QList<int>>(), QList<int>() << EntryCount - 1);
+
+    // 汇率表中没有欧元
+    model.item(1, ColCurrency)->setText("EUR");
+    QCOMPARE(failed.count(), 1);
+    QCOMPARE(model.item(1, ColCurrency)->text(), QString());
+}
+
+QTEST_APPLESS_MAIN(TestRecomputeEngine)
+
+#include "tst_recomputeengine.moc"
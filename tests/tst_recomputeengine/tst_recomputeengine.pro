@@ -0,0 +1,14 @@
+include(../tests.pri)
+
+TARGET = tst_recomputeengine
+
+INCLUDEPATH += $$LEDGER_SRC/recomputeengine $$LEDGER_SRC/exchangerates
+
+HEADERS += \
+    $$LEDGER_SRC/recomputeengine/recomputeengine.h
+
+SOURCES += \
+    tst_recomputeengine.cpp \
+    $$LEDGER_SRC/recomputeengine/recomputeengine.cpp \
+    $$LEDGER_SRC/exchangerates/exchangerates.cpp \
+    $$LEDGER_RECORD_SOURCES
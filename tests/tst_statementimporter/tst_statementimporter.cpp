@@ -0,0 +1,316 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 23:59:30
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 23:59:30
+ * @Description: StatementImporter 单元测试：流水解析与重叠流水的去重
+ */
+#include <QtTest>
+#include <QTemporaryDir>
+#include <QFile>
+#include "statementimporter.h"
+
+namespace {
+
+const char *const Header = "交易日期,金额,摘要\n";
+
+/**
+ * @brief 写入一个流水文件
+ * @param path 文件路径
+ * @param content 文件内容（UTF-8）
+ */
+bool writeStatement(const QString &path, const QByteArray &content)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    return file.write(content) == content.size();
+}
+
+/**
+ * @brief 明细中某日期、金额、备注的笔数
+ */
+int countOf(const TransactionLedger &ledger, const QDate &date, qint64 cents, const QString &note)
+{
+    int count = 0;
+    for (int i = 0; i < ledger.count(); ++i) {
+        const TransactionLedger::Transaction &transaction = ledger.at(i);
+        if (transaction.julianDay == date.toJulianDay() && transaction.cents == cents && ledger.noteText(transaction) == note) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+} // namespace
+
+class TestStatementImporter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void splitRowHandlesQuotes();
+    void fingerprintDependsOnAllFields();
+    void importsAndParsesAmounts();
+    void reimportIsDeduplicated();
+    void overlappingStatements();
+    void repeatedIdenticalRows();
+    void deduplicatesAgainstExistingEntries();
+    void splitDebitCreditColumns();
+    void reportsMappingAndFileErrors();
+
+private:
+    QTemporaryDir *dir = nullptr;   //!< 每个用例独立的临时目录
+    QString ledgerPath;             //!< 收支明细文件路径
+};
+
+void TestStatementImporter::init()
+{
+    dir = new QTemporaryDir();
+    QVERIFY(dir->isValid());
+    ledgerPath = dir->filePath("ledger.tx.csv");
+}
+
+void TestStatementImporter::cleanup()
+{
+    delete dir;
+    dir = nullptr;
+}
+
+/**
+ * @brief 双引号包裹的字段可以包含分隔符，两个双引号表示一个双引号
+ */
+void TestStatementImporter::splitRowHandlesQuotes()
+{
+    QCOMPARE(StatementImporter::splitRow(u"a, \"b,c\" ,\"d\"\"e\",", ','),
+             QStringList() << "a" << "b,c" << "d\"e" << "");
+    QCOMPARE(StatementImporter::splitRow(u"2024-01-02;-12.50;咖啡", ';'),
+             QStringList() << "2024-01-02" << "-12.50" << "咖啡");
+}
+
+/**
+ * @brief 指纹由日期、金额、摘要共同决定
+ */
+void TestStatementImporter::fingerprintDependsOnAllFields()
+{
+    const quint64 base = StatementImporter::fingerprint(2460000, -1250, u"咖啡");
+    QCOMPARE(StatementImporter::fingerprint(2460000, -1250, u"咖啡"), base);
+    QVERIFY(StatementImporter::fingerprint(2460001, -1250, u"咖啡") != base);
+    QVERIFY(StatementImporter::fingerprint(2460000, 1250, u"咖啡") != base);
+    QVERIFY(StatementImporter::fingerprint(2460000, -1250, u"咖啡豆") != base);
+}
+
+/**
+ * @brief 各种日期与金额写法，无法解析或金额为0的行计为格式错误
+ */
+void TestStatementImporter::importsAndParsesAmounts()
+{
+    const QString path = dir->filePath("statement.csv");
+    QVERIFY(writeStatement(path, QByteArray(Header) +
+                           "2024-01-02,-12.50,咖啡\n"
+                           "2024/1/3 10:15:00,\"¥1,234.56\",\"工资, 一月\"\n"
+                           "2024-01-04,(20.00),退款冲正\n"
+                           "\n"
+                           "不是日期,-1.00,无效\n"
+                           "2024-01-05,,空金额\n"
+                           "2024-01-06,0.00,零金额\n"));
+
+    TransactionLedger ledger;
+    QVERIFY(ledger.open(ledgerPath));
+    const StatementImporter::Result result = StatementImporter::importFile(path, StatementImporter::ColumnMapping(), ledger);
+    QVERIFY2(result.ok, qPrintable(result.error));
+    QCOMPARE(result.lines, qint64(6));
+    QCOMPARE(result.imported, qint64(3));
+    QCOMPARE(result.malformed, qint64(3));
+    QCOMPARE(result.duplicates, qint64(0));
+
+    QCOMPARE(ledger.count(), 3);
+    QCOMPARE(countOf(ledger, QDate(2024, 1, 2), -1250, "咖啡"), 1);
+    QCOMPARE(countOf(ledger, QDate(2024, 1, 3), 123456, TransactionLedger::normalizeField("工资, 一月")), 1);
+    QCOMPARE(countOf(ledger, QDate(2024, 1, 4), -2000, "退款冲正"), 1);
+    QCOMPARE(ledger.categoryName(ledger.at(0).category), QString("导入"));
+}
+
+/**
+ * @brief 同一流水再次导入时全部视为重复，重新打开明细文件后仍然如此
+ */
+void TestStatementImporter::reimportIsDeduplicated()
+{
+    const QString path = dir->filePath("statement.csv");
+    QVERIFY(writeStatement(path, QByteArray(Header) +
+                           "2024-02-01,-30.00,\"超市, 日用品\"\n"
+                           "2024-02-02,-8.00,地铁\n"
+                           "2024-02-03,5000.00,工资\n"));
+
+    TransactionLedger ledger;
+    QVERIFY(ledger.open(ledgerPath));
+    QCOMPARE(StatementImporter::importFile(path, StatementImporter::ColumnMapping(), ledger).imported, qint64(3));
+
+    StatementImporter::Result again = StatementImporter::importFile(path, StatementImporter::ColumnMapping(), ledger);
+    QVERIFY(again.ok);
+    QCOMPARE(again.imported, qint64(0));
+    QCOMPARE(again.duplicates, qint64(3));
+
+    TransactionLedger reopened;
+    QVERIFY(reopened.open(ledgerPath));
+    QCOMPARE(reopened.count(), 3);
+    again = StatementImporter::importFile(path, StatementImporter::ColumnMapping(), reopened);
+    QVERIFY(again.ok);
+    QCOMPARE(again.imported, qint64(0));
+    QCOMPARE(again.duplicates, qint64(3));
+    QCOMPARE(reopened.count(), 3);
+}
+
+/**
+ * @brief 时间段重叠的两个月度流水，重叠部分只导入一次
+ */
+void TestStatementImporter::overlappingStatements()
+{
+    const QString january = dir->filePath("january.csv");
+    const QString february = dir->filePath("february.csv");
+    QByteArray first = Header;
+    QByteArray second = Header;
+    for (int day = 1; day <= 40; ++day) {
+        const QDate date = QDate(2024, 1, 1).addDays(day - 1);
+        const QByteArray row = date.toString(Qt::ISODate).toUtf8() + ",-" + QByteArray::number(day) + ".00,消费" +
+                               QByteArray::number(day % 4) + "\n";
+        if (day <= 31) {
+            first += row;
+        }
+        if (day >= 20) {
+            second += row;
+        }
+    }
+    QVERIFY(writeStatement(january, first));
+    QVERIFY(writeStatement(february, second));
+
+    TransactionLedger ledger;
+    QVERIFY(ledger.open(ledgerPath));
+    QCOMPARE(StatementImporter::importFile(january, StatementImporter::ColumnMapping(), ledger).imported, qint64(31));
+    const StatementImporter::Result result = StatementImporter::importFile(february, StatementImporter::ColumnMapping(), ledger);
+    QVERIFY(result.ok);
+    QCOMPARE(result.lines, qint64(21));
+    QCOMPARE(result.duplicates, qint64(12));
+    QCOMPARE(result.imported, qint64(9));
+    QCOMPARE(ledger.count(), 40);
+}
+
+/**
+ * @brief 同一天同金额同摘要的多笔流水都保留；再次导入时只新增多出来的那几笔
+ */
+void TestStatementImporter::repeatedIdenticalRows()
+{
+    const QString twice = dir->filePath("twice.csv");
+    const QString thrice = dir->filePath("thrice.csv");
+    const QByteArray row = "2024-03-08,-15.00,食堂\n";
+    QVERIFY(writeStatement(twice, QByteArray(Header) + row + row));
+    QVERIFY(writeStatement(thrice, QByteArray(Header) + row + "2024-03-08,-16.00,食堂\n" + row + row));
+
+    TransactionLedger ledger;
+    QVERIFY(ledger.open(ledgerPath));
+    StatementImporter::Result result = StatementImporter::importFile(twice, StatementImporter::ColumnMapping(), ledger);
+    QCOMPARE(result.imported, qint64(2));
+    QCOMPARE(result.duplicates, qint64(0));
+
+    result = StatementImporter::importFile(thrice, StatementImporter::ColumnMapping(), ledger);
+    QVERIFY(result.ok);
+    QCOMPARE(result.duplicates, qint64(2));
+    QCOMPARE(result.imported, qint64(2));
+    QCOMPARE(countOf(ledger, QDate(2024, 3, 8), -1500, "食堂"), 3);
+    QCOMPARE(countOf(ledger, QDate(2024, 3, 8), -1600, "食堂"), 1);
+}
+
+/**
+ * @brief 手工录入过的明细与流水中的同一笔交易视为重复
+ */
+void TestStatementImporter::deduplicatesAgainstExistingEntries()
+{
+    TransactionLedger ledger;
+    QVERIFY(ledger.open(ledgerPath));
+    QVERIFY(ledger.add(QDate(2024, 4, 1), "餐饮", -4500, "  晚餐  "));
+    QVERIFY(ledger.add(QDate(2024, 4, 2), "交通", -300, "公交"));
+
+    const QString path = dir->filePath("statement.csv");
+    QVERIFY(writeStatement(path, QByteArray(Header) +
+                           "2024-04-01,-45.00,晚餐\n"
+                           "2024-04-02,-3.00,公交车\n"
+                           "2024-04-03,-3.00,公交\n"));
+    const StatementImporter::Result result = StatementImporter::importFile(path, StatementImporter::ColumnMapping(), ledger);
+    QVERIFY(result.ok);
+    QCOMPARE(result.duplicates, qint64(1));
+    QCOMPARE(result.imported, qint64(2));
+    QCOMPARE(ledger.count(), 4);
+}
+
+/**
+ * @brief 支出、收入分两列的流水，以及分号分隔、自定义日期格式和分类列
+ */
+void TestStatementImporter::splitDebitCreditColumns()
+{
+    const QString path = dir->filePath("statement.csv");
+    QVERIFY(writeStatement(path,
+                           "银行流水\n"
+                           "日期;摘要;支出;收入;类别\n"
+                           "20240501;房租;3000.00;;住房\n"
+                           "20240502;工资;;8000.00;\n"
+                           "20240503;两列都空;;;其他\n"
+                           "2024-05-04;格式不符;10.00;;其他\n"));
+
+    StatementImporter::ColumnMapping mapping;
+    mapping.separator = ';';
+    mapping.headerLines = 2;
+    mapping.dateFormat = "yyyyMMdd";
+    mapping.dateColumn = 0;
+    mapping.descriptionColumn = 1;
+    mapping.debitColumn = 2;
+    mapping.creditColumn = 3;
+    mapping.categoryColumn = 4;
+    mapping.defaultCategory = "未分类";
+
+    TransactionLedger ledger;
+    QVERIFY(ledger.open(ledgerPath));
+    const StatementImporter::Result result = StatementImporter::importFile(path, mapping, ledger);
+    QVERIFY2(result.ok, qPrintable(result.error));
+    QCOMPARE(result.lines, qint64(4));
+    QCOMPARE(result.imported, qint64(2));
+    QCOMPARE(result.malformed, qint64(2));
+
+    QCOMPARE(ledger.at(0).cents, qint64(-300000));
+    QCOMPARE(ledger.categoryName(ledger.at(0).category), QString("住房"));
+    QCOMPARE(ledger.at(1).cents, qint64(800000));
+    QCOMPARE(ledger.categoryName(ledger.at(1).category), QString("未分类"));
+}
+
+/**
+ * @brief 列映射不完整、文件不存在或编码不支持时导入失败
+ */
+void TestStatementImporter::reportsMappingAndFileErrors()
+{
+    TransactionLedger ledger;
+    QVERIFY(ledger.open(ledgerPath));
+
+    StatementImporter::ColumnMapping mapping;
+    mapping.amountColumn = -1;
+    StatementImporter::Result result = StatementImporter::importFile(dir->filePath("statement.csv"), mapping, ledger);
+    QVERIFY(!result.ok);
+    QVERIFY(!result.error.isEmpty());
+
+    result = StatementImporter::importFile(dir->filePath("missing.csv"), StatementImporter::ColumnMapping(), ledger);
+    QVERIFY(!result.ok);
+
+    const QString path = dir->filePath("statement.csv");
+    QVERIFY(writeStatement(path, QByteArray(Header) + "2024-06-01,-1.00,测试\n"));
+    mapping = StatementImporter::ColumnMapping();
+    mapping.encoding = "no-such-encoding";
+    result = StatementImporter::importFile(path, mapping, ledger);
+    QVERIFY(!result.ok);
+    QCOMPARE(ledger.count(), 0);
+}
+
+QTEST_APPLESS_MAIN(TestStatementImporter)
+
+#include "tst_statementimporter.moc"
@@ -0,0 +1,12 @@
+include(../tests.pri)
+
+TARGET = tst_statementimporter
+
+INCLUDEPATH += $$LEDGER_SRC/statementimporter $$LEDGER_SRC/transactionledger $$LEDGER_SRC/quantilesketch
+
+SOURCES += \
+    tst_statementimporter.cpp \
+    $$LEDGER_SRC/statementimporter/statementimporter.cpp \
+    $$LEDGER_SRC/transactionledger/transactionledger.cpp \
+    $$LEDGER_SRC/quantilesketch/quantilesketch.cpp \
+    $$LEDGER_RECORD_SOURCES
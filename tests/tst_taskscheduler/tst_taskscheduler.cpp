@@ -0,0 +1,188 @@
+/*
+ * @Author: yu.wang
+ * @Date: 2026-10-19 23:59:20
+ * @LastEditors: yu.wang
+ * @LastEditTime: 2026-10-19 23:59:20
+ * @Description: TaskScheduler 单元测试：交付、按键取代与取消、批量汇总、优先级
+ */
+#include <QtTest>
+#include <QSemaphore>
+#include <QMutex>
+#include <QElapsedTimer>
+#include "taskscheduler.h"
+
+namespace {
+
+const int WaitMs = 5000;    //!< 等待结果交付的上限
+
+/**
+ * @brief 一直运行到被取消（最多 WaitMs 毫秒），模拟耗时的计算
+ * @param started 开始运行时释放一次，测试线程据此确认任务已在执行
+ */
+int runUntilCancelled(const TaskScheduler::CancellationToken &token, QSemaphore *started, int value)
+{
+    started->release();
+    QElapsedTimer timer;
+    timer.start();
+    while (!token.isCancelled() && timer.elapsed() < WaitMs) {
+        QThread::msleep(1);
+    }
+    return value;
+}
+
+} // namespace
+
+class TestTaskScheduler : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void deliversResult();
+    void newerTaskReplacesOlder();
+    void cancelDropsResult();
+    void batchReducesPartsInOrder();
+    void higherPriorityRunsFirst();
+};
+
+/**
+ * @brief 任务在工作线程中执行，结果回到调度器所在线程交付
+ */
+void TestTaskScheduler::deliversResult()
+{
+    TaskScheduler scheduler(2);
+    QThread *testThread = QThread::currentThread();
+    QThread *workThread = nullptr;
+    QThread *doneThread = nullptr;
+    int delivered = 0;
+    scheduler.submit(QString(), TaskScheduler::Background,
+                     [&workThread](const TaskScheduler::CancellationToken &) {
+                         workThread = QThread::currentThread();
+                         return 42;
+                     },
+                     [&](int value) {
+                         doneThread = QThread::currentThread();
+                         delivered = value;
+                     });
+    QTRY_COMPARE_WITH_TIMEOUT(delivered, 42, WaitMs);
+    QVERIFY(workThread && workThread != testThread);
+    QCOMPARE(doneThread, testThread);
+}
+
+/**
+ * @brief 同一键下提交新任务时，正在执行的旧任务收到取消标记且结果不交付
+ */
+void TestTaskScheduler::newerTaskReplacesOlder()
+{
+    TaskScheduler scheduler(2);
+    QSemaphore started;
+    QList<int> delivered;
+    auto record = [&delivered](int value) { delivered.append(value); };
+
+    scheduler.submit("chart", TaskScheduler::Visible,
+                     [&started](const TaskScheduler::CancellationToken &token) {
+                         return runUntilCancelled(token, &started, 1);
+                     },
+                     record);
+    QVERIFY(started.tryAcquire(1, WaitMs));
+    scheduler.submit("chart", TaskScheduler::Visible,
+                     [](const TaskScheduler::CancellationToken &) { return 2; },
+                     record);
+
+    QTRY_COMPARE_WITH_TIMEOUT(delivered, QList<int>() << 2, WaitMs);
+    QTest::qWait(50);
+    QCOMPARE(delivered, QList<int>() << 2);
+}
+
+/**
+ * @brief cancel 之后任务的结果不再交付
+ */
+void TestTaskScheduler::cancelDropsResult()
+{
+    TaskScheduler scheduler(1);
+    QSemaphore started;
+    bool delivered = false;
+    scheduler.submit("integrity", TaskScheduler::Background,
+                     [&started](const TaskScheduler::CancellationToken &token) {
+                         return runUntilCancelled(token, &started, 1);
+                     },
+                     [&delivered](int) { delivered = true; });
+    QVERIFY(started.tryAcquire(1, WaitMs));
+    scheduler.cancel("integrity");
+
+    // 之后提交的任务交付时，被取消的任务早已结束
+    bool later = false;
+    scheduler.submit(QString(), TaskScheduler::Background,
+                     [](const TaskScheduler::CancellationToken &) { return 0; },
+                     [&later](int) { later = true; });
+    QTRY_VERIFY_WITH_TIMEOUT(later, WaitMs);
+    QVERIFY(!delivered);
+}
+
+/**
+ * @brief 一批子任务分散到各线程执行，汇总时结果按子任务序号排列，只交付一次
+ */
+void TestTaskScheduler::batchReducesPartsInOrder()
+{
+    TaskScheduler scheduler(4);
+    const int count = 64;
+    int deliveries = 0;
+    QVector<qint64> result;
+    scheduler.submitBatch("projection", TaskScheduler::Interactive, count,
+                          [](int index, const TaskScheduler::CancellationToken &) {
+                              return qint64(index) * index;
+                          },
+                          [](const QVector<qint64> &parts, const TaskScheduler::CancellationToken &) {
+                              return parts;
+                          },
+                          [&](const QVector<qint64> &parts) {
+                              ++deliveries;
+                              result = parts;
+                          });
+    QTRY_COMPARE_WITH_TIMEOUT(deliveries, 1, WaitMs);
+    QCOMPARE(int(result.size()), count);
+    for (int i = 0; i < count; ++i) {
+        QCOMPARE(result[i], qint64(i) * i);
+    }
+    QTest::qWait(20);
+    QCOMPARE(deliveries, 1);
+}
+
+/**
+ * @brief 单个工作线程被占用期间排队的任务，高优先级的先执行
+ */
+void TestTaskScheduler::higherPriorityRunsFirst()
+{
+    TaskScheduler scheduler(1);
+    QSemaphore started;
+    QSemaphore gate;
+    QMutex mutex;
+    QStringList order;
+    int finished = 0;
+
+    scheduler.post(QString(), TaskScheduler::Background,
+                   [&](const TaskScheduler::CancellationToken &) {
+                       started.release();
+                       gate.tryAcquire(1, WaitMs);
+                   },
+                   nullptr);
+    QVERIFY(started.tryAcquire(1, WaitMs));
+
+    auto task = [&](const QString &name) {
+        return [&, name](const TaskScheduler::CancellationToken &) {
+            QMutexLocker locker(&mutex);
+            order.append(name);
+        };
+    };
+    auto done = [&finished]() { ++finished; };
+    scheduler.post(QString(), TaskScheduler::Background, task("background"), done);
+    scheduler.post(QString(), TaskScheduler::Visible, task("visible"), done);
+    scheduler.post(QString(), TaskScheduler::Interactive, task("interactive"), done);
+    gate.release();
+
+    QTRY_COMPARE_WITH_TIMEOUT(finished, 3, WaitMs);
+    QCOMPARE(order, QStringList() << "interactive" << "visible" << "background");
+}
+
+QTEST_GUILESS_MAIN(TestTaskScheduler)
+
+#include "tst_taskscheduler.moc"
@@ -0,0 +1,12 @@
+include(../tests.pri)
+
+TARGET = tst_taskscheduler
+
+INCLUDEPATH += $$LEDGER_SRC/taskscheduler
+
+HEADERS += \
+    $$LEDGER_SRC/taskscheduler/taskscheduler.h
+
+SOURCES += \
+    tst_taskscheduler.cpp \
+    $$LEDGER_SRC/taskscheduler/taskscheduler.cpp